@@ -0,0 +1,69 @@
+// Copyright (c) the Dviglo project
+// License: MIT
+
+#pragma once
+
+#include "../common/primitive_types.hpp"
+
+#include <type_traits>
+
+
+namespace dviglo
+{
+
+// Порядковый номер типа компонента. Назначается при первом обращении к component_id<T>()
+using ComponentId = u32;
+
+// Набор типов компонентов (бит с номером ComponentId)
+using ComponentMask = u64;
+
+inline constexpr u32 max_components = 64;
+
+// Маска, которая конфликтует с любой другой (например для систем, которые меняют состояние вне ECS)
+inline constexpr ComponentMask all_components = ~ComponentMask(0);
+
+// Размер и выравнивание типа компонента
+struct ComponentInfo
+{
+    u32 size;
+    u32 align;
+};
+
+namespace ecs_detail
+{
+    // Потокобезопасна
+    ComponentId register_component(u32 size, u32 align);
+}
+
+// Компоненты хранятся в массивах внутри чанков и перемещаются memcpy(),
+// поэтому должны быть тривиально копируемыми (позиции, скорости, указатели на ресурсы и т.д.)
+template <typename T>
+ComponentId component_id()
+{
+    // const T - тот же компонент (системы помечают так компоненты, которые только читают),
+    // поэтому номер регистрируется только для типа без const
+    if constexpr (std::is_const_v<T>)
+    {
+        return component_id<std::remove_const_t<T>>();
+    }
+    else
+    {
+        static_assert(std::is_trivially_copyable_v<T> && std::is_trivially_destructible_v<T>,
+                      "ECS components must be trivially copyable");
+        static_assert(alignof(T) <= 16, "ECS components must not be over-aligned");
+
+        // Инициализация статической переменной потокобезопасна
+        static const ComponentId id = ecs_detail::register_component((u32)sizeof(T), (u32)alignof(T));
+        return id;
+    }
+}
+
+template <typename... Ts>
+ComponentMask component_mask()
+{
+    return (ComponentMask(0) | ... | (ComponentMask(1) << component_id<Ts>()));
+}
+
+const ComponentInfo& get_component_info(ComponentId id);
+
+} // namespace dviglo
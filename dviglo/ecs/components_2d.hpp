@@ -0,0 +1,43 @@
+// Copyright (c) the Dviglo project
+// License: MIT
+
+#pragma once
+
+#include "../gl_utils/texture.hpp"
+#include "../math/rect.hpp"
+
+#include <glm/glm.hpp>
+
+
+namespace dviglo
+{
+
+// Стандартные компоненты для 2D-сцен
+
+// Центр объекта в мировых пикселях
+struct Position2d
+{
+    glm::vec2 value{0.f, 0.f};
+};
+
+struct Velocity2d
+{
+    glm::vec2 value{0.f, 0.f}; // Пикселей в секунду
+};
+
+// Узел в TransformHierarchy. Мировое положение копируется в Position2d функцией copy_world_transforms()
+struct TransformNode2d
+{
+    u32 node = ~0u;
+};
+
+struct Sprite2d
+{
+    Texture* texture = nullptr;
+    Rect source; // Область текстуры в пикселях
+    glm::vec2 size{0.f, 0.f};
+    u32 color = 0xFFFFFFFF; // 0xAABBGGRR
+    f32 rotation = 0.f; // В радианах, по часовой стрелке
+};
+
+} // namespace dviglo
@@ -0,0 +1,92 @@
+// Copyright (c) the Dviglo project
+// License: MIT
+
+#include "sprite_systems.hpp"
+
+using namespace glm;
+using namespace std;
+
+
+namespace dviglo
+{
+
+void move_entities(World& world, f32 time_step, WorkerPool& workers)
+{
+    world.for_each_chunk_parallel<Position2d, const Velocity2d>(workers,
+        [time_step](i32 count, const Entity*, Position2d* positions, const Velocity2d* velocities)
+        {
+            for (i32 i = 0; i < count; ++i)
+                positions[i].value += velocities[i].value * time_step;
+        });
+}
+
+void copy_world_transforms(World& world, const TransformHierarchy& hierarchy)
+{
+    world.for_each_chunk<const TransformNode2d, Position2d>(
+        [&hierarchy](i32 count, const Entity*, const TransformNode2d* nodes, Position2d* positions)
+        {
+            for (i32 i = 0; i < count; ++i)
+                positions[i].value = hierarchy.world_position(nodes[i].node);
+        });
+
+    world.for_each_chunk<const TransformNode2d, Sprite2d>(
+        [&hierarchy](i32 count, const Entity*, const TransformNode2d* nodes, Sprite2d* sprites)
+        {
+            for (i32 i = 0; i < count; ++i)
+                sprites[i].rotation = hierarchy.world(nodes[i].node).rotation();
+        });
+}
+
+void draw_sprites(World& world, SpriteBatch* sprite_batch)
+{
+    world.for_each_chunk<const Position2d, const Sprite2d>(
+        [sprite_batch](i32 count, const Entity*, const Position2d* positions, const Sprite2d* sprites)
+        {
+            for (i32 i = 0; i < count; ++i)
+            {
+                const Sprite2d& sprite = sprites[i];
+
+                if (!sprite.texture)
+                    continue;
+
+                // SpriteBatch сдвигает спрайт на -origin, поэтому позиция становится центром
+                Rect destination(positions[i].value, sprite.size);
+                sprite_batch->draw_sprite(sprite.texture, destination, &sprite.source, sprite.color,
+                                          sprite.rotation, sprite.size * 0.5f);
+            }
+        });
+}
+
+void fill_sprite_set(World& world, SpriteSet* sprite_set)
+{
+    Texture* texture = sprite_set->texture();
+    vector<SpriteInstance>& instances = sprite_set->edit_sprites();
+    instances.clear();
+
+    if (!texture)
+        return;
+
+    vec2 inv_texture_size = 1.f / vec2(texture->size());
+
+    world.for_each_chunk<const Position2d, const Sprite2d>(
+        [&](i32 count, const Entity*, const Position2d* positions, const Sprite2d* sprites)
+        {
+            for (i32 i = 0; i < count; ++i)
+            {
+                const Sprite2d& sprite = sprites[i];
+
+                if (sprite.texture != texture)
+                    continue;
+
+                SpriteInstance& instance = instances.emplace_back();
+                instance.position = positions[i].value;
+                instance.size = sprite.size;
+                instance.uv_min = sprite.source.pos * inv_texture_size;
+                instance.uv_max = (sprite.source.pos + sprite.source.size) * inv_texture_size;
+                instance.color = sprite.color;
+                instance.rotation = sprite.rotation;
+            }
+        });
+}
+
+} // namespace dviglo
@@ -0,0 +1,31 @@
+// Copyright (c) the Dviglo project
+// License: MIT
+
+#pragma once
+
+#include "components_2d.hpp"
+#include "world.hpp"
+
+#include "../graphics/sprite_batch.hpp"
+#include "../graphics/sprite_set.hpp"
+#include "../graphics/transform_hierarchy.hpp"
+
+
+namespace dviglo
+{
+
+// Перемещает сущности с Position2d и Velocity2d. Чанки обрабатываются параллельно потоками workers
+void move_entities(World& world, f32 time_step, WorkerPool& workers);
+
+// Копирует мировое положение и поворот узлов в Position2d и Sprite2d::rotation.
+// hierarchy.update() нужно вызвать заранее
+void copy_world_transforms(World& world, const TransformHierarchy& hierarchy);
+
+// Выводит сущности с Position2d и Sprite2d через SpriteBatch
+void draw_sprites(World& world, SpriteBatch* sprite_batch);
+
+// Заполняет SpriteSet сущностями, у которых Sprite2d::texture совпадает с текстурой набора.
+// Обходит SpriteBatch и подходит для больших однородных наборов (частицы, юниты)
+void fill_sprite_set(World& world, SpriteSet* sprite_set);
+
+} // namespace dviglo
@@ -0,0 +1,88 @@
+// Copyright (c) the Dviglo project
+// License: MIT
+
+#include "system_scheduler.hpp"
+
+#include "../fs/log.hpp"
+
+using namespace std;
+
+
+namespace dviglo
+{
+
+static bool conflict(ComponentMask reads_a, ComponentMask writes_a, ComponentMask reads_b, ComponentMask writes_b)
+{
+    return (writes_a & (reads_b | writes_b)) || (writes_b & reads_a);
+}
+
+SystemScheduler::SystemScheduler(i32 max_threads)
+    : workers_(max_threads)
+{
+}
+
+void SystemScheduler::add(const StrUtf8& name, ComponentMask reads, ComponentMask writes, function<void(World&)> run)
+{
+    if (!run)
+    {
+        DV_LOG->writef_error("{} | !run | {}", DV_FUNCSIG, name);
+        return;
+    }
+
+    System system;
+    system.name = name;
+    system.reads = reads;
+    system.writes = writes;
+    system.run = std::move(run);
+
+    // Стадия после последней конфликтующей системы
+    for (const System& other : systems_)
+    {
+        if (conflict(reads, writes, other.reads, other.writes))
+            system.stage = std::max(system.stage, other.stage + 1);
+    }
+
+    if (system.stage == (i32)stages_.size())
+        stages_.emplace_back();
+
+    stages_[system.stage].push_back((i32)systems_.size());
+    systems_.push_back(std::move(system));
+}
+
+void SystemScheduler::run(World& world)
+{
+    for (const vector<i32>& stage : stages_)
+    {
+        // Стадия из одной системы выполняется в текущем потоке, и пул остаётся свободным для её чанков
+        if (stage.size() == 1)
+        {
+            systems_[stage[0]].run(world);
+            continue;
+        }
+
+        workers_.run((i32)stage.size(), [&](i32 index)
+        {
+            systems_[stage[index]].run(world);
+        });
+    }
+}
+
+void SystemScheduler::log_stages() const
+{
+    for (size_t i = 0; i < stages_.size(); ++i)
+    {
+        StrUtf8 names;
+
+        for (i32 index : stages_[i])
+        {
+            if (!names.empty())
+                names += ", ";
+
+            names += systems_[index].name;
+        }
+
+        DV_LOG->writef_info("ECS stage {} | {}", i, names);
+    }
+}
+
+} // namespace dviglo
@@ -0,0 +1,64 @@
+// Copyright (c) the Dviglo project
+// License: MIT
+
+#pragma once
+
+#include "world.hpp"
+
+#include "../std_utils/string.hpp"
+
+#include <functional>
+#include <vector>
+
+
+namespace dviglo
+{
+
+// Выполняет системы ECS. Каждая система объявляет, какие компоненты читает и какие меняет.
+// Системы разбиваются на стадии: внутри стадии нет двух систем, одна из которых меняет
+// компоненты, которые другая читает или меняет, поэтому системы стадии выполняются параллельно.
+// Стадии выполняются по порядку, а система всегда попадает в стадию после всех конфликтующих
+// с ней систем, добавленных раньше, поэтому результат совпадает с последовательным выполнением
+class SystemScheduler
+{
+private:
+    struct System
+    {
+        StrUtf8 name;
+        ComponentMask reads = 0;
+        ComponentMask writes = 0;
+        std::function<void(World&)> run;
+        i32 stage = 0;
+    };
+
+    std::vector<System> systems_;
+
+    // Индексы систем по стадиям
+    std::vector<std::vector<i32>> stages_;
+
+    // Выполняет системы одной стадии параллельно
+    WorkerPool workers_;
+
+public:
+    // max_threads - сколько потоков (включая вызывающий) выполняют системы.
+    // max_threads <= 0 - по числу ядер
+    explicit SystemScheduler(i32 max_threads = 0);
+
+    // Системы могут передавать пул в World::for_each_chunk_parallel(). Внутри стадии
+    // из нескольких систем пул занят, и чанки обрабатываются в потоке системы
+    WorkerPool& workers() { return workers_; }
+
+    // Порядок добавления определяет порядок выполнения конфликтующих систем.
+    // Системы не должны менять структуру World (создавать и удалять сущности и компоненты)
+    void add(const StrUtf8& name, ComponentMask reads, ComponentMask writes, std::function<void(World&)> run);
+
+    i32 num_systems() const { return (i32)systems_.size(); }
+    i32 num_stages() const { return (i32)stages_.size(); }
+
+    void run(World& world);
+
+    // Выводит в лог разбиение на стадии
+    void log_stages() const;
+};
+
+} // namespace dviglo
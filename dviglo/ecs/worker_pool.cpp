@@ -0,0 +1,113 @@
+// Copyright (c) the Dviglo project
+// License: MIT
+
+#include "worker_pool.hpp"
+
+#include <algorithm> // max
+
+using namespace std;
+
+
+namespace dviglo
+{
+
+WorkerPool::WorkerPool(i32 max_threads)
+{
+    if (max_threads <= 0)
+        max_threads = std::max((i32)thread::hardware_concurrency(), 1);
+
+    // Один из потоков - вызывающий
+    threads_.reserve(max_threads - 1);
+
+    for (i32 i = 0; i < max_threads - 1; ++i)
+        threads_.emplace_back(&WorkerPool::worker_loop, this);
+}
+
+WorkerPool::~WorkerPool()
+{
+    {
+        lock_guard lock(mutex_);
+        stop_ = true;
+    }
+
+    start_cv_.notify_all();
+
+    for (thread& thread : threads_)
+        thread.join();
+}
+
+void WorkerPool::run_tasks()
+{
+    while (true)
+    {
+        i32 index = next_task_.fetch_add(1);
+
+        if (index >= num_tasks_)
+            return;
+
+        (*task_)(index);
+    }
+}
+
+void WorkerPool::worker_loop()
+{
+    u64 generation = 0;
+
+    while (true)
+    {
+        {
+            unique_lock lock(mutex_);
+            start_cv_.wait(lock, [&] { return stop_ || generation_ != generation; });
+
+            if (stop_)
+                return;
+
+            generation = generation_;
+        }
+
+        run_tasks();
+
+        {
+            lock_guard lock(mutex_);
+
+            if (--num_working_ == 0)
+                done_cv_.notify_one();
+        }
+    }
+}
+
+void WorkerPool::run(i32 num_tasks, const function<void(i32)>& task)
+{
+    bool expected = false;
+
+    if (threads_.empty() || num_tasks <= 1 || !busy_.compare_exchange_strong(expected, true))
+    {
+        for (i32 i = 0; i < num_tasks; ++i)
+            task(i);
+
+        return;
+    }
+
+    {
+        lock_guard lock(mutex_);
+        task_ = &task;
+        num_tasks_ = num_tasks;
+        next_task_ = 0;
+        num_working_ = (i32)threads_.size();
+        ++generation_;
+    }
+
+    start_cv_.notify_all();
+    run_tasks();
+
+    // Рабочие потоки не должны обращаться к task_ после выхода из run()
+    {
+        unique_lock lock(mutex_);
+        done_cv_.wait(lock, [&] { return num_working_ == 0; });
+        task_ = nullptr;
+    }
+
+    busy_ = false;
+}
+
+} // namespace dviglo
@@ -0,0 +1,65 @@
+// Copyright (c) the Dviglo project
+// License: MIT
+
+#pragma once
+
+#include "../common/primitive_types.hpp"
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+
+namespace dviglo
+{
+
+// Постоянные рабочие потоки для параллельного выполнения задач ECS.
+// Потоки создаются один раз и ждут работы, поэтому запуск задач не создаёт потоков
+class WorkerPool
+{
+private:
+    std::vector<std::thread> threads_;
+
+    std::mutex mutex_;
+    std::condition_variable start_cv_; // Рабочие потоки ждут новую работу
+    std::condition_variable done_cv_;  // run() ждёт, пока рабочие потоки закончат
+
+    // Текущая работа. Меняется под mutex_
+    const std::function<void(i32)>* task_ = nullptr;
+    i32 num_tasks_ = 0;
+    u64 generation_ = 0; // Увеличивается при каждом запуске работы
+    i32 num_working_ = 0; // Сколько рабочих потоков ещё не закончили текущую работу
+    bool stop_ = false;
+
+    // Номер следующей задачи
+    std::atomic<i32> next_task_ = 0;
+
+    // Выполняется ли работа. Пул выполняет одну работу за раз
+    std::atomic<bool> busy_ = false;
+
+    void worker_loop();
+
+    // Забирает задачи текущей работы, пока они не закончатся
+    void run_tasks();
+
+public:
+    // max_threads - сколько потоков, включая вызывающий, выполняют задачи.
+    // max_threads <= 0 - по числу ядер
+    explicit WorkerPool(i32 max_threads = 0);
+    ~WorkerPool();
+
+    WorkerPool(const WorkerPool&) = delete;
+    WorkerPool& operator=(const WorkerPool&) = delete;
+
+    // Включая вызывающий поток
+    i32 num_threads() const { return (i32)threads_.size() + 1; }
+
+    // Вызывает task(i) для каждого i из [0, num_tasks) и ждёт завершения. Вызывающий поток тоже выполняет задачи.
+    // Если пул уже занят (например, run() вызван из задачи), то задачи выполняются в вызывающем потоке
+    void run(i32 num_tasks, const std::function<void(i32)>& task);
+};
+
+} // namespace dviglo
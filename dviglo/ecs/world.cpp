@@ -0,0 +1,248 @@
+// Copyright (c) the Dviglo project
+// License: MIT
+
+#include "world.hpp"
+
+#include "../fs/log.hpp"
+
+#include <bit> // countr_zero
+#include <cassert>
+#include <cstring> // memcpy
+#include <mutex>
+
+using namespace std;
+
+
+namespace dviglo
+{
+
+static ComponentInfo component_infos[max_components];
+static u32 num_components = 0;
+static mutex component_mutex;
+
+namespace ecs_detail
+{
+
+ComponentId register_component(u32 size, u32 align)
+{
+    lock_guard lock(component_mutex);
+
+    if (num_components == max_components)
+    {
+        DV_LOG->writef_error("{} | num_components == max_components", DV_FUNCSIG);
+        assert(false);
+        return max_components - 1;
+    }
+
+    component_infos[num_components] = {size, align};
+    return num_components++;
+}
+
+} // namespace ecs_detail
+
+const ComponentInfo& get_component_info(ComponentId id)
+{
+    return component_infos[id];
+}
+
+World::World()
+{
+    // Архетип 0 - сущности без компонентов
+    get_archetype(0);
+}
+
+World::~World() = default;
+
+i32 World::get_archetype(ComponentMask mask)
+{
+    auto it = archetype_indices_.find(mask);
+
+    if (it != archetype_indices_.end())
+        return it->second;
+
+    unique_ptr<Archetype> archetype = make_unique<Archetype>();
+    archetype->mask = mask;
+    fill(begin(archetype->offsets), end(archetype->offsets), -1);
+
+    // Байт на строку без учёта выравнивания
+    i32 row_bytes = sizeof(Entity);
+
+    for (ComponentMask bits = mask; bits; bits &= bits - 1)
+        row_bytes += get_component_info(countr_zero(bits)).size;
+
+    // Выравнивание может потребовать до 15 байт на массив
+    i32 padding = popcount(mask) * 15;
+    archetype->chunk_capacity = std::max((chunk_bytes - padding) / row_bytes, 1);
+
+    i32 offset = sizeof(Entity) * archetype->chunk_capacity;
+
+    for (ComponentMask bits = mask; bits; bits &= bits - 1)
+    {
+        ComponentId id = countr_zero(bits);
+        const ComponentInfo& info = get_component_info(id);
+
+        offset = (offset + info.align - 1) / info.align * info.align;
+        archetype->offsets[id] = offset;
+        offset += info.size * archetype->chunk_capacity;
+    }
+
+    // Больше chunk_bytes, только если в чанк не помещается даже одна строка
+    archetype->chunk_size = offset;
+
+    i32 index = (i32)archetypes_.size();
+    archetypes_.push_back(std::move(archetype));
+    archetype_indices_[mask] = index;
+    return index;
+}
+
+void World::append_row(i32 archetype_index, Entity entity)
+{
+    Archetype& archetype = *archetypes_[archetype_index];
+
+    if (archetype.chunks.empty() || archetype.chunks.back().count == archetype.chunk_capacity)
+    {
+        // new выравнивает память по 16 байт, этого достаточно для любого компонента
+        Chunk chunk;
+        chunk.data = make_unique<byte[]>(archetype.chunk_size);
+        archetype.chunks.push_back(std::move(chunk));
+    }
+
+    i32 chunk_index = (i32)archetype.chunks.size() - 1;
+    Chunk& chunk = archetype.chunks.back();
+    i32 row = chunk.count++;
+    chunk_entities(chunk)[row] = entity;
+    ++archetype.num_entities;
+
+    EntitySlot& slot = slots_[entity.index];
+    slot.archetype = archetype_index;
+    slot.chunk = chunk_index;
+    slot.row = row;
+}
+
+void World::remove_row(i32 archetype_index, i32 chunk_index, i32 row)
+{
+    Archetype& archetype = *archetypes_[archetype_index];
+    Chunk& chunk = archetype.chunks[chunk_index];
+    Chunk& last_chunk = archetype.chunks.back();
+    i32 last_row = last_chunk.count - 1;
+
+    if (&chunk != &last_chunk || row != last_row)
+    {
+        Entity moved = chunk_entities(last_chunk)[last_row];
+        chunk_entities(chunk)[row] = moved;
+
+        for (i32 i = 0; i < (i32)max_components; ++i)
+        {
+            i32 offset = archetype.offsets[i];
+
+            if (offset < 0)
+                continue;
+
+            u32 size = get_component_info(i).size;
+            memcpy(chunk.data.get() + offset + size * row, last_chunk.data.get() + offset + size * last_row, size);
+        }
+
+        EntitySlot& slot = slots_[moved.index];
+        slot.chunk = chunk_index;
+        slot.row = row;
+    }
+
+    --last_chunk.count;
+    --archetype.num_entities;
+
+    if (last_chunk.count == 0)
+        archetype.chunks.pop_back();
+}
+
+void World::move_entity(Entity entity, ComponentMask new_mask)
+{
+    EntitySlot old_slot = slots_[entity.index];
+    i32 new_archetype_index = get_archetype(new_mask);
+
+    append_row(new_archetype_index, entity);
+
+    Archetype& old_archetype = *archetypes_[old_slot.archetype];
+    Archetype& new_archetype = *archetypes_[new_archetype_index];
+    const EntitySlot& new_slot = slots_[entity.index];
+
+    Chunk& old_chunk = old_archetype.chunks[old_slot.chunk];
+    Chunk& new_chunk = new_archetype.chunks[new_slot.chunk];
+
+    for (ComponentMask bits = old_archetype.mask & new_mask; bits; bits &= bits - 1)
+    {
+        ComponentId id = countr_zero(bits);
+        u32 size = get_component_info(id).size;
+        memcpy(new_chunk.data.get() + new_archetype.offsets[id] + size * new_slot.row,
+               old_chunk.data.get() + old_archetype.offsets[id] + size * old_slot.row, size);
+    }
+
+    remove_row(old_slot.archetype, old_slot.chunk, old_slot.row);
+}
+
+std::byte* World::get_component_ptr(Entity entity, ComponentId id)
+{
+    if (!alive(entity))
+        return nullptr;
+
+    const EntitySlot& slot = slots_[entity.index];
+    Archetype& archetype = *archetypes_[slot.archetype];
+    i32 offset = archetype.offsets[id];
+
+    if (offset < 0)
+        return nullptr;
+
+    return archetype.chunks[slot.chunk].data.get() + offset + get_component_info(id).size * slot.row;
+}
+
+Entity World::create()
+{
+    Entity entity;
+
+    if (free_slots_.empty())
+    {
+        entity.index = (u32)slots_.size();
+        slots_.emplace_back();
+    }
+    else
+    {
+        entity.index = free_slots_.back();
+        free_slots_.pop_back();
+    }
+
+    entity.generation = slots_[entity.index].generation;
+    append_row(0, entity);
+    ++num_entities_;
+
+    return entity;
+}
+
+void World::destroy(Entity entity)
+{
+    if (!alive(entity))
+        return;
+
+    EntitySlot& slot = slots_[entity.index];
+    remove_row(slot.archetype, slot.chunk, slot.row);
+
+    slot.archetype = -1;
+    ++slot.generation;
+    free_slots_.push_back(entity.index);
+    --num_entities_;
+}
+
+bool World::alive(Entity entity) const
+{
+    return entity.index < slots_.size()
+        && slots_[entity.index].archetype >= 0
+        && slots_[entity.index].generation == entity.generation;
+}
+
+ComponentMask World::mask(Entity entity) const
+{
+    if (!alive(entity))
+        return 0;
+
+    return archetypes_[slots_[entity.index].archetype]->mask;
+}
+
+} // namespace dviglo
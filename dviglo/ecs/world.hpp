@@ -0,0 +1,235 @@
+// Copyright (c) the Dviglo project
+// License: MIT
+
+#pragma once
+
+#include "component.hpp"
+#include "worker_pool.hpp"
+
+#include <algorithm>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+
+namespace dviglo
+{
+
+// Идентификатор сущности. После уничтожения сущности её индекс используется повторно
+// с другим поколением, поэтому старые идентификаторы становятся недействительными
+struct Entity
+{
+    u32 index = ~0u;
+    u32 generation = 0;
+
+    bool operator==(const Entity&) const = default;
+};
+
+inline constexpr Entity null_entity;
+
+// Хранилище сущностей. Сущности с одинаковым набором компонентов (архетипом) лежат в чанках
+// по chunk_bytes байт, а внутри чанка каждый компонент хранится отдельным массивом (SoA).
+// Запросы перебирают непрерывные массивы, а добавление и удаление компонента переносит
+// одну строку между архетипами. Чанки архетипа, кроме последнего, всегда заполнены.
+// Структурные изменения (создание и удаление сущностей, добавление и удаление компонентов)
+// запрещены во время перебора и в параллельных системах
+class World
+{
+public:
+    inline static constexpr i32 chunk_bytes = 16 * 1024;
+
+private:
+    struct Chunk
+    {
+        std::unique_ptr<std::byte[]> data;
+        i32 count = 0;
+    };
+
+    struct Archetype
+    {
+        ComponentMask mask = 0;
+
+        // Смещение массива компонента в чанке, -1 - компонента нет.
+        // Массив Entity лежит в начале чанка
+        i32 offsets[max_components];
+
+        i32 chunk_capacity = 0;
+        i32 chunk_size = 0;
+        std::vector<Chunk> chunks;
+        i64 num_entities = 0;
+    };
+
+    // Где находится сущность
+    struct EntitySlot
+    {
+        u32 generation = 0;
+        i32 archetype = -1; // -1 - слот свободен
+        i32 chunk = 0;
+        i32 row = 0;
+    };
+
+    std::vector<EntitySlot> slots_;
+    std::vector<u32> free_slots_;
+
+    std::vector<std::unique_ptr<Archetype>> archetypes_;
+    std::unordered_map<ComponentMask, i32> archetype_indices_;
+
+    i64 num_entities_ = 0;
+
+    i32 get_archetype(ComponentMask mask);
+
+    // Выделяет строку в конце архетипа и записывает туда сущность
+    void append_row(i32 archetype_index, Entity entity);
+
+    // Переносит последнюю строку архетипа на место удаляемой
+    void remove_row(i32 archetype_index, i32 chunk_index, i32 row);
+
+    // Переносит сущность в другой архетип, копируя общие компоненты
+    void move_entity(Entity entity, ComponentMask new_mask);
+
+    std::byte* get_component_ptr(Entity entity, ComponentId id);
+
+    static Entity* chunk_entities(Chunk& chunk) { return reinterpret_cast<Entity*>(chunk.data.get()); }
+
+    template <typename T>
+    static T* chunk_array(const Archetype& archetype, Chunk& chunk)
+    {
+        return reinterpret_cast<T*>(chunk.data.get() + archetype.offsets[component_id<T>()]);
+    }
+
+    // Чанки всех архетипов, которые содержат mask
+    template <typename F>
+    void for_each_matching_chunk(ComponentMask mask, F&& f)
+    {
+        for (const std::unique_ptr<Archetype>& archetype : archetypes_)
+        {
+            if ((archetype->mask & mask) != mask)
+                continue;
+
+            for (Chunk& chunk : archetype->chunks)
+            {
+                if (chunk.count > 0)
+                    f(*archetype, chunk);
+            }
+        }
+    }
+
+public:
+    World();
+    ~World();
+
+    World(const World&) = delete;
+    World& operator=(const World&) = delete;
+
+    i64 num_entities() const { return num_entities_; }
+    i32 num_archetypes() const { return (i32)archetypes_.size(); }
+
+    // Создаёт сущность без компонентов
+    Entity create();
+
+    // Создаёт сущность сразу с компонентами, без промежуточных переносов между архетипами
+    template <typename... Ts>
+    Entity create(const Ts&... components)
+    {
+        Entity entity = create();
+
+        if constexpr (sizeof...(Ts) > 0)
+        {
+            move_entity(entity, component_mask<Ts...>());
+            ((*reinterpret_cast<Ts*>(get_component_ptr(entity, component_id<Ts>())) = components), ...);
+        }
+
+        return entity;
+    }
+
+    void destroy(Entity entity);
+    bool alive(Entity entity) const;
+
+    ComponentMask mask(Entity entity) const;
+
+    template <typename T>
+    bool has(Entity entity) const
+    {
+        return mask(entity) & component_mask<T>();
+    }
+
+    // Добавляет компонент или заменяет значение существующего
+    template <typename T>
+    void add(Entity entity, const T& component)
+    {
+        if (!alive(entity))
+            return;
+
+        ComponentMask new_mask = mask(entity) | component_mask<T>();
+
+        if (new_mask != mask(entity))
+            move_entity(entity, new_mask);
+
+        *reinterpret_cast<T*>(get_component_ptr(entity, component_id<T>())) = component;
+    }
+
+    template <typename T>
+    void remove(Entity entity)
+    {
+        if (!has<T>(entity))
+            return;
+
+        move_entity(entity, mask(entity) & ~component_mask<T>());
+    }
+
+    // nullptr, если компонента нет. Указатель действителен до следующего структурного изменения
+    template <typename T>
+    T* get(Entity entity)
+    {
+        return reinterpret_cast<T*>(get_component_ptr(entity, component_id<T>()));
+    }
+
+    // Вызывает f(i32 count, const Entity* entities, Ts*... components) для каждого чанка,
+    // где есть все Ts. Для компонентов, которые система только читает, используйте const T
+    template <typename... Ts, typename F>
+    void for_each_chunk(F&& f)
+    {
+        for_each_matching_chunk(component_mask<Ts...>(), [&](const Archetype& archetype, Chunk& chunk)
+        {
+            f(chunk.count, (const Entity*)chunk_entities(chunk), chunk_array<Ts>(archetype, chunk)...);
+        });
+    }
+
+    // Вызывает f(Entity, Ts&... components) для каждой сущности, где есть все Ts
+    template <typename... Ts, typename F>
+    void for_each(F&& f)
+    {
+        for_each_chunk<Ts...>([&](i32 count, const Entity* entities, Ts*... arrays)
+        {
+            for (i32 i = 0; i < count; ++i)
+                f(entities[i], arrays[i]...);
+        });
+    }
+
+    // Как for_each_chunk(), но чанки распределяются между потоками пула
+    // (например, SystemScheduler::workers())
+    template <typename... Ts, typename F>
+    void for_each_chunk_parallel(WorkerPool& workers, F&& f)
+    {
+        struct Item
+        {
+            const Archetype* archetype;
+            Chunk* chunk;
+        };
+
+        std::vector<Item> items;
+        for_each_matching_chunk(component_mask<Ts...>(), [&](const Archetype& archetype, Chunk& chunk)
+        {
+            items.push_back({&archetype, &chunk});
+        });
+
+        // Каждый чанк - отдельная задача, поэтому свободные потоки забирают оставшиеся чанки
+        workers.run((i32)items.size(), [&](i32 index)
+        {
+            Chunk& chunk = *items[index].chunk;
+            f(chunk.count, (const Entity*)chunk_entities(chunk), chunk_array<Ts>(*items[index].archetype, chunk)...);
+        });
+    }
+};
+
+} // namespace dviglo
@@ -0,0 +1,50 @@
+# Генерирует cpp-файл, в котором файлы из папки INPUT_DIR хранятся в виде массивов байтов.
+# Запуск: cmake -D INPUT_DIR=<папка> -D PREFIX=<префикс путей> -D HEADER=<путь к embedded_files.hpp>
+#               -D OUTPUT=<cpp-файл> -P embed_files.cmake
+
+file(GLOB_RECURSE files LIST_DIRECTORIES false RELATIVE ${INPUT_DIR} ${INPUT_DIR}/*)
+
+# find_embedded_file() использует двоичный поиск
+list(SORT files)
+
+# Регулярное выражение для 32 байтов (CMake не поддерживает квантификатор {n})
+string(REPEAT "0x..," 32 line_regex)
+
+set(arrays "")
+set(entries "")
+set(index 0)
+
+foreach(file ${files})
+    file(READ ${INPUT_DIR}/${file} hex HEX)
+    string(LENGTH "${hex}" hex_length)
+    math(EXPR size "${hex_length} / 2")
+
+    # По 32 байта в строке
+    string(REGEX REPLACE "([0-9a-f][0-9a-f])" "0x\\1," bytes "${hex}")
+    string(REGEX REPLACE "(${line_regex})" "\\1\n    " bytes "${bytes}")
+
+    # Нуль-терминатор не входит в размер, но позволяет использовать текстовые файлы как C-строки
+    string(APPEND arrays "// ${PREFIX}${file}\nalignas(16) static constexpr u8 file_${index}[] =\n{\n    ${bytes}0x00\n};\n\n")
+    string(APPEND entries "    {\"${PREFIX}${file}\", file_${index}, ${size}},\n")
+    math(EXPR index "${index} + 1")
+endforeach()
+
+if(index EQUAL 0)
+    set(body "span<const EmbeddedFile> get_embedded_files()\n{\n    return {};\n}\n")
+else()
+    string(CONCAT body "${arrays}static constexpr EmbeddedFile files[] =\n{\n${entries}};\n\n"
+                       "span<const EmbeddedFile> get_embedded_files()\n{\n    return files;\n}\n")
+endif()
+
+string(CONCAT content
+       "// Сгенерировано embed_files.cmake. Не редактировать\n\n"
+       "#include \"${HEADER}\"\n\n"
+       "using namespace std;\n\n\n"
+       "namespace dviglo\n{\n\n"
+       "${body}"
+       "\n} // namespace dviglo\n")
+
+# Не перезаписываем файл без изменений, чтобы не было лишней перекомпиляции
+file(WRITE ${OUTPUT}.tmp "${content}")
+file(COPY_FILE ${OUTPUT}.tmp ${OUTPUT} ONLY_IF_DIFFERENT)
+file(REMOVE ${OUTPUT}.tmp)
@@ -0,0 +1,49 @@
+// Copyright (c) the Dviglo project
+// License: MIT
+
+#include "embedded_files.hpp"
+
+#include "fs_base.hpp"
+
+#include <algorithm> // lower_bound
+
+using namespace std;
+
+
+namespace dviglo
+{
+
+#ifndef DV_EMBED_ENGINE_DATA
+// Встраивание выключено опцией DV_EMBED_ENGINE_DATA, файлы читаются с диска
+span<const EmbeddedFile> get_embedded_files()
+{
+    return {};
+}
+#endif
+
+const EmbeddedFile* find_embedded_file(StrViewUtf8 path)
+{
+    if (!is_embedded_path(path))
+        return nullptr;
+
+    StrViewUtf8 relative_path = path.substr(embedded_prefix.size());
+    span<const EmbeddedFile> files = get_embedded_files();
+
+    auto it = lower_bound(files.begin(), files.end(), relative_path,
+                          [](const EmbeddedFile& file, StrViewUtf8 value) { return StrViewUtf8(file.path) < value; });
+
+    if (it == files.end() || StrViewUtf8(it->path) != relative_path)
+        return nullptr;
+
+    return &*it;
+}
+
+StrUtf8 to_disk_path(StrViewUtf8 path)
+{
+    if (!is_embedded_path(path))
+        return StrUtf8(path);
+
+    return get_base_path() + StrUtf8(path.substr(embedded_prefix.size()));
+}
+
+} // namespace dviglo
@@ -0,0 +1,45 @@
+// Copyright (c) the Dviglo project
+// License: MIT
+
+// Файлы, встроенные в исполняемый файл при сборке (embed_files.cmake).
+// К ним обращаются по виртуальному пути, например ":/engine_data/shaders/sdf_shape.vert".
+// Функции read_all_text(), read_all_data() и конструктор Image понимают виртуальные пути
+
+#pragma once
+
+#include "../std_utils/string.hpp"
+
+#include <span>
+
+
+namespace dviglo
+{
+
+// Префикс виртуальных путей
+inline constexpr StrViewUtf8 embedded_prefix = ":/";
+
+struct EmbeddedFile
+{
+    const char* path; // Путь без префикса, например "engine_data/shaders/sdf_shape.vert"
+    const u8* data;
+    size_t size;
+};
+
+// Все встроенные файлы, отсортированные по пути.
+// Определение генерируется при сборке
+std::span<const EmbeddedFile> get_embedded_files();
+
+constexpr bool is_embedded_path(StrViewUtf8 path)
+{
+    return path.starts_with(embedded_prefix);
+}
+
+// Ищет встроенный файл по виртуальному пути. Возвращает nullptr, если путь не виртуальный
+// или файл не был встроен при сборке
+const EmbeddedFile* find_embedded_file(StrViewUtf8 path);
+
+// Для виртуального пути возвращает путь к такому же файлу в папке приложения
+// (используется, если файл не встроен), для остальных путей - path без изменений
+StrUtf8 to_disk_path(StrViewUtf8 path);
+
+} // namespace dviglo
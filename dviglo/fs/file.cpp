@@ -3,6 +3,7 @@
 
 #include "file.hpp"
 
+#include "embedded_files.hpp"
 #include "file_base.hpp"
 #include "log.hpp"
 
@@ -15,9 +16,12 @@ namespace dviglo
 // Используем самый быстрый способ: https://insanecoding.blogspot.com/2011/11/how-to-read-in-file-in-c.html
 StrUtf8 read_all_text(const StrUtf8& path)
 {
+    if (const EmbeddedFile* file = find_embedded_file(path))
+        return StrUtf8((const char*)file->data, file->size);
+
     StrUtf8 ret;
 
-    FILE* fp = file_open(path, "rb");
+    FILE* fp = file_open(to_disk_path(path), "rb");
 
     if (!fp)
     {
@@ -38,9 +42,15 @@ StrUtf8 read_all_text(const StrUtf8& path)
 
 vector<byte> read_all_data(const StrUtf8& path)
 {
+    if (const EmbeddedFile* file = find_embedded_file(path))
+    {
+        const byte* data = (const byte*)file->data;
+        return vector<byte>(data, data + file->size);
+    }
+
     vector<byte> ret;
 
-    FILE* fp = file_open(path, "rb");
+    FILE* fp = file_open(to_disk_path(path), "rb");
 
     if (!fp)
     {
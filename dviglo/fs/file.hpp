@@ -9,6 +9,8 @@
 namespace dviglo
 {
 
+// Функции ниже понимают виртуальные пути к встроенным файлам (embedded_files.hpp)
+
 // Читает содержимое всего файла в строку. Файл должен быть в кодировке UTF-8 без BOM
 StrUtf8 read_all_text(const StrUtf8& path);
 
@@ -75,6 +75,10 @@ void Log::write(LogLevel message_type, StrViewUtf8 message)
     if (message_type == LogLevel::none)
         return;
 
+    // localtime() в time_to_str() тоже не потокобезопасна
+    lock_guard<mutex> lock(mutex_);
+    ++num_messages_;
+
     StrUtf8 str = format("[{}] {}: {}\n", time_to_str(), to_string(message_type), message);
     cout << str;
 
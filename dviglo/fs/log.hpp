@@ -5,7 +5,9 @@
 
 #include "../std_utils/string.hpp"
 
+#include <atomic>
 #include <format>
+#include <mutex>
 
 
 namespace dviglo
@@ -29,9 +31,17 @@ private:
 
     FILE* stream_ = nullptr;
 
+    // Лог может использоваться из рабочих потоков
+    std::mutex mutex_;
+
+    // Число записанных сообщений (для оверлея производительности)
+    std::atomic<i64> num_messages_{0};
+
 public:
     static Log* instance() { return instance_; }
 
+    i64 num_messages() const { return num_messages_; }
+
     Log(const StrUtf8& path);
     ~Log();
 
@@ -0,0 +1,44 @@
+// Copyright (c) the Dviglo project
+// License: MIT
+
+#pragma once
+
+#include "../common/primitive_types.hpp"
+
+
+namespace dviglo
+{
+
+// Число вызовов отрисовки и вершин за кадр
+struct DrawCounters
+{
+    i64 draw_calls = 0;
+    i64 vertices = 0;
+};
+
+// Счётчики для оверлея производительности. Используются только в потоке рендеринга
+namespace draw_counters
+{
+    // Текущий кадр
+    inline DrawCounters current;
+
+    // Последний завершённый кадр
+    inline DrawCounters last_frame;
+
+    // Вызывается после каждого вызова отрисовки. Считаются вершины, а не индексы:
+    // четырёхугольник - 4 вершины, экземпляр - вершины одного экземпляра, умноженные на число экземпляров
+    inline void add(i64 num_vertices)
+    {
+        ++current.draw_calls;
+        current.vertices += num_vertices;
+    }
+
+    // Вызывается в Application::main_iterate() после SDL_GL_SwapWindow()
+    inline void end_frame()
+    {
+        last_frame = current;
+        current = DrawCounters();
+    }
+}
+
+} // namespace dviglo
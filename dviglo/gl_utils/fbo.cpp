@@ -3,6 +3,8 @@
 
 #include "fbo.hpp"
 
+#include "gl_debug.hpp"
+
 #include "../fs/log.hpp"
 
 using namespace glm;
@@ -12,7 +14,7 @@ using namespace std;
 namespace dviglo
 {
 
-Fbo::Fbo(ivec2 size)
+Fbo::Fbo(ivec2 size, bool depth)
 {
     glGenFramebuffers(1, &gpu_object_name_);
     glBindFramebuffer(GL_FRAMEBUFFER, gpu_object_name_);
@@ -20,8 +22,41 @@ Fbo::Fbo(ivec2 size)
     texture_ = make_unique<Texture>(size);
     glFramebufferTexture(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, texture_->gpu_object_name(), 0);
 
+    // Текстура уже учтена, но относится к другой категории
+    gpu_memory::track(GpuObjectKind::texture, texture_->gpu_object_name(), GpuMemoryCategory::render_target,
+                      gpu_memory::calc_texture_bytes(size, 4, true));
+
+    if (depth)
+    {
+        glGenRenderbuffers(1, &depth_renderbuffer_);
+        glBindRenderbuffer(GL_RENDERBUFFER, depth_renderbuffer_);
+        glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, size.x, size.y);
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, depth_renderbuffer_);
+
+        gpu_memory::track(GpuObjectKind::renderbuffer, depth_renderbuffer_, GpuMemoryCategory::render_target,
+                          gpu_memory::calc_texture_bytes(size, 4, false));
+    }
+
     if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
-        DV_LOG->writef_error(R"(Fbo::Fbo(ivec2 size) | glCheckFramebufferStatus() returns {})", glCheckFramebufferStatus(GL_FRAMEBUFFER));
+        DV_LOG->writef_error(R"(Fbo::Fbo(ivec2 size, bool depth) | glCheckFramebufferStatus() returns {})", glCheckFramebufferStatus(GL_FRAMEBUFFER));
+
+    set_label("Fbo " + to_string(size.x) + "x" + to_string(size.y));
+}
+
+void Fbo::set_label(StrViewUtf8 label)
+{
+    set_gl_label(GL_FRAMEBUFFER, gpu_object_name_, label);
+
+    if (!gl_debug_enabled())
+        return;
+
+    StrUtf8 str(label);
+
+    if (texture_)
+        texture_->set_label(str + " color");
+
+    set_gl_label(GL_RENDERBUFFER, depth_renderbuffer_, str + " depth");
+    gpu_memory::set_source(GpuObjectKind::renderbuffer, depth_renderbuffer_, str + " depth");
 }
 
 } // namespace dviglo
@@ -20,9 +20,13 @@ private:
 
     std::unique_ptr<Texture> texture_;
 
+    // Буфер глубины и трафарета (может отсутствовать)
+    GLuint depth_renderbuffer_ = 0;
+
 public:
-    // В конструкторе меняется текущий FBO
-    Fbo(glm::ivec2 size);
+    // В конструкторе меняется текущий FBO.
+    // depth - создать буфер глубины, к которому прилагается 8-битный буфер трафарета
+    Fbo(glm::ivec2 size, bool depth = false);
 
     // Запрещаем копировать объект, так как если в одной из копий будет вызван деструктор,
     // все другие объекты будут хранить уничтоженный gpu_object_name_
@@ -33,6 +37,9 @@ public:
     {
         glDeleteFramebuffers(1, &gpu_object_name_); // Проверка на 0 не нужна
         gpu_object_name_ = 0;
+        gpu_memory::untrack(GpuObjectKind::renderbuffer, depth_renderbuffer_);
+        glDeleteRenderbuffers(1, &depth_renderbuffer_);
+        depth_renderbuffer_ = 0;
     }
 
     Texture* texture() const { return texture_.get(); }
@@ -43,6 +50,9 @@ public:
     {
         glBindFramebuffer(GL_FRAMEBUFFER, gpu_object_name_);
     }
+
+    // Имя FBO и его вложений в GPU-профайлерах (см. gl_debug.hpp)
+    void set_label(StrViewUtf8 label);
 };
 
 } // namespace dviglo
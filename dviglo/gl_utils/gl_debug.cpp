@@ -0,0 +1,143 @@
+// Copyright (c) the Dviglo project
+// License: MIT
+
+#include "gl_debug.hpp"
+
+#include "../fs/log.hpp"
+#include "../main/engine_params.hpp"
+
+#include <algorithm> // min
+
+using namespace std;
+
+
+namespace dviglo
+{
+
+static bool enabled = false;
+
+// Максимальная длина имени объекта или группы
+static GLsizei max_label_length = 0;
+
+static const char* source_name(GLenum source)
+{
+    switch (source)
+    {
+    case GL_DEBUG_SOURCE_API:             return "API";
+    case GL_DEBUG_SOURCE_WINDOW_SYSTEM:   return "window system";
+    case GL_DEBUG_SOURCE_SHADER_COMPILER: return "shader compiler";
+    case GL_DEBUG_SOURCE_THIRD_PARTY:     return "third party";
+    case GL_DEBUG_SOURCE_APPLICATION:     return "application";
+    default:                              return "other";
+    }
+}
+
+static const char* type_name(GLenum type)
+{
+    switch (type)
+    {
+    case GL_DEBUG_TYPE_ERROR:               return "error";
+    case GL_DEBUG_TYPE_DEPRECATED_BEHAVIOR: return "deprecated";
+    case GL_DEBUG_TYPE_UNDEFINED_BEHAVIOR:  return "undefined behavior";
+    case GL_DEBUG_TYPE_PORTABILITY:         return "portability";
+    case GL_DEBUG_TYPE_PERFORMANCE:         return "performance";
+    case GL_DEBUG_TYPE_MARKER:              return "marker";
+    default:                                return "other";
+    }
+}
+
+static void GLAD_API_PTR debug_callback(GLenum source, GLenum type, GLuint id, GLenum severity,
+                                        GLsizei length, const GLchar* message, const void* user_param)
+{
+    (void)user_param;
+
+    StrViewUtf8 text(message, length);
+
+    switch (severity)
+    {
+    case GL_DEBUG_SEVERITY_HIGH:
+        DV_LOG->writef_error("OpenGL | {} | {} | {} | {}", source_name(source), type_name(type), id, text);
+        break;
+
+    case GL_DEBUG_SEVERITY_MEDIUM:
+        DV_LOG->writef_warning("OpenGL | {} | {} | {} | {}", source_name(source), type_name(type), id, text);
+        break;
+
+    default:
+        // Ошибки и предупреждения о производительности важны при любом уровне важности
+        if (type == GL_DEBUG_TYPE_ERROR || type == GL_DEBUG_TYPE_PERFORMANCE)
+            DV_LOG->writef_warning("OpenGL | {} | {} | {} | {}", source_name(source), type_name(type), id, text);
+        else
+            DV_LOG->writef_info("OpenGL | {} | {} | {} | {}", source_name(source), type_name(type), id, text);
+        break;
+    }
+}
+
+void init_gl_debug()
+{
+    if (!engine_params::gl_debug)
+        return;
+
+    if (!GLAD_GL_KHR_debug)
+    {
+        DV_LOG->write_info("GL_KHR_debug is not supported");
+        return;
+    }
+
+    GLint context_flags = 0;
+    glGetIntegerv(GL_CONTEXT_FLAGS, &context_flags);
+
+    // Без отладочного контекста драйвер может не присылать сообщения, но имена объектов и группы работают
+    if (!(context_flags & GL_CONTEXT_FLAG_DEBUG_BIT))
+        DV_LOG->write_info("OpenGL context is not a debug context");
+
+    glEnable(GL_DEBUG_OUTPUT);
+
+    // Сообщение приходит в том же потоке во время вызова, который его вызвал.
+    // Так проще найти источник ошибки в отладчике
+    glEnable(GL_DEBUG_OUTPUT_SYNCHRONOUS);
+
+    glDebugMessageCallback(debug_callback, nullptr);
+
+    // Уведомления (в том числе о наших же группах) засоряют лог
+    glDebugMessageControl(GL_DONT_CARE, GL_DONT_CARE, GL_DEBUG_SEVERITY_NOTIFICATION, 0, nullptr, GL_FALSE);
+
+    GLint max_length = 0;
+    glGetIntegerv(GL_MAX_LABEL_LENGTH, &max_length);
+    max_label_length = max_length;
+
+    enabled = true;
+    DV_LOG->write_info("GL_KHR_debug enabled");
+}
+
+bool gl_debug_enabled()
+{
+    return enabled;
+}
+
+void set_gl_label(GLenum identifier, GLuint name, StrViewUtf8 label)
+{
+    if (!enabled || !name)
+        return;
+
+    // Длина с учётом нуль-терминатора должна быть меньше GL_MAX_LABEL_LENGTH
+    GLsizei length = std::min((GLsizei)label.size(), max_label_length - 1);
+    glObjectLabel(identifier, name, length, label.data());
+}
+
+void push_gl_debug_group(StrViewUtf8 name)
+{
+    if (!enabled)
+        return;
+
+    GLsizei length = std::min((GLsizei)name.size(), max_label_length - 1);
+    glPushDebugGroup(GL_DEBUG_SOURCE_APPLICATION, 0, length, name.data());
+}
+
+void pop_gl_debug_group()
+{
+    if (enabled)
+        glPopDebugGroup();
+}
+
+} // namespace dviglo
@@ -0,0 +1,44 @@
+// Copyright (c) the Dviglo project
+// License: MIT
+
+// Интеграция с расширением GL_KHR_debug (входит в OpenGL 4.3).
+// Включается параметром engine_params::gl_debug. Если расширение недоступно, то функции ничего не делают
+
+#pragma once
+
+#include "../std_utils/string.hpp"
+
+#include <glad/gl.h>
+
+
+namespace dviglo
+{
+
+// Вызывается после загрузки функций OpenGL.
+// Перенаправляет сообщения драйвера (ошибки, предупреждения о производительности) в лог.
+// Важность сообщения определяет уровень записи в лог, уведомления (GL_DEBUG_SEVERITY_NOTIFICATION) игнорируются
+void init_gl_debug();
+
+// Включено ли GL_KHR_debug
+bool gl_debug_enabled();
+
+// Даёт объекту OpenGL имя, которое видно в сообщениях драйвера и в GPU-профайлерах (RenderDoc, Nsight и т.д.).
+// identifier - GL_TEXTURE, GL_BUFFER, GL_VERTEX_ARRAY, GL_PROGRAM, GL_FRAMEBUFFER, GL_RENDERBUFFER и т.д.
+void set_gl_label(GLenum identifier, GLuint name, StrViewUtf8 label);
+
+// Именованная группа команд в GPU-профайлерах. Группы могут быть вложенными
+void push_gl_debug_group(StrViewUtf8 name);
+void pop_gl_debug_group();
+
+// Группа команд до конца области видимости
+class GlDebugGroup
+{
+public:
+    GlDebugGroup(StrViewUtf8 name) { push_gl_debug_group(name); }
+    ~GlDebugGroup() { pop_gl_debug_group(); }
+
+    GlDebugGroup(const GlDebugGroup&) = delete;
+    GlDebugGroup& operator=(const GlDebugGroup&) = delete;
+};
+
+} // namespace dviglo
@@ -16,4 +16,21 @@ IntRect get_viewport()
     return IntRect(viewport[0], viewport[1], viewport[2], viewport[3]);
 }
 
+static glm::vec2 viewport_scale{1.f, 1.f};
+
+void set_viewport_scale(glm::vec2 scale)
+{
+    viewport_scale = scale;
+}
+
+glm::vec2 get_viewport_scale()
+{
+    return viewport_scale;
+}
+
+glm::vec2 get_logical_viewport_size()
+{
+    return glm::vec2(get_viewport().size) / viewport_scale;
+}
+
 } // namespace dviglo
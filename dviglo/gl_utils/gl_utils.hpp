@@ -42,4 +42,14 @@ inline u32 to_rgba(u8 r, u8 g, u8 b, u8 a)
 // Начало координат в левом нижнем углу
 IntRect get_viewport();
 
+// Масштаб динамического разрешения (см. graphics/dynamic_resolution.hpp): во сколько раз
+// вьюпорт меньше логического размера. SpriteBatch задаёт вершины в логических пикселях,
+// поэтому сцена рисуется в координатах окна при любом масштабе.
+// Масштаб задаётся по каждой оси, так как размер вьюпорта округляется по осям отдельно
+void set_viewport_scale(glm::vec2 scale);
+glm::vec2 get_viewport_scale();
+
+// Размер вьюпорта в логических пикселях
+glm::vec2 get_logical_viewport_size();
+
 }  // namespace dviglo
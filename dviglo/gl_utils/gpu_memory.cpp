@@ -0,0 +1,236 @@
+// Copyright (c) the Dviglo project
+// License: MIT
+
+#include "gpu_memory.hpp"
+
+#include "../fs/log.hpp"
+
+#include <algorithm> // partial_sort
+#include <unordered_map>
+#include <vector>
+
+using namespace glm;
+using namespace std;
+
+
+namespace dviglo
+{
+
+// Зарегистрированный объект
+struct GpuMemoryEntry
+{
+    GpuMemoryCategory category = GpuMemoryCategory::texture;
+    i64 num_bytes = 0;
+    StrUtf8 source;
+};
+
+static constexpr size_t num_categories = (size_t)GpuMemoryCategory::count;
+
+static unordered_map<u64, GpuMemoryEntry> entries;
+
+static i64 used[num_categories]{};
+static i64 peak[num_categories]{};
+static i64 budget[num_categories]{};
+static bool over_budget[num_categories]{};
+
+static i64 total_used = 0;
+static i64 total_peak = 0;
+static i64 total_budget = 0;
+static bool total_over_budget = false;
+
+static i64 total_at_frame_start = 0;
+static i64 frame_delta = 0;
+
+static const char* category_name(GpuMemoryCategory category)
+{
+    switch (category)
+    {
+    case GpuMemoryCategory::texture:       return "textures";
+    case GpuMemoryCategory::render_target: return "render targets";
+    case GpuMemoryCategory::vertex_buffer: return "vertex buffers";
+    case GpuMemoryCategory::index_buffer:  return "index buffers";
+    default:                               return "?";
+    }
+}
+
+static u64 make_key(GpuObjectKind kind, GLuint name)
+{
+    return (u64)kind << 32 | name;
+}
+
+static f64 to_mb(i64 num_bytes)
+{
+    return num_bytes / (1024.0 * 1024.0);
+}
+
+static void check_budgets(GpuMemoryCategory category)
+{
+    size_t index = (size_t)category;
+
+    if (budget[index] > 0)
+    {
+        bool over = used[index] > budget[index];
+
+        if (over && !over_budget[index])
+        {
+            DV_LOG->writef_warning("GPU memory budget exceeded | {} | {:.1f} MB > {:.1f} MB",
+                                   category_name(category), to_mb(used[index]), to_mb(budget[index]));
+        }
+
+        over_budget[index] = over;
+    }
+
+    if (total_budget > 0)
+    {
+        bool over = total_used > total_budget;
+
+        if (over && !total_over_budget)
+            DV_LOG->writef_warning("GPU memory budget exceeded | total | {:.1f} MB > {:.1f} MB", to_mb(total_used), to_mb(total_budget));
+
+        total_over_budget = over;
+    }
+}
+
+static void add_bytes(GpuMemoryCategory category, i64 num_bytes)
+{
+    size_t index = (size_t)category;
+    used[index] += num_bytes;
+    peak[index] = std::max(peak[index], used[index]);
+    total_used += num_bytes;
+    total_peak = std::max(total_peak, total_used);
+}
+
+namespace gpu_memory
+{
+
+void track(GpuObjectKind kind, GLuint name, GpuMemoryCategory category, i64 num_bytes)
+{
+    if (!name && kind != GpuObjectKind::window)
+        return;
+
+    GpuMemoryEntry& entry = entries[make_key(kind, name)];
+
+    // Новая запись создаётся с нулевым размером
+    add_bytes(entry.category, -entry.num_bytes);
+
+    entry.category = category;
+    entry.num_bytes = num_bytes;
+    add_bytes(category, num_bytes);
+
+    check_budgets(category);
+}
+
+void untrack(GpuObjectKind kind, GLuint name)
+{
+    auto it = entries.find(make_key(kind, name));
+
+    if (it == entries.end())
+        return;
+
+    add_bytes(it->second.category, -it->second.num_bytes);
+    check_budgets(it->second.category);
+    entries.erase(it);
+}
+
+void set_source(GpuObjectKind kind, GLuint name, StrViewUtf8 source)
+{
+    auto it = entries.find(make_key(kind, name));
+
+    if (it != entries.end())
+        it->second.source = source;
+}
+
+i64 used_bytes(GpuMemoryCategory category)
+{
+    return used[(size_t)category];
+}
+
+i64 peak_bytes(GpuMemoryCategory category)
+{
+    return peak[(size_t)category];
+}
+
+i64 total_used_bytes()
+{
+    return total_used;
+}
+
+i64 total_peak_bytes()
+{
+    return total_peak;
+}
+
+i64 frame_delta_bytes()
+{
+    return frame_delta;
+}
+
+void end_frame()
+{
+    frame_delta = total_used - total_at_frame_start;
+    total_at_frame_start = total_used;
+}
+
+void set_budget(GpuMemoryCategory category, i64 num_bytes)
+{
+    budget[(size_t)category] = num_bytes;
+    over_budget[(size_t)category] = false;
+    check_budgets(category);
+}
+
+void set_total_budget(i64 num_bytes)
+{
+    total_budget = num_bytes;
+    total_over_budget = false;
+    check_budgets(GpuMemoryCategory::texture);
+}
+
+void log_summary(i32 max_objects)
+{
+    DV_LOG->writef_info("GPU memory | total {:.2f} MB | peak {:.2f} MB | {} objects",
+                        to_mb(total_used), to_mb(total_peak), entries.size());
+
+    for (size_t i = 0; i < num_categories; ++i)
+    {
+        DV_LOG->writef_info("GPU memory | {} | {:.2f} MB | peak {:.2f} MB",
+                            category_name((GpuMemoryCategory)i), to_mb(used[i]), to_mb(peak[i]));
+    }
+
+    vector<const GpuMemoryEntry*> sorted;
+    sorted.reserve(entries.size());
+
+    for (const auto& pair : entries)
+        sorted.push_back(&pair.second);
+
+    size_t count = std::min(sorted.size(), (size_t)std::max(max_objects, 0));
+    partial_sort(sorted.begin(), sorted.begin() + count, sorted.end(),
+                 [](const GpuMemoryEntry* a, const GpuMemoryEntry* b) { return a->num_bytes > b->num_bytes; });
+
+    for (size_t i = 0; i < count; ++i)
+    {
+        const GpuMemoryEntry* entry = sorted[i];
+        DV_LOG->writef_info("GPU memory | {:.2f} MB | {} | {}", to_mb(entry->num_bytes),
+                            category_name(entry->category), entry->source.empty() ? "(no label)" : entry->source);
+    }
+}
+
+i64 calc_texture_bytes(ivec2 size, i32 bytes_per_pixel, bool mipmaps, i32 num_samples)
+{
+    i64 ret = 0;
+
+    while (true)
+    {
+        ret += (i64)size.x * size.y * bytes_per_pixel;
+
+        if (!mipmaps || (size.x <= 1 && size.y <= 1))
+            break;
+
+        size = max(size / 2, ivec2(1));
+    }
+
+    return ret * std::max(num_samples, 1);
+}
+
+} // namespace gpu_memory
+
+} // namespace dviglo
@@ -0,0 +1,73 @@
+// Copyright (c) the Dviglo project
+// License: MIT
+
+#pragma once
+
+#include "../common/primitive_types.hpp"
+#include "../std_utils/string.hpp"
+
+#include <glad/gl.h>
+#include <glm/glm.hpp>
+
+
+namespace dviglo
+{
+
+enum class GpuMemoryCategory : u32
+{
+    texture = 0,
+    render_target, // Вложения FBO и буфер окна
+    vertex_buffer,
+    index_buffer,
+
+    count
+};
+
+// Пространство имён объектов OpenGL (имена текстур и буферов могут совпадать)
+enum class GpuObjectKind : u32
+{
+    texture = 0,
+    buffer,
+    renderbuffer,
+    window, // Буфер окна, имя всегда 0
+};
+
+// Учёт видеопамяти, которую занимают объекты gl_utils. Размеры вычисляются по формату,
+// числу мип-уровней и сэмплов, поэтому это оценка: драйвер может выравнивать и сжимать данные.
+// Объекты определяются по имени OpenGL, а не по адресу, так как Texture и буферы перемещаются.
+// Используется только в потоке рендеринга
+namespace gpu_memory
+{
+    // Регистрирует объект или меняет его размер и категорию
+    void track(GpuObjectKind kind, GLuint name, GpuMemoryCategory category, i64 num_bytes);
+
+    // Вызывается при уничтожении объекта. Незарегистрированные объекты игнорируются
+    void untrack(GpuObjectKind kind, GLuint name);
+
+    // Откуда объект (путь к файлу или имя из set_label()). Используется в log_summary()
+    void set_source(GpuObjectKind kind, GLuint name, StrViewUtf8 source);
+
+    i64 used_bytes(GpuMemoryCategory category);
+    i64 peak_bytes(GpuMemoryCategory category);
+    i64 total_used_bytes();
+    i64 total_peak_bytes();
+
+    // Изменение общего объёма за последний завершённый кадр
+    i64 frame_delta_bytes();
+
+    // Вызывается в Application::main_iterate() после SDL_GL_SwapWindow()
+    void end_frame();
+
+    // При превышении бюджета в лог выводится предупреждение (повторно - только после
+    // возврата в бюджет). 0 - бюджет не задан
+    void set_budget(GpuMemoryCategory category, i64 num_bytes);
+    void set_total_budget(i64 num_bytes);
+
+    // Выводит в лог объём по категориям и самые большие объекты
+    void log_summary(i32 max_objects = 10);
+
+    // Размер текстуры с учётом мип-уровней (уменьшаются вдвое до 1x1) и числа сэмплов
+    i64 calc_texture_bytes(glm::ivec2 size, i32 bytes_per_pixel, bool mipmaps, i32 num_samples = 1);
+}
+
+} // namespace dviglo
@@ -3,6 +3,8 @@
 
 #include "index_buffer.hpp"
 
+#include "gl_debug.hpp"
+
 #include <cassert>
 
 
@@ -23,6 +25,7 @@ IndexBuffer::IndexBuffer(GLsizei num_indices, IndexType type, BufferUsage usage,
 
     GLsizeiptr index_size = (type == IndexType::u16) ? 2 : 4;
     glBufferData(GL_ELEMENT_ARRAY_BUFFER, num_indices * index_size, data, (GLenum)usage);
+    gpu_memory::track(GpuObjectKind::buffer, gpu_object_name_, GpuMemoryCategory::index_buffer, num_indices * index_size);
 
     num_indices_ = num_indices;
     type_ = (GLenum)type;
@@ -33,4 +36,10 @@ void IndexBuffer::bind()
     glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, gpu_object_name_);
 }
 
+void IndexBuffer::set_label(StrViewUtf8 label)
+{
+    set_gl_label(GL_BUFFER, gpu_object_name_, label);
+    gpu_memory::set_source(GpuObjectKind::buffer, gpu_object_name_, label);
+}
+
 } // namespace dviglo
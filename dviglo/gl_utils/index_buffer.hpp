@@ -4,6 +4,9 @@
 #pragma once
 
 #include "gl_common.hpp"
+#include "gpu_memory.hpp"
+
+#include "../std_utils/string.hpp"
 
 #include <utility> // std::exchange()
 
@@ -32,7 +35,10 @@ public:
     ~IndexBuffer()
     {
         if (gpu_object_name_)
+        {
+            gpu_memory::untrack(GpuObjectKind::buffer, gpu_object_name_);
             glDeleteBuffers(1, &gpu_object_name_);
+        }
     }
 
     // Запрещаем копировать объект, так как если в одной из копий будет вызван деструктор,
@@ -61,10 +67,14 @@ public:
         return *this;
     }
 
+    GLuint gpu_object_name() const { return gpu_object_name_; }
     GLsizei num_indices() const { return num_indices_; }
     GLenum type() const { return type_; }
 
     void bind();
+
+    // Имя буфера в GPU-профайлерах (см. gl_debug.hpp)
+    void set_label(StrViewUtf8 label);
 };
 
 } // namespace dviglo
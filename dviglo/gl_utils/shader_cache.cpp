@@ -25,6 +25,41 @@ ShaderProgram* ShaderCache::get(const StrUtf8& vertex_shader_path, const StrUtf8
     return shader_program;
 }
 
+ShaderProgram* ShaderCache::get_compute(const StrUtf8& compute_shader_path)
+{
+    auto it = compute_storage_.find(compute_shader_path);
+
+    if (it != compute_storage_.end())
+        return it->second;
+
+    ShaderProgram* shader_program = new ShaderProgram(compute_shader_path);
+    compute_storage_[compute_shader_path] = shader_program;
+
+    return shader_program;
+}
+
+bool ShaderCache::find_paths(const ShaderProgram* shader_program, StrUtf8* out_vertex_shader_path,
+                             StrUtf8* out_fragment_shader_path, StrUtf8* out_geometry_shader_path) const
+{
+    for (const auto& pair : storage_)
+    {
+        if (pair.second != shader_program)
+            continue;
+
+        const StrUtf8& id = pair.first;
+        size_t first = id.find('*');
+        size_t second = id.find('*', first + 1);
+
+        *out_vertex_shader_path = id.substr(0, first);
+        *out_fragment_shader_path = id.substr(first + 1, second - first - 1);
+        *out_geometry_shader_path = id.substr(second + 1);
+
+        return true;
+    }
+
+    return false;
+}
+
 ShaderCache::ShaderCache()
 {
     assert(!instance_);
@@ -40,6 +75,11 @@ ShaderCache::~ShaderCache()
         delete it.second;
 
     storage_.clear();
+
+    for (auto& it : compute_storage_)
+        delete it.second;
+
+    compute_storage_.clear();
     DV_LOG->write_debug("ShaderCache destructed");
 }
 
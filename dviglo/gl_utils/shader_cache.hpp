@@ -19,8 +19,12 @@ private:
     // Инициализируется в конструкторе
     inline static ShaderCache* instance_ = nullptr;
 
+    // Ключ - пути к шейдерам через '*'
     std::unordered_map<StrUtf8, ShaderProgram*> storage_;
 
+    // Программы из вычислительных шейдеров. Ключ - путь к шейдеру
+    std::unordered_map<StrUtf8, ShaderProgram*> compute_storage_;
+
 public:
     static ShaderCache* instance() { return instance_; }
 
@@ -29,6 +33,14 @@ public:
 
     ShaderProgram* get(const StrUtf8& vertex_shader_path, const StrUtf8& fragment_shader_path,
                        const StrUtf8& geometry_shader_path = StrUtf8());
+
+    // Программа из вычислительного шейдера (OpenGL 4.3)
+    ShaderProgram* get_compute(const StrUtf8& compute_shader_path);
+
+    // Находит пути к шейдерам, из которых была создана программа.
+    // Возвращает false, если программы нет в кэше. Перебирает все программы
+    bool find_paths(const ShaderProgram* shader_program, StrUtf8* out_vertex_shader_path,
+                    StrUtf8* out_fragment_shader_path, StrUtf8* out_geometry_shader_path) const;
 };
 
 #define DV_SHADER_CACHE (dviglo::ShaderCache::instance())
@@ -3,6 +3,8 @@
 
 #include "shader_program.hpp"
 
+#include "gl_debug.hpp"
+
 #include "../fs/file.hpp"
 #include "../fs/log.hpp"
 
@@ -55,6 +57,32 @@ static GLuint compile_shader(const StrUtf8& file_path, GLenum type)
     }
 }
 
+// Проверяет, успешно ли прошла линковка, и выводит лог компоновщика.
+// paths - пути к шейдерам для сообщения в логе
+static bool check_link_status(GLuint gpu_object_name, const StrUtf8& paths)
+{
+    GLint success;
+    glGetProgramiv(gpu_object_name, GL_LINK_STATUS, &success);
+
+    // Компоновщик может выдавать предупреждения, поэтому проверяем лог даже при успешной линковке
+    GLint log_buffer_size; // Длина строки + нуль-терминатор
+    glGetProgramiv(gpu_object_name, GL_INFO_LOG_LENGTH, &log_buffer_size);
+
+    if (log_buffer_size)
+    {
+        StrUtf8 msg(log_buffer_size - 1, '\0');
+        glGetProgramInfoLog(gpu_object_name, log_buffer_size, nullptr, msg.data());
+        trim_end_chars(msg, "\n"); // Удаляем перевод строки в конце
+
+        if (success)
+            DV_LOG->write_warning(paths + " | " + msg);
+        else
+            DV_LOG->write_error(paths + " | " + msg);
+    }
+
+    return success;
+}
+
 ShaderProgram::ShaderProgram(const StrUtf8& vertex_shader_path, const StrUtf8& fragment_shader_path,
                              const StrUtf8& geometry_shader_path)
 {
@@ -95,32 +123,12 @@ ShaderProgram::ShaderProgram(const StrUtf8& vertex_shader_path, const StrUtf8& f
 
     glLinkProgram(gpu_object_name_);
 
-    // Успешно ли прошла линковка
-    GLint success;
-    glGetProgramiv(gpu_object_name_, GL_LINK_STATUS, &success);
+    StrUtf8 paths = vertex_shader_path + " + " + fragment_shader_path;
 
-    // Компоновщик может выдавать предупреждения, поэтому проверяем лог даже при успешной линковке
-    GLint log_buffer_size; // Длина строки + нуль-терминатор
-    glGetProgramiv(gpu_object_name_, GL_INFO_LOG_LENGTH, &log_buffer_size);
-
-    if (log_buffer_size)
-    {
-        StrUtf8 msg(log_buffer_size - 1, '\0');
-        glGetProgramInfoLog(gpu_object_name_, log_buffer_size, nullptr, msg.data());
-        trim_end_chars(msg, "\n"); // Удаляем перевод строки в конце
-
-        StrUtf8 out_message = vertex_shader_path + " + " + fragment_shader_path;
-
-        if (geometry_shader)
-            out_message += " + " + geometry_shader_path;
-
-        out_message += " | " + msg;
+    if (geometry_shader)
+        paths += " + " + geometry_shader_path;
 
-        if (success)
-            DV_LOG->write_warning(out_message);
-        else
-            DV_LOG->write_error(out_message);
-    }
+    bool success = check_link_status(gpu_object_name_, paths);
 
     // Шейдеры после линковки не нужны
     glDeleteShader(vertex_shader);
@@ -131,7 +139,35 @@ ShaderProgram::ShaderProgram(const StrUtf8& vertex_shader_path, const StrUtf8& f
     {
         glDeleteProgram(gpu_object_name_);
         gpu_object_name_ = 0;
+        return;
     }
+
+    if (gl_debug_enabled())
+        set_gl_label(GL_PROGRAM, gpu_object_name_, paths);
+}
+
+ShaderProgram::ShaderProgram(const StrUtf8& compute_shader_path)
+{
+    GLuint compute_shader = compile_shader(compute_shader_path, GL_COMPUTE_SHADER);
+
+    if (!compute_shader)
+        return;
+
+    gpu_object_name_ = glCreateProgram();
+    glAttachShader(gpu_object_name_, compute_shader);
+    glLinkProgram(gpu_object_name_);
+    bool success = check_link_status(gpu_object_name_, compute_shader_path);
+    glDeleteShader(compute_shader);
+
+    if (!success)
+    {
+        glDeleteProgram(gpu_object_name_);
+        gpu_object_name_ = 0;
+        return;
+    }
+
+    if (gl_debug_enabled())
+        set_gl_label(GL_PROGRAM, gpu_object_name_, compute_shader_path);
 }
 
 } // namespace dviglo
@@ -27,6 +27,9 @@ public:
     ShaderProgram(const StrUtf8& vertex_shader_path, const StrUtf8& fragment_shader_path,
                   const StrUtf8& geometry_shader_path = StrUtf8());
 
+    // Вычислительный шейдер (OpenGL 4.3)
+    explicit ShaderProgram(const StrUtf8& compute_shader_path);
+
     ~ShaderProgram()
     {
         glDeleteProgram(gpu_object_name_); // Проверка на 0 не нужна
@@ -52,6 +55,9 @@ public:
         return *this;
     }
 
+    // 0, если программу не удалось собрать
+    GLuint gpu_object_name() const { return gpu_object_name_; }
+
     void use() const
     {
         glUseProgram(gpu_object_name_);
@@ -69,6 +75,12 @@ public:
         glUniform1i(location, value);
     }
 
+    void set(const StrAscii& name, GLfloat value) const
+    {
+        GLint location = glGetUniformLocation(gpu_object_name_, name.c_str());
+        glUniform1f(location, value);
+    }
+
     void set(const StrAscii& name, glm::vec2 value) const
     {
         GLint location = glGetUniformLocation(gpu_object_name_, name.c_str());
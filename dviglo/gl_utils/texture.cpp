@@ -3,6 +3,8 @@
 
 #include "texture.hpp"
 
+#include "gl_debug.hpp"
+
 #include "../fs/log.hpp"
 
 #include <pugixml.hpp>
@@ -18,8 +20,9 @@ namespace dviglo
 {
 
 // Пытается загрузить xml-файл с настройками текстуры.
-// В случае неудачи возвращает дефолтные параметры
-static TextureParams try_load_xml(const StrUtf8& xml_file_path)
+// В случае неудачи возвращает дефолтные параметры.
+// Кроме параметров OpenGL файл может содержать края для draw_nine_slice()
+static TextureParams try_load_xml(const StrUtf8& xml_file_path, NineSliceBorders* out_borders)
 {
     TextureParams ret = Texture::default_params;
 
@@ -77,6 +80,13 @@ static TextureParams try_load_xml(const StrUtf8& xml_file_path)
             else
                 DV_LOG->writef_error(R"(load_xml("{}") | GL_TEXTURE_MAG_FILTER | incorrect value "{}")", xml_file_path, value);
         }
+        else if (key == "nine_slice")
+        {
+            out_borders->left = child.attribute("left").as_float();
+            out_borders->top = child.attribute("top").as_float();
+            out_borders->right = child.attribute("right").as_float();
+            out_borders->bottom = child.attribute("bottom").as_float();
+        }
         else
         {
             DV_LOG->writef_error(R"(load_xml("{}") | incorrect key "{}")", xml_file_path, key);
@@ -117,12 +127,15 @@ Texture::Texture(const StrUtf8& file_path)
 
     size_ = image->size();
     image_ = image;
+    opaque_ = image->is_opaque();
 
     glGenTextures(1, &gpu_object_name_);
     glBindTexture(GL_TEXTURE_2D, gpu_object_name_);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, size_.x, size_.y, 0, img_format, GL_UNSIGNED_BYTE, image->data());
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, size_.x, size_.y, 0, img_format, GL_UNSIGNED_BYTE, image->const_data());
     glGenerateMipmap(GL_TEXTURE_2D);
-    set_params(try_load_xml(file_path + ".xml"));
+    track_memory();
+    set_params(try_load_xml(file_path + ".xml", &nine_slice_borders_));
+    set_label(file_path);
 }
 
 Texture::Texture(ivec2 size)
@@ -132,6 +145,7 @@ Texture::Texture(ivec2 size)
     glBindTexture(GL_TEXTURE_2D, gpu_object_name_);
     glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, size.x, size.y, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
     glGenerateMipmap(GL_TEXTURE_2D);
+    track_memory();
 }
 
 Texture::Texture(const Image& image)
@@ -162,11 +176,13 @@ Texture::Texture(const Image& image)
     }
 
     size_ = image.size();
+    opaque_ = image.is_opaque();
 
     glGenTextures(1, &gpu_object_name_);
     glBindTexture(GL_TEXTURE_2D, gpu_object_name_);
     glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, size_.x, size_.y, 0, img_format, GL_UNSIGNED_BYTE, image.data());
     glGenerateMipmap(GL_TEXTURE_2D);
+    track_memory();
 }
 
 Texture::Texture(shared_ptr<Image> image, bool keep_ptr)
@@ -197,19 +213,34 @@ Texture::Texture(shared_ptr<Image> image, bool keep_ptr)
     }
 
     size_ = image->size();
+    opaque_ = image->is_opaque();
 
     glGenTextures(1, &gpu_object_name_);
     glBindTexture(GL_TEXTURE_2D, gpu_object_name_);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, size_.x, size_.y, 0, img_format, GL_UNSIGNED_BYTE, image->data());
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, size_.x, size_.y, 0, img_format, GL_UNSIGNED_BYTE, image->const_data());
     glGenerateMipmap(GL_TEXTURE_2D);
+    track_memory();
 
     if (keep_ptr)
         image_ = image;
 }
 
+void Texture::set_label(StrViewUtf8 label)
+{
+    set_gl_label(GL_TEXTURE, gpu_object_name_, label);
+    gpu_memory::set_source(GpuObjectKind::texture, gpu_object_name_, label);
+}
+
+void Texture::track_memory()
+{
+    gpu_memory::track(GpuObjectKind::texture, gpu_object_name_, GpuMemoryCategory::texture,
+                      gpu_memory::calc_texture_bytes(size_, 4, true));
+}
+
 void Texture::from_error_image()
 {
     size_ = error_image.size();
+    opaque_ = true;
 
     GLenum img_format = (error_image.num_components() == 3) ? GL_RGB : GL_RGBA;
 
@@ -217,6 +248,7 @@ void Texture::from_error_image()
     glBindTexture(GL_TEXTURE_2D, gpu_object_name_);
     glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, size_.x, size_.y, 0, img_format, GL_UNSIGNED_BYTE, error_image.data());
     glGenerateMipmap(GL_TEXTURE_2D);
+    track_memory();
 }
 
 } // namespace dviglo
@@ -3,6 +3,8 @@
 
 #pragma once
 
+#include "gpu_memory.hpp"
+
 #include "../res/image.hpp"
 
 #include <glad/gl.h>
@@ -19,6 +21,18 @@ struct TextureParams
     GLint mag_filter = GL_LINEAR;
 };
 
+// Ширина неизменяемых краёв для SpriteBatch::draw_nine_slice() в пикселях текстуры.
+// Загружается из файла .xml рядом с текстурой: <nine_slice left="8" top="8" right="8" bottom="8" />
+struct NineSliceBorders
+{
+    f32 left = 0.f;
+    f32 top = 0.f;
+    f32 right = 0.f;
+    f32 bottom = 0.f;
+
+    bool empty() const { return left == 0.f && top == 0.f && right == 0.f && bottom == 0.f; }
+};
+
 class Texture
 {
 private:
@@ -26,9 +40,18 @@ private:
     glm::ivec2 size_;
     std::shared_ptr<Image> image_; // Картинка, из которой была загружена текстура
 
+    // Все пиксели непрозрачны. Вычисляется при загрузке из изображения.
+    // Непрозрачные спрайты SpriteBatch рисует с буфером глубины
+    bool opaque_ = false;
+
+    NineSliceBorders nine_slice_borders_;
+
     // Если что-то пошло не так, то используем шахматную текстуру
     void from_error_image();
 
+    // Регистрирует текстуру в gpu_memory (RGBA8 с мипмапами)
+    void track_memory();
+
 public:
     // Эти параметры используются по умолчанию при создании новой текстуры
     inline static TextureParams default_params;
@@ -53,6 +76,7 @@ public:
 
     ~Texture()
     {
+        gpu_memory::untrack(GpuObjectKind::texture, gpu_object_name_);
         glDeleteTextures(1, &gpu_object_name_); // Проверка на 0 не нужна
     }
 
@@ -66,6 +90,8 @@ public:
     Texture(Texture&& other) noexcept
         : gpu_object_name_(std::exchange(other.gpu_object_name_, 0))
         , size_(std::exchange(other.size_, {}))
+        , opaque_(std::exchange(other.opaque_, false))
+        , nine_slice_borders_(std::exchange(other.nine_slice_borders_, {}))
     {
     }
 
@@ -75,6 +101,8 @@ public:
         {
             gpu_object_name_ = std::exchange(other.gpu_object_name_, 0);
             size_ = std::exchange(other.size_, {});
+            opaque_ = std::exchange(other.opaque_, false);
+            nine_slice_borders_ = std::exchange(other.nine_slice_borders_, {});
         }
 
         return *this;
@@ -85,12 +113,23 @@ public:
     i32 height() const { return size_.y; }
     GLuint gpu_object_name() const { return gpu_object_name_; }
     std::shared_ptr<Image> image() const { return image_; }
+    bool opaque() const { return opaque_; }
+
+    // Позволяет вручную указать, что текстура непрозрачна (или наоборот),
+    // например для текстур, пиксели которых рисуются в шейдере
+    void set_opaque(bool opaque) { opaque_ = opaque; }
+
+    const NineSliceBorders& nine_slice_borders() const { return nine_slice_borders_; }
+    void set_nine_slice_borders(const NineSliceBorders& borders) { nine_slice_borders_ = borders; }
 
     void bind()
     {
         glBindTexture(GL_TEXTURE_2D, gpu_object_name_);
     }
 
+    // Имя текстуры в GPU-профайлерах (см. gl_debug.hpp). Текстуры из файлов получают имя автоматически
+    void set_label(StrViewUtf8 label);
+
     void set_params(const TextureParams& params)
     {
         glBindTexture(GL_TEXTURE_2D, gpu_object_name_);
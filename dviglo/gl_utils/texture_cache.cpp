@@ -56,6 +56,37 @@ std::shared_ptr<Texture> TextureCache::get(const StrUtf8& file_path)
     return texture;
 }
 
+StrUtf8 TextureCache::find_path(const Texture* texture) const
+{
+    for (const auto& pair : umap_storage_)
+    {
+        if (pair.second.get() == texture)
+            return pair.first;
+    }
+
+    return StrUtf8();
+}
+
+// Мипмапы добавляют примерно треть к размеру текстуры
+static i64 estimate_bytes(const Texture* texture)
+{
+    return (i64)texture->width() * texture->height() * 4 * 4 / 3;
+}
+
+void TextureCache::get_usage(i32* out_num_textures, i64* out_num_bytes) const
+{
+    i64 num_bytes = 0;
+
+    for (const auto& pair : umap_storage_)
+        num_bytes += estimate_bytes(pair.second.get());
+
+    for (const shared_ptr<Texture>& texture : vec_storage_)
+        num_bytes += estimate_bytes(texture.get());
+
+    *out_num_textures = (i32)(umap_storage_.size() + vec_storage_.size());
+    *out_num_bytes = num_bytes;
+}
+
 void TextureCache::add(std::shared_ptr<Texture> texture)
 {
     vec_storage_.push_back(texture);
@@ -30,6 +30,14 @@ public:
 
     std::shared_ptr<Texture> get(const StrUtf8& file_path);
 
+    // Возвращает путь, по которому текстура была загружена, или пустую строку,
+    // если текстура не загружалась из файла. Перебирает все текстуры
+    StrUtf8 find_path(const Texture* texture) const;
+
+    // Число текстур в кэше и примерный объём видеопамяти, который они занимают
+    // (RGBA по 8 бит на канал с мипмапами). Перебирает все текстуры
+    void get_usage(i32* out_num_textures, i64* out_num_bytes) const;
+
     // Добавляет текстуру в vec_storage_
     void add(std::shared_ptr<Texture> texture);
 
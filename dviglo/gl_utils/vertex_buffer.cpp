@@ -3,6 +3,9 @@
 
 #include "vertex_buffer.hpp"
 
+#include "gl_debug.hpp"
+#include "gpu_memory.hpp"
+
 
 namespace dviglo
 {
@@ -20,6 +23,15 @@ constexpr GLsizei calc_vertex_size(VertexAttributes vertex_attributes)
     if (!!(vertex_attributes & VertexAttributes::uv))
         ret += 2 * sizeof(f32);
 
+    if (!!(vertex_attributes & VertexAttributes::channel_mask))
+        ret += sizeof(u32);
+
+    if (!!(vertex_attributes & VertexAttributes::params))
+        ret += 4 * sizeof(f32);
+
+    if (!!(vertex_attributes & VertexAttributes::depth))
+        ret += sizeof(f32);
+
     return ret;
 }
 
@@ -53,6 +65,7 @@ void VertexBuffer::create(GLsizei num_vertices, VertexAttributes vertex_attribut
     glGenBuffers(1, &vbo_);
     glBindBuffer(GL_ARRAY_BUFFER, vbo_);
     glBufferData(GL_ARRAY_BUFFER, data_size, data, (GLenum)usage);
+    gpu_memory::track(GpuObjectKind::buffer, vbo_, GpuMemoryCategory::vertex_buffer, data_size);
 
     GLuint attribute_index = 0;
     size_t attribute_offset = 0; // Смещение до атрибута вершины от начала вершины
@@ -87,6 +100,34 @@ void VertexBuffer::create(GLsizei num_vertices, VertexAttributes vertex_attribut
         attribute_offset += 2 * sizeof(f32);
     }
 
+    if (!!(vertex_attributes & VertexAttributes::channel_mask))
+    {
+        // Как и цвет, на стороне GPU маска становится vec4
+        glVertexAttribPointer(attribute_index, 4, GL_UNSIGNED_BYTE, GL_TRUE, stride, (void*)attribute_offset);
+        glEnableVertexAttribArray(attribute_index);
+
+        ++attribute_index;
+        attribute_offset += sizeof(u32);
+    }
+
+    if (!!(vertex_attributes & VertexAttributes::params))
+    {
+        glVertexAttribPointer(attribute_index, 4, GL_FLOAT, GL_FALSE, stride, (void*)attribute_offset);
+        glEnableVertexAttribArray(attribute_index);
+
+        ++attribute_index;
+        attribute_offset += 4 * sizeof(f32);
+    }
+
+    if (!!(vertex_attributes & VertexAttributes::depth))
+    {
+        glVertexAttribPointer(attribute_index, 1, GL_FLOAT, GL_FALSE, stride, (void*)attribute_offset);
+        glEnableVertexAttribArray(attribute_index);
+
+        ++attribute_index;
+        attribute_offset += sizeof(f32);
+    }
+
     capacity_ = num_vertices;
     num_vertices_ = data ? num_vertices : 0;
     vertex_attributes_ = vertex_attributes;
@@ -102,6 +143,7 @@ void VertexBuffer::release()
 {
     if (vbo_)
     {
+        gpu_memory::untrack(GpuObjectKind::buffer, vbo_);
         glDeleteBuffers(1, &vbo_);
         vbo_ = 0;
     }
@@ -131,4 +173,11 @@ void VertexBuffer::bind()
     glBindVertexArray(vao_);
 }
 
+void VertexBuffer::set_label(StrViewUtf8 label)
+{
+    set_gl_label(GL_VERTEX_ARRAY, vao_, label);
+    set_gl_label(GL_BUFFER, vbo_, label);
+    gpu_memory::set_source(GpuObjectKind::buffer, vbo_, label);
+}
+
 } // namespace dviglo
@@ -7,6 +7,7 @@
 
 #include "../common/primitive_types.hpp"
 #include "../std_utils/flags.hpp"
+#include "../std_utils/string.hpp"
 
 #include <utility> // std::exchange()
 
@@ -20,6 +21,9 @@ enum class VertexAttributes : u32
     position = 1 << 0,
     color    = 1 << 1, // 0xAABBGGRR
     uv       = 1 << 2,
+    channel_mask = 1 << 3, // 0xAABBGGRR, 0xFF в выбранном канале текстуры
+    params   = 1 << 4, // vec4, смысл зависит от шейдера
+    depth    = 1 << 5, // f32
 };
 DV_FLAGS(VertexAttributes);
 
@@ -74,6 +78,9 @@ public:
         return *this;
     }
 
+    // Идентификатор буфера (не VAO)
+    GLuint gpu_object_name() const { return vbo_; }
+
     GLsizei num_vertices() const { return num_vertices_; }
     GLsizei capacity() const { return capacity_; }
 
@@ -85,6 +92,9 @@ public:
 
     void release();
     void bind();
+
+    // Имя буфера и VAO в GPU-профайлерах (см. gl_debug.hpp)
+    void set_label(StrViewUtf8 label);
 };
 
 } // namespace dviglo
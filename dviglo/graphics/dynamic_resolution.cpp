@@ -0,0 +1,178 @@
+// Copyright (c) the Dviglo project
+// License: MIT
+
+#include "dynamic_resolution.hpp"
+
+#include "../fs/embedded_files.hpp"
+#include "../gl_utils/draw_counters.hpp"
+#include "../gl_utils/gl_debug.hpp"
+#include "../gl_utils/gl_utils.hpp"
+#include "../gl_utils/shader_cache.hpp"
+#include "../main/engine_params.hpp"
+#include "../main/os_window.hpp"
+#include "../main/timer.hpp"
+
+#include <algorithm> // clamp
+
+using namespace glm;
+using namespace std;
+
+
+namespace dviglo
+{
+
+// Смена масштаба меньше этой величины игнорируется, чтобы размер не менялся каждый кадр
+static constexpr f32 scale_hysteresis = 0.03f;
+
+// Размер области рендеринга округляется до кратного этому числу
+static constexpr i32 size_granularity = 8;
+
+DynamicResolution::DynamicResolution()
+{
+    StrUtf8 shaders_path = StrUtf8(embedded_prefix) + "engine_data/shaders/";
+    upscale_shader_program_ = DV_SHADER_CACHE->get(shaders_path + "fullscreen_triangle.vert",
+                                                   shaders_path + "dynamic_resolution_upscale.frag");
+
+    glGenVertexArrays(1, &vao_);
+    glGenQueries(num_queries, queries_);
+
+    set_gl_label(GL_VERTEX_ARRAY, vao_, "DynamicResolution");
+
+    for (i32 i = 0; i < num_queries; ++i)
+        set_gl_label(GL_QUERY, queries_[i], "DynamicResolution frame time");
+}
+
+DynamicResolution::~DynamicResolution()
+{
+    // Проверка на 0 не нужна
+    glDeleteVertexArrays(1, &vao_);
+    glDeleteQueries(num_queries, queries_);
+}
+
+void DynamicResolution::update_scale(f64 gpu_ms)
+{
+    gpu_frame_ms_ = gpu_frame_ms_ > 0.0 ? gpu_frame_ms_ + (gpu_ms - gpu_frame_ms_) * 0.1 : gpu_ms;
+
+    // Время GPU примерно пропорционально числу пикселей, то есть квадрату масштаба
+    f32 ideal = scale_ * (f32)sqrt(engine_params::target_gpu_frame_ms / gpu_frame_ms_);
+    ideal = std::clamp(ideal, engine_params::min_resolution_scale, 1.f);
+
+    if (abs(ideal - scale_) < scale_hysteresis)
+        return;
+
+    // Движемся к цели постепенно, так как результат запросов запаздывает на несколько кадров
+    scale_ += (ideal - scale_) * 0.5f;
+}
+
+void DynamicResolution::read_queries()
+{
+    while (num_pending_ > 0)
+    {
+        GLuint query = queries_[(next_query_ - num_pending_ + num_queries) % num_queries];
+
+        GLint available = GL_FALSE;
+        glGetQueryObjectiv(query, GL_QUERY_RESULT_AVAILABLE, &available);
+
+        if (!available)
+            break;
+
+        GLuint64 elapsed_ns = 0;
+        glGetQueryObjectui64v(query, GL_QUERY_RESULT, &elapsed_ns);
+        --num_pending_;
+
+        update_scale((f64)elapsed_ns / ns_per_ms);
+    }
+}
+
+void DynamicResolution::begin_frame()
+{
+    read_queries();
+
+    // Свёрнутое окно может иметь нулевой размер
+    ivec2 window_size = max(DV_OS_WINDOW->get_size_in_pixels(), ivec2(1));
+
+    if (window_size != window_size_ || !fbo_)
+    {
+        window_size_ = window_size;
+        // Буфер глубины нужен для SpriteBatch::begin_depth_scene()
+        fbo_ = make_unique<Fbo>(window_size, true);
+        fbo_->set_label("DynamicResolution scene");
+
+        // Мип-уровни не нужны, сцена только растягивается
+        fbo_->texture()->set_params({GL_LINEAR, GL_LINEAR});
+    }
+
+    render_size_ = ivec2(vec2(window_size) * scale_);
+    render_size_ = (render_size_ + size_granularity - 1) / size_granularity * size_granularity;
+    render_size_ = clamp(render_size_, ivec2(1), window_size);
+
+    fbo_->bind();
+    glViewport(0, 0, render_size_.x, render_size_.y);
+    set_viewport_scale(vec2(render_size_) / vec2(window_size));
+
+    // Если все запросы ещё выполняются, этот кадр не замеряем
+    query_active_ = num_pending_ < num_queries;
+
+    if (query_active_)
+        glBeginQuery(GL_TIME_ELAPSED, queries_[next_query_]);
+}
+
+void DynamicResolution::upscale()
+{
+    GlDebugGroup debug_group("DynamicResolution::upscale");
+
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glViewport(0, 0, window_size_.x, window_size_.y);
+    set_viewport_scale(vec2(1.f));
+
+    // Непрозрачный полноэкранный треугольник перезаписывает весь буфер окна.
+    // После него draw_ui() рисует с тем состоянием, которое было задано до upscale()
+    GLboolean blend = glIsEnabled(GL_BLEND);
+    GLboolean depth_test = glIsEnabled(GL_DEPTH_TEST);
+    GLboolean scissor_test = glIsEnabled(GL_SCISSOR_TEST);
+
+    glDisable(GL_BLEND);
+    glDisable(GL_DEPTH_TEST);
+    glDisable(GL_SCISSOR_TEST);
+
+    vec2 texture_size(fbo_->texture()->size());
+
+    upscale_shader_program_->use();
+    upscale_shader_program_->set("u_uv_scale", vec2(render_size_) / texture_size);
+    upscale_shader_program_->set("u_texel_size", 1.f / texture_size);
+    upscale_shader_program_->set("u_uv_min", 0.5f / texture_size);
+    upscale_shader_program_->set("u_uv_max", (vec2(render_size_) - 0.5f) / texture_size);
+    upscale_shader_program_->set("u_sharpness", std::clamp(engine_params::upscale_sharpness, 0.f, 1.f));
+
+    glActiveTexture(GL_TEXTURE0);
+    fbo_->texture()->bind();
+    upscale_shader_program_->set("u_texture", 0);
+
+    glBindVertexArray(vao_);
+    glDrawArrays(GL_TRIANGLES, 0, 3);
+    glBindVertexArray(0);
+
+    draw_counters::add(3);
+
+    if (blend)
+        glEnable(GL_BLEND);
+
+    if (depth_test)
+        glEnable(GL_DEPTH_TEST);
+
+    if (scissor_test)
+        glEnable(GL_SCISSOR_TEST);
+}
+
+void DynamicResolution::end_frame()
+{
+    if (!query_active_)
+        return;
+
+    glEndQuery(GL_TIME_ELAPSED);
+    next_query_ = (next_query_ + 1) % num_queries;
+    ++num_pending_;
+    query_active_ = false;
+}
+
+} // namespace dviglo
@@ -0,0 +1,76 @@
+// Copyright (c) the Dviglo project
+// License: MIT
+
+#pragma once
+
+#include "../gl_utils/fbo.hpp"
+#include "../gl_utils/shader_program.hpp"
+
+#include <memory>
+
+
+namespace dviglo
+{
+
+// Динамическое разрешение (см. engine_params::dynamic_resolution).
+// Сцена рисуется в левый нижний угол FBO размером с окно, а размер этой области
+// подбирается по запросам GL_TIME_ELAPSED так, чтобы время кадра на GPU было близко
+// к engine_params::target_gpu_frame_ms. FBO не пересоздаётся при смене масштаба.
+// Результаты запросов читаются с задержкой в несколько кадров, чтобы не останавливать конвейер
+class DynamicResolution
+{
+private:
+    std::unique_ptr<Fbo> fbo_;
+    ShaderProgram* upscale_shader_program_ = nullptr;
+
+    // Пустой VAO для полноэкранного треугольника
+    GLuint vao_ = 0;
+
+    inline static constexpr i32 num_queries = 4;
+    GLuint queries_[num_queries]{};
+
+    // Запрос, который будет начат в следующем кадре
+    i32 next_query_ = 0;
+
+    // Число запросов, результат которых ещё не прочитан
+    i32 num_pending_ = 0;
+
+    // Запрос начат в текущем кадре
+    bool query_active_ = false;
+
+    // Доля размера окна, в которой рендерится сцена
+    f32 scale_ = 1.f;
+
+    glm::ivec2 window_size_{0, 0};
+    glm::ivec2 render_size_{0, 0};
+
+    // Сглаженное время кадра на GPU
+    f64 gpu_frame_ms_ = 0.0;
+
+    // Читает готовые результаты запросов и обновляет scale_
+    void read_queries();
+
+    void update_scale(f64 gpu_ms);
+
+public:
+    DynamicResolution();
+    ~DynamicResolution();
+
+    DynamicResolution(const DynamicResolution&) = delete;
+    DynamicResolution& operator=(const DynamicResolution&) = delete;
+
+    // Начинает замер времени кадра и делает текущим FBO сцены
+    void begin_frame();
+
+    // Растягивает сцену на окно. После этого текущим становится буфер окна
+    void upscale();
+
+    // Заканчивает замер. Вызывается перед SDL_GL_SwapWindow()
+    void end_frame();
+
+    f32 scale() const { return scale_; }
+    glm::ivec2 render_size() const { return render_size_; }
+    f64 gpu_frame_ms() const { return gpu_frame_ms_; }
+};
+
+} // namespace dviglo
@@ -0,0 +1,311 @@
+// Copyright (c) the Dviglo project
+// License: MIT
+
+#include "light_map.hpp"
+
+#include "../fs/embedded_files.hpp"
+#include "../fs/log.hpp"
+#include "../gl_utils/draw_counters.hpp"
+#include "../gl_utils/gl_debug.hpp"
+#include "../gl_utils/gl_utils.hpp"
+#include "../gl_utils/shader_cache.hpp"
+
+#include <algorithm> // stable_partition
+#include <cstddef> // offsetof
+
+using namespace glm;
+using namespace std;
+
+
+namespace dviglo
+{
+
+LightMap::LightMap(i32 resolution_divisor)
+    : resolution_divisor_(std::max(resolution_divisor, 1))
+{
+    StrUtf8 shaders_path = StrUtf8(embedded_prefix) + "engine_data/shaders/";
+    light_shader_program_ = DV_SHADER_CACHE->get(shaders_path + "light.vert", shaders_path + "light.frag");
+    shadow_shader_program_ = DV_SHADER_CACHE->get(shaders_path + "light_shadow.vert", shaders_path + "light_shadow.frag");
+    composite_shader_program_ = DV_SHADER_CACHE->get(shaders_path + "fullscreen_triangle.vert", shaders_path + "light_composite.frag");
+
+    glGenVertexArrays(1, &light_vao_);
+    glGenBuffers(1, &light_buffer_);
+
+    glBindVertexArray(light_vao_);
+    glBindBuffer(GL_ARRAY_BUFFER, light_buffer_);
+
+    // Все атрибуты относятся к экземпляру, угол четырёхугольника берётся из gl_VertexID
+    for (GLuint i = 0; i <= 3; ++i)
+    {
+        glVertexAttribDivisor(i, 1);
+        glEnableVertexAttribArray(i);
+    }
+
+    bind_light_instances(0);
+
+    glGenVertexArrays(1, &occluder_vao_);
+    glGenBuffers(1, &occluder_vertex_buffer_);
+    glGenBuffers(1, &occluder_index_buffer_);
+
+    glBindVertexArray(occluder_vao_);
+    glBindBuffer(GL_ARRAY_BUFFER, occluder_vertex_buffer_);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, occluder_index_buffer_);
+
+    constexpr GLsizei stride = sizeof(OccluderVertex);
+    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, stride, (void*)offsetof(OccluderVertex, position));
+    glVertexAttribPointer(1, 1, GL_FLOAT, GL_FALSE, stride, (void*)offsetof(OccluderVertex, extrude));
+    glEnableVertexAttribArray(0);
+    glEnableVertexAttribArray(1);
+
+    glBindVertexArray(0);
+
+    glGenVertexArrays(1, &composite_vao_);
+
+    set_gl_label(GL_VERTEX_ARRAY, light_vao_, "LightMap lights");
+    set_gl_label(GL_BUFFER, light_buffer_, "LightMap lights");
+    set_gl_label(GL_VERTEX_ARRAY, occluder_vao_, "LightMap occluders");
+    set_gl_label(GL_BUFFER, occluder_vertex_buffer_, "LightMap occluder vertices");
+    set_gl_label(GL_BUFFER, occluder_index_buffer_, "LightMap occluder indices");
+    set_gl_label(GL_VERTEX_ARRAY, composite_vao_, "LightMap composite");
+}
+
+LightMap::~LightMap()
+{
+    // Проверка на 0 не нужна
+    glDeleteVertexArrays(1, &light_vao_);
+    glDeleteBuffers(1, &light_buffer_);
+    glDeleteVertexArrays(1, &occluder_vao_);
+    glDeleteBuffers(1, &occluder_vertex_buffer_);
+    glDeleteBuffers(1, &occluder_index_buffer_);
+    glDeleteVertexArrays(1, &composite_vao_);
+}
+
+void LightMap::set_ambient_color(u32 color)
+{
+    ambient_color_ = vec4(get_r(color), get_g(color), get_b(color), get_a(color)) / 255.f;
+}
+
+void LightMap::clear_occluders()
+{
+    occluder_vertices_.clear();
+    occluder_indices_.clear();
+    occluders_dirty_ = true;
+}
+
+void LightMap::add_occluder(const vector<vec2>& polygon, bool closed)
+{
+    if (polygon.size() < 2)
+    {
+        DV_LOG->writef_error("{} | polygon.size() < 2", DV_FUNCSIG);
+        return;
+    }
+
+    size_t num_edges = closed ? polygon.size() : polygon.size() - 1;
+
+    for (size_t i = 0; i < num_edges; ++i)
+    {
+        vec2 a = polygon[i];
+        vec2 b = polygon[(i + 1) % polygon.size()];
+        u32 base = (u32)occluder_vertices_.size();
+
+        occluder_vertices_.push_back({a, 0.f});
+        occluder_vertices_.push_back({b, 0.f});
+        occluder_vertices_.push_back({a, 1.f});
+        occluder_vertices_.push_back({b, 1.f});
+
+        // Обход не важен, отсечение граней выключено
+        u32 indices[] = {base, base + 1, base + 2, base + 1, base + 3, base + 2};
+        occluder_indices_.insert(occluder_indices_.end(), begin(indices), end(indices));
+    }
+
+    occluders_dirty_ = true;
+}
+
+void LightMap::upload_occluders()
+{
+    glBindBuffer(GL_ARRAY_BUFFER, occluder_vertex_buffer_);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(OccluderVertex) * occluder_vertices_.size(), occluder_vertices_.data(), GL_STATIC_DRAW);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    // GL_ELEMENT_ARRAY_BUFFER - часть состояния VAO
+    glBindVertexArray(occluder_vao_);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(u32) * occluder_indices_.size(), occluder_indices_.data(), GL_STATIC_DRAW);
+    glBindVertexArray(0);
+
+    occluders_dirty_ = false;
+}
+
+void LightMap::bind_light_instances(i32 first_instance)
+{
+    // Вызывается при привязанных light_vao_ и light_buffer_
+    constexpr GLsizei stride = sizeof(LightInstance);
+    size_t base = sizeof(LightInstance) * first_instance;
+
+    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, stride, (void*)(base + offsetof(LightInstance, position)));
+    glVertexAttribPointer(1, 1, GL_FLOAT, GL_FALSE, stride, (void*)(base + offsetof(LightInstance, radius)));
+    glVertexAttribPointer(2, 1, GL_FLOAT, GL_FALSE, stride, (void*)(base + offsetof(LightInstance, falloff)));
+    glVertexAttribPointer(3, 4, GL_FLOAT, GL_FALSE, stride, (void*)(base + offsetof(LightInstance, color)));
+}
+
+void LightMap::render()
+{
+    GlDebugGroup debug_group("LightMap::render");
+
+    GLint prev_framebuffer;
+    glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &prev_framebuffer);
+    IntRect prev_viewport = get_viewport();
+    logical_size_ = get_logical_viewport_size();
+
+    ivec2 size = max(ivec2(ceil(logical_size_ / (f32)resolution_divisor_)), ivec2(1));
+
+    if (!fbo_ || fbo_->texture()->size() != size)
+    {
+        fbo_ = make_unique<Fbo>(size, true); // Тени используют буфер трафарета
+        fbo_->set_label("LightMap");
+
+        // Карта освещения растягивается при наложении
+        fbo_->texture()->set_params({GL_LINEAR, GL_LINEAR});
+    }
+
+    fbo_->bind();
+    glViewport(0, 0, size.x, size.y);
+
+    GLfloat clear_color[4];
+    glGetFloatv(GL_COLOR_CLEAR_VALUE, clear_color);
+    glClearColor(ambient_color_.x, ambient_color_.y, ambient_color_.z, 1.f);
+    glClear(GL_COLOR_BUFFER_BIT);
+    glClearColor(clear_color[0], clear_color[1], clear_color[2], clear_color[3]);
+
+    if (occluders_dirty_)
+        upload_occluders();
+
+    // Источники без теней идут первыми и рисуются одним вызовом. Порядок источников на результат не влияет
+    auto first_shadowed = stable_partition(lights_.begin(), lights_.end(),
+                                           [](const Light2d& light) { return !light.casts_shadows; });
+    i32 num_unshadowed = (i32)(first_shadowed - lights_.begin());
+
+    instances_.clear();
+
+    for (const Light2d& light : lights_)
+    {
+        vec4 color = vec4(get_r(light.color), get_g(light.color), get_b(light.color), 255.f) * (light.intensity / 255.f);
+        instances_.push_back({light.position, light.radius, light.falloff, color});
+    }
+
+    glDisable(GL_DEPTH_TEST);
+    glDisable(GL_SCISSOR_TEST);
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_ONE, GL_ONE);
+    glBlendEquation(GL_FUNC_ADD);
+
+    vec2 pixel_size(2.f / logical_size_.x, 2.f / logical_size_.y);
+
+    glBindVertexArray(light_vao_);
+    glBindBuffer(GL_ARRAY_BUFFER, light_buffer_);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(LightInstance) * instances_.size(), instances_.data(), GL_STREAM_DRAW);
+    bind_light_instances(0);
+
+    light_shader_program_->use();
+    light_shader_program_->set("u_pixel_size", pixel_size);
+
+    if (num_unshadowed > 0)
+    {
+        glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, num_unshadowed);
+        draw_counters::add((i64)num_unshadowed * 4);
+    }
+
+    if (num_unshadowed < (i32)lights_.size())
+    {
+        glEnable(GL_STENCIL_TEST);
+        glStencilMask(0xFF);
+        glClearStencil(0);
+
+        vec2 to_fbo = vec2(size) / logical_size_;
+
+        for (i32 i = num_unshadowed; i < (i32)lights_.size(); ++i)
+        {
+            const Light2d& light = lights_[i];
+
+            // Стираем трафарет только в области источника
+            ivec2 min_px = clamp(ivec2(floor((light.position - light.radius) * to_fbo)), ivec2(0), size);
+            ivec2 max_px = clamp(ivec2(ceil((light.position + light.radius) * to_fbo)), ivec2(0), size);
+
+            if (min_px.x >= max_px.x || min_px.y >= max_px.y)
+                continue;
+
+            glEnable(GL_SCISSOR_TEST);
+            glScissor(min_px.x, size.y - max_px.y, max_px.x - min_px.x, max_px.y - min_px.y);
+            glClear(GL_STENCIL_BUFFER_BIT);
+
+            if (!occluder_indices_.empty())
+            {
+                // Тени отмечаются в трафарете без записи цвета
+                glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+                glStencilFunc(GL_ALWAYS, 1, 0xFF);
+                glStencilOp(GL_KEEP, GL_KEEP, GL_REPLACE);
+
+                shadow_shader_program_->use();
+                shadow_shader_program_->set("u_pixel_size", pixel_size);
+                shadow_shader_program_->set("u_light_pos", light.position);
+                shadow_shader_program_->set("u_extrude_distance", light.radius * 2.f);
+
+                glBindVertexArray(occluder_vao_);
+                glDrawElements(GL_TRIANGLES, (GLsizei)occluder_indices_.size(), GL_UNSIGNED_INT, nullptr);
+                draw_counters::add((i64)occluder_vertices_.size());
+
+                glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+            }
+
+            glStencilFunc(GL_EQUAL, 0, 0xFF);
+            glStencilOp(GL_KEEP, GL_KEEP, GL_KEEP);
+
+            light_shader_program_->use();
+            light_shader_program_->set("u_pixel_size", pixel_size);
+
+            glBindVertexArray(light_vao_);
+            glBindBuffer(GL_ARRAY_BUFFER, light_buffer_);
+            bind_light_instances(i);
+            glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, 1);
+            draw_counters::add(4);
+        }
+
+        glDisable(GL_SCISSOR_TEST);
+        glDisable(GL_STENCIL_TEST);
+    }
+
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glBindVertexArray(0);
+
+    glBindFramebuffer(GL_FRAMEBUFFER, prev_framebuffer);
+    glViewport(prev_viewport.pos.x, prev_viewport.pos.y, prev_viewport.size.x, prev_viewport.size.y);
+}
+
+void LightMap::composite()
+{
+    if (!fbo_)
+        return;
+
+    GlDebugGroup debug_group("LightMap::composite");
+
+    // Результат = сцена * свет
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_DST_COLOR, GL_ZERO);
+    glBlendEquation(GL_FUNC_ADD);
+    glDisable(GL_DEPTH_TEST);
+    glDisable(GL_SCISSOR_TEST);
+
+    composite_shader_program_->use();
+    composite_shader_program_->set("u_uv_scale", vec2(1.f, 1.f));
+
+    glActiveTexture(GL_TEXTURE0);
+    fbo_->texture()->bind();
+    composite_shader_program_->set("u_texture", 0);
+
+    glBindVertexArray(composite_vao_);
+    glDrawArrays(GL_TRIANGLES, 0, 3);
+    glBindVertexArray(0);
+
+    draw_counters::add(3);
+}
+
+} // namespace dviglo
@@ -0,0 +1,120 @@
+// Copyright (c) the Dviglo project
+// License: MIT
+
+#pragma once
+
+#include "../gl_utils/fbo.hpp"
+#include "../gl_utils/shader_program.hpp"
+
+#include <memory>
+#include <vector>
+
+
+namespace dviglo
+{
+
+// Точечный источник света. Координаты в пикселях SpriteBatch
+struct Light2d
+{
+    glm::vec2 position;
+    f32 radius;
+    u32 color = 0xFFFFFFFF; // 0xAABBGGRR, альфа не используется
+    f32 intensity = 1.f;
+
+    // Степень спада яркости от центра к краю
+    f32 falloff = 2.f;
+
+    // Отбрасывает тени от препятствий (см. LightMap::add_occluder())
+    bool casts_shadows = false;
+};
+
+// Двумерное освещение. Свет накапливается в FBO, который меньше вьюпорта в resolution_divisor раз,
+// а затем одним проходом умножается на уже нарисованную сцену.
+// Источники без теней выводятся одним вызовом инстансинга, поэтому сотни источников
+// стоят почти как один полноэкранный проход в уменьшенном разрешении.
+// Для источника с тенями рёбра препятствий вытягиваются от источника в вершинном шейдере
+// и отмечаются в буфере трафарета, после чего источник рисуется только вне теней.
+// После render() и composite() нужно снова вызвать SpriteBatch::prepare_ogl()
+class LightMap
+{
+private:
+    std::unique_ptr<Fbo> fbo_;
+    i32 resolution_divisor_;
+
+    ShaderProgram* light_shader_program_ = nullptr;
+    ShaderProgram* shadow_shader_program_ = nullptr;
+    ShaderProgram* composite_shader_program_ = nullptr;
+
+    // Источник в буфере экземпляров. Цвет уже умножен на яркость
+    struct LightInstance
+    {
+        glm::vec2 position;
+        f32 radius;
+        f32 falloff;
+        glm::vec4 color;
+    };
+
+    std::vector<Light2d> lights_;
+    std::vector<LightInstance> instances_;
+
+    GLuint light_vao_ = 0;
+    GLuint light_buffer_ = 0;
+
+    // Вершины рёбер препятствий: по 4 на ребро, дальние 2 вытягиваются шейдером
+    struct OccluderVertex
+    {
+        glm::vec2 position;
+        f32 extrude;
+    };
+
+    std::vector<OccluderVertex> occluder_vertices_;
+    std::vector<u32> occluder_indices_;
+    bool occluders_dirty_ = false;
+
+    GLuint occluder_vao_ = 0;
+    GLuint occluder_vertex_buffer_ = 0;
+    GLuint occluder_index_buffer_ = 0;
+
+    // Пустой VAO для полноэкранного треугольника
+    GLuint composite_vao_ = 0;
+
+    glm::vec4 ambient_color_{0.f, 0.f, 0.f, 1.f};
+
+    // Логический размер вьюпорта во время последнего render()
+    glm::vec2 logical_size_{0.f, 0.f};
+
+    void upload_occluders();
+
+    // Указывает атрибутам экземпляров на источник с индексом first_instance
+    void bind_light_instances(i32 first_instance);
+
+public:
+    // resolution_divisor - обычно 2 или 4
+    LightMap(i32 resolution_divisor = 2);
+    ~LightMap();
+
+    LightMap(const LightMap&) = delete;
+    LightMap& operator=(const LightMap&) = delete;
+
+    // Освещённость там, куда не достаёт ни один источник (0xAABBGGRR)
+    void set_ambient_color(u32 color);
+
+    // Источники задаются заново каждый кадр
+    void clear_lights() { lights_.clear(); }
+    void add_light(const Light2d& light) { lights_.push_back(light); }
+
+    // Препятствия хранятся до вызова clear_occluders().
+    // polygon - вершины в пикселях SpriteBatch, closed - соединить последнюю вершину с первой
+    void clear_occluders();
+    void add_occluder(const std::vector<glm::vec2>& polygon, bool closed = true);
+
+    // Рисует свет в FBO. Текущие FBO и вьюпорт восстанавливаются
+    void render();
+
+    // Умножает текущий буфер на карту освещения
+    void composite();
+
+    Texture* texture() const { return fbo_ ? fbo_->texture() : nullptr; }
+};
+
+} // namespace dviglo
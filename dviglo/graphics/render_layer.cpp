@@ -0,0 +1,138 @@
+// Copyright (c) the Dviglo project
+// License: MIT
+
+#include "render_layer.hpp"
+
+#include "../fs/log.hpp"
+#include "../gl_utils/gl_utils.hpp"
+#include "../main/os_window.hpp"
+
+using namespace glm;
+using namespace std;
+
+
+namespace dviglo
+{
+
+RenderLayer::RenderLayer(vec2 size)
+    : size_(size)
+{
+}
+
+RenderLayer::~RenderLayer()
+{
+    // Атлас может быть уже уничтожен при завершении приложения
+    if (allocation_.page >= 0 && DV_RENDER_LAYER_ATLAS)
+        DV_RENDER_LAYER_ATLAS->release(allocation_);
+}
+
+void RenderLayer::set_size(vec2 size)
+{
+    if (size == size_)
+        return;
+
+    size_ = size;
+    valid_ = false;
+}
+
+bool RenderLayer::begin(SpriteBatch* sprite_batch)
+{
+    if (recording_)
+    {
+        DV_LOG->writef_error("{} | recording_", DV_FUNCSIG);
+        return false;
+    }
+
+    // При переносе окна на другой монитор меняется плотность пикселей, а с ней обычно шрифты и раскладка
+    f32 pixel_density = DV_OS_WINDOW->get_pixel_density();
+
+    if (pixel_density != pixel_density_)
+    {
+        pixel_density_ = pixel_density;
+        valid_ = false;
+    }
+
+    if (valid_)
+        return false;
+
+    ivec2 pixel_size = max(ivec2(ceil(size_)), ivec2(1));
+
+    if (allocation_.page < 0 || allocation_.rect.size != pixel_size)
+    {
+        if (allocation_.page >= 0)
+            DV_RENDER_LAYER_ATLAS->release(allocation_);
+
+        allocation_ = DV_RENDER_LAYER_ATLAS->allocate(pixel_size);
+
+        if (allocation_.page < 0)
+            return false;
+    }
+
+    sprite_batch->flush();
+
+    glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &prev_framebuffer_);
+    prev_viewport_ = get_viewport();
+    prev_viewport_scale_ = get_viewport_scale();
+    prev_alpha_blending_ = sprite_batch->alpha_blending();
+    prev_flip_vertically_ = sprite_batch->flip_vertically();
+
+    const IntRect& rect = allocation_.rect;
+    DV_RENDER_LAYER_ATLAS->fbo(allocation_.page)->bind();
+    glViewport(rect.pos.x, rect.pos.y, rect.size.x, rect.size.y);
+    set_viewport_scale(vec2(1.f));
+
+    // glClear() не учитывает вьюпорт, поэтому очищаем только свою область
+    GLfloat clear_color[4];
+    glGetFloatv(GL_COLOR_CLEAR_VALUE, clear_color);
+    glEnable(GL_SCISSOR_TEST);
+    glScissor(rect.pos.x, rect.pos.y, rect.size.x, rect.size.y);
+    glClearColor(0.f, 0.f, 0.f, 0.f);
+    glClear(GL_COLOR_BUFFER_BIT);
+    glClearColor(clear_color[0], clear_color[1], clear_color[2], clear_color[3]);
+    glDisable(GL_SCISSOR_TEST);
+
+    // С вертикальным отражением верх слоя оказывается в строке rect.pos.y,
+    // поэтому при выводе область атласа используется без отражения
+    sprite_batch->prepare_ogl(true, true);
+
+    recording_ = true;
+    return true;
+}
+
+void RenderLayer::end(SpriteBatch* sprite_batch)
+{
+    if (!recording_)
+    {
+        DV_LOG->writef_error("{} | !recording_", DV_FUNCSIG);
+        return;
+    }
+
+    sprite_batch->flush();
+
+    glBindFramebuffer(GL_FRAMEBUFFER, prev_framebuffer_);
+    glViewport(prev_viewport_.pos.x, prev_viewport_.pos.y, prev_viewport_.size.x, prev_viewport_.size.y);
+    set_viewport_scale(prev_viewport_scale_);
+    sprite_batch->prepare_ogl(prev_alpha_blending_, prev_flip_vertically_);
+
+    recording_ = false;
+    valid_ = true;
+}
+
+void RenderLayer::draw(SpriteBatch* sprite_batch, vec2 position, u32 color)
+{
+    if (allocation_.page < 0)
+        return;
+
+    Texture* texture = DV_RENDER_LAYER_ATLAS->fbo(allocation_.page)->texture();
+    Rect source(allocation_.rect);
+
+    // Цвет в слое уже умножен на альфу
+    RhiBlendMode prev_blend_mode = sprite_batch->blend_mode();
+    sprite_batch->set_blend_mode(RhiBlendMode::premultiplied);
+
+    sprite_batch->draw_sprite(texture, Rect(position, source.size), &source, color);
+
+    sprite_batch->set_blend_mode(prev_blend_mode);
+}
+
+} // namespace dviglo
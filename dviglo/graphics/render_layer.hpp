@@ -0,0 +1,71 @@
+// Copyright (c) the Dviglo project
+// License: MIT
+
+#pragma once
+
+#include "render_layer_atlas.hpp"
+#include "sprite_batch.hpp"
+
+
+namespace dviglo
+{
+
+// Кэшированный слой: неизменная часть сцены или интерфейса (например панель с сотнями строк),
+// которая записывается в область RenderLayerAtlas один раз и затем выводится одним спрайтом.
+// Пример:
+//
+//     if (layer.begin(sprite_batch))
+//     {
+//         sprite_batch->draw_string(...); // Координаты относительно левого верхнего угла слоя
+//         layer.end(sprite_batch);
+//     }
+//
+//     layer.draw(sprite_batch, panel_pos);
+//
+// Слой перерисовывается после invalidate(), изменения размера и изменения плотности пикселей окна.
+// Во время записи стек отсечения SpriteBatch должен быть пустым
+class RenderLayer
+{
+private:
+    glm::vec2 size_;
+    RenderLayerAllocation allocation_;
+
+    // Плотность пикселей окна во время последней записи
+    f32 pixel_density_ = 0.f;
+
+    bool valid_ = false;
+    bool recording_ = false;
+
+    // Состояние, которое восстанавливается в end()
+    GLint prev_framebuffer_ = 0;
+    IntRect prev_viewport_;
+    glm::vec2 prev_viewport_scale_{1.f, 1.f};
+    bool prev_alpha_blending_ = true;
+    bool prev_flip_vertically_ = false;
+
+public:
+    // size - в пикселях SpriteBatch
+    RenderLayer(glm::vec2 size);
+    ~RenderLayer();
+
+    RenderLayer(const RenderLayer&) = delete;
+    RenderLayer& operator=(const RenderLayer&) = delete;
+
+    glm::vec2 size() const { return size_; }
+    void set_size(glm::vec2 size);
+
+    // Содержимое слоя будет перерисовано при следующем begin()
+    void invalidate() { valid_ = false; }
+    bool valid() const { return valid_; }
+
+    // Если слой актуален, возвращает false. Иначе возвращает true и перенаправляет вывод
+    // sprite_batch в слой до вызова end()
+    bool begin(SpriteBatch* sprite_batch);
+    void end(SpriteBatch* sprite_batch);
+
+    // Выводит слой. Содержимое слоя хранится с предумноженной альфой,
+    // поэтому при полупрозрачном color компоненты RGB тоже должны быть умножены на альфу
+    void draw(SpriteBatch* sprite_batch, glm::vec2 position, u32 color = 0xFFFFFFFF);
+};
+
+} // namespace dviglo
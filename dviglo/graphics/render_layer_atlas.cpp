@@ -0,0 +1,170 @@
+// Copyright (c) the Dviglo project
+// License: MIT
+
+#include "render_layer_atlas.hpp"
+
+#include "../fs/log.hpp"
+
+#include <cassert>
+
+using namespace glm;
+using namespace std;
+
+
+namespace dviglo
+{
+
+RenderLayerAtlas::RenderLayerAtlas()
+{
+    assert(!instance_);
+    instance_ = this;
+
+    DV_LOG->write_debug("RenderLayerAtlas constructed");
+}
+
+RenderLayerAtlas::~RenderLayerAtlas()
+{
+    instance_ = nullptr;
+    DV_LOG->write_debug("RenderLayerAtlas destructed");
+}
+
+i32 RenderLayerAtlas::create_page(ivec2 size, bool dedicated)
+{
+    i32 index = 0;
+
+    while (index < (i32)pages_.size() && pages_[index].fbo)
+        ++index;
+
+    if (index == (i32)pages_.size())
+        pages_.emplace_back();
+
+    Page& page = pages_[index];
+    page = Page();
+    page.fbo = make_unique<Fbo>(size);
+    page.fbo->set_label("RenderLayerAtlas page " + to_string(index));
+    page.dedicated = dedicated;
+
+    // Слои выводятся без мип-уровней
+    page.fbo->texture()->set_params({GL_LINEAR, GL_LINEAR});
+
+    return index;
+}
+
+bool RenderLayerAtlas::allocate_on_page(Page& page, ivec2 size, IntRect& out_rect)
+{
+    ivec2 padded = size + padding;
+
+    // Ищем самую низкую полку, в которую помещается область и на которой она не займёт слишком много места
+    Shelf* best = nullptr;
+
+    for (Shelf& shelf : page.shelves)
+    {
+        if (shelf.height < padded.y || shelf.height > padded.y + padded.y / 2)
+            continue;
+
+        if (page_size - shelf.used_width < padded.x)
+            continue;
+
+        if (!best || shelf.height < best->height)
+            best = &shelf;
+    }
+
+    if (!best)
+    {
+        if (page_size - page.used_height < padded.y)
+            return false;
+
+        page.shelves.push_back({page.used_height, padded.y, 0});
+        page.used_height += padded.y;
+        best = &page.shelves.back();
+    }
+
+    out_rect = IntRect(best->used_width, best->y, size.x, size.y);
+    best->used_width += padded.x;
+    return true;
+}
+
+RenderLayerAllocation RenderLayerAtlas::allocate(ivec2 size)
+{
+    RenderLayerAllocation ret;
+
+    if (size.x <= 0 || size.y <= 0)
+    {
+        DV_LOG->writef_error("{} | size.x <= 0 || size.y <= 0", DV_FUNCSIG);
+        return ret;
+    }
+
+    if (size.x + padding > page_size || size.y + padding > page_size)
+    {
+        ret.page = create_page(size, true);
+        ret.rect = IntRect(ivec2(0, 0), size);
+        ++pages_[ret.page].num_allocations;
+        return ret;
+    }
+
+    for (i32 i = 0; i < (i32)pages_.size(); ++i)
+    {
+        Page& page = pages_[i];
+
+        if (!page.fbo || page.dedicated)
+            continue;
+
+        if (allocate_on_page(page, size, ret.rect))
+        {
+            ret.page = i;
+            ++page.num_allocations;
+            return ret;
+        }
+    }
+
+    ret.page = create_page(ivec2(page_size), false);
+    allocate_on_page(pages_[ret.page], size, ret.rect);
+    ++pages_[ret.page].num_allocations;
+    return ret;
+}
+
+void RenderLayerAtlas::release(const RenderLayerAllocation& allocation)
+{
+    if (allocation.page < 0 || allocation.page >= (i32)pages_.size() || !pages_[allocation.page].fbo)
+    {
+        DV_LOG->writef_error("{} | incorrect allocation", DV_FUNCSIG);
+        return;
+    }
+
+    Page& page = pages_[allocation.page];
+
+    if (--page.num_allocations > 0)
+        return;
+
+    // Страница опустела. Обычную страницу оставляем для следующих слоёв, а отдельную уничтожаем
+    if (page.dedicated)
+    {
+        page = Page();
+    }
+    else
+    {
+        page.shelves.clear();
+        page.used_height = 0;
+    }
+}
+
+void RenderLayerAtlas::get_usage(i32* out_num_pages, i64* out_num_bytes) const
+{
+    i32 num_pages = 0;
+    i64 num_bytes = 0;
+
+    for (const Page& page : pages_)
+    {
+        if (!page.fbo)
+            continue;
+
+        ++num_pages;
+        ivec2 size = page.fbo->texture()->size();
+        num_bytes += (i64)size.x * size.y * 4;
+    }
+
+    *out_num_pages = num_pages;
+    *out_num_bytes = num_bytes;
+}
+
+} // namespace dviglo
@@ -0,0 +1,87 @@
+// Copyright (c) the Dviglo project
+// License: MIT
+
+#pragma once
+
+#include "../gl_utils/fbo.hpp"
+#include "../math/rect.hpp"
+
+#include <vector>
+
+
+namespace dviglo
+{
+
+// Область атласа, выделенная для RenderLayer
+struct RenderLayerAllocation
+{
+    // -1 - область не выделена
+    i32 page = -1;
+
+    // В пикселях текстуры страницы, строка 0 - первая строка текстуры
+    IntRect rect{0, 0, 0, 0};
+};
+
+// Общий пул текстур для RenderLayer. Области раскладываются по полкам на страницах
+// page_size x page_size, поэтому множество небольших слоёв делят несколько FBO.
+// Слой больше страницы получает собственную страницу.
+// Освобождённое место возвращается, когда освобождаются все области страницы
+class RenderLayerAtlas
+{
+private:
+    // Инициализируется в конструкторе
+    inline static RenderLayerAtlas* instance_ = nullptr;
+
+    // Ряд областей одинаковой высоты
+    struct Shelf
+    {
+        i32 y;
+        i32 height;
+        i32 used_width;
+    };
+
+    struct Page
+    {
+        std::unique_ptr<Fbo> fbo;
+        std::vector<Shelf> shelves;
+        i32 used_height = 0;
+        i32 num_allocations = 0;
+
+        // Страница создана для одного большого слоя
+        bool dedicated = false;
+    };
+
+    std::vector<Page> pages_;
+
+    // Создаёт страницу в свободном слоте pages_ и возвращает её индекс
+    i32 create_page(glm::ivec2 size, bool dedicated);
+
+    // Ищет место на странице. Возвращает false, если места нет
+    static bool allocate_on_page(Page& page, glm::ivec2 size, IntRect& out_rect);
+
+public:
+    inline static constexpr i32 page_size = 2048;
+
+    // Пустые пиксели между областями, чтобы при билинейной фильтрации не было видно соседей
+    inline static constexpr i32 padding = 1;
+
+    static RenderLayerAtlas* instance() { return instance_; }
+
+    RenderLayerAtlas();
+    ~RenderLayerAtlas();
+
+    RenderLayerAtlas(const RenderLayerAtlas&) = delete;
+    RenderLayerAtlas& operator=(const RenderLayerAtlas&) = delete;
+
+    RenderLayerAllocation allocate(glm::ivec2 size);
+    void release(const RenderLayerAllocation& allocation);
+
+    Fbo* fbo(i32 page) const { return pages_[page].fbo.get(); }
+
+    // Число страниц и объём видеопамяти, который они занимают
+    void get_usage(i32* out_num_pages, i64* out_num_bytes) const;
+};
+
+#define DV_RENDER_LAYER_ATLAS (dviglo::RenderLayerAtlas::instance())
+
+} // namespace dviglo
@@ -0,0 +1,209 @@
+// Copyright (c) the Dviglo project
+// License: MIT
+
+#include "sprite_animator.hpp"
+
+#include "../fs/log.hpp"
+
+#include <cassert>
+
+using namespace glm;
+using namespace std;
+
+
+namespace dviglo
+{
+
+SpriteAnimator::SpriteAnimator(const AnimationLibrary* library)
+    : library_(library)
+{
+    assert(library_);
+}
+
+SpriteAnimator::AnimId SpriteAnimator::add(i32 clip, f32 speed)
+{
+    if (clip < 0 || clip >= library_->num_clips())
+    {
+        DV_LOG->writef_error("{} | clip < 0 || clip >= library_->num_clips()", DV_FUNCSIG);
+        return -1;
+    }
+
+    AnimId id;
+
+    if (free_ids_.empty())
+    {
+        id = (AnimId)clips_.size();
+        clips_.push_back(-1);
+        first_frames_.push_back(0);
+        num_frames_.push_back(0);
+        frame_durations_ns_.push_back(0);
+        loops_.push_back(0);
+        times_ns_.push_back(0);
+        speeds_.push_back(0.f);
+        frames_.push_back(0);
+    }
+    else
+    {
+        id = free_ids_.back();
+        free_ids_.pop_back();
+    }
+
+    speeds_[id] = std::max(speed, 0.f);
+    start(id, clip);
+    return id;
+}
+
+void SpriteAnimator::remove(AnimId id)
+{
+    if (!alive(id))
+        return;
+
+    clips_[id] = -1;
+
+    // Нулевая длительность кадра пропускается в update()
+    frame_durations_ns_[id] = 0;
+    free_ids_.push_back(id);
+}
+
+void SpriteAnimator::start(AnimId id, i32 clip)
+{
+    const AnimationClip& clip_data = library_->clip(clip);
+    clips_[id] = clip;
+    first_frames_[id] = clip_data.first_frame;
+    num_frames_[id] = clip_data.num_frames;
+    frame_durations_ns_[id] = clip_data.frame_duration_ns;
+    loops_[id] = clip_data.loop;
+    times_ns_[id] = 0;
+    frames_[id] = clip_data.first_frame;
+}
+
+void SpriteAnimator::play(AnimId id, i32 clip, bool restart)
+{
+    if (!alive(id))
+    {
+        DV_LOG->writef_error("{} | !alive(id)", DV_FUNCSIG);
+        return;
+    }
+
+    if (clip < 0 || clip >= library_->num_clips())
+    {
+        DV_LOG->writef_error("{} | clip < 0 || clip >= library_->num_clips()", DV_FUNCSIG);
+        return;
+    }
+
+    if (clips_[id] == clip && !restart)
+        return;
+
+    start(id, clip);
+}
+
+void SpriteAnimator::set_speed(AnimId id, f32 speed)
+{
+    if (!alive(id))
+    {
+        DV_LOG->writef_error("{} | !alive(id)", DV_FUNCSIG);
+        return;
+    }
+
+    speeds_[id] = std::max(speed, 0.f);
+}
+
+i32 SpriteAnimator::clip(AnimId id) const
+{
+    if (!alive(id))
+    {
+        DV_LOG->writef_error("{} | !alive(id)", DV_FUNCSIG);
+        return -1;
+    }
+
+    return clips_[id];
+}
+
+i32 SpriteAnimator::frame(AnimId id) const
+{
+    if (!alive(id))
+    {
+        DV_LOG->writef_error("{} | !alive(id)", DV_FUNCSIG);
+        return -1;
+    }
+
+    return frames_[id];
+}
+
+const Rect& SpriteAnimator::source(AnimId id) const
+{
+    if (!alive(id))
+    {
+        DV_LOG->writef_error("{} | !alive(id)", DV_FUNCSIG);
+
+        static const Rect empty;
+        return empty;
+    }
+
+    return library_->frame_source(frames_[id]);
+}
+
+bool SpriteAnimator::finished(AnimId id) const
+{
+    if (!alive(id))
+    {
+        DV_LOG->writef_error("{} | !alive(id)", DV_FUNCSIG);
+        return true;
+    }
+
+    return !loops_[id] && times_ns_[id] >= frame_durations_ns_[id] * num_frames_[id];
+}
+
+void SpriteAnimator::update(i64 ns)
+{
+    const i32 count = size();
+    const f64 step = (f64)ns;
+
+    for (i32 i = 0; i < count; ++i)
+    {
+        i64 duration = frame_durations_ns_[i];
+
+        if (duration == 0)
+            continue;
+
+        i64 time = times_ns_[i] + (i64)(step * speeds_[i]);
+        i32 num_frames = num_frames_[i];
+        i64 clip_duration = duration * num_frames;
+
+        // Время повторяющейся анимации держим в пределах одного цикла, чтобы не было переполнения
+        if (loops_[i])
+            time %= clip_duration;
+        else
+            time = std::min(time, clip_duration);
+
+        times_ns_[i] = time;
+        frames_[i] = first_frames_[i] + std::min((i32)(time / duration), num_frames - 1);
+    }
+}
+
+void SpriteAnimator::write_uvs(SpriteInstance* instances, i32 count, AnimId first_id) const
+{
+    if (first_id < 0 || first_id + count > size())
+    {
+        DV_LOG->writef_error("{} | first_id < 0 || first_id + count > size()", DV_FUNCSIG);
+        return;
+    }
+
+    const vec2* uv_mins = library_->frame_uv_mins().data();
+    const vec2* uv_maxs = library_->frame_uv_maxs().data();
+    const i32* frames = frames_.data() + first_id;
+
+    for (i32 i = 0; i < count; ++i)
+    {
+        instances[i].uv_min = uv_mins[frames[i]];
+        instances[i].uv_max = uv_maxs[frames[i]];
+    }
+}
+
+void SpriteAnimator::write_uvs(SpriteSet* sprite_set) const
+{
+    vector<SpriteInstance>& sprites = sprite_set->edit_sprites();
+    write_uvs(sprites.data(), std::min((i32)sprites.size(), size()));
+}
+
+} // namespace dviglo
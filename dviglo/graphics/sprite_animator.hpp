@@ -0,0 +1,85 @@
+// Copyright (c) the Dviglo project
+// License: MIT
+
+#pragma once
+
+#include "sprite_set.hpp"
+
+#include "../res/animation_library.hpp"
+
+#include <vector>
+
+
+namespace dviglo
+{
+
+// Состояния множества анимированных спрайтов с общим AnimationLibrary.
+// Состояние хранится в отдельных массивах (SoA), а параметры анимации копируются в них в play(),
+// поэтому update() - один цикл без виртуальных вызовов и поиска в словарях.
+// Номер анимированного спрайта (AnimId) не меняется, пока спрайт не удалён
+class SpriteAnimator
+{
+public:
+    using AnimId = i32;
+
+private:
+    const AnimationLibrary* library_;
+
+    std::vector<i32> clips_; // -1 - слот свободен
+    std::vector<i32> first_frames_;
+    std::vector<i32> num_frames_;
+    std::vector<i64> frame_durations_ns_;
+    std::vector<u8> loops_;
+    std::vector<i64> times_ns_;
+    std::vector<f32> speeds_;
+
+    // Текущий кадр (индекс в AnimationLibrary)
+    std::vector<i32> frames_;
+
+    std::vector<AnimId> free_ids_;
+
+    // Копирует параметры анимации clip в слот id и сбрасывает время. Без проверок
+    void start(AnimId id, i32 clip);
+
+public:
+    SpriteAnimator(const AnimationLibrary* library);
+
+    const AnimationLibrary* library() const { return library_; }
+
+    // clip - индекс в AnimationLibrary
+    AnimId add(i32 clip, f32 speed = 1.f);
+    void remove(AnimId id);
+
+    // Переключает анимацию. Если она уже играет и restart == false, время не сбрасывается
+    void play(AnimId id, i32 clip, bool restart = false);
+
+    // Множитель скорости, не меньше 0
+    void set_speed(AnimId id, f32 speed);
+
+    // Число слотов (включая свободные). AnimId меньше этого числа
+    i32 size() const { return (i32)clips_.size(); }
+
+    // Анимация добавлена и не удалена
+    bool alive(AnimId id) const { return id >= 0 && id < size() && clips_[id] >= 0; }
+
+    // -1, если анимации нет
+    i32 clip(AnimId id) const;
+    i32 frame(AnimId id) const;
+
+    const Rect& source(AnimId id) const;
+
+    // Неповторяющаяся анимация дошла до последнего кадра
+    bool finished(AnimId id) const;
+
+    // Продвигает все анимации
+    void update(i64 ns);
+
+    // Записывает UV текущих кадров в спрайты: instances[i] получает кадр анимации first_id + i.
+    // Позиции, размеры и цвета не меняются
+    void write_uvs(SpriteInstance* instances, i32 count, AnimId first_id = 0) const;
+
+    // Для SpriteSet, в котором спрайт i соответствует анимации i
+    void write_uvs(SpriteSet* sprite_set) const;
+};
+
+} // namespace dviglo
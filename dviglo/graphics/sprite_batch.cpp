@@ -3,11 +3,15 @@
 
 #include "sprite_batch.hpp"
 
-#include "../fs/fs_base.hpp"
+#include "../fs/embedded_files.hpp"
+#include "../fs/log.hpp"
+#include "../gl_utils/draw_counters.hpp"
+#include "../gl_utils/gl_debug.hpp"
 #include "../gl_utils/gl_utils.hpp"
 #include "../gl_utils/shader_cache.hpp"
 #include "../math/math.hpp"
 
+#include <algorithm> // sort
 #include <cstring> // memcpy
 
 using namespace glm;
@@ -17,22 +21,65 @@ using namespace std;
 namespace dviglo
 {
 
+template <typename V>
+static Aabb calc_bounds(const V* vertices, i32 num_vertices)
+{
+    Aabb ret(vertices[0].position, vertices[0].position);
+
+    for (i32 i = 1; i < num_vertices; ++i)
+        ret.merge(vertices[i].position);
+
+    return ret;
+}
+
 void SpriteBatch::add_triangle()
 {
-    // Рендерили четырёхугольники, а теперь нужно рендерить треугольники
-    if (q_num_vertices_ > 0)
-        flush();
+    if (capture_)
+        capture_->triangle(&triangle_);
+
+    if (!clip_stack_.empty())
+    {
+        Aabb bounds(triangle_.v0.position, triangle_.v0.position);
+        bounds.merge(triangle_.v1.position);
+        bounds.merge(triangle_.v2.position);
+        ClipResult clip_result = test_clip(bounds);
+
+        if (clip_result == ClipResult::culled)
+            return;
+        else if (clip_result == ClipResult::partial)
+            set_portion_scissor(true);
+    }
+    else if (portion_scissor_)
+    {
+        set_portion_scissor(false);
+    }
+
+    if (depth_scene_)
+    {
+        defer_primitive(false);
+        return;
+    }
+
+    submit_triangle();
+}
+
+void SpriteBatch::submit_triangle()
+{
+    // Рендерили четырёхугольники или фигуры, а теперь нужно рендерить треугольники
+    if (q_num_vertices_ > 0 || s_num_vertices_ > 0)
+        flush(FlushReason::primitive);
 
     memcpy(t_vertices_ + t_num_vertices_, &triangle_, sizeof(triangle_));
     t_num_vertices_ += vertices_per_triangle_;
 
     // Если после добавления вершин мы заполнили массив до предела, то рендерим порцию
     if (t_num_vertices_ == max_triangles_in_portion_ * vertices_per_triangle_)
-        flush();
+        flush(FlushReason::full);
 }
 
 void SpriteBatch::set_shape_color(u32 color)
 {
+    shape_color_ = color;
     triangle_.v0.color = color;
     triangle_.v1.color = color;
     triangle_.v2.color = color;
@@ -40,30 +87,573 @@ void SpriteBatch::set_shape_color(u32 color)
 
 void SpriteBatch::add_quad()
 {
-    // Рендерили треугольники, а теперь нужно рендерить четырёхугольники
-    if (t_num_vertices_ > 0)
-        flush();
+    if (capture_)
+        capture_->quad(quad.texture, quad.shader_program, &quad.v0);
+
+    submit_quad();
+}
+
+void SpriteBatch::submit_quad()
+{
+    if (!clip_stack_.empty())
+    {
+        if (!clip_quad())
+            return;
+    }
+    else if (portion_scissor_)
+    {
+        set_portion_scissor(false);
+    }
 
-    if (quad.texture != q_current_texture_ || quad.shader_program != q_current_shader_program_)
+    if (depth_scene_)
     {
-        flush();
+        defer_quad();
+        return;
+    }
+
+    // Рендерили треугольники или фигуры, а теперь нужно рендерить четырёхугольники
+    if (t_num_vertices_ > 0 || s_num_vertices_ > 0)
+        flush(FlushReason::primitive);
+
+    if ((quad.texture != q_current_texture_ || quad.shader_program != q_current_shader_program_) && !begin_quad_run())
+    {
+        flush(quad.texture != q_current_texture_ ? FlushReason::texture : FlushReason::shader);
 
         q_current_texture_ = quad.texture;
         q_current_shader_program_ = quad.shader_program;
     }
 
+    // Первый прогон порции
+    if (multi_draw_ && q_num_vertices_ == 0)
+    {
+        q_textures_[0] = q_current_texture_;
+        q_num_textures_ = 1;
+        q_runs_.clear();
+        q_runs_.push_back({0, 0});
+    }
+
     memcpy(q_vertices_ + q_num_vertices_, &(quad.v0), sizeof(QVertex) * vertices_per_quad_);
     q_num_vertices_ += vertices_per_quad_;
+    ++num_drawn_quads_;
 
     // Если после добавления вершин мы заполнили массив до предела, то рендерим порцию
     if (q_num_vertices_ == max_quads_in_portion_ * vertices_per_quad_)
-        flush();
+        flush(FlushReason::full);
+}
+
+void SpriteBatch::add_shape()
+{
+    if (capture_)
+        capture_->shape(&shape_);
+
+    if (!clip_stack_.empty())
+    {
+        Aabb bounds(shape_.v0.position, shape_.v0.position);
+        bounds.merge(shape_.v1.position);
+        bounds.merge(shape_.v2.position);
+        bounds.merge(shape_.v3.position);
+        ClipResult clip_result = test_clip(bounds);
+
+        if (clip_result == ClipResult::culled)
+            return;
+        else if (clip_result == ClipResult::partial)
+            set_portion_scissor(true); // local_pos нельзя обрезать, так как шейдер вычисляет по ней размер фигуры
+    }
+    else if (portion_scissor_)
+    {
+        set_portion_scissor(false);
+    }
+
+    if (depth_scene_)
+    {
+        defer_primitive(true);
+        return;
+    }
+
+    submit_shape();
+}
+
+void SpriteBatch::submit_shape()
+{
+    // Рендерили треугольники или четырёхугольники, а теперь нужно рендерить фигуры
+    if (t_num_vertices_ > 0 || q_num_vertices_ > 0)
+        flush(FlushReason::primitive);
+
+    memcpy(s_vertices_ + s_num_vertices_, &shape_, sizeof(shape_));
+    s_num_vertices_ += vertices_per_quad_;
+
+    // Если после добавления вершин мы заполнили массив до предела, то рендерим порцию
+    if (s_num_vertices_ == max_quads_in_portion_ * vertices_per_quad_)
+        flush(FlushReason::full);
+}
+
+void SpriteBatch::add_shape(vec2 center_pos, vec2 axis_x, vec2 half_size, const vec4& params)
+{
+    vec2 axis_y(-axis_x.y, axis_x.x); // Ось Y направлена вниз
+    vec2 local = half_size + shape_margin_;
+    vec2 dx = axis_x * local.x;
+    vec2 dy = axis_y * local.y;
+
+    // Лицевая грань задаётся по часовой стрелке
+    shape_.v0.position = center_pos - dx - dy;
+    shape_.v0.local_pos = vec2(-local.x, -local.y);
+
+    shape_.v1.position = center_pos + dx - dy;
+    shape_.v1.local_pos = vec2(local.x, -local.y);
+
+    shape_.v2.position = center_pos + dx + dy;
+    shape_.v2.local_pos = vec2(local.x, local.y);
+
+    shape_.v3.position = center_pos - dx + dy;
+    shape_.v3.local_pos = vec2(-local.x, local.y);
+
+    shape_.v0.color = shape_.v1.color = shape_.v2.color = shape_.v3.color = shape_color_;
+    shape_.v0.params = shape_.v1.params = shape_.v2.params = shape_.v3.params = params;
+
+    add_shape();
+}
+
+void SpriteBatch::defer_quad()
+{
+    DepthQuad depth_quad;
+    depth_quad.texture = quad.texture;
+    depth_quad.shader_program = quad.shader_program;
+    depth_quad.depth = depth_;
+    memcpy(&depth_quad.v0, &quad.v0, sizeof(QVertex) * vertices_per_quad_);
+
+    bool opaque = quad.shader_program == q_default_shader_program_ && quad.texture && quad.texture->opaque()
+                  && get_a(quad.v0.color) == 0xFF && get_a(quad.v1.color) == 0xFF
+                  && get_a(quad.v2.color) == 0xFF && get_a(quad.v3.color) == 0xFF;
+
+    if (opaque)
+        opaque_quads_.push_back(depth_quad);
+    else
+        translucent_quads_.push_back(depth_quad);
+}
+
+void SpriteBatch::defer_primitive(bool is_shape)
+{
+    DeferredPrimitive primitive;
+    primitive.num_quads_before = (u32)translucent_quads_.size();
+    primitive.is_shape = is_shape;
+    primitive.scissor = portion_scissor_;
+    primitive.scissor_rect = portion_scissor_rect_;
+
+    if (is_shape)
+    {
+        primitive.index = (u32)deferred_shapes_.size();
+        deferred_shapes_.push_back(shape_);
+    }
+    else
+    {
+        primitive.index = (u32)deferred_triangles_.size();
+        deferred_triangles_.push_back(triangle_);
+    }
+
+    deferred_primitives_.push_back(primitive);
+}
+
+void SpriteBatch::draw_deferred_primitives(u32 num_quads_before)
+{
+    if (next_deferred_primitive_ == deferred_primitives_.size()
+        || deferred_primitives_[next_deferred_primitive_].num_quads_before != num_quads_before)
+    {
+        return;
+    }
+
+    // Шейдеры треугольников и фигур не знают о глубине
+    flush_depth_quads(FlushReason::primitive);
+    glDisable(GL_DEPTH_TEST);
+
+    // В triangle_ хранится цвет из set_shape_color()
+    auto triangle = triangle_;
+
+    while (next_deferred_primitive_ < deferred_primitives_.size()
+           && deferred_primitives_[next_deferred_primitive_].num_quads_before == num_quads_before)
+    {
+        const DeferredPrimitive& primitive = deferred_primitives_[next_deferred_primitive_++];
+        set_portion_scissor(primitive.scissor, primitive.scissor_rect);
+
+        // Примитивы уже записаны в capture_ при добавлении в сцену
+        if (primitive.is_shape)
+        {
+            shape_ = deferred_shapes_[primitive.index];
+            submit_shape();
+        }
+        else
+        {
+            triangle_ = deferred_triangles_[primitive.index];
+            submit_triangle();
+        }
+    }
+
+    flush(FlushReason::primitive);
+    set_portion_scissor(false);
+    triangle_ = triangle;
+
+    glEnable(GL_DEPTH_TEST);
+}
+
+void SpriteBatch::flush_depth_quads(FlushReason reason)
+{
+    if (d_num_vertices_ == 0)
+        return;
+
+    ShaderProgram* shader_program = use_shader(d_shader_program_, true);
+
+    glActiveTexture(GL_TEXTURE0);
+    d_current_texture_->bind();
+    shader_program->set("u_texture", 0);
+
+    d_vertex_buffer_->set_data(d_num_vertices_, d_vertices_);
+
+    q_index_buffer_->bind();
+    // d_vertex_buffer_->bind() вызывается в d_vertex_buffer_->set_data()
+    i32 num_quads = d_num_vertices_ / vertices_per_quad_;
+    glDrawElements(GL_TRIANGLES, num_quads * indices_per_quad_, q_index_buffer_->type(), nullptr);
+    draw_counters::add(num_quads * vertices_per_quad_);
+
+    if (debug_mode_ == SpriteBatchDebugMode::batches)
+    {
+        begin_debug_tint(reason, calc_bounds(d_vertices_, d_num_vertices_), num_quads);
+        glDrawElements(GL_TRIANGLES, num_quads * indices_per_quad_, q_index_buffer_->type(), nullptr);
+        draw_counters::add(num_quads * vertices_per_quad_);
+        end_debug_tint();
+    }
+
+    // Начинаем новую порцию
+    d_num_vertices_ = 0;
+}
+
+void SpriteBatch::draw_depth_quads(const vector<DepthQuad>& quads, bool translucent)
+{
+    for (size_t i = 0; i < quads.size(); ++i)
+    {
+        if (translucent)
+            draw_deferred_primitives((u32)i);
+
+        const DepthQuad& depth_quad = quads[i];
+
+        if (depth_quad.shader_program != q_default_shader_program_)
+        {
+            // Шейдер не знает о глубине
+            flush_depth_quads(FlushReason::shader);
+            glDisable(GL_DEPTH_TEST);
+
+            quad.texture = depth_quad.texture;
+            quad.shader_program = depth_quad.shader_program;
+            memcpy(&quad.v0, &depth_quad.v0, sizeof(QVertex) * vertices_per_quad_);
+
+            // Четырёхугольник уже записан в capture_ при добавлении в сцену
+            submit_quad();
+            flush(FlushReason::shader);
+
+            glEnable(GL_DEPTH_TEST);
+            continue;
+        }
+
+        if (depth_quad.texture != d_current_texture_)
+        {
+            flush_depth_quads(FlushReason::texture);
+            d_current_texture_ = depth_quad.texture;
+        }
+
+        const QVertex* src = &depth_quad.v0;
+        DVertex* dest = d_vertices_ + d_num_vertices_;
+
+        for (i32 i = 0; i < vertices_per_quad_; ++i)
+        {
+            dest[i].position = src[i].position;
+            dest[i].color = src[i].color;
+            dest[i].uv = src[i].uv;
+            dest[i].depth = depth_quad.depth;
+        }
+
+        d_num_vertices_ += vertices_per_quad_;
+        ++num_drawn_quads_;
+
+        // Если после добавления вершин мы заполнили массив до предела, то рендерим порцию
+        if (d_num_vertices_ == max_quads_in_portion_ * vertices_per_quad_)
+            flush_depth_quads(FlushReason::full);
+    }
+
+    if (translucent)
+        draw_deferred_primitives((u32)quads.size());
+
+    flush_depth_quads(FlushReason::depth_scene);
+}
+
+void SpriteBatch::begin_depth_scene()
+{
+    if (depth_scene_)
+    {
+        DV_LOG->writef_error("{} | depth_scene_", DV_FUNCSIG);
+        return;
+    }
+
+    if (capture_)
+        capture_->begin_depth_scene();
+
+    flush(FlushReason::depth_scene);
+    depth_scene_ = true;
+    depth_ = 0.f;
+
+    glDepthMask(GL_TRUE);
+    glClearDepth(1.0);
+    glClear(GL_DEPTH_BUFFER_BIT);
+}
+
+void SpriteBatch::set_depth(f32 depth)
+{
+    if (capture_)
+        capture_->set_depth(depth);
+
+    depth_ = depth;
+}
+
+void SpriteBatch::end_depth_scene()
+{
+    if (!depth_scene_)
+    {
+        DV_LOG->writef_error("{} | !depth_scene_", DV_FUNCSIG);
+        return;
+    }
+
+    if (capture_)
+        capture_->end_depth_scene();
+
+    flush(FlushReason::depth_scene);
+    depth_scene_ = false;
+
+    GlDebugGroup debug_group("SpriteBatch::end_depth_scene");
+
+    // Области отсечения уже применены при добавлении
+    vector<Aabb> clip_stack = std::move(clip_stack_);
+    clip_stack_.clear();
+    set_portion_scissor(false);
+
+    // Спереди назад. При одинаковой глубине группируем по текстурам, чтобы было меньше порций
+    sort(opaque_quads_.begin(), opaque_quads_.end(), [](const DepthQuad& a, const DepthQuad& b)
+    {
+        if (a.depth != b.depth)
+            return a.depth < b.depth;
+
+        return a.texture < b.texture;
+    });
+
+    glEnable(GL_DEPTH_TEST);
+    glDepthFunc(GL_LESS);
+
+    // Непрозрачным спрайтам смешивание не нужно (но нужно для тепловой карты)
+    if (debug_mode_ != SpriteBatchDebugMode::overdraw)
+        glDisable(GL_BLEND);
+    glDepthMask(GL_TRUE);
+    draw_depth_quads(opaque_quads_, false);
+
+    apply_gl_blend_mode(effective_blend_mode());
+
+    glDepthMask(GL_FALSE);
+    draw_depth_quads(translucent_quads_, true);
+
+    glDepthMask(GL_TRUE);
+    glDisable(GL_DEPTH_TEST);
+
+    // Память не освобождается, так как сцена обычно рисуется каждый кадр
+    opaque_quads_.clear();
+    translucent_quads_.clear();
+    deferred_primitives_.clear();
+    deferred_triangles_.clear();
+    deferred_shapes_.clear();
+    next_deferred_primitive_ = 0;
+    d_current_texture_ = nullptr;
+
+    clip_stack_ = std::move(clip_stack);
+}
+
+void SpriteBatch::set_portion_scissor(bool enabled)
+{
+    set_portion_scissor(enabled, enabled ? clip_stack_.back() : portion_scissor_rect_);
+}
+
+void SpriteBatch::set_portion_scissor(bool enabled, const Aabb& rect)
+{
+    if (enabled == portion_scissor_ && (!enabled || portion_scissor_rect_ == rect))
+        return;
+
+    flush(FlushReason::scissor);
+    portion_scissor_ = enabled;
+
+    if (enabled)
+        portion_scissor_rect_ = rect;
+}
+
+SpriteBatch::ClipResult SpriteBatch::test_clip(const Aabb& bounds)
+{
+    const Aabb& clip = clip_stack_.back();
+
+    if (!clip.intersects(bounds))
+        return ClipResult::culled;
+
+    if (!clip.contains(bounds))
+        return ClipResult::partial;
+
+    // Геометрия не нуждается в отсечении, но scissor-тест текущей порции не должен её обрезать
+    if (portion_scissor_ && !portion_scissor_rect_.contains(bounds))
+        set_portion_scissor(false);
+
+    return ClipResult::inside;
+}
+
+bool SpriteBatch::clip_quad()
+{
+    Aabb bounds(quad.v0.position, quad.v0.position);
+    bounds.merge(quad.v1.position);
+    bounds.merge(quad.v2.position);
+    bounds.merge(quad.v3.position);
+    ClipResult clip_result = test_clip(bounds);
+
+    if (clip_result != ClipResult::partial)
+        return clip_result == ClipResult::inside;
+
+    // Стороны v0-v1 и v3-v2 горизонтальны, а стороны v0-v3 и v1-v2 вертикальны.
+    // При отражении или отрицательном масштабе x1 < x0 или y1 < y0
+    bool axis_aligned = quad.v0.position.y == quad.v1.position.y && quad.v3.position.y == quad.v2.position.y
+                        && quad.v0.position.x == quad.v3.position.x && quad.v1.position.x == quad.v2.position.x;
+
+    // Цвета пришлось бы интерполировать, поэтому градиенты обрезаются scissor-тестом
+    bool same_colors = quad.v0.color == quad.v1.color && quad.v0.color == quad.v2.color
+                       && quad.v0.color == quad.v3.color;
+
+    if (!axis_aligned || !same_colors)
+    {
+        set_portion_scissor(true);
+        return true;
+    }
+
+    const Aabb& clip = clip_stack_.back();
+
+    f32 x0 = quad.v0.position.x;
+    f32 x1 = quad.v1.position.x;
+    f32 y0 = quad.v0.position.y;
+    f32 y1 = quad.v3.position.y;
+
+    f32 new_x0 = glm::clamp(x0, clip.min.x, clip.max.x);
+    f32 new_x1 = glm::clamp(x1, clip.min.x, clip.max.x);
+    f32 new_y0 = glm::clamp(y0, clip.min.y, clip.max.y);
+    f32 new_y1 = glm::clamp(y1, clip.min.y, clip.max.y);
+
+    // Текстурные координаты линейно зависят от позиции
+    f32 tx0 = (new_x0 - x0) / (x1 - x0);
+    f32 tx1 = (new_x1 - x0) / (x1 - x0);
+    f32 ty0 = (new_y0 - y0) / (y1 - y0);
+    f32 ty1 = (new_y1 - y0) / (y1 - y0);
+
+    vec2 uv_origin = quad.v0.uv;
+    vec2 uv_dx = quad.v1.uv - quad.v0.uv;
+    vec2 uv_dy = quad.v3.uv - quad.v0.uv;
+
+    quad.v0.position = vec2(new_x0, new_y0);
+    quad.v0.uv = uv_origin + uv_dx * tx0 + uv_dy * ty0;
+
+    quad.v1.position = vec2(new_x1, new_y0);
+    quad.v1.uv = uv_origin + uv_dx * tx1 + uv_dy * ty0;
+
+    quad.v2.position = vec2(new_x1, new_y1);
+    quad.v2.uv = uv_origin + uv_dx * tx1 + uv_dy * ty1;
+
+    quad.v3.position = vec2(new_x0, new_y1);
+    quad.v3.uv = uv_origin + uv_dx * tx0 + uv_dy * ty1;
+
+    // Обрезанный четырёхугольник внутри области отсечения
+    if (portion_scissor_ && !portion_scissor_rect_.contains(bounds.intersection(clip)))
+        set_portion_scissor(false);
+
+    return true;
+}
+
+void SpriteBatch::push_clip(const Rect& rect)
+{
+    if (capture_)
+        capture_->push_clip(rect);
+
+    Aabb clip(rect);
+
+    if (!clip_stack_.empty())
+        clip = clip.intersection(clip_stack_.back());
+
+    clip_stack_.push_back(clip);
+}
+
+void SpriteBatch::pop_clip()
+{
+    if (clip_stack_.empty())
+    {
+        DV_LOG->writef_error("{} | clip_stack_.empty()", DV_FUNCSIG);
+        return;
+    }
+
+    if (capture_)
+        capture_->pop_clip();
+
+    clip_stack_.pop_back();
+}
+
+// Включает scissor-тест для области в координатах вершин SpriteBatch
+static void enable_scissor(const Aabb& rect, bool flip_vertically)
+{
+    IntRect viewport = get_viewport();
+
+    // Координаты вершин в логических пикселях, а glScissor() - в пикселях вьюпорта
+    vec2 scale = get_viewport_scale();
+
+    i32 x = (i32)floor(rect.min.x * scale.x);
+    i32 width = std::max((i32)ceil(rect.max.x * scale.x) - x, 0);
+    i32 top = (i32)floor(rect.min.y * scale.y);
+    i32 height = std::max((i32)ceil(rect.max.y * scale.y) - top, 0);
+
+    // Ось Y glScissor() направлена вверх. При вертикальном отражении оси совпадают
+    i32 y = flip_vertically ? top : viewport.size.y - top - height;
+
+    glEnable(GL_SCISSOR_TEST);
+    glScissor(viewport.pos.x + x, viewport.pos.y + y, width, height);
+}
+
+void SpriteBatch::apply_gl_blend_mode(RhiBlendMode mode)
+{
+    switch (mode)
+    {
+        case RhiBlendMode::opaque:
+            glDisable(GL_BLEND);
+            break;
+
+        case RhiBlendMode::alpha:
+            glEnable(GL_BLEND);
+            glBlendFuncSeparate(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA, GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
+            glBlendEquation(GL_FUNC_ADD);
+            break;
+
+        case RhiBlendMode::additive:
+            glEnable(GL_BLEND);
+            glBlendFunc(GL_ONE, GL_ONE);
+            glBlendEquation(GL_FUNC_ADD);
+            break;
+
+        case RhiBlendMode::premultiplied:
+            glEnable(GL_BLEND);
+            glBlendFunc(GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
+            glBlendEquation(GL_FUNC_ADD);
+            break;
+    }
 }
 
 void SpriteBatch::prepare_ogl(bool alpha_blending, bool flip_vertically)
 {
-    flush(); // На случай, если параметры меняются посередине рендеринга
+    flush(FlushReason::state); // На случай, если параметры меняются посередине рендеринга
+
+    if (capture_)
+        capture_->prepare_ogl(alpha_blending, flip_vertically);
 
+    alpha_blending_ = alpha_blending;
     flip_vertically_ = flip_vertically;
 
 #if false // Для тестов
@@ -76,33 +666,39 @@ void SpriteBatch::prepare_ogl(bool alpha_blending, bool flip_vertically)
         glFrontFace(GL_CW); // Задаём треугольники по часовой стрелке
 #endif
 
-    // Включаем альфа-смешение, если нужно
-    if (alpha_blending)
-    {
-        glEnable(GL_BLEND);
-        glBlendFuncSeparate(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA, GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
-        glBlendEquation(GL_FUNC_ADD);
-    }
-    else
-    {
-        glDisable(GL_BLEND);
-    }
+    // Порции выводятся заранее созданными конвейерами с этим смешением.
+    // Тепловая карта накапливается аддитивным смешением (см. effective_blend_mode())
+    blend_mode_ = alpha_blending ? RhiBlendMode::alpha : RhiBlendMode::opaque;
+    apply_gl_blend_mode(effective_blend_mode());
 }
 
-SpriteBatch::SpriteBatch()
+void SpriteBatch::set_blend_mode(RhiBlendMode mode)
 {
-    t_vertex_buffer_ = make_unique<VertexBuffer>(max_triangles_in_portion_ * vertices_per_triangle_,
-        VertexAttributes::position | VertexAttributes::color, BufferUsage::dynamic_draw, nullptr);
+    flush(FlushReason::state);
 
-    StrUtf8 base_path = get_base_path();
-    t_shader_program_ = DV_SHADER_CACHE->get(base_path + "engine_data/shaders/vert_color.vert", base_path + "engine_data/shaders/vert_color.frag");
-    q_current_shader_program_ = q_default_shader_program_ = DV_SHADER_CACHE->get(base_path + "engine_data/shaders/vert_color_texture.vert", base_path + "engine_data/shaders/vert_color_texture.frag");
+    if (capture_)
+        capture_->set_blend_mode(mode);
+
+    blend_mode_ = mode;
+    apply_gl_blend_mode(effective_blend_mode());
+}
+
+SpriteBatch::SpriteBatch()
+{
+    // Шейдеры встроены в исполняемый файл. Если встраивание выключено, то читаются из папки приложения
+    StrUtf8 shaders_path = StrUtf8(embedded_prefix) + "engine_data/shaders/";
+    t_shader_program_ = DV_SHADER_CACHE->get(shaders_path + "vert_color.vert", shaders_path + "vert_color.frag");
+    q_current_shader_program_ = q_default_shader_program_ = DV_SHADER_CACHE->get(shaders_path + "vert_color_texture.vert", shaders_path + "vert_color_texture.frag");
     quad.shader_program = sprite.shader_program = q_default_shader_program_;
+    q_channel_text_shader_program_ = DV_SHADER_CACHE->get(shaders_path + "channel_text.vert", shaders_path + "channel_text.frag");
+
+    s_shader_program_ = DV_SHADER_CACHE->get(shaders_path + "sdf_shape.vert", shaders_path + "sdf_shape.frag");
 
     set_shape_color(0xFFFFFFFF);
 
     q_vertex_buffer_ = make_unique<VertexBuffer>(max_quads_in_portion_ * vertices_per_quad_,
-        VertexAttributes::position | VertexAttributes::color | VertexAttributes::uv, BufferUsage::dynamic_draw, nullptr);
+        VertexAttributes::position | VertexAttributes::color | VertexAttributes::uv | VertexAttributes::channel_mask,
+        BufferUsage::dynamic_draw, nullptr);
 
     // Индексный буфер всегда содержит набор четырёхугольников, поэтому его можно сразу заполнить
 
@@ -123,46 +719,128 @@ SpriteBatch::SpriteBatch()
 
     q_index_buffer_ = make_unique<IndexBuffer>(max_quads_in_portion_ * indices_per_quad_, IndexType::u16,
                                                BufferUsage::static_draw, indices.get());
+    q_index_buffer_->set_label("SpriteBatch quad indices");
+
+    d_shader_program_ = DV_SHADER_CACHE->get(shaders_path + "depth_sprite.vert", shaders_path + "depth_sprite.frag");
+
+    debug_shader_program_ = DV_SHADER_CACHE->get(shaders_path + "debug_solid.vert", shaders_path + "debug_solid.frag");
+    heatmap_shader_program_ = DV_SHADER_CACHE->get(shaders_path + "overdraw_heatmap.vert", shaders_path + "overdraw_heatmap.frag");
+
+    // Четырёхугольники с глубиной используют индексный буфер четырёхугольников
+    d_vertex_buffer_ = make_unique<VertexBuffer>(max_quads_in_portion_ * vertices_per_quad_,
+        VertexAttributes::position | VertexAttributes::color | VertexAttributes::uv | VertexAttributes::depth,
+        BufferUsage::dynamic_draw, nullptr);
+
+    q_vertex_buffer_->set_label("SpriteBatch quads");
+    d_vertex_buffer_->set_label("SpriteBatch depth quads");
+
+    init_rhi(indices.get());
+    init_multi_draw();
+}
+
+ShaderProgram* SpriteBatch::use_shader(ShaderProgram* shader_program, bool use_depth)
+{
+    // В режиме тепловой карты каждый слой геометрии добавляет к пикселю 1/255
+    if (debug_mode_ == SpriteBatchDebugMode::overdraw)
+    {
+        shader_program = debug_shader_program_;
+        shader_program->use();
+        shader_program->set("u_color", vec4(1.f / 255.f, 0.f, 0.f, 1.f));
+        shader_program->set("u_use_depth", use_depth);
+    }
+    else
+    {
+        shader_program->use();
+    }
+
+    vec2 viewport_size = get_logical_viewport_size();
+    shader_program->set("u_pixel_size", vec2(2.f / viewport_size.x, 2.f / viewport_size.y));
+    shader_program->set("u_flip_vertically", flip_vertically_);
+
+    return shader_program;
 }
 
 void SpriteBatch::flush()
 {
+    if (capture_)
+        capture_->flush();
+
+    flush(FlushReason::manual);
+}
+
+void SpriteBatch::flush(FlushReason reason)
+{
+    if (t_num_vertices_ == 0 && q_num_vertices_ == 0 && s_num_vertices_ == 0)
+        return;
+
+    // В GPU-профайлере видно, почему порция была разорвана
+    if (gl_debug_enabled())
+        push_gl_debug_group(StrUtf8("SpriteBatch::flush ") + flush_reason_name(reason));
+
+    bool scissor = portion_scissor_;
+
+    if (scissor)
+        enable_scissor(portion_scissor_rect_, flip_vertically_);
+
+    // Подкрашивание задаёт uniform-переменные до вывода, а рисуется тем же списком команд
+    bool tint = debug_mode_ == SpriteBatchDebugMode::batches;
+
     if (t_num_vertices_ > 0)
     {
-        t_shader_program_->use();
-        ivec2 viewport_size = get_viewport().size;
-        t_shader_program_->set("u_pixel_size", vec2(2.f / viewport_size.x, 2.f / viewport_size.y));
-        t_shader_program_->set("u_flip_vertically", flip_vertically_);
+        ShaderProgram* shader_program = use_shader(t_shader_program_);
 
-        t_vertex_buffer_->set_data(t_num_vertices_, t_vertices_);
+        if (tint)
+            prepare_debug_tint(reason, calc_bounds(t_vertices_, t_num_vertices_), t_num_vertices_ / vertices_per_triangle_);
 
-        // t_vertex_buffer_->bind() вызывается в t_vertex_buffer_->set_data()
-        glDrawArrays(GL_TRIANGLES, 0, t_vertex_buffer_->num_vertices());
+        draw_portion(t_portion_, shader_program, nullptr, t_vertices_, t_num_vertices_, 0, tint);
 
         // Начинаем новую порцию
         t_num_vertices_ = 0;
     }
+    else if (q_runs_.size() > 1)
+    {
+        draw_quad_runs();
+
+        // Начинаем новую порцию
+        q_num_vertices_ = 0;
+        q_runs_.clear();
+    }
     else if (q_num_vertices_ > 0)
     {
-        q_current_shader_program_->use();
-        ivec2 viewport_size = get_viewport().size;
-        t_shader_program_->set("u_pixel_size", vec2(2.f / viewport_size.x, 2.f / viewport_size.y));
-        t_shader_program_->set("u_flip_vertically", flip_vertically_);
+        ShaderProgram* shader_program = use_shader(q_current_shader_program_);
+        shader_program->set("u_texture", 0);
 
-        glActiveTexture(GL_TEXTURE0);
-        q_current_texture_->bind();
-        q_current_shader_program_->set("u_texture", 0);
+        i32 num_quads = q_num_vertices_ / vertices_per_quad_;
 
-        q_vertex_buffer_->set_data(q_num_vertices_, q_vertices_);
+        if (tint)
+            prepare_debug_tint(reason, calc_bounds(q_vertices_, q_num_vertices_), num_quads);
 
-        q_index_buffer_->bind();
-        // q_vertex_buffer_->bind() вызывается в q_vertex_buffer_->set_data()
-        i32 num_quads = q_num_vertices_ / vertices_per_quad_;
-        glDrawElements(GL_TRIANGLES, num_quads * indices_per_quad_, q_index_buffer_->type(), nullptr);
+        draw_portion(q_portion_, shader_program, q_current_texture_, q_vertices_, q_num_vertices_,
+                     num_quads * indices_per_quad_, tint);
 
         // Начинаем новую порцию
         q_num_vertices_ = 0;
     }
+    else if (s_num_vertices_ > 0)
+    {
+        ShaderProgram* shader_program = use_shader(s_shader_program_);
+
+        i32 num_shapes = s_num_vertices_ / vertices_per_quad_;
+
+        if (tint)
+            prepare_debug_tint(reason, calc_bounds(s_vertices_, s_num_vertices_), num_shapes);
+
+        draw_portion(s_portion_, shader_program, nullptr, s_vertices_, s_num_vertices_,
+                     num_shapes * indices_per_quad_, tint);
+
+        // Начинаем новую порцию
+        s_num_vertices_ = 0;
+    }
+
+    if (scissor)
+        glDisable(GL_SCISSOR_TEST);
+
+    pop_gl_debug_group();
 }
 
 // ======================= Используем пакетный рендеринг треугольников =======================
@@ -210,6 +888,50 @@ void SpriteBatch::draw_disk(vec2 center_pos, f32 radius, i32 num_segments)
     draw_triangle(points[num_segments - 1], points[0], center_pos);
 }
 
+// ======================= Используем пакетный рендеринг фигур =======================
+
+void SpriteBatch::draw_circle(vec2 center_pos, f32 radius)
+{
+    // Круг - это квадрат с максимальным скруглением углов
+    add_shape(center_pos, vec2(1.f, 0.f), vec2(radius), vec4(shape_kind_box, radius, 0.f, 0.f));
+}
+
+void SpriteBatch::draw_ring(vec2 center_pos, f32 radius, f32 thickness)
+{
+    add_shape(center_pos, vec2(1.f, 0.f), vec2(radius), vec4(shape_kind_box, radius, thickness, 0.f));
+}
+
+void SpriteBatch::draw_rounded_rect(const Rect& rect, f32 corner_radius, f32 outline_thickness)
+{
+    vec2 half_size = rect.size * 0.5f;
+    corner_radius = std::min(corner_radius, std::min(half_size.x, half_size.y));
+    add_shape(rect.pos + half_size, vec2(1.f, 0.f), half_size, vec4(shape_kind_box, corner_radius, outline_thickness, 0.f));
+}
+
+void SpriteBatch::draw_line(vec2 from, vec2 to, f32 thickness)
+{
+    vec2 dir = to - from;
+    f32 len = length(dir);
+    vec2 axis_x = len > 0.f ? dir / len : vec2(1.f, 0.f);
+    f32 radius = thickness * 0.5f;
+
+    // Капсула - это прямоугольник вдоль линии с максимальным скруглением углов
+    add_shape((from + to) * 0.5f, axis_x, vec2(len * 0.5f + radius, radius), vec4(shape_kind_box, radius, 0.f, 0.f));
+}
+
+void SpriteBatch::draw_arc(vec2 center_pos, f32 radius, f32 thickness, f32 start_angle, f32 end_angle)
+{
+    // В шейдере дуга симметрична относительно локальной оси Y,
+    // поэтому поворачиваем четырёхугольник так, чтобы ось Y указывала на середину дуги
+    f32 sin, cos;
+    sin_cos((start_angle + end_angle) * 0.5f, sin, cos);
+    vec2 axis_x(sin, -cos);
+
+    f32 half_angle = std::abs(end_angle - start_angle) * 0.5f;
+    f32 half_size = radius + thickness * 0.5f;
+    add_shape(center_pos, axis_x, vec2(half_size), vec4(shape_kind_arc, radius, thickness, half_angle));
+}
+
 // ======================= Используем пакетный рендеринг четырёхугольников =======================
 
 void SpriteBatch::transform_sprite_internal()
@@ -296,15 +1018,19 @@ void SpriteBatch::draw_sprite_internal()
 
     quad.v0.color = sprite.color0;
     quad.v0.uv = sprite.source_uv.pos;
+    quad.v0.channel_mask = sprite.channel_mask;
 
     quad.v1.color = sprite.color1;
     quad.v1.uv = vec2(sprite.source_uv.pos.x + sprite.source_uv.size.x, sprite.source_uv.pos.y);
+    quad.v1.channel_mask = sprite.channel_mask;
 
     quad.v2.color = sprite.color2;
     quad.v2.uv = sprite.source_uv.pos + sprite.source_uv.size;
+    quad.v2.channel_mask = sprite.channel_mask;
 
     quad.v3.color = sprite.color3;
     quad.v3.uv = vec2(sprite.source_uv.pos.x, sprite.source_uv.pos.y + sprite.source_uv.size.y);
+    quad.v3.channel_mask = sprite.channel_mask;
 
     add_quad();
 }
@@ -374,6 +1100,7 @@ void SpriteBatch::draw_sprite(Texture* texture, const Rect& destination, const R
     sprite.color1 = color;
     sprite.color2 = color;
     sprite.color3 = color;
+    sprite.channel_mask = 0;
 
     draw_sprite_internal();
 }
@@ -415,6 +1142,7 @@ void SpriteBatch::draw_sprite(Texture* texture, vec2 position, const Rect* sourc
     sprite.color1 = color;
     sprite.color2 = color;
     sprite.color3 = color;
+    sprite.channel_mask = 0;
 
     draw_sprite_internal();
 }
@@ -487,6 +1215,19 @@ void SpriteBatch::draw_string(const StrUtf8& text, SpriteFont* font, vec2 positi
         vec2 offset(glyph.offset);
 
         sprite.texture = font->textures()[glyph.page].get();
+
+        // Глифы из атласа с упаковкой по каналам окрашиваются цветом вершин в отдельном шейдере
+        if (glyph.channel >= 0)
+        {
+            sprite.shader_program = q_channel_text_shader_program_;
+            sprite.channel_mask = 0xFFu << (glyph.channel * 8);
+        }
+        else
+        {
+            sprite.shader_program = q_default_shader_program_;
+            sprite.channel_mask = 0;
+        }
+
         sprite.destination = Rect(char_pos, rect.size);
         sprite.source_uv = Rect(rect.pos * pixel_size, rect.size * pixel_size);
 
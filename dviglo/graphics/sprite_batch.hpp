@@ -3,14 +3,21 @@
 
 #pragma once
 
+#include "sprite_batch_capture.hpp"
+
+#include "../gl_utils/fbo.hpp"
 #include "../gl_utils/index_buffer.hpp"
 #include "../gl_utils/shader_program.hpp"
 #include "../gl_utils/texture.hpp"
 #include "../gl_utils/vertex_buffer.hpp"
 #include "../math/rect.hpp"
 #include "../res/sprite_font.hpp"
+#include "../rhi/rhi.hpp"
 
+#include <array>
 #include <memory>
+#include <unordered_map>
+#include <vector>
 
 
 namespace dviglo
@@ -26,6 +33,18 @@ enum class FlipModes : u32
 };
 DV_FLAGS(FlipModes);
 
+// Отладочные режимы SpriteBatch
+enum class SpriteBatchDebugMode : u32
+{
+    none,
+
+    // Тепловая карта перерисовки: сколько раз закрашивался каждый пиксель
+    overdraw,
+
+    // Каждая порция (вызов отрисовки) подкрашивается своим цветом и подписывается причиной flush()
+    batches
+};
+
 
 class SpriteBatch
 {
@@ -55,9 +74,6 @@ private:
     // Шейдерная программа для рендеринга треугольников
     ShaderProgram* t_shader_program_;
 
-    // Вершинный буфер для треугольников (индексный буфер не используется)
-    std::unique_ptr<VertexBuffer> t_vertex_buffer_;
-
 public:
 
     // Данные для функции add_triangle().
@@ -71,6 +87,13 @@ public:
     // Перед вызовом этой функции необходимо заполнить структуру triangle_
     void add_triangle();
 
+private:
+
+    // Часть add_triangle() после отсечения
+    void submit_triangle();
+
+public:
+
     // Указывает цвет для следующих треугольников (в формате 0xAABBGGRR)
     void set_shape_color(u32 color);
 
@@ -95,6 +118,10 @@ private:
         glm::vec2 position;
         u32 color; // Цвет в формате 0xAABBGGRR
         glm::vec2 uv;
+
+        // Маска канала текстуры для атласов с упаковкой по каналам (0xFF в нужном байте).
+        // Дефолтный шейдер её игнорирует
+        u32 channel_mask;
     };
 
     // Текущая порция четырёхугольников
@@ -109,13 +136,17 @@ private:
     // Дефолтная шейдерная программа для четырёхугольников
     ShaderProgram* q_default_shader_program_;
 
+    // Шейдерная программа для текста из атласов с упаковкой по каналам.
+    // Берёт из текстуры канал, указанный в маске, и окрашивает его цветом вершины
+    ShaderProgram* q_channel_text_shader_program_;
+
     // Текущая шейдерная программа для четырёхугольников
     ShaderProgram* q_current_shader_program_;
 
-    // Вершинный буфер для четырёхугольников
+    // Вершинный буфер для multi-draw indirect (обычные порции выводятся через RHI)
     std::unique_ptr<VertexBuffer> q_vertex_buffer_;
 
-    // Индексный буфер для четырёхугольников
+    // Индексный буфер для multi-draw indirect и четырёхугольников с глубиной
     std::unique_ptr<IndexBuffer> q_index_buffer_;
 
 public:
@@ -132,25 +163,534 @@ public:
     // Добавляет 4 вершины в массив q_vertices_.
     // Если массив полон или требуемые шейдеры или текстура отличаются от текущих, то автоматически
     // происходит вызов функции flush() (то есть начинается новая порция).
+    // На OpenGL 4.3 смена текстуры у дефолтного шейдера порцию не разрывает.
     // Перед вызовом этой функции необходимо заполнить структуру quad
     void add_quad();
 
+private:
+
+    // Часть add_quad() после записи в capture_. Используется для повторной отправки
+    // отложенных четырёхугольников, которые уже записаны
+    void submit_quad();
+
+    // Сколько четырёхугольников попало в порции (после отсечения) за всё время.
+    // По нему SpriteBatchReplay проверяет, что воспроизведение совпадает с записью
+    u64 num_drawn_quads_ = 0;
+
+    // ============================ Multi-draw indirect (OpenGL 4.3) ============================
+
+private:
+
+    // Порция четырёхугольников с дефолтным шейдером может содержать несколько прогонов
+    // (последовательностей четырёхугольников с одной текстурой). Все прогоны порции выводятся
+    // одним вызовом glMultiDrawElementsIndirect(), а текстуры привязываются к разным текстурным юнитам.
+    // Номер юнита передаётся в шейдер через baseInstance команды отрисовки
+
+    // Максимальное число текстур в порции. Совпадает с размером массива в multi_draw_sprite.frag
+    inline static constexpr i32 max_textures_in_portion_ = 16;
+
+    // Команда отрисовки для glMultiDrawElementsIndirect()
+    struct DrawElementsIndirectCommand
+    {
+        u32 count;
+        u32 instance_count;
+        u32 first_index;
+        i32 base_vertex;
+        u32 base_instance;
+    };
+
+    // Прогон четырёхугольников с одной текстурой
+    struct QuadRun
+    {
+        i32 first_vertex; // Индекс первой вершины в q_vertices_
+        u32 texture_slot; // Индекс в q_textures_
+    };
+
+    // Используется ли multi-draw indirect. Определяется в конструкторе
+    bool multi_draw_ = false;
+
+    // Прогоны текущей порции
+    std::vector<QuadRun> q_runs_;
+
+    // Текстуры текущей порции. Индекс - текстурный юнит
+    Texture* q_textures_[max_textures_in_portion_];
+    i32 q_num_textures_ = 0;
+
+    // Шейдерная программа для вывода прогонов (аналог дефолтной с массивом текстур)
+    ShaderProgram* q_multi_draw_shader_program_ = nullptr;
+
+    // Буфер с номерами текстурных юнитов 0, 1, 2, ... (атрибут экземпляра)
+    GLuint q_texture_slot_buffer_ = 0;
+
+    // Кольцевой буфер команд отрисовки. Каждая порция пишет команды после предыдущей без синхронизации,
+    // а память переразмечается (orphaning) только при переходе в начало
+    GLuint q_indirect_buffer_ = 0;
+
+    // Размер q_indirect_buffer_ в байтах: несколько полных порций
+    inline static constexpr GLsizeiptr q_indirect_buffer_size_ = sizeof(DrawElementsIndirectCommand) * max_quads_in_portion_ * 4;
+
+    // Куда будут записаны команды следующей порции
+    GLintptr q_indirect_offset_ = 0;
+
+    // Реализация в sprite_batch_multi_draw.cpp
+
+    // Настраивает multi-draw indirect, если доступен OpenGL 4.3
+    void init_multi_draw();
+
+    // Пытается продолжить текущую порцию четырёхугольников новым прогоном с текстурой quad.texture.
+    // Возвращает false, если нужен flush()
+    bool begin_quad_run();
+
+    // Выводит порцию из нескольких прогонов
+    void draw_quad_runs();
+
+    // ============================ Пакетный рендеринг фигур ============================
+
+private:
+
+    // Фигура - это четырёхугольник, который закрашивается по расстоянию со знаком (SDF) во фрагментном шейдере.
+    // Индексный буфер общий с четырёхугольниками.
+    // Фигуры разного вида (круг, кольцо, прямоугольник, линия, дуга) рендерятся одной порцией
+
+    // Атрибуты вершин фигур
+    struct SVertex
+    {
+        glm::vec2 position;
+        u32 color; // Цвет в формате 0xAABBGGRR
+
+        // Позиция вершины в локальных координатах фигуры (в пикселях, от центра фигуры).
+        // Модуль одинаков у всех вершин и равен половине размера четырёхугольника
+        glm::vec2 local_pos;
+
+        // x - вид фигуры (shape_kind_box или shape_kind_arc), остальное зависит от вида:
+        // box: y - радиус скругления углов, z - толщина обводки (0 - без обводки)
+        // arc: y - радиус средней линии дуги, z - толщина дуги, w - половина угла дуги
+        glm::vec4 params;
+    };
+
+    inline static constexpr f32 shape_kind_box = 0.f;
+    inline static constexpr f32 shape_kind_arc = 1.f;
+
+    // На сколько пикселей четырёхугольник больше фигуры (для сглаживания краёв)
+    inline static constexpr f32 shape_margin_ = 1.f;
+
+    // Текущая порция фигур
+    SVertex s_vertices_[max_quads_in_portion_ * vertices_per_quad_];
+
+    // Число вершин в массиве s_vertices_
+    i32 s_num_vertices_ = 0;
+
+    // Шейдерная программа для рендеринга фигур
+    ShaderProgram* s_shader_program_;
+
+    // Цвет фигур в формате 0xAABBGGRR
+    u32 shape_color_ = 0xFFFFFFFF;
+
+    // Данные для функции add_shape()
+    struct
+    {
+        SVertex v0, v1, v2, v3;
+    } shape_;
+
+    // Добавляет 4 вершины в массив s_vertices_. Вызывает flush(), если массив полон.
+    // Перед вызовом этой функции необходимо заполнить структуру shape_
+    void add_shape();
+
+    // Часть add_shape() после отсечения
+    void submit_shape();
+
+    // Заполняет shape_ и вызывает add_shape().
+    // axis_x - единичный вектор, задающий поворот фигуры. half_size - половина размера фигуры без учёта shape_margin_
+    void add_shape(glm::vec2 center_pos, glm::vec2 axis_x, glm::vec2 half_size, const glm::vec4& params);
+
+    // ============================ Области отсечения ============================
+
+private:
+
+    // Стек областей отсечения. Каждая область уже пересечена с предыдущей.
+    // Если стек пуст, то отсечение не производится
+    std::vector<Aabb> clip_stack_;
+
+    // Выводится ли текущая порция со scissor-тестом.
+    // Scissor используется только для геометрии, которую нельзя обрезать на CPU (повёрнутые
+    // четырёхугольники, треугольники, фигуры), так как смена области scissor требует flush()
+    bool portion_scissor_ = false;
+
+    // Область scissor-теста текущей порции (в тех же координатах, что и вершины)
+    Aabb portion_scissor_rect_;
+
+    // Включает или выключает scissor-тест для следующей геометрии (включённый scissor-тест
+    // использует текущую область отсечения). Вызывает flush(), если порция выводится иначе
+    void set_portion_scissor(bool enabled);
+
+    // То же, но с заданной областью (для геометрии, отложенной до end_depth_scene())
+    void set_portion_scissor(bool enabled, const Aabb& rect);
+
+    // Результат проверки геометрии областью отсечения
+    enum class ClipResult
+    {
+        culled,  // Геометрия полностью за пределами области отсечения
+        inside,  // Геометрия полностью внутри области отсечения
+        partial  // Геометрию нужно обрезать
+    };
+
+    // Вызывается только при непустом стеке областей отсечения
+    ClipResult test_clip(const Aabb& bounds);
+
+    // Обрезает на CPU четырёхугольник в структуре quad (позиции и текстурные координаты),
+    // если он не повёрнут, иначе включает scissor-тест.
+    // Возвращает false, если четырёхугольник полностью отсечён
+    bool clip_quad();
+
+public:
+
+    // Добавляет область отсечения (пересекается с текущей).
+    // Неповёрнутые спрайты и текст обрезаются на CPU без разрыва порции
+    void push_clip(const Rect& rect);
+
+    void pop_clip();
+
+    // ============================ Сцена с буфером глубины ============================
+
+private:
+
+    // Атрибуты вершин четырёхугольников в сцене с буфером глубины
+    struct DVertex
+    {
+        glm::vec2 position;
+        u32 color; // Цвет в формате 0xAABBGGRR
+        glm::vec2 uv;
+        f32 depth;
+    };
+
+    // Отложенный до end_depth_scene() четырёхугольник
+    struct DepthQuad
+    {
+        Texture* texture;
+        ShaderProgram* shader_program;
+        f32 depth;
+        QVertex v0, v1, v2, v3;
+    };
+
+    // Идёт ли накопление сцены
+    bool depth_scene_ = false;
+
+    // Глубина следующих спрайтов
+    f32 depth_ = 0.f;
+
+    // Непрозрачные четырёхугольники. Рисуются спереди назад с записью глубины
+    std::vector<DepthQuad> opaque_quads_;
+
+    // Полупрозрачные четырёхугольники. Рисуются в порядке добавления после непрозрачных
+    std::vector<DepthQuad> translucent_quads_;
+
+    // Треугольник или фигура, отложенные до end_depth_scene()
+    struct DeferredPrimitive
+    {
+        // Сколько полупрозрачных четырёхугольников добавлено раньше. Задаёт место в порядке вывода
+        u32 num_quads_before;
+
+        bool is_shape;
+        u32 index; // Индекс в deferred_shapes_ или deferred_triangles_
+
+        // Область scissor-теста на момент добавления
+        bool scissor;
+        Aabb scissor_rect;
+    };
+
+    // Отложенные треугольники и фигуры в порядке добавления
+    std::vector<DeferredPrimitive> deferred_primitives_;
+    std::vector<decltype(triangle_)> deferred_triangles_;
+    std::vector<decltype(shape_)> deferred_shapes_;
+
+    // Первый ещё не выведенный элемент deferred_primitives_
+    size_t next_deferred_primitive_ = 0;
+
+    // Текущая порция четырёхугольников с глубиной
+    DVertex d_vertices_[max_quads_in_portion_ * vertices_per_quad_];
+
+    // Число вершин в массиве d_vertices_
+    i32 d_num_vertices_ = 0;
+
+    // Текущая текстура для четырёхугольников с глубиной
+    Texture* d_current_texture_ = nullptr;
+
+    // Шейдерная программа для четырёхугольников с глубиной
+    ShaderProgram* d_shader_program_;
+
+    // Вершинный буфер для четырёхугольников с глубиной (индексный буфер общий с четырёхугольниками)
+    std::unique_ptr<VertexBuffer> d_vertex_buffer_;
+
+    // Откладывает четырёхугольник из структуры quad до end_depth_scene()
+    void defer_quad();
+
+    // Откладывает треугольник из triangle_ или фигуру из shape_ до end_depth_scene()
+    void defer_primitive(bool is_shape);
+
+    // Рисует отложенные треугольники и фигуры, которые были добавлены после num_quads_before
+    // полупрозрачных четырёхугольников
+    void draw_deferred_primitives(u32 num_quads_before);
+
+    // Рисует отложенные четырёхугольники. Среди полупрозрачных рисует и отложенные треугольники и фигуры
+    void draw_depth_quads(const std::vector<DepthQuad>& quads, bool translucent);
+
+    // Причина рендеринга порции (для отладки)
+    enum class FlushReason : u32
+    {
+        manual,      // Явный вызов flush()
+        primitive,   // Смена вида геометрии (треугольники, четырёхугольники, фигуры)
+        full,        // Порция заполнена
+        texture,     // Смена текстуры
+        shader,      // Смена шейдера
+        scissor,     // Смена области scissor-теста
+        state,       // Вызов prepare_ogl()
+        depth_scene  // Начало или конец сцены с буфером глубины
+    };
+
+    // Название причины для отладки. Реализация в sprite_batch_debug.cpp
+    static const char* flush_reason_name(FlushReason reason);
+
+    // Рендерит накопленные четырёхугольники с глубиной
+    void flush_depth_quads(FlushReason reason);
+
+public:
+
+    // Начинает сцену с буфером глубины (требуется буфер глубины у текущего фреймбуфера).
+    // Четырёхугольники откладываются до end_depth_scene(). Непрозрачные (непрозрачная текстура,
+    // дефолтный шейдер, непрозрачный цвет вершин) рисуются спереди назад с записью глубины,
+    // поэтому закрытые пиксели не закрашиваются повторно. Полупрозрачные рисуются после них
+    // в порядке добавления с проверкой глубины.
+    // Четырёхугольники с нестандартным шейдером (например текст из атласа с упаковкой по каналам)
+    // рисуются вместе с полупрозрачными, но без проверки глубины.
+    // Треугольники и фигуры тоже откладываются и рисуются среди полупрозрачных в порядке добавления,
+    // без проверки глубины. Повёрнутые спрайты не обрезаются областями отсечения
+    void begin_depth_scene();
+
+    // Глубина следующих спрайтов в диапазоне [0, 1]. Меньшее значение - ближе к камере.
+    // Полупрозрачные спрайты должны добавляться от дальних к ближним
+    void set_depth(f32 depth);
+
+    void end_depth_scene();
+
+    // ============================ Отладка ============================
+
+private:
+
+    SpriteBatchDebugMode debug_mode_ = SpriteBatchDebugMode::none;
+
+    // Закрашивает геометрию цветом u_color. Используется для тепловой карты и подкрашивания порций
+    ShaderProgram* debug_shader_program_;
+
+    // Раскрашивает тепловую карту
+    ShaderProgram* heatmap_shader_program_;
+
+    // В режиме overdraw сцена рисуется сюда. Пересоздаётся при изменении размера вьюпорта
+    std::unique_ptr<Fbo> overdraw_fbo_;
+
+    // Что было привязано до переключения на overdraw_fbo_
+    GLint prev_framebuffer_ = 0;
+    IntRect prev_viewport_;
+
+    // Шрифт для подписей порций в режиме batches. Без шрифта порции только подкрашиваются
+    SpriteFont* debug_font_ = nullptr;
+
+    // Порция, выведенная в текущем кадре
+    struct DebugBatch
+    {
+        FlushReason reason;
+        Aabb bounds;
+        i32 num_primitives;
+        u32 color; // 0xAABBGGRR
+    };
+
+    std::vector<DebugBatch> debug_batches_;
+
+    // Состояние OpenGL, которое меняется при подкрашивании порции
+    bool tint_blend_ = false;
+    bool tint_depth_test_ = false;
+
+    // Смешение до begin_debug_frame() (в режиме overdraw) или до end_debug_frame().
+    // Восстанавливается в конце end_debug_frame()
+    struct DebugBlendState
+    {
+        GLboolean enabled = GL_FALSE;
+        GLint src_rgb = GL_ONE, dst_rgb = GL_ZERO;
+        GLint src_alpha = GL_ONE, dst_alpha = GL_ZERO;
+        GLint equation_rgb = GL_FUNC_ADD, equation_alpha = GL_FUNC_ADD;
+    } debug_blend_state_;
+
+    void save_debug_blend_state();
+    void restore_debug_blend_state() const;
+
+    // Запоминает порцию и задаёт uniform-переменные debug_shader_program_ для её подкрашивания
+    void prepare_debug_tint(FlushReason reason, const Aabb& bounds, i32 num_primitives);
+
+    // То же, что prepare_debug_tint(), но ещё настраивает смешение для повторного вывода геометрии
+    // напрямую через OpenGL. После повторного вызова отрисовки нужно вызвать end_debug_tint()
+    void begin_debug_tint(FlushReason reason, const Aabb& bounds, i32 num_primitives);
+    void end_debug_tint();
+
+public:
+
+    // Реализация отладочных режимов в sprite_batch_debug.cpp
+
+    SpriteBatchDebugMode debug_mode() const { return debug_mode_; }
+    void set_debug_mode(SpriteBatchDebugMode mode);
+
+    void set_debug_font(SpriteFont* font) { debug_font_ = font; }
+
+    // Отладочные режимы сами не включаются. Владелец батча каждый кадр вызывает:
+    //   sprite_batch->begin_debug_frame();
+    //   sprite_batch->prepare_ogl();
+    //   ... рисование сцены ...
+    //   sprite_batch->end_debug_frame();
+    // а set_debug_mode() - например, по нажатию клавиши в handle_sdl_event().
+    // В режиме none эти вызовы почти ничего не стоят
+
+    // Вызывается в начале кадра до prepare_ogl() и рисования сцены.
+    // В режиме overdraw переключает рендеринг в FBO с тепловой картой
+    void begin_debug_frame();
+
+    // Вызывается в конце кадра после рисования сцены (до SDL_GL_SwapWindow()).
+    // В режиме overdraw выводит раскрашенную тепловую карту, в режиме batches - подписи порций.
+    // Состояние смешения возвращается к тому, что было до отладочного вывода
+    void end_debug_frame();
+
+    // ============================ Запись команд ============================
+
+private:
+
+    // Записывает вызовы в файл. nullptr, если запись не ведётся
+    std::unique_ptr<SpriteBatchCapture> capture_;
+
+    // num_drawn_quads_ в начале записываемого кадра
+    u64 capture_frame_start_quads_ = 0;
+
+    // Воспроизведение заполняет структуры, которые не видны пользователю
+    friend class SpriteBatchReplay;
+
+public:
+
+    // Реализация в sprite_batch_capture.cpp
+
+    // Начинает записывать все вызовы SpriteBatch в файл на num_frames кадров
+    // (для воспроизведения в dviglo_replay). Вызывается между кадрами.
+    // Без изменения кода запись включается через engine_params::capture_path
+    void begin_capture(const StrUtf8& path, i32 num_frames);
+
+    bool capturing() const { return capture_ != nullptr; }
+
+    // Вызывается в конце каждого кадра. После записи num_frames кадров закрывает файл
+    void end_capture_frame();
+
     // ============================ Общее ============================
 
 private:
 
-    // Вертикальное отражение необходимо при рендеринге в текстуру
+    // Параметры последнего вызова prepare_ogl()
+    bool alpha_blending_ = true;
     bool flip_vertically_ = false;
 
+    // Смешение порций. Задаётся prepare_ogl() или set_blend_mode()
+    RhiBlendMode blend_mode_ = RhiBlendMode::alpha;
+
+    // Смешение, с которым выводится порция. В режиме overdraw всегда аддитивное
+    RhiBlendMode effective_blend_mode() const
+    {
+        return debug_mode_ == SpriteBatchDebugMode::overdraw ? RhiBlendMode::additive : blend_mode_;
+    }
+
+    // Задаёт смешение напрямую через OpenGL так же, как конвейеры RHI. Нужно путям, которые
+    // ещё не перенесены на RHI (multi-draw, четырёхугольники с глубиной), и коду вне SpriteBatch
+    static void apply_gl_blend_mode(RhiBlendMode mode);
+
+    // Делает шейдер текущим и задаёт общие uniform-переменные.
+    // В режиме overdraw вместо него использует debug_shader_program_.
+    // use_depth - есть ли у вершин атрибут глубины
+    ShaderProgram* use_shader(ShaderProgram* shader_program, bool use_depth = false);
+
+    void flush(FlushReason reason);
+
+    // ============================ Вывод через RHI ============================
+
+    // Порции треугольников, четырёхугольников и фигур выводятся через RenderDevice (см. rhi/rhi.hpp).
+    // Пути, ещё не перенесённые на RHI (multi-draw, четырёхугольники с глубиной), используют свои буферы
+
+    // Конвейеры одного шейдера. Индекс - RhiBlendMode
+    using RhiPipelines = std::array<RhiPipeline, num_rhi_blend_modes>;
+
+    struct RhiPortion
+    {
+        // Кольцевой буфер на несколько порций. Порция пишется после предыдущей и выводится со смещением
+        RhiBuffer vertex_buffer;
+        i32 ring_size = 0;   // В вершинах
+        i32 ring_offset = 0; // Куда будет записана следующая порция (в вершинах)
+
+        RhiBuffer index_buffer; // Пустой у треугольников
+
+        std::vector<RhiVertexAttribute> attributes;
+        u32 vertex_stride = 0;
+
+        // Для встроенных шейдеров создаются в init_rhi(), для остальных - при первом использовании
+        std::unordered_map<const ShaderProgram*, RhiPipelines> pipelines;
+    };
+
+    RenderDevice* render_device_ = nullptr;
+    CommandList command_list_;
+
+    RhiPortion t_portion_;
+    RhiPortion q_portion_;
+    RhiPortion s_portion_;
+
+    // Шейдеры RHI для программ из ShaderCache
+    std::unordered_map<const ShaderProgram*, RhiShader> rhi_shaders_;
+
+    // Импортированные текстуры. Новая текстура по адресу удалённой получает её дескриптор,
+    // что безопасно, так как дескриптор хранит только адрес
+    std::unordered_map<const Texture*, RhiTexture> rhi_textures_;
+
+    // Сколько текстур можно импортировать, прежде чем rhi_textures_ будет очищен
+    inline static constexpr size_t max_rhi_textures_ = 256;
+
+    // Реализация в sprite_batch_rhi.cpp
+
+    // quad_indices - содержимое q_index_buffer_
+    void init_rhi(const u16* quad_indices);
+    void init_rhi_portion(RhiPortion& portion, i32 max_vertices, u32 vertex_stride, const char* label);
+    void release_rhi();
+
+    RhiShader get_rhi_shader(ShaderProgram* shader_program);
+
+    // Элементы пустые, если шейдер не удалось получить
+    const RhiPipelines& get_pipelines(RhiPortion& portion, ShaderProgram* shader_program);
+
+    RhiTexture get_rhi_texture(Texture* texture);
+
+    // Загружает вершины и выводит порцию. texture может быть nullptr.
+    // Если num_indices == 0, то вершины выводятся без индексного буфера.
+    // Если tint == true, то порция затем подкрашивается (см. prepare_debug_tint())
+    void draw_portion(RhiPortion& portion, ShaderProgram* shader_program, Texture* texture,
+                      const void* vertices, i32 num_vertices, i32 num_indices, bool tint);
+
 public:
 
     SpriteBatch();
+    ~SpriteBatch();
 
     // Настраивает OpenGL для работы со SpriteBatch.
     // Для корректного рендеринга текста альфа-смешение должно быть включено.
     // Вертикальное отражение необходимо при рендеринге в текстуру
     void prepare_ogl(bool alpha_blending = true, bool flip_vertically = false);
 
+    // Параметры последнего вызова prepare_ogl()
+    bool alpha_blending() const { return alpha_blending_; }
+    bool flip_vertically() const { return flip_vertically_; }
+
+    // Выбирает смешение следующих порций (например, premultiplied для RenderLayer::draw()).
+    // prepare_ogl() задаёт alpha или opaque
+    void set_blend_mode(RhiBlendMode mode);
+    RhiBlendMode blend_mode() const { return blend_mode_; }
+
     // Рендерит накопленную геометрию (то есть текущую порцию)
     void flush();
 
@@ -163,6 +703,26 @@ public:
     // Рисует круг
     void draw_disk(glm::vec2 center_pos, f32 radius, i32 num_segments);
 
+    // ======================= Используем пакетный рендеринг фигур =======================
+    // Края фигур сглаживаются. Цвет задаётся функцией set_shape_color()
+
+    // Рисует круг одним четырёхугольником (в отличие от draw_disk())
+    void draw_circle(glm::vec2 center_pos, f32 radius);
+
+    // Рисует кольцо. radius - внешний радиус
+    void draw_ring(glm::vec2 center_pos, f32 radius, f32 thickness);
+
+    // Рисует прямоугольник со скруглёнными углами.
+    // Если outline_thickness > 0, то рисуется только обводка указанной толщины (внутрь прямоугольника)
+    void draw_rounded_rect(const Rect& rect, f32 corner_radius, f32 outline_thickness = 0.f);
+
+    // Рисует линию с закруглёнными концами (капсулу)
+    void draw_line(glm::vec2 from, glm::vec2 to, f32 thickness);
+
+    // Рисует дугу с закруглёнными концами. radius - радиус средней линии.
+    // Углы в радианах и увеличиваются по часовой стрелке, как в draw_disk()
+    void draw_arc(glm::vec2 center_pos, f32 radius, f32 thickness, f32 start_angle, f32 end_angle);
+
     // ======================= Используем пакетный рендеринг четырёхугольников =======================
 
 private:
@@ -182,6 +742,7 @@ private:
         u32 color1; // Верхний правый угол
         u32 color2; // Нижний правый угол
         u32 color3; // Нижний левый угол
+        u32 channel_mask;
     } sprite;
 
     // Берёт данные из sprite, вычисляет позиции вершин и записывает их в quad
@@ -209,6 +770,26 @@ public:
     Rect measure_sprite(Texture* texture, glm::vec2 position = {0.f, 0.f}, const Rect* source = nullptr,
         f32 rotation = 0.f, glm::vec2 origin = {0.f, 0.f}, glm::vec2 scale = {1.f, 1.f});
 
+private:
+    // Добавляет четырёхугольник со сторонами, параллельными осям, без вызова transform_sprite_internal()
+    void add_axis_aligned_quad(Texture* texture, glm::vec2 pos_min, glm::vec2 pos_max, glm::vec2 uv_min, glm::vec2 uv_max, u32 color);
+
+public:
+    // Рамка из 9 частей: углы не масштабируются, края растягиваются вдоль одной оси, а центр - по обеим.
+    // borders - ширина краёв в пикселях текстуры (nullptr - Texture::nine_slice_borders()).
+    // border_scale - во сколько раз края на экране больше, чем в текстуре.
+    // Если destination меньше суммы краёв, края пропорционально сужаются.
+    // Без поворота. Реализация в sprite_batch_nine_slice.cpp.
+    // color - цвет в формате 0xAABBGGRR
+    void draw_nine_slice(Texture* texture, const Rect& destination, const Rect* source = nullptr,
+        u32 color = 0xFFFFFFFF, const NineSliceBorders* borders = nullptr, f32 border_scale = 1.f);
+
+    // Заполняет destination копиями source размером source.size * tile_scale.
+    // Крайние копии обрезаются. Без поворота. Реализация в sprite_batch_nine_slice.cpp.
+    // color - цвет в формате 0xAABBGGRR
+    void draw_tiled(Texture* texture, const Rect& destination, const Rect* source = nullptr,
+        u32 color = 0xFFFFFFFF, glm::vec2 tile_scale = {1.f, 1.f});
+
     // color - цвет в формате 0xAABBGGRR
     void draw_string(const StrUtf8& text, SpriteFont* font, glm::vec2 position, u32 color = 0xFFFFFFFF,
         f32 rotation = 0.0f, glm::vec2 origin = {0.f, 0.f}, glm::vec2 scale = {1.f, 1.f}, FlipModes flip_modes = FlipModes::none);
@@ -0,0 +1,575 @@
+// Copyright (c) the Dviglo project
+// License: MIT
+
+#include "sprite_batch_capture.hpp"
+
+#include "sprite_batch.hpp"
+
+#include "../fs/file.hpp"
+#include "../fs/file_base.hpp"
+#include "../fs/fs_base.hpp"
+#include "../fs/log.hpp"
+#include "../gl_utils/gl_utils.hpp"
+#include "../gl_utils/shader_cache.hpp"
+#include "../gl_utils/texture_cache.hpp"
+
+#include <cstring> // memcpy
+
+using namespace glm;
+using namespace std;
+
+
+namespace dviglo
+{
+
+// ============================ SpriteBatchCapture ============================
+
+SpriteBatchCapture::SpriteBatchCapture(const StrUtf8& path, i32 num_frames, u32 triangle_vertex_size,
+                                       u32 quad_vertex_size, u32 shape_vertex_size)
+    : frames_left_(num_frames)
+{
+    file_ = file_open(path, "wb");
+
+    if (!file_)
+    {
+        DV_LOG->writef_error("{} | !file_ | path = \"{}\"", DV_FUNCSIG, path);
+        return;
+    }
+
+    header_.triangle_vertex_size = triangle_vertex_size;
+    header_.quad_vertex_size = quad_vertex_size;
+    header_.shape_vertex_size = shape_vertex_size;
+    write(header_);
+}
+
+SpriteBatchCapture::~SpriteBatchCapture()
+{
+    if (!file_)
+        return;
+
+    // Перезаписываем заголовок, так как число кадров стало известно только сейчас
+    file_rewind(file_);
+    write(header_);
+    file_close(file_);
+}
+
+void SpriteBatchCapture::write(const void* data, size_t size)
+{
+    if (file_)
+        file_write(data, 1, (i32)size, file_);
+}
+
+void SpriteBatchCapture::write_path(const StrUtf8& path)
+{
+    StrUtf8 base_path = get_base_path();
+    bool relative = !base_path.empty() && path.starts_with(base_path);
+    StrViewUtf8 str = relative ? StrViewUtf8(path).substr(base_path.size()) : StrViewUtf8(path);
+
+    write((u8)relative);
+    write((u32)str.size());
+    write(str.data(), str.size());
+}
+
+u32 SpriteBatchCapture::texture_id(const Texture* texture)
+{
+    if (!texture)
+        return sb_null_texture_id;
+
+    auto it = texture_ids_.find(texture);
+
+    if (it != texture_ids_.end())
+        return it->second;
+
+    u32 id = (u32)texture_ids_.size();
+    texture_ids_[texture] = id;
+
+    StrUtf8 path = DV_TEXTURE_CACHE->find_path(texture);
+    shared_ptr<Image> image = path.empty() ? texture->image() : nullptr;
+
+    if (image && image->size() != texture->size())
+        image = nullptr;
+
+    write(SBCommand::define_texture);
+    write(id);
+    write_path(path);
+    write(texture->size());
+
+    if (image)
+    {
+        write((i32)image->num_components());
+        write(image->const_data(), (size_t)image->width() * image->height() * image->num_components());
+    }
+    else
+    {
+        write((i32)0);
+    }
+
+    return id;
+}
+
+u32 SpriteBatchCapture::shader_id(const ShaderProgram* shader_program)
+{
+    auto it = shader_ids_.find(shader_program);
+
+    if (it != shader_ids_.end())
+        return it->second;
+
+    u32 id = (u32)shader_ids_.size();
+    shader_ids_[shader_program] = id;
+
+    StrUtf8 vertex_shader_path, fragment_shader_path, geometry_shader_path;
+
+    if (!DV_SHADER_CACHE->find_paths(shader_program, &vertex_shader_path, &fragment_shader_path, &geometry_shader_path))
+        DV_LOG->writef_warning("{} | !find_paths(...)", DV_FUNCSIG);
+
+    write(SBCommand::define_shader);
+    write(id);
+    write_path(vertex_shader_path);
+    write_path(fragment_shader_path);
+    write_path(geometry_shader_path);
+
+    return id;
+}
+
+void SpriteBatchCapture::end_frame(u32 num_drawn_quads)
+{
+    write(SBCommand::end_frame);
+    write(num_drawn_quads);
+    --frames_left_;
+    ++header_.num_frames;
+}
+
+void SpriteBatchCapture::prepare_ogl(bool alpha_blending, bool flip_vertically)
+{
+    write(SBCommand::prepare_ogl);
+    write(get_viewport());
+    write((u8)alpha_blending);
+    write((u8)flip_vertically);
+}
+
+void SpriteBatchCapture::push_clip(const Rect& rect)
+{
+    write(SBCommand::push_clip);
+    write(rect);
+}
+
+void SpriteBatchCapture::set_depth(f32 depth)
+{
+    write(SBCommand::set_depth);
+    write(depth);
+}
+
+void SpriteBatchCapture::set_blend_mode(RhiBlendMode mode)
+{
+    write(SBCommand::set_blend_mode);
+    write((u8)mode);
+}
+
+void SpriteBatchCapture::triangle(const void* vertices)
+{
+    write(SBCommand::triangle);
+    write(vertices, header_.triangle_vertex_size * 3);
+}
+
+void SpriteBatchCapture::quad(const Texture* texture, const ShaderProgram* shader_program, const void* vertices)
+{
+    // Определения текстуры и шейдера должны идти перед командой
+    u32 tex_id = texture_id(texture);
+    u32 sp_id = shader_id(shader_program);
+
+    write(SBCommand::quad);
+    write(tex_id);
+    write(sp_id);
+    write(vertices, header_.quad_vertex_size * 4);
+}
+
+void SpriteBatchCapture::shape(const void* vertices)
+{
+    write(SBCommand::shape);
+    write(vertices, header_.shape_vertex_size * 4);
+}
+
+// ============================ SpriteBatchReplay ============================
+
+// Последовательное чтение из буфера с проверкой границ
+struct CaptureReader
+{
+    const byte* data;
+    size_t size;
+    size_t offset = 0;
+    bool error = false;
+
+    // Возвращает указатель на следующие num_bytes байт или nullptr, если данные закончились
+    const byte* skip(size_t num_bytes)
+    {
+        if (error || offset + num_bytes > size)
+        {
+            error = true;
+            return nullptr;
+        }
+
+        const byte* ret = data + offset;
+        offset += num_bytes;
+        return ret;
+    }
+
+    void read(void* out, size_t num_bytes)
+    {
+        const byte* src = skip(num_bytes);
+
+        if (src)
+            memcpy(out, src, num_bytes);
+    }
+
+    template <typename T>
+    T read()
+    {
+        T ret{};
+        read(&ret, sizeof(T));
+        return ret;
+    }
+
+    StrUtf8 read_path()
+    {
+        bool relative = read<u8>();
+        u32 length = read<u32>();
+        const byte* str = skip(length);
+
+        if (!str)
+            return StrUtf8();
+
+        StrUtf8 ret((const char*)str, length);
+
+        if (relative)
+            ret = get_base_path() + ret;
+
+        return ret;
+    }
+};
+
+// Определение текстуры в файле
+struct TextureDef
+{
+    u32 id;
+    StrUtf8 path;
+    ivec2 size;
+    i32 num_components;
+    const byte* pixels;
+};
+
+static TextureDef read_texture_def(CaptureReader& reader)
+{
+    TextureDef ret;
+    ret.id = reader.read<u32>();
+    ret.path = reader.read_path();
+    ret.size = reader.read<ivec2>();
+    ret.num_components = reader.read<i32>();
+    ret.pixels = nullptr;
+
+    if (ret.num_components > 0)
+        ret.pixels = reader.skip((size_t)ret.size.x * ret.size.y * ret.num_components);
+
+    return ret;
+}
+
+SpriteBatchReplay::SpriteBatchReplay(const StrUtf8& path)
+{
+    data_ = read_all_data(path);
+
+    if (data_.empty())
+        return;
+
+    if (!load())
+    {
+        DV_LOG->writef_error("{} | !load() | path = \"{}\"", DV_FUNCSIG, path);
+        frame_offsets_.clear();
+    }
+}
+
+bool SpriteBatchReplay::load()
+{
+    CaptureReader reader{data_.data(), data_.size()};
+    header_ = reader.read<SBCaptureHeader>();
+
+    SBCaptureHeader expected;
+
+    if (reader.error || memcmp(header_.magic, expected.magic, sizeof(expected.magic)) != 0
+        || header_.version != expected.version)
+    {
+        DV_LOG->writef_error("{} | wrong header", DV_FUNCSIG);
+        return false;
+    }
+
+    if (header_.triangle_vertex_size != sizeof(SpriteBatch::TVertex)
+        || header_.quad_vertex_size != sizeof(SpriteBatch::QVertex)
+        || header_.shape_vertex_size != sizeof(SpriteBatch::SVertex))
+    {
+        DV_LOG->writef_error("{} | wrong vertex size", DV_FUNCSIG);
+        return false;
+    }
+
+    bool frame_start = true;
+
+    while (reader.offset < reader.size && !reader.error)
+    {
+        if (frame_start)
+        {
+            frame_offsets_.push_back(reader.offset);
+            frame_start = false;
+        }
+
+        SBCommand command = reader.read<SBCommand>();
+
+        switch (command)
+        {
+        case SBCommand::end_frame:
+            reader.skip(sizeof(u32));
+            frame_start = true;
+            break;
+
+        case SBCommand::define_texture:
+        {
+            TextureDef def = read_texture_def(reader);
+
+            if (reader.error)
+                break;
+
+            if (textures_.size() <= def.id)
+                textures_.resize(def.id + 1);
+
+            if (!def.path.empty())
+            {
+                textures_[def.id] = DV_TEXTURE_CACHE->get(def.path);
+            }
+            else if (def.pixels)
+            {
+                Image image(def.size, def.num_components);
+                memcpy(image.data(), def.pixels, (size_t)def.size.x * def.size.y * def.num_components);
+                textures_[def.id] = make_shared<Texture>(image);
+            }
+            else
+            {
+                // Пиксели неизвестны (например текстура FBO). На производительность это не влияет
+                textures_[def.id] = make_shared<Texture>(def.size);
+            }
+
+            break;
+        }
+
+        case SBCommand::define_shader:
+        {
+            u32 id = reader.read<u32>();
+            StrUtf8 vertex_shader_path = reader.read_path();
+            StrUtf8 fragment_shader_path = reader.read_path();
+            StrUtf8 geometry_shader_path = reader.read_path();
+
+            if (reader.error)
+                break;
+
+            if (shader_programs_.size() <= id)
+                shader_programs_.resize(id + 1, nullptr);
+
+            if (!vertex_shader_path.empty())
+                shader_programs_[id] = DV_SHADER_CACHE->get(vertex_shader_path, fragment_shader_path, geometry_shader_path);
+
+            break;
+        }
+
+        case SBCommand::prepare_ogl:
+        {
+            IntRect viewport = reader.read<IntRect>();
+            reader.skip(2);
+            target_size_ = max(target_size_, viewport.pos + viewport.size);
+            break;
+        }
+
+        case SBCommand::flush:
+        case SBCommand::pop_clip:
+        case SBCommand::begin_depth_scene:
+        case SBCommand::end_depth_scene:
+            break;
+
+        case SBCommand::push_clip:
+            reader.skip(sizeof(Rect));
+            break;
+
+        case SBCommand::set_depth:
+            reader.skip(sizeof(f32));
+            break;
+
+        case SBCommand::set_blend_mode:
+            reader.skip(sizeof(u8));
+            break;
+
+        case SBCommand::triangle:
+            reader.skip(header_.triangle_vertex_size * 3);
+            break;
+
+        case SBCommand::quad:
+            reader.skip(sizeof(u32) * 2 + header_.quad_vertex_size * 4);
+            break;
+
+        case SBCommand::shape:
+            reader.skip(header_.shape_vertex_size * 4);
+            break;
+
+        default:
+            DV_LOG->writef_error("{} | unknown command {}", DV_FUNCSIG, (u32)command);
+            return false;
+        }
+    }
+
+    // Запись могла оборваться, но целые кадры можно воспроизвести
+    if (reader.error && !frame_start)
+        frame_offsets_.pop_back();
+
+    return !frame_offsets_.empty();
+}
+
+bool SpriteBatchReplay::play_frame(i32 index, SpriteBatch* sprite_batch) const
+{
+    CaptureReader reader{data_.data(), data_.size(), frame_offsets_[index]};
+    u64 start_num_quads = sprite_batch->num_drawn_quads_;
+
+    while (reader.offset < reader.size && !reader.error)
+    {
+        SBCommand command = reader.read<SBCommand>();
+
+        switch (command)
+        {
+        case SBCommand::end_frame:
+            return reader.read<u32>() == sprite_batch->num_drawn_quads_ - start_num_quads;
+
+        case SBCommand::define_texture:
+            read_texture_def(reader);
+            break;
+
+        case SBCommand::define_shader:
+            reader.skip(sizeof(u32));
+            reader.read_path();
+            reader.read_path();
+            reader.read_path();
+            break;
+
+        case SBCommand::prepare_ogl:
+        {
+            IntRect viewport = reader.read<IntRect>();
+            bool alpha_blending = reader.read<u8>();
+            bool flip_vertically = reader.read<u8>();
+            glViewport(viewport.pos.x, viewport.pos.y, viewport.size.x, viewport.size.y);
+            sprite_batch->prepare_ogl(alpha_blending, flip_vertically);
+            break;
+        }
+
+        case SBCommand::flush:
+            sprite_batch->flush();
+            break;
+
+        case SBCommand::push_clip:
+            sprite_batch->push_clip(reader.read<Rect>());
+            break;
+
+        case SBCommand::pop_clip:
+            sprite_batch->pop_clip();
+            break;
+
+        case SBCommand::begin_depth_scene:
+            sprite_batch->begin_depth_scene();
+            break;
+
+        case SBCommand::set_depth:
+            sprite_batch->set_depth(reader.read<f32>());
+            break;
+
+        case SBCommand::set_blend_mode:
+            sprite_batch->set_blend_mode((RhiBlendMode)reader.read<u8>());
+            break;
+
+        case SBCommand::end_depth_scene:
+            sprite_batch->end_depth_scene();
+            break;
+
+        case SBCommand::triangle:
+            reader.read(&sprite_batch->triangle_, sizeof(sprite_batch->triangle_));
+            sprite_batch->add_triangle();
+            break;
+
+        case SBCommand::quad:
+        {
+            u32 texture_id = reader.read<u32>();
+            u32 shader_id = reader.read<u32>();
+
+            Texture* texture = texture_id < textures_.size() ? textures_[texture_id].get() : nullptr;
+            ShaderProgram* shader_program = shader_id < shader_programs_.size() ? shader_programs_[shader_id] : nullptr;
+
+            sprite_batch->quad.texture = texture;
+            sprite_batch->quad.shader_program = shader_program ? shader_program : sprite_batch->q_default_shader_program_;
+            reader.read(&sprite_batch->quad.v0, sizeof(SpriteBatch::QVertex) * SpriteBatch::vertices_per_quad_);
+
+            if (texture || texture_id == sb_null_texture_id)
+                sprite_batch->add_quad();
+
+            break;
+        }
+
+        case SBCommand::shape:
+            reader.read(&sprite_batch->shape_, sizeof(sprite_batch->shape_));
+            sprite_batch->add_shape();
+            break;
+        }
+    }
+
+    return false;
+}
+
+// ============================ SpriteBatch ============================
+
+void SpriteBatch::begin_capture(const StrUtf8& path, i32 num_frames)
+{
+    if (capture_)
+    {
+        DV_LOG->writef_error("{} | capture_", DV_FUNCSIG);
+        return;
+    }
+
+    if (num_frames <= 0)
+    {
+        DV_LOG->writef_error("{} | num_frames <= 0", DV_FUNCSIG);
+        return;
+    }
+
+    capture_ = make_unique<SpriteBatchCapture>(path, num_frames, (u32)sizeof(TVertex),
+                                               (u32)sizeof(QVertex), (u32)sizeof(SVertex));
+
+    if (!capture_->is_open())
+    {
+        capture_ = nullptr;
+        return;
+    }
+
+    // Состояние, заданное до начала записи, тоже нужно воспроизвести
+    capture_->prepare_ogl(alpha_blending_, flip_vertically_);
+
+    if (blend_mode_ != (alpha_blending_ ? RhiBlendMode::alpha : RhiBlendMode::opaque))
+        capture_->set_blend_mode(blend_mode_);
+    capture_frame_start_quads_ = num_drawn_quads_;
+
+    DV_LOG->writef_info("SpriteBatch capture started | path = \"{}\", num_frames = {}", path, num_frames);
+}
+
+void SpriteBatch::end_capture_frame()
+{
+    if (!capture_)
+        return;
+
+    capture_->end_frame((u32)(num_drawn_quads_ - capture_frame_start_quads_));
+    capture_frame_start_quads_ = num_drawn_quads_;
+
+    if (capture_->finished())
+    {
+        capture_ = nullptr; // Деструктор закрывает файл
+        DV_LOG->write_info("SpriteBatch capture finished");
+    }
+}
+
+} // namespace dviglo
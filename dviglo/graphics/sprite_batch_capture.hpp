@@ -0,0 +1,156 @@
+// Copyright (c) the Dviglo project
+// License: MIT
+
+#pragma once
+
+#include "../gl_utils/shader_program.hpp"
+#include "../gl_utils/texture.hpp"
+#include "../math/rect.hpp"
+#include "../rhi/rhi.hpp"
+
+#include <cstdio>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+
+namespace dviglo
+{
+
+class SpriteBatch;
+
+// Команды в файле записи SpriteBatch.
+// Спрайты, текст и фигуры записываются в виде вершин, которые они добавляют в порции,
+// поэтому при воспроизведении не нужны шрифты и не тратится время на раскладку текста
+enum class SBCommand : u8
+{
+    end_frame,         // u32 число четырёхугольников, попавших в порции за кадр
+    define_texture,    // u32 id, путь, ivec2 размер, i32 число компонентов (0 - без пикселей), пиксели
+    define_shader,     // u32 id, пути к вершинному, фрагментному и геометрическому шейдерам
+    prepare_ogl,       // IntRect вьюпорт, u8 alpha_blending, u8 flip_vertically
+    flush,
+    push_clip,         // Rect
+    pop_clip,
+    begin_depth_scene,
+    set_depth,         // f32
+    end_depth_scene,
+    triangle,          // 3 вершины
+    quad,              // u32 id текстуры (sb_null_texture_id - без текстуры), u32 id шейдера, 4 вершины
+    shape,             // 4 вершины
+    set_blend_mode     // u8 RhiBlendMode
+};
+
+// id текстуры в команде quad, если текстура не задана
+inline constexpr u32 sb_null_texture_id = 0xFFFFFFFF;
+
+// Заголовок файла записи
+struct SBCaptureHeader
+{
+    char magic[4] = {'D', 'V', 'S', 'B'};
+    u32 version = 3;
+    i32 num_frames = 0; // Заполняется при закрытии файла
+
+    // Размеры вершин. Вершины записываются как есть, поэтому файл
+    // можно воспроизвести только сборкой с тем же форматом вершин
+    u32 triangle_vertex_size = 0;
+    u32 quad_vertex_size = 0;
+    u32 shape_vertex_size = 0;
+};
+
+// Записывает вызовы SpriteBatch в компактный бинарный файл.
+// Текстуры записываются по пути, если загружены через TextureCache, иначе вместе с пикселями
+// (если текстура хранит изображение) или только размером
+class SpriteBatchCapture
+{
+private:
+    FILE* file_ = nullptr;
+
+    SBCaptureHeader header_;
+
+    // Сколько кадров осталось записать
+    i32 frames_left_ = 0;
+
+    // Текстуры и шейдеры, которые уже записаны в файл
+    std::unordered_map<const Texture*, u32> texture_ids_;
+    std::unordered_map<const ShaderProgram*, u32> shader_ids_;
+
+    void write(const void* data, size_t size);
+
+    template <typename T>
+    void write(const T& value) { write(&value, sizeof(T)); }
+
+    void write(SBCommand command) { write(&command, sizeof(command)); }
+
+    // Записывает путь относительно get_base_path(), если возможно
+    void write_path(const StrUtf8& path);
+
+    // При первом использовании текстуры или шейдера записывает команду define_*.
+    // Для nullptr вместо текстуры возвращает sb_null_texture_id
+    u32 texture_id(const Texture* texture);
+    u32 shader_id(const ShaderProgram* shader_program);
+
+public:
+    SpriteBatchCapture(const StrUtf8& path, i32 num_frames, u32 triangle_vertex_size,
+                       u32 quad_vertex_size, u32 shape_vertex_size);
+
+    // Записывает в заголовок число кадров и закрывает файл
+    ~SpriteBatchCapture();
+
+    SpriteBatchCapture(const SpriteBatchCapture&) = delete;
+    SpriteBatchCapture& operator=(const SpriteBatchCapture&) = delete;
+
+    bool is_open() const { return file_ != nullptr; }
+
+    // Все кадры записаны
+    bool finished() const { return frames_left_ <= 0; }
+
+    // num_drawn_quads - сколько четырёхугольников SpriteBatch вывел за кадр
+    void end_frame(u32 num_drawn_quads);
+    void prepare_ogl(bool alpha_blending, bool flip_vertically);
+    void flush() { write(SBCommand::flush); }
+    void push_clip(const Rect& rect);
+    void pop_clip() { write(SBCommand::pop_clip); }
+    void begin_depth_scene() { write(SBCommand::begin_depth_scene); }
+    void set_depth(f32 depth);
+    void set_blend_mode(RhiBlendMode mode);
+    void end_depth_scene() { write(SBCommand::end_depth_scene); }
+    void triangle(const void* vertices);
+    void quad(const Texture* texture, const ShaderProgram* shader_program, const void* vertices);
+    void shape(const void* vertices);
+};
+
+// Воспроизводит файл, записанный SpriteBatchCapture
+class SpriteBatchReplay
+{
+private:
+    std::vector<byte> data_;
+    SBCaptureHeader header_;
+
+    // Смещения начала каждого кадра в data_
+    std::vector<size_t> frame_offsets_;
+
+    // Индекс - id из файла
+    std::vector<std::shared_ptr<Texture>> textures_;
+    std::vector<ShaderProgram*> shader_programs_;
+
+    // Размер фреймбуфера, в который помещаются все вьюпорты из записи
+    glm::ivec2 target_size_{0, 0};
+
+    // Разбирает файл, загружает текстуры и шейдеры.
+    // Возвращает false, если файл повреждён
+    bool load();
+
+public:
+    SpriteBatchReplay(const StrUtf8& path);
+
+    bool is_loaded() const { return !frame_offsets_.empty(); }
+    i32 num_frames() const { return (i32)frame_offsets_.size(); }
+    glm::ivec2 target_size() const { return target_size_; }
+
+    // Повторяет вызовы одного кадра.
+    // Текущий фреймбуфер должен иметь размер не меньше target_size().
+    // Возвращает false, если SpriteBatch вывел не столько четырёхугольников, сколько при записи
+    bool play_frame(i32 index, SpriteBatch* sprite_batch) const;
+};
+
+} // namespace dviglo
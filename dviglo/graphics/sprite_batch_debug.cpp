@@ -0,0 +1,230 @@
+// Copyright (c) the Dviglo project
+// License: MIT
+
+// Отладочные режимы SpriteBatch
+
+#include "sprite_batch.hpp"
+
+#include "../gl_utils/gl_utils.hpp"
+
+#include <cmath> // fmod
+
+using namespace glm;
+using namespace std;
+
+
+namespace dviglo
+{
+
+const char* SpriteBatch::flush_reason_name(FlushReason reason)
+{
+    // Порядок совпадает с SpriteBatch::FlushReason
+    static const char* names[] =
+    {
+        "manual",
+        "primitive",
+        "full",
+        "texture",
+        "shader",
+        "scissor",
+        "state",
+        "depth_scene"
+    };
+
+    return (u32)reason < size(names) ? names[(u32)reason] : "?";
+}
+
+// Соседние порции получают сильно отличающиеся оттенки (шаг по золотому сечению)
+static u32 batch_color(i32 index)
+{
+    f32 hue = fmod(index * 0.618034f, 1.f) * 6.f;
+    f32 x = 1.f - abs(fmod(hue, 2.f) - 1.f);
+    vec3 rgb;
+
+    if (hue < 1.f)
+        rgb = vec3(1.f, x, 0.f);
+    else if (hue < 2.f)
+        rgb = vec3(x, 1.f, 0.f);
+    else if (hue < 3.f)
+        rgb = vec3(0.f, 1.f, x);
+    else if (hue < 4.f)
+        rgb = vec3(0.f, x, 1.f);
+    else if (hue < 5.f)
+        rgb = vec3(x, 0.f, 1.f);
+    else
+        rgb = vec3(1.f, 0.f, x);
+
+    return to_rgba((u32)(rgb.x * 255.f), (u32)(rgb.y * 255.f), (u32)(rgb.z * 255.f), 0xFFu);
+}
+
+void SpriteBatch::set_debug_mode(SpriteBatchDebugMode mode)
+{
+    flush();
+    debug_mode_ = mode;
+    debug_batches_.clear();
+
+    if (mode != SpriteBatchDebugMode::overdraw)
+        overdraw_fbo_.reset();
+}
+
+void SpriteBatch::prepare_debug_tint(FlushReason reason, const Aabb& bounds, i32 num_primitives)
+{
+    u32 color = batch_color((i32)debug_batches_.size());
+    debug_batches_.push_back(DebugBatch{reason, bounds, num_primitives, color});
+
+    debug_shader_program_->use();
+    vec2 viewport_size = get_logical_viewport_size();
+    debug_shader_program_->set("u_pixel_size", vec2(2.f / viewport_size.x, 2.f / viewport_size.y));
+    debug_shader_program_->set("u_flip_vertically", flip_vertically_);
+    debug_shader_program_->set("u_use_depth", false);
+    debug_shader_program_->set("u_color", vec4(get_r(color) / 255.f, get_g(color) / 255.f, get_b(color) / 255.f, 0.35f));
+}
+
+void SpriteBatch::begin_debug_tint(FlushReason reason, const Aabb& bounds, i32 num_primitives)
+{
+    prepare_debug_tint(reason, bounds, num_primitives);
+
+    tint_blend_ = glIsEnabled(GL_BLEND);
+    tint_depth_test_ = glIsEnabled(GL_DEPTH_TEST);
+
+    glEnable(GL_BLEND);
+    glBlendFuncSeparate(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA, GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
+    glDisable(GL_DEPTH_TEST);
+}
+
+void SpriteBatch::end_debug_tint()
+{
+    if (!tint_blend_)
+        glDisable(GL_BLEND);
+
+    if (tint_depth_test_)
+        glEnable(GL_DEPTH_TEST);
+}
+
+void SpriteBatch::save_debug_blend_state()
+{
+    DebugBlendState& state = debug_blend_state_;
+    state.enabled = glIsEnabled(GL_BLEND);
+    glGetIntegerv(GL_BLEND_SRC_RGB, &state.src_rgb);
+    glGetIntegerv(GL_BLEND_DST_RGB, &state.dst_rgb);
+    glGetIntegerv(GL_BLEND_SRC_ALPHA, &state.src_alpha);
+    glGetIntegerv(GL_BLEND_DST_ALPHA, &state.dst_alpha);
+    glGetIntegerv(GL_BLEND_EQUATION_RGB, &state.equation_rgb);
+    glGetIntegerv(GL_BLEND_EQUATION_ALPHA, &state.equation_alpha);
+}
+
+void SpriteBatch::restore_debug_blend_state() const
+{
+    const DebugBlendState& state = debug_blend_state_;
+
+    if (state.enabled)
+        glEnable(GL_BLEND);
+    else
+        glDisable(GL_BLEND);
+
+    glBlendFuncSeparate(state.src_rgb, state.dst_rgb, state.src_alpha, state.dst_alpha);
+    glBlendEquationSeparate(state.equation_rgb, state.equation_alpha);
+}
+
+void SpriteBatch::begin_debug_frame()
+{
+    debug_batches_.clear();
+
+    if (debug_mode_ != SpriteBatchDebugMode::overdraw)
+        return;
+
+    flush();
+
+    prev_viewport_ = get_viewport();
+    glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &prev_framebuffer_);
+
+    if (!overdraw_fbo_ || overdraw_fbo_->texture()->size() != prev_viewport_.size)
+    {
+        overdraw_fbo_ = make_unique<Fbo>(prev_viewport_.size, true); // Буфер глубины для begin_depth_scene()
+        overdraw_fbo_->set_label("SpriteBatch overdraw");
+    }
+
+    overdraw_fbo_->bind();
+    glViewport(0, 0, prev_viewport_.size.x, prev_viewport_.size.y);
+
+    GLfloat clear_color[4];
+    glGetFloatv(GL_COLOR_CLEAR_VALUE, clear_color);
+    glClearColor(0.f, 0.f, 0.f, 0.f);
+    glDepthMask(GL_TRUE);
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    glClearColor(clear_color[0], clear_color[1], clear_color[2], clear_color[3]);
+
+    // Во время кадра смешение аддитивное, поэтому состояние вызывающего кода запоминаем здесь
+    save_debug_blend_state();
+
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_ONE, GL_ONE);
+    glBlendEquation(GL_FUNC_ADD);
+}
+
+void SpriteBatch::end_debug_frame()
+{
+    if (debug_mode_ == SpriteBatchDebugMode::none)
+        return;
+
+    flush();
+
+    // Отладочная геометрия сама не должна учитываться и отсекаться
+    SpriteBatchDebugMode mode = debug_mode_;
+    debug_mode_ = SpriteBatchDebugMode::none;
+    vector<Aabb> clip_stack = std::move(clip_stack_);
+    clip_stack_.clear();
+    set_portion_scissor(false);
+
+    // Если begin_debug_frame() не переключал рендеринг в FBO, то текущее смешение задал вызывающий код
+    if (mode != SpriteBatchDebugMode::overdraw || !overdraw_fbo_)
+        save_debug_blend_state();
+
+    // Отладочный вывод идёт конвейерами с альфа-смешением
+    RhiBlendMode blend_mode = blend_mode_;
+    blend_mode_ = RhiBlendMode::alpha;
+    apply_gl_blend_mode(blend_mode_);
+
+    if (mode == SpriteBatchDebugMode::overdraw && overdraw_fbo_)
+    {
+        glBindFramebuffer(GL_FRAMEBUFFER, prev_framebuffer_);
+        glViewport(prev_viewport_.pos.x, prev_viewport_.pos.y, prev_viewport_.size.x, prev_viewport_.size.y);
+
+        sprite.texture = overdraw_fbo_->texture();
+        sprite.shader_program = heatmap_shader_program_;
+        sprite.destination = Rect(vec2(0.f, 0.f), get_logical_viewport_size());
+        sprite.source_uv = Rect(0.f, 0.f, 1.f, 1.f);
+
+        // Строки текстуры FBO идут снизу вверх
+        sprite.flip_modes = flip_vertically_ ? FlipModes::none : FlipModes::vertically;
+
+        sprite.scale = vec2(1.f, 1.f);
+        sprite.rotation = 0.f;
+        sprite.origin = vec2(0.f, 0.f);
+        sprite.color0 = sprite.color1 = sprite.color2 = sprite.color3 = 0xFFFFFFFF;
+        sprite.channel_mask = 0;
+        draw_sprite_internal();
+        flush();
+    }
+    else if (mode == SpriteBatchDebugMode::batches && debug_font_)
+    {
+        for (size_t i = 0; i < debug_batches_.size(); ++i)
+        {
+            const DebugBatch& batch = debug_batches_[i];
+            StrUtf8 label = "#" + to_string(i) + " " + flush_reason_name(batch.reason)
+                            + " (" + to_string(batch.num_primitives) + ")";
+            draw_string(label, debug_font_, batch.bounds.min, batch.color);
+        }
+
+        flush();
+    }
+
+    blend_mode_ = blend_mode;
+    restore_debug_blend_state();
+
+    debug_batches_.clear();
+    clip_stack_ = std::move(clip_stack);
+    debug_mode_ = mode;
+}
+
+} // namespace dviglo
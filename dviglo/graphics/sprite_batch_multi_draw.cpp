@@ -0,0 +1,178 @@
+// Copyright (c) the Dviglo project
+// License: MIT
+
+// Multi-draw indirect для SpriteBatch (OpenGL 4.3)
+
+#include "sprite_batch.hpp"
+
+#include "../fs/embedded_files.hpp"
+#include "../fs/log.hpp"
+#include "../gl_utils/draw_counters.hpp"
+#include "../gl_utils/gl_debug.hpp"
+#include "../gl_utils/shader_cache.hpp"
+#include "../main/engine_params.hpp"
+
+#include <cstring> // memcpy
+
+using namespace glm;
+using namespace std;
+
+
+namespace dviglo
+{
+
+// Атрибут с номером текстурного юнита. Следует за атрибутами QVertex
+static constexpr GLuint texture_slot_location = 4;
+
+void SpriteBatch::init_multi_draw()
+{
+    if (!engine_params::gl_4_3_features || !GLAD_GL_VERSION_4_3)
+        return;
+
+    StrUtf8 shaders_path = StrUtf8(embedded_prefix) + "engine_data/shaders/";
+    q_multi_draw_shader_program_ = DV_SHADER_CACHE->get(shaders_path + "multi_draw_sprite.vert",
+                                                        shaders_path + "multi_draw_sprite.frag");
+
+    if (!q_multi_draw_shader_program_->gpu_object_name())
+    {
+        DV_LOG->writef_error("{} | !q_multi_draw_shader_program_->gpu_object_name()", DV_FUNCSIG);
+        return;
+    }
+
+    // Текстурные юниты не меняются, поэтому задаём их один раз
+    q_multi_draw_shader_program_->use();
+    for (i32 i = 0; i < max_textures_in_portion_; ++i)
+        q_multi_draw_shader_program_->set("u_textures[" + to_string(i) + "]", i);
+
+    // Атрибут экземпляра с номером юнита. Каждая команда отрисовки рисует один экземпляр,
+    // а baseInstance выбирает элемент буфера
+    u32 texture_slots[max_textures_in_portion_];
+    for (i32 i = 0; i < max_textures_in_portion_; ++i)
+        texture_slots[i] = (u32)i;
+
+    glGenBuffers(1, &q_texture_slot_buffer_);
+    q_vertex_buffer_->bind(); // Атрибут добавляется в VAO четырёхугольников
+    glBindBuffer(GL_ARRAY_BUFFER, q_texture_slot_buffer_);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(texture_slots), texture_slots, GL_STATIC_DRAW);
+    glVertexAttribIPointer(texture_slot_location, 1, GL_UNSIGNED_INT, sizeof(u32), nullptr);
+    glVertexAttribDivisor(texture_slot_location, 1);
+    glEnableVertexAttribArray(texture_slot_location);
+    glBindVertexArray(0);
+
+    glGenBuffers(1, &q_indirect_buffer_);
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, q_indirect_buffer_);
+    glBufferData(GL_DRAW_INDIRECT_BUFFER, q_indirect_buffer_size_, nullptr, GL_STREAM_DRAW);
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+
+    set_gl_label(GL_BUFFER, q_texture_slot_buffer_, "SpriteBatch texture slots");
+    set_gl_label(GL_BUFFER, q_indirect_buffer_, "SpriteBatch draw commands");
+
+    // Прогонов в порции не больше, чем четырёхугольников
+    q_runs_.reserve(max_quads_in_portion_);
+
+    multi_draw_ = true;
+    DV_LOG->write_info("SpriteBatch uses multi-draw indirect");
+}
+
+SpriteBatch::~SpriteBatch()
+{
+    release_rhi();
+
+    glDeleteBuffers(1, &q_texture_slot_buffer_); // Проверка на 0 не нужна
+    glDeleteBuffers(1, &q_indirect_buffer_);
+}
+
+bool SpriteBatch::begin_quad_run()
+{
+    // Отладочные режимы подкрашивают порции и подменяют шейдер, поэтому используют обычный путь
+    if (!multi_draw_ || debug_mode_ != SpriteBatchDebugMode::none || q_num_vertices_ == 0)
+        return false;
+
+    if (quad.shader_program != q_default_shader_program_ || q_current_shader_program_ != q_default_shader_program_)
+        return false;
+
+    i32 slot = 0;
+
+    while (slot < q_num_textures_ && q_textures_[slot] != quad.texture)
+        ++slot;
+
+    if (slot == q_num_textures_)
+    {
+        // Все текстурные юниты заняты
+        if (q_num_textures_ == max_textures_in_portion_)
+            return false;
+
+        q_textures_[q_num_textures_++] = quad.texture;
+    }
+
+    q_runs_.push_back({q_num_vertices_, (u32)slot});
+    q_current_texture_ = quad.texture;
+
+    return true;
+}
+
+void SpriteBatch::draw_quad_runs()
+{
+    use_shader(q_multi_draw_shader_program_);
+
+    for (i32 i = 0; i < q_num_textures_; ++i)
+    {
+        glActiveTexture(GL_TEXTURE0 + i);
+        q_textures_[i]->bind();
+    }
+
+    glActiveTexture(GL_TEXTURE0);
+
+    DrawElementsIndirectCommand commands[max_quads_in_portion_];
+    i32 num_runs = (i32)q_runs_.size();
+
+    for (i32 i = 0; i < num_runs; ++i)
+    {
+        i32 end_vertex = i + 1 < num_runs ? q_runs_[i + 1].first_vertex : q_num_vertices_;
+        i32 num_quads = (end_vertex - q_runs_[i].first_vertex) / vertices_per_quad_;
+
+        // Индексный буфер содержит одинаковые четырёхугольники, начинающиеся с вершины 0,
+        // поэтому прогон выбирается смещением base_vertex
+        commands[i].count = (u32)(num_quads * indices_per_quad_);
+        commands[i].instance_count = 1;
+        commands[i].first_index = 0;
+        commands[i].base_vertex = q_runs_[i].first_vertex;
+        commands[i].base_instance = q_runs_[i].texture_slot;
+    }
+
+    q_vertex_buffer_->set_data(q_num_vertices_, q_vertices_);
+    q_index_buffer_->bind();
+
+    GLsizeiptr commands_size = sizeof(DrawElementsIndirectCommand) * num_runs;
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, q_indirect_buffer_);
+
+    // Кольцо заполнено. GPU ещё может читать старые команды, поэтому память переразмечается
+    if (q_indirect_offset_ + commands_size > q_indirect_buffer_size_)
+    {
+        glBufferData(GL_DRAW_INDIRECT_BUFFER, q_indirect_buffer_size_, nullptr, GL_STREAM_DRAW);
+        q_indirect_offset_ = 0;
+    }
+
+    // Эта часть буфера после переразметки ещё не использовалась, поэтому синхронизация не нужна
+    void* mapped = glMapBufferRange(GL_DRAW_INDIRECT_BUFFER, q_indirect_offset_, commands_size,
+                                    GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+
+    if (mapped)
+    {
+        memcpy(mapped, commands, commands_size);
+        glUnmapBuffer(GL_DRAW_INDIRECT_BUFFER);
+    }
+    else
+    {
+        DV_LOG->writef_error("{} | !mapped", DV_FUNCSIG);
+        glBufferSubData(GL_DRAW_INDIRECT_BUFFER, q_indirect_offset_, commands_size, commands);
+    }
+
+    glMultiDrawElementsIndirect(GL_TRIANGLES, q_index_buffer_->type(), (const void*)q_indirect_offset_, num_runs, 0);
+    q_indirect_offset_ += commands_size;
+    draw_counters::add(q_num_vertices_);
+
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+}
+
+} // namespace dviglo
@@ -0,0 +1,147 @@
+// Copyright (c) the Dviglo project
+// License: MIT
+
+// Рамки из 9 частей и заполнение области повторяющимся спрайтом
+
+#include "sprite_batch.hpp"
+
+#include "../fs/log.hpp"
+
+#include <cmath> // ceil
+
+using namespace glm;
+using namespace std;
+
+
+namespace dviglo
+{
+
+// Ограничение числа копий в draw_tiled() на случай ошибочно маленького tile_scale
+static constexpr i64 max_tiles = 1 << 20;
+
+void SpriteBatch::add_axis_aligned_quad(Texture* texture, vec2 pos_min, vec2 pos_max, vec2 uv_min, vec2 uv_max, u32 color)
+{
+    if (pos_min.x >= pos_max.x || pos_min.y >= pos_max.y)
+        return;
+
+    quad.texture = texture;
+    quad.shader_program = q_default_shader_program_;
+
+    quad.v0.position = pos_min;
+    quad.v0.uv = uv_min;
+
+    quad.v1.position = vec2(pos_max.x, pos_min.y);
+    quad.v1.uv = vec2(uv_max.x, uv_min.y);
+
+    quad.v2.position = pos_max;
+    quad.v2.uv = uv_max;
+
+    quad.v3.position = vec2(pos_min.x, pos_max.y);
+    quad.v3.uv = vec2(uv_min.x, uv_max.y);
+
+    quad.v0.color = quad.v1.color = quad.v2.color = quad.v3.color = color;
+    quad.v0.channel_mask = quad.v1.channel_mask = quad.v2.channel_mask = quad.v3.channel_mask = 0;
+
+    add_quad();
+}
+
+void SpriteBatch::draw_nine_slice(Texture* texture, const Rect& destination, const Rect* source,
+    u32 color, const NineSliceBorders* borders, f32 border_scale)
+{
+    if (!texture)
+        return;
+
+    Rect src = source ? *source : Rect(vec2(0.f), vec2(texture->size()));
+
+    if (!borders)
+        borders = &texture->nine_slice_borders();
+
+    vec2 inv_texture_size = 1.f / vec2(texture->size());
+
+    // Края на экране. Если не помещаются, сужаем пропорционально
+    vec2 border_min = vec2(borders->left, borders->top) * border_scale;
+    vec2 border_max = vec2(borders->right, borders->bottom) * border_scale;
+    vec2 borders_sum = border_min + border_max;
+
+    for (i32 axis = 0; axis < 2; ++axis)
+    {
+        if (borders_sum[axis] > destination.size[axis] && borders_sum[axis] > 0.f)
+        {
+            f32 k = destination.size[axis] / borders_sum[axis];
+            border_min[axis] *= k;
+            border_max[axis] *= k;
+        }
+    }
+
+    // Границы столбцов и строк на экране и в текстуре
+    vec2 dest_end = destination.pos + destination.size;
+    vec2 src_end = src.pos + src.size;
+
+    vec2 pos[4] = {destination.pos, destination.pos + border_min, dest_end - border_max, dest_end};
+
+    vec2 uv[4] =
+    {
+        src.pos * inv_texture_size,
+        (src.pos + vec2(borders->left, borders->top)) * inv_texture_size,
+        (src_end - vec2(borders->right, borders->bottom)) * inv_texture_size,
+        src_end * inv_texture_size
+    };
+
+    // Пустые части (нулевые края) пропускаются в add_axis_aligned_quad()
+    for (i32 row = 0; row < 3; ++row)
+    {
+        for (i32 column = 0; column < 3; ++column)
+        {
+            add_axis_aligned_quad(texture, vec2(pos[column].x, pos[row].y), vec2(pos[column + 1].x, pos[row + 1].y),
+                                  vec2(uv[column].x, uv[row].y), vec2(uv[column + 1].x, uv[row + 1].y), color);
+        }
+    }
+}
+
+void SpriteBatch::draw_tiled(Texture* texture, const Rect& destination, const Rect* source,
+    u32 color, vec2 tile_scale)
+{
+    if (!texture)
+        return;
+
+    Rect src = source ? *source : Rect(vec2(0.f), vec2(texture->size()));
+    vec2 tile_size = src.size * tile_scale;
+
+    if (tile_size.x <= 0.f || tile_size.y <= 0.f || destination.size.x <= 0.f || destination.size.y <= 0.f)
+        return;
+
+    i64 num_columns = (i64)ceil(destination.size.x / tile_size.x);
+    i64 num_rows = (i64)ceil(destination.size.y / tile_size.y);
+
+    if (num_columns * num_rows > max_tiles)
+    {
+        DV_LOG->writef_error("{} | num_columns * num_rows > max_tiles | {} > {}", DV_FUNCSIG,
+                             num_columns * num_rows, max_tiles);
+        return;
+    }
+
+    vec2 inv_texture_size = 1.f / vec2(texture->size());
+    vec2 uv_min = src.pos * inv_texture_size;
+    vec2 uv_size = src.size * inv_texture_size;
+    vec2 dest_end = destination.pos + destination.size;
+
+    for (i64 row = 0; row < num_rows; ++row)
+    {
+        f32 y0 = destination.pos.y + tile_size.y * row;
+        f32 y1 = std::min(y0 + tile_size.y, dest_end.y);
+
+        // Последняя строка может быть обрезана, текстурные координаты сокращаются так же
+        f32 v1 = uv_min.y + uv_size.y * (y1 - y0) / tile_size.y;
+
+        for (i64 column = 0; column < num_columns; ++column)
+        {
+            f32 x0 = destination.pos.x + tile_size.x * column;
+            f32 x1 = std::min(x0 + tile_size.x, dest_end.x);
+            f32 u1 = uv_min.x + uv_size.x * (x1 - x0) / tile_size.x;
+
+            add_axis_aligned_quad(texture, vec2(x0, y0), vec2(x1, y1), uv_min, vec2(u1, v1), color);
+        }
+    }
+}
+
+} // namespace dviglo
@@ -0,0 +1,258 @@
+// Copyright (c) the Dviglo project
+// License: MIT
+
+// Вывод порций SpriteBatch через RHI
+
+#include "sprite_batch.hpp"
+
+#include "../fs/log.hpp"
+#include "../gl_utils/shader_cache.hpp"
+
+#include <cstddef> // offsetof
+
+using namespace glm;
+using namespace std;
+
+
+namespace dviglo
+{
+
+// Сколько порций помещается в кольцевой вершинный буфер
+static constexpr i32 portions_in_ring = 4;
+
+void SpriteBatch::init_rhi_portion(RhiPortion& portion, i32 max_vertices, u32 vertex_stride, const char* label)
+{
+    portion.vertex_stride = vertex_stride;
+    portion.ring_size = max_vertices * portions_in_ring;
+
+    RhiBufferDesc desc;
+    desc.type = RhiBufferType::vertex;
+    desc.usage = RhiBufferUsage::stream_draw;
+    desc.size = (u32)portion.ring_size * vertex_stride;
+    desc.label = label;
+    portion.vertex_buffer = render_device_->create_buffer(desc);
+}
+
+void SpriteBatch::init_rhi(const u16* quad_indices)
+{
+    render_device_ = DV_RENDER_DEVICE;
+
+    if (!render_device_)
+    {
+        DV_LOG->writef_error("{} | !render_device_", DV_FUNCSIG);
+        return;
+    }
+
+    // Номера атрибутов совпадают с VertexBuffer, поэтому шейдеры не меняются
+
+    init_rhi_portion(t_portion_, max_triangles_in_portion_ * vertices_per_triangle_, sizeof(TVertex),
+                     "SpriteBatch triangles");
+    t_portion_.attributes =
+    {
+        {0, RhiVertexFormat::f32x2, offsetof(TVertex, position)},
+        {1, RhiVertexFormat::u8x4_norm, offsetof(TVertex, color)}
+    };
+
+    // Индексный буфер у четырёхугольников и фигур общий. Вершины порции выбираются через base_vertex
+    RhiBufferDesc index_desc;
+    index_desc.type = RhiBufferType::index;
+    index_desc.usage = RhiBufferUsage::static_draw;
+    index_desc.size = max_quads_in_portion_ * indices_per_quad_ * sizeof(u16);
+    index_desc.data = quad_indices;
+    index_desc.label = "SpriteBatch quad indices (RHI)";
+    RhiBuffer index_buffer = render_device_->create_buffer(index_desc);
+
+    init_rhi_portion(q_portion_, max_quads_in_portion_ * vertices_per_quad_, sizeof(QVertex), "SpriteBatch quads (RHI)");
+    q_portion_.index_buffer = index_buffer;
+    q_portion_.attributes =
+    {
+        {0, RhiVertexFormat::f32x2, offsetof(QVertex, position)},
+        {1, RhiVertexFormat::u8x4_norm, offsetof(QVertex, color)},
+        {2, RhiVertexFormat::f32x2, offsetof(QVertex, uv)},
+        {3, RhiVertexFormat::u8x4_norm, offsetof(QVertex, channel_mask)}
+    };
+
+    init_rhi_portion(s_portion_, max_quads_in_portion_ * vertices_per_quad_, sizeof(SVertex), "SpriteBatch shapes");
+    s_portion_.index_buffer = index_buffer;
+    s_portion_.attributes =
+    {
+        {0, RhiVertexFormat::f32x2, offsetof(SVertex, position)},
+        {1, RhiVertexFormat::u8x4_norm, offsetof(SVertex, color)},
+        {2, RhiVertexFormat::f32x2, offsetof(SVertex, local_pos)},
+        {3, RhiVertexFormat::f32x4, offsetof(SVertex, params)}
+    };
+
+    // Конвейеры встроенных шейдеров создаются заранее, чтобы prepare_ogl() только выбирал режим смешения.
+    // debug_shader_program_ нужен тепловой карте и подкрашиванию порций
+    for (ShaderProgram* shader_program : {t_shader_program_, debug_shader_program_})
+        get_pipelines(t_portion_, shader_program);
+
+    for (ShaderProgram* shader_program : {q_default_shader_program_, q_channel_text_shader_program_, debug_shader_program_})
+        get_pipelines(q_portion_, shader_program);
+
+    for (ShaderProgram* shader_program : {s_shader_program_, debug_shader_program_})
+        get_pipelines(s_portion_, shader_program);
+}
+
+void SpriteBatch::release_rhi()
+{
+    if (!render_device_)
+        return;
+
+    for (RhiPortion* portion : {&t_portion_, &q_portion_, &s_portion_})
+    {
+        for (const auto& [shader_program, pipelines] : portion->pipelines)
+        {
+            for (RhiPipeline pipeline : pipelines)
+                render_device_->destroy_pipeline(pipeline);
+        }
+
+        render_device_->destroy_buffer(portion->vertex_buffer);
+    }
+
+    render_device_->destroy_buffer(q_portion_.index_buffer);
+
+    for (const auto& [shader_program, shader] : rhi_shaders_)
+        render_device_->destroy_shader(shader);
+
+    for (const auto& [texture, rhi_texture] : rhi_textures_)
+        render_device_->destroy_texture(rhi_texture);
+}
+
+RhiShader SpriteBatch::get_rhi_shader(ShaderProgram* shader_program)
+{
+    auto it = rhi_shaders_.find(shader_program);
+
+    if (it != rhi_shaders_.end())
+        return it->second;
+
+    // RHI получает шейдер по путям, а GlRenderDevice находит ту же программу в ShaderCache
+    RhiShaderDesc desc;
+    StrUtf8 geometry_shader_path;
+    RhiShader shader;
+
+    if (DV_SHADER_CACHE->find_paths(shader_program, &desc.vertex_shader_path, &desc.fragment_shader_path,
+                                    &geometry_shader_path))
+    {
+        shader = render_device_->create_shader(desc);
+    }
+    else
+    {
+        DV_LOG->writef_error("{} | shader_program is not in ShaderCache", DV_FUNCSIG);
+    }
+
+    // Пустой дескриптор тоже запоминается, чтобы не пытаться создать шейдер каждую порцию
+    rhi_shaders_[shader_program] = shader;
+
+    return shader;
+}
+
+const SpriteBatch::RhiPipelines& SpriteBatch::get_pipelines(RhiPortion& portion, ShaderProgram* shader_program)
+{
+    auto it = portion.pipelines.find(shader_program);
+
+    if (it != portion.pipelines.end())
+        return it->second;
+
+    RhiPipelines& pipelines = portion.pipelines[shader_program];
+    RhiShader shader = get_rhi_shader(shader_program);
+
+    if (!shader)
+        return pipelines;
+
+    // Буфер глубины используют только четырёхугольники с глубиной, которые выводятся не через RHI
+    RhiPipelineDesc desc;
+    desc.shader = shader;
+    desc.attributes = portion.attributes;
+    desc.vertex_stride = portion.vertex_stride;
+    desc.depth_test = RhiDepthTest::disabled;
+
+    for (u32 i = 0; i < num_rhi_blend_modes; ++i)
+    {
+        desc.blend_mode = (RhiBlendMode)i;
+        pipelines[i] = render_device_->create_pipeline(desc);
+    }
+
+    return pipelines;
+}
+
+RhiTexture SpriteBatch::get_rhi_texture(Texture* texture)
+{
+    auto it = rhi_textures_.find(texture);
+
+    if (it != rhi_textures_.end())
+        return it->second;
+
+    // Адреса удалённых текстур иначе копились бы бесконечно
+    if (rhi_textures_.size() >= max_rhi_textures_)
+    {
+        for (const auto& [old_texture, rhi_texture] : rhi_textures_)
+            render_device_->destroy_texture(rhi_texture);
+
+        rhi_textures_.clear();
+    }
+
+    RhiTexture rhi_texture = render_device_->import_texture(texture);
+    rhi_textures_[texture] = rhi_texture;
+
+    return rhi_texture;
+}
+
+void SpriteBatch::draw_portion(RhiPortion& portion, ShaderProgram* shader_program, Texture* texture,
+                               const void* vertices, i32 num_vertices, i32 num_indices, bool tint)
+{
+    if (!render_device_)
+        return;
+
+    RhiPipeline pipeline = get_pipelines(portion, shader_program)[(u32)effective_blend_mode()];
+
+    if (!pipeline)
+        return;
+
+    // Вершины пишутся сразу в буфер устройства после предыдущей порции.
+    // Когда кольцо заполнено, память буфера переразмечается
+    bool discard = portion.ring_offset + num_vertices > portion.ring_size;
+
+    if (discard)
+        portion.ring_offset = 0;
+
+    i32 first_vertex = portion.ring_offset;
+    render_device_->write_buffer(portion.vertex_buffer, (u32)first_vertex * portion.vertex_stride, vertices,
+                                 (u32)num_vertices * portion.vertex_stride, discard);
+    portion.ring_offset += num_vertices;
+
+    command_list_.reset();
+    command_list_.set_pipeline(pipeline);
+    command_list_.set_vertex_buffer(portion.vertex_buffer);
+
+    if (portion.index_buffer)
+        command_list_.set_index_buffer(portion.index_buffer, RhiIndexType::u16);
+
+    if (texture)
+        command_list_.set_texture(0, get_rhi_texture(texture));
+
+    if (num_indices > 0)
+        command_list_.draw_indexed(0, (u32)num_indices, (u32)num_vertices, first_vertex);
+    else
+        command_list_.draw((u32)first_vertex, (u32)num_vertices);
+
+    // Подкрашивание рисуется поверх порции с альфа-смешением. Буферы остаются привязанными при смене конвейера
+    RhiPipeline tint_pipeline = tint ? get_pipelines(portion, debug_shader_program_)[(u32)RhiBlendMode::alpha] : RhiPipeline();
+
+    if (tint_pipeline)
+    {
+        command_list_.set_pipeline(tint_pipeline);
+
+        if (num_indices > 0)
+            command_list_.draw_indexed(0, (u32)num_indices, (u32)num_vertices, first_vertex);
+        else
+            command_list_.draw((u32)first_vertex, (u32)num_vertices);
+
+        // Код вне RHI (например, multi-draw) рассчитывает на смешение из prepare_ogl()
+        command_list_.set_pipeline(pipeline);
+    }
+
+    render_device_->submit(command_list_);
+}
+
+} // namespace dviglo
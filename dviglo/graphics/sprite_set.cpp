@@ -0,0 +1,269 @@
+// Copyright (c) the Dviglo project
+// License: MIT
+
+#include "sprite_set.hpp"
+
+#include "../fs/embedded_files.hpp"
+#include "../fs/log.hpp"
+#include "../gl_utils/draw_counters.hpp"
+#include "../gl_utils/gl_debug.hpp"
+#include "../gl_utils/shader_cache.hpp"
+#include "../main/engine_params.hpp"
+
+#include <cstddef> // offsetof
+
+using namespace glm;
+using namespace std;
+
+
+namespace dviglo
+{
+
+// Должен совпадать с local_size_x в sprite_cull.comp
+static constexpr i32 cull_group_size = 256;
+
+// Команда отрисовки для glDrawArraysIndirect()
+struct DrawArraysIndirectCommand
+{
+    u32 count;
+    u32 instance_count;
+    u32 first;
+    u32 base_instance;
+};
+
+SpriteSet::SpriteSet(Texture* texture)
+    : texture_(texture)
+{
+    StrUtf8 shaders_path = StrUtf8(embedded_prefix) + "engine_data/shaders/";
+    shader_program_ = DV_SHADER_CACHE->get(shaders_path + "sprite_set.vert", shaders_path + "sprite_set.frag");
+
+    glGenVertexArrays(1, &vao_);
+    glGenBuffers(1, &instance_buffer_);
+
+    glBindVertexArray(vao_);
+    glBindBuffer(GL_ARRAY_BUFFER, instance_buffer_);
+
+    constexpr GLsizei stride = sizeof(SpriteInstance);
+
+    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, stride, (void*)offsetof(SpriteInstance, position));
+    glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, stride, (void*)offsetof(SpriteInstance, size));
+    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, stride, (void*)offsetof(SpriteInstance, uv_min));
+    glVertexAttribPointer(3, 2, GL_FLOAT, GL_FALSE, stride, (void*)offsetof(SpriteInstance, uv_max));
+    glVertexAttribPointer(4, 4, GL_UNSIGNED_BYTE, GL_TRUE, stride, (void*)offsetof(SpriteInstance, color));
+    glVertexAttribPointer(5, 1, GL_FLOAT, GL_FALSE, stride, (void*)offsetof(SpriteInstance, rotation));
+
+    // Все атрибуты относятся к экземпляру, угол четырёхугольника берётся из gl_VertexID
+    for (GLuint i = 0; i <= 5; ++i)
+    {
+        glVertexAttribDivisor(i, 1);
+        glEnableVertexAttribArray(i);
+    }
+
+    glBindVertexArray(0);
+
+    set_gl_label(GL_VERTEX_ARRAY, vao_, "SpriteSet");
+    set_gl_label(GL_BUFFER, instance_buffer_, "SpriteSet visible sprites");
+
+    if (!engine_params::gl_4_3_features || !GLAD_GL_VERSION_4_3)
+        return;
+
+    cull_shader_program_ = DV_SHADER_CACHE->get_compute(shaders_path + "sprite_cull.comp");
+
+    if (!cull_shader_program_->gpu_object_name())
+    {
+        DV_LOG->writef_error("{} | !cull_shader_program_->gpu_object_name()", DV_FUNCSIG);
+        return;
+    }
+
+    glGenBuffers(1, &source_buffer_);
+    glGenBuffers(1, &indirect_buffer_);
+    glGenBuffers(1, &group_count_buffer_);
+    glGenBuffers(1, &count_readback_buffer_);
+
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, indirect_buffer_);
+    glBufferData(GL_DRAW_INDIRECT_BUFFER, sizeof(DrawArraysIndirectCommand), nullptr, GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+
+    glBindBuffer(GL_COPY_WRITE_BUFFER, count_readback_buffer_);
+    glBufferData(GL_COPY_WRITE_BUFFER, sizeof(u32), nullptr, GL_STREAM_READ);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+    set_gl_label(GL_BUFFER, source_buffer_, "SpriteSet sprites");
+    set_gl_label(GL_BUFFER, indirect_buffer_, "SpriteSet draw command");
+    set_gl_label(GL_BUFFER, group_count_buffer_, "SpriteSet group counts");
+    set_gl_label(GL_BUFFER, count_readback_buffer_, "SpriteSet visible count");
+
+    gpu_culling_ = true;
+}
+
+SpriteSet::~SpriteSet()
+{
+    // Проверка на 0 не нужна
+    glDeleteVertexArrays(1, &vao_);
+    glDeleteBuffers(1, &instance_buffer_);
+    glDeleteBuffers(1, &source_buffer_);
+    glDeleteBuffers(1, &indirect_buffer_);
+    glDeleteBuffers(1, &group_count_buffer_);
+    glDeleteBuffers(1, &count_readback_buffer_);
+
+    if (count_fence_)
+        glDeleteSync(count_fence_);
+}
+
+void SpriteSet::cull_gpu(const Rect& view)
+{
+    i32 num_sprites = (i32)sprites_.size();
+
+    if (dirty_)
+    {
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, source_buffer_);
+
+        if (num_sprites > gpu_capacity_)
+        {
+            gpu_capacity_ = num_sprites;
+            glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(SpriteInstance) * gpu_capacity_, sprites_.data(), GL_DYNAMIC_DRAW);
+
+            // Видимые спрайты и счётчики групп пишет только GPU
+            glBindBuffer(GL_SHADER_STORAGE_BUFFER, instance_buffer_);
+            glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(SpriteInstance) * gpu_capacity_, nullptr, GL_DYNAMIC_COPY);
+
+            i32 max_groups = (gpu_capacity_ + cull_group_size - 1) / cull_group_size;
+            glBindBuffer(GL_SHADER_STORAGE_BUFFER, group_count_buffer_);
+            glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(u32) * max_groups, nullptr, GL_DYNAMIC_COPY);
+        }
+        else
+        {
+            glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(SpriteInstance) * num_sprites, sprites_.data());
+        }
+
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+        dirty_ = false;
+    }
+
+    // Шейдер записывает instance_count
+    DrawArraysIndirectCommand command{4, 0, 0, 0};
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, indirect_buffer_);
+    glBufferSubData(GL_DRAW_INDIRECT_BUFFER, 0, sizeof(command), &command);
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, source_buffer_);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, instance_buffer_);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, indirect_buffer_);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 3, group_count_buffer_);
+
+    cull_shader_program_->use();
+    cull_shader_program_->set("u_num_sprites", num_sprites);
+    cull_shader_program_->set("u_view", vec4(view.pos, view.pos + view.size));
+
+    GLuint num_groups = (GLuint)((num_sprites + cull_group_size - 1) / cull_group_size);
+
+    // Число видимых спрайтов в каждой группе
+    cull_shader_program_->set("u_pass", 0);
+    glDispatchCompute(num_groups, 1, 1);
+    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+
+    // Запись видимых спрайтов со смещением группы
+    cull_shader_program_->set("u_pass", 1);
+    glDispatchCompute(num_groups, 1, 1);
+
+    // Результат читается как атрибуты экземпляров и как команда отрисовки
+    glMemoryBarrier(GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT | GL_COMMAND_BARRIER_BIT);
+}
+
+void SpriteSet::cull_cpu(const Rect& view)
+{
+    Aabb view_aabb(view);
+    visible_.clear();
+
+    for (const SpriteInstance& sprite : sprites_)
+    {
+        // Повёрнутый спрайт всегда помещается в описанную окружность
+        f32 radius = length(sprite.size) * 0.5f;
+        Aabb bounds(sprite.position - radius, sprite.position + radius);
+
+        if (view_aabb.intersects(bounds))
+            visible_.push_back(sprite);
+    }
+
+    glBindBuffer(GL_ARRAY_BUFFER, instance_buffer_);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(SpriteInstance) * visible_.size(), visible_.data(), GL_STREAM_DRAW);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void SpriteSet::update_visible_count()
+{
+    if (count_fence_)
+    {
+        GLenum status = glClientWaitSync(count_fence_, 0, 0);
+
+        if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED)
+            return;
+
+        glDeleteSync(count_fence_);
+        count_fence_ = nullptr;
+
+        glBindBuffer(GL_COPY_READ_BUFFER, count_readback_buffer_);
+        glGetBufferSubData(GL_COPY_READ_BUFFER, 0, sizeof(u32), &last_visible_count_);
+        glBindBuffer(GL_COPY_READ_BUFFER, 0);
+    }
+
+    glBindBuffer(GL_COPY_READ_BUFFER, indirect_buffer_);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, count_readback_buffer_);
+    glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, offsetof(DrawArraysIndirectCommand, instance_count),
+                        0, sizeof(u32));
+    glBindBuffer(GL_COPY_READ_BUFFER, 0);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+    count_fence_ = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
+
+void SpriteSet::draw(const Rect& view, bool flip_vertically)
+{
+    if (sprites_.empty() || !texture_)
+        return;
+
+    GlDebugGroup debug_group("SpriteSet::draw");
+
+    if (gpu_culling_)
+    {
+        cull_gpu(view);
+    }
+    else
+    {
+        cull_cpu(view);
+
+        if (visible_.empty())
+            return;
+    }
+
+    shader_program_->use();
+    shader_program_->set("u_view_pos", view.pos);
+    shader_program_->set("u_pixel_size", vec2(2.f / view.size.x, 2.f / view.size.y));
+    shader_program_->set("u_flip_vertically", flip_vertically);
+
+    glActiveTexture(GL_TEXTURE0);
+    texture_->bind();
+    shader_program_->set("u_texture", 0);
+
+    glBindVertexArray(vao_);
+
+    if (gpu_culling_)
+    {
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, indirect_buffer_);
+        glDrawArraysIndirect(GL_TRIANGLE_STRIP, nullptr);
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+
+        // Число видимых спрайтов известно только GPU, поэтому берём результат прошлых кадров без ожидания
+        update_visible_count();
+        draw_counters::add((i64)last_visible_count_ * 4);
+    }
+    else
+    {
+        glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, (GLsizei)visible_.size());
+        draw_counters::add((i64)visible_.size() * 4);
+    }
+
+    glBindVertexArray(0);
+}
+
+} // namespace dviglo
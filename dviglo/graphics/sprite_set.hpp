@@ -0,0 +1,113 @@
+// Copyright (c) the Dviglo project
+// License: MIT
+
+#pragma once
+
+#include "../gl_utils/shader_program.hpp"
+#include "../gl_utils/texture.hpp"
+#include "../math/rect.hpp"
+
+#include <vector>
+
+
+namespace dviglo
+{
+
+// Спрайт в SpriteSet. Формат совпадает со структурой Sprite в sprite_cull.comp (std430)
+struct SpriteInstance
+{
+    glm::vec2 position; // Центр спрайта
+    glm::vec2 size;
+    glm::vec2 uv_min{0.f, 0.f};
+    glm::vec2 uv_max{1.f, 1.f};
+    u32 color = 0xFFFFFFFF; // 0xAABBGGRR
+    f32 rotation = 0.f; // В радианах, по часовой стрелке
+};
+
+static_assert(sizeof(SpriteInstance) == 40);
+
+// Большой набор спрайтов с одной текстурой (сотни тысяч частиц, тайлов, юнитов и т.д.),
+// который выводится одним вызовом инстансинга в обход SpriteBatch.
+// На OpenGL 4.3 спрайты хранятся в SSBO и отсекаются вычислительным шейдером: видимые спрайты
+// складываются в буфер экземпляров в исходном порядке (префиксные суммы), а их число записывается
+// в поле команды glDrawArraysIndirect(), поэтому данные не возвращаются на CPU.
+// Иначе спрайты отсекаются на CPU и каждый кадр загружаются только видимые.
+// В обоих случаях спрайты выводятся в порядке sprites()
+class SpriteSet
+{
+private:
+    Texture* texture_;
+
+    std::vector<SpriteInstance> sprites_;
+
+    // Спрайты изменились после последней загрузки в GPU
+    bool dirty_ = true;
+
+    // Отсекать спрайты вычислительным шейдером. Определяется в конструкторе
+    bool gpu_culling_ = false;
+
+    ShaderProgram* shader_program_ = nullptr;
+    ShaderProgram* cull_shader_program_ = nullptr;
+
+    GLuint vao_ = 0;
+
+    // Видимые спрайты (атрибуты экземпляров)
+    GLuint instance_buffer_ = 0;
+
+    // Все спрайты (только при отсечении на GPU)
+    GLuint source_buffer_ = 0;
+
+    // DrawArraysIndirectCommand (только при отсечении на GPU)
+    GLuint indirect_buffer_ = 0;
+
+    // Число видимых спрайтов в каждой группе вычислительного шейдера (только при отсечении на GPU)
+    GLuint group_count_buffer_ = 0;
+
+    // Сколько спрайтов помещается в source_buffer_ и instance_buffer_
+    i32 gpu_capacity_ = 0;
+
+    // Число видимых спрайтов для счётчиков отрисовки. При отсечении на GPU копируется из команды
+    // отрисовки в count_readback_buffer_ и читается, когда GPU закончит (count_fence_),
+    // поэтому отстаёт на несколько кадров
+    GLuint count_readback_buffer_ = 0;
+    GLsync count_fence_ = nullptr;
+    u32 last_visible_count_ = 0;
+
+    // Результат отсечения на CPU
+    std::vector<SpriteInstance> visible_;
+
+    void cull_gpu(const Rect& view);
+    void cull_cpu(const Rect& view);
+
+    // Забирает готовое число видимых спрайтов и запрашивает копию для текущего кадра
+    void update_visible_count();
+
+public:
+    SpriteSet(Texture* texture);
+    ~SpriteSet();
+
+    SpriteSet(const SpriteSet&) = delete;
+    SpriteSet& operator=(const SpriteSet&) = delete;
+
+    Texture* texture() const { return texture_; }
+    void set_texture(Texture* texture) { texture_ = texture; }
+
+    bool gpu_culling() const { return gpu_culling_; }
+
+    const std::vector<SpriteInstance>& sprites() const { return sprites_; }
+
+    // Доступ для изменения. Перед следующей отрисовкой все спрайты будут заново загружены в GPU,
+    // поэтому статичные наборы лучше не трогать без необходимости
+    std::vector<SpriteInstance>& edit_sprites()
+    {
+        dirty_ = true;
+        return sprites_;
+    }
+
+    // Выводит спрайты, которые пересекают область view (в мировых пикселях).
+    // Область растягивается на весь вьюпорт. Смешение настраивается вызывающей стороной
+    // (например, SpriteBatch::prepare_ogl()). Порцию SpriteBatch нужно вывести заранее
+    void draw(const Rect& view, bool flip_vertically = false);
+};
+
+} // namespace dviglo
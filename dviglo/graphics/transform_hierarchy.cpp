@@ -0,0 +1,536 @@
+// Copyright (c) the Dviglo project
+// License: MIT
+
+#include "transform_hierarchy.hpp"
+
+#include "../fs/log.hpp"
+#include "../math/math.hpp"
+
+#include <cassert>
+#include <cmath> // atan2
+#include <type_traits> // decay_t
+
+using namespace glm;
+using namespace std;
+
+
+namespace dviglo
+{
+
+Affine2d Affine2d::from_trs(vec2 translation, f32 rotation, vec2 scale)
+{
+    f32 sin, cos;
+    sin_cos(rotation, sin, cos);
+
+    Affine2d ret;
+    ret.a = cos * scale.x;
+    ret.b = sin * scale.x;
+    ret.c = -sin * scale.y;
+    ret.d = cos * scale.y;
+    ret.tx = translation.x;
+    ret.ty = translation.y;
+    return ret;
+}
+
+f32 Affine2d::rotation() const
+{
+    return atan2(b, a);
+}
+
+vec2 Affine2d::scale() const
+{
+    f32 scale_x = sqrt(a * a + b * b);
+
+    if (scale_x == 0.f)
+        return vec2(0.f, sqrt(c * c + d * d));
+
+    // Знак определителя сохраняет отражение
+    return vec2(scale_x, (a * d - b * c) / scale_x);
+}
+
+Affine2d operator*(const Affine2d& parent, const Affine2d& child)
+{
+    Affine2d ret;
+    ret.a = parent.a * child.a + parent.c * child.b;
+    ret.b = parent.b * child.a + parent.d * child.b;
+    ret.c = parent.a * child.c + parent.c * child.d;
+    ret.d = parent.b * child.c + parent.d * child.d;
+    ret.tx = parent.a * child.tx + parent.c * child.ty + parent.tx;
+    ret.ty = parent.b * child.tx + parent.d * child.ty + parent.ty;
+    return ret;
+}
+
+void TransformHierarchy::set_world(i32 index, const Affine2d& transform)
+{
+    world_a_[index] = transform.a;
+    world_b_[index] = transform.b;
+    world_c_[index] = transform.c;
+    world_d_[index] = transform.d;
+    world_tx_[index] = transform.tx;
+    world_ty_[index] = transform.ty;
+}
+
+Affine2d TransformHierarchy::get_local(i32 index) const
+{
+    return {local_a_[index], local_b_[index], local_c_[index], local_d_[index], local_tx_[index], local_ty_[index]};
+}
+
+Affine2d TransformHierarchy::get_world(i32 index) const
+{
+    return {world_a_[index], world_b_[index], world_c_[index], world_d_[index], world_tx_[index], world_ty_[index]};
+}
+
+void TransformHierarchy::update_children(i32 parent_index)
+{
+    const f32 pa = world_a_[parent_index];
+    const f32 pb = world_b_[parent_index];
+    const f32 pc = world_c_[parent_index];
+    const f32 pd = world_d_[parent_index];
+    const f32 ptx = world_tx_[parent_index];
+    const f32 pty = world_ty_[parent_index];
+
+    const i32 begin = child_begins_[parent_index];
+    const i32 end = begin + child_counts_[parent_index];
+
+    const f32* la = local_a_.data();
+    const f32* lb = local_b_.data();
+    const f32* lc = local_c_.data();
+    const f32* ld = local_d_.data();
+    const f32* ltx = local_tx_.data();
+    const f32* lty = local_ty_.data();
+
+    f32* wa = world_a_.data();
+    f32* wb = world_b_.data();
+    f32* wc = world_c_.data();
+    f32* wd = world_d_.data();
+    f32* wtx = world_tx_.data();
+    f32* wty = world_ty_.data();
+
+    // Матрица родителя общая для всех детей, а данные детей лежат подряд,
+    // поэтому цикл без ветвлений векторизуется
+    for (i32 i = begin; i < end; ++i)
+    {
+        wa[i] = pa * la[i] + pc * lb[i];
+        wb[i] = pb * la[i] + pd * lb[i];
+        wc[i] = pa * lc[i] + pc * ld[i];
+        wd[i] = pb * lc[i] + pd * ld[i];
+        wtx[i] = pa * ltx[i] + pc * lty[i] + ptx;
+        wty[i] = pb * ltx[i] + pd * lty[i] + pty;
+    }
+}
+
+void TransformHierarchy::mark_dirty(i32 index, NodeState state)
+{
+    if (states_[index] != NodeState::clean)
+        return;
+
+    states_[index] = state;
+
+    i32 depth = depths_[index];
+    dirty_begins_[depth] = std::min(dirty_begins_[depth], index);
+    dirty_ends_[depth] = std::max(dirty_ends_[depth], index + 1);
+}
+
+void TransformHierarchy::unlink(NodeId id)
+{
+    NodeId parent = parents_[id];
+
+    if (parent == null_node)
+        return;
+
+    if (first_children_[parent] == id)
+    {
+        first_children_[parent] = next_siblings_[id];
+    }
+    else
+    {
+        NodeId sibling = first_children_[parent];
+
+        while (next_siblings_[sibling] != id)
+            sibling = next_siblings_[sibling];
+
+        next_siblings_[sibling] = next_siblings_[id];
+    }
+
+    parents_[id] = null_node;
+    next_siblings_[id] = null_node;
+}
+
+void TransformHierarchy::link(NodeId id, NodeId parent)
+{
+    parents_[id] = parent;
+
+    if (parent != null_node)
+    {
+        next_siblings_[id] = first_children_[parent];
+        first_children_[parent] = id;
+    }
+}
+
+void TransformHierarchy::rebuild_layout()
+{
+    // Обход в ширину: корни, затем их дети и т.д. Дети одного узла попадают в массив подряд
+    vector<NodeId> order;
+    order.reserve(num_nodes_);
+
+    for (NodeId id = 0; id < (NodeId)used_.size(); ++id)
+    {
+        if (used_[id] && parents_[id] == null_node)
+            order.push_back(id);
+    }
+
+    vector<i32> new_parent_indices(num_nodes_, -1);
+    vector<i32> new_child_begins(num_nodes_, 0);
+    vector<i32> new_child_counts(num_nodes_, 0);
+    vector<i32> new_depths(num_nodes_, 0);
+
+    for (size_t i = 0; i < order.size(); ++i)
+    {
+        new_child_begins[i] = (i32)order.size();
+
+        for (NodeId child = first_children_[order[i]]; child != null_node; child = next_siblings_[child])
+        {
+            new_parent_indices[order.size()] = (i32)i;
+            new_depths[order.size()] = new_depths[i] + 1;
+            order.push_back(child);
+        }
+
+        new_child_counts[i] = (i32)order.size() - new_child_begins[i];
+    }
+
+    assert((i32)order.size() == num_nodes_);
+
+    // Переставляем матрицы и состояния в новый порядок. Новые узлы хранятся в конце массивов,
+    // и их мировые матрицы ещё не посчитаны, но такие узлы пересчитываются ниже
+    const size_t old_size = local_a_.size();
+
+    auto gather = [&](auto& values)
+    {
+        values.resize(old_size);
+        std::decay_t<decltype(values)> result(num_nodes_);
+
+        for (i32 i = 0; i < num_nodes_; ++i)
+            result[i] = values[indices_[order[i]]];
+
+        values = std::move(result);
+    };
+
+    for (vector<f32>* values : {&local_a_, &local_b_, &local_c_, &local_d_, &local_tx_, &local_ty_,
+                                &world_a_, &world_b_, &world_c_, &world_d_, &world_tx_, &world_ty_})
+    {
+        gather(*values);
+    }
+
+    gather(states_);
+
+    for (i32 i = 0; i < num_nodes_; ++i)
+        indices_[order[i]] = i;
+
+    ids_ = std::move(order);
+    parent_indices_ = std::move(new_parent_indices);
+    child_begins_ = std::move(new_child_begins);
+    child_counts_ = std::move(new_child_counts);
+    depths_ = std::move(new_depths);
+
+    i32 num_levels = num_nodes_ ? depths_.back() + 1 : 0;
+    level_begins_.assign(num_levels + 1, num_nodes_);
+
+    for (i32 i = num_nodes_ - 1; i >= 0; --i)
+        level_begins_[depths_[i]] = i;
+
+    dirty_begins_.resize(num_levels);
+    dirty_ends_.resize(num_levels);
+
+    for (i32 level = 0; level < num_levels; ++level)
+    {
+        dirty_begins_[level] = level_begins_[level + 1];
+        dirty_ends_[level] = level_begins_[level];
+    }
+
+    layout_dirty_ = false;
+
+    // Мировые матрицы остальных узлов не изменились. Потомки новых и перемещённых узлов
+    // пересчитываются вместе с ними
+    for (NodeId id : relayout_dirty_ids_)
+    {
+        if (alive(id))
+            states_[indices_[id]] = NodeState::local_changed;
+    }
+
+    relayout_dirty_ids_.clear();
+
+    // Диапазоны изменённых узлов в новом порядке (сюда попадают и узлы, изменённые до create() и т.п.)
+    for (i32 i = 0; i < num_nodes_; ++i)
+    {
+        NodeState state = states_[i];
+
+        if (state != NodeState::clean)
+        {
+            states_[i] = NodeState::clean;
+            mark_dirty(i, state);
+        }
+    }
+}
+
+TransformHierarchy::NodeId TransformHierarchy::create(NodeId parent, const Affine2d& local)
+{
+    if (parent != null_node && !alive(parent))
+    {
+        DV_LOG->writef_error("{} | parent != null_node && !alive(parent)", DV_FUNCSIG);
+        parent = null_node;
+    }
+
+    NodeId id;
+
+    if (free_ids_.empty())
+    {
+        id = (NodeId)used_.size();
+        parents_.push_back(null_node);
+        first_children_.push_back(null_node);
+        next_siblings_.push_back(null_node);
+        used_.push_back(true);
+        indices_.push_back(0);
+    }
+    else
+    {
+        id = free_ids_.back();
+        free_ids_.pop_back();
+        used_[id] = true;
+    }
+
+    link(id, parent);
+    ++num_nodes_;
+    relayout_dirty_ids_.push_back(id);
+
+    // До перестроения узел хранится в конце массивов
+    indices_[id] = (i32)local_a_.size();
+    local_a_.push_back(local.a);
+    local_b_.push_back(local.b);
+    local_c_.push_back(local.c);
+    local_d_.push_back(local.d);
+    local_tx_.push_back(local.tx);
+    local_ty_.push_back(local.ty);
+
+    layout_dirty_ = true;
+    return id;
+}
+
+void TransformHierarchy::destroy(NodeId id)
+{
+    if (!alive(id))
+        return;
+
+    unlink(id);
+
+    vector<NodeId> stack{id};
+
+    while (!stack.empty())
+    {
+        NodeId node = stack.back();
+        stack.pop_back();
+
+        for (NodeId child = first_children_[node]; child != null_node; child = next_siblings_[child])
+            stack.push_back(child);
+
+        parents_[node] = null_node;
+        first_children_[node] = null_node;
+        next_siblings_[node] = null_node;
+        used_[node] = false;
+        free_ids_.push_back(node);
+        --num_nodes_;
+    }
+
+    layout_dirty_ = true;
+}
+
+TransformHierarchy::NodeId TransformHierarchy::parent(NodeId id) const
+{
+    if (!alive(id))
+        return null_node;
+
+    return parents_[id];
+}
+
+void TransformHierarchy::set_parent(NodeId id, NodeId parent)
+{
+    if (!alive(id))
+    {
+        DV_LOG->writef_error("{} | !alive(id)", DV_FUNCSIG);
+        return;
+    }
+
+    if (parent != null_node && !alive(parent))
+    {
+        DV_LOG->writef_error("{} | parent != null_node && !alive(parent)", DV_FUNCSIG);
+        return;
+    }
+
+    if (parents_[id] == parent)
+        return;
+
+    // Узел нельзя сделать потомком самого себя
+    for (NodeId ancestor = parent; ancestor != null_node; ancestor = parents_[ancestor])
+    {
+        if (ancestor == id)
+        {
+            DV_LOG->writef_error("{} | parent is a descendant of id", DV_FUNCSIG);
+            return;
+        }
+    }
+
+    unlink(id);
+    link(id, parent);
+    relayout_dirty_ids_.push_back(id);
+    layout_dirty_ = true;
+}
+
+Affine2d TransformHierarchy::local(NodeId id) const
+{
+    if (!alive(id))
+        return {};
+
+    return get_local(indices_[id]);
+}
+
+void TransformHierarchy::set_local(NodeId id, const Affine2d& local)
+{
+    if (!alive(id))
+    {
+        DV_LOG->writef_error("{} | !alive(id)", DV_FUNCSIG);
+        return;
+    }
+
+    i32 index = indices_[id];
+    local_a_[index] = local.a;
+    local_b_[index] = local.b;
+    local_c_[index] = local.c;
+    local_d_[index] = local.d;
+    local_tx_[index] = local.tx;
+    local_ty_[index] = local.ty;
+
+    // До перестроения индексы узлов недействительны для диапазонов изменённых узлов
+    if (layout_dirty_)
+        relayout_dirty_ids_.push_back(id);
+    else
+        mark_dirty(index, NodeState::local_changed);
+}
+
+void TransformHierarchy::update()
+{
+    if (layout_dirty_)
+        rebuild_layout();
+
+    last_update_count_ = 0;
+
+    for (i32 level = 0; level < (i32)dirty_begins_.size(); ++level)
+    {
+        i32 begin = dirty_begins_[level];
+        i32 end = dirty_ends_[level];
+
+        for (i32 i = begin; i < end; ++i)
+        {
+            NodeState state = states_[i];
+
+            if (state == NodeState::clean)
+                continue;
+
+            if (state == NodeState::local_changed)
+            {
+                i32 parent_index = parent_indices_[i];
+
+                if (parent_index < 0)
+                    set_world(i, get_local(i));
+                else
+                    set_world(i, get_world(parent_index) * get_local(i));
+
+                ++last_update_count_;
+            }
+
+            states_[i] = NodeState::clean;
+
+            i32 num_children = child_counts_[i];
+
+            if (num_children == 0)
+                continue;
+
+            update_children(i);
+            last_update_count_ += num_children;
+
+            // Дети уже пересчитаны (даже если их локальные матрицы тоже менялись),
+            // осталось передать изменения их потомкам
+            i32 child_begin = child_begins_[i];
+
+            for (i32 child = child_begin; child < child_begin + num_children; ++child)
+                states_[child] = NodeState::world_changed;
+
+            dirty_begins_[level + 1] = std::min(dirty_begins_[level + 1], child_begin);
+            dirty_ends_[level + 1] = std::max(dirty_ends_[level + 1], child_begin + num_children);
+        }
+
+        dirty_begins_[level] = level_begins_[level + 1];
+        dirty_ends_[level] = level_begins_[level];
+    }
+}
+
+Affine2d TransformHierarchy::world(NodeId id) const
+{
+    if (!alive(id) || layout_dirty_)
+        return {};
+
+    return get_world(indices_[id]);
+}
+
+vec2 TransformHierarchy::world_position(NodeId id) const
+{
+    return world(id).translation();
+}
+
+void TransformHierarchy::apply(NodeId id, vec2 size, SpriteInstance& instance) const
+{
+    Affine2d transform = world(id);
+    instance.position = transform.translation();
+    instance.size = size * abs(transform.scale());
+    instance.rotation = transform.rotation();
+}
+
+void TransformHierarchy::apply(span<const NodeId> ids, span<const vec2> sizes, span<SpriteInstance> instances) const
+{
+    if (ids.size() != sizes.size() || ids.size() != instances.size())
+    {
+        DV_LOG->writef_error("{} | ids.size() != sizes.size() || ids.size() != instances.size()", DV_FUNCSIG);
+        return;
+    }
+
+    if (layout_dirty_)
+    {
+        DV_LOG->writef_error("{} | layout_dirty_", DV_FUNCSIG);
+        return;
+    }
+
+    for (size_t i = 0; i < ids.size(); ++i)
+    {
+        NodeId id = ids[i];
+
+        if (!alive(id))
+            continue;
+
+        i32 index = indices_[id];
+        Affine2d transform = get_world(index);
+        SpriteInstance& instance = instances[i];
+        instance.position = transform.translation();
+        instance.size = sizes[i] * abs(transform.scale());
+        instance.rotation = transform.rotation();
+    }
+}
+
+void TransformHierarchy::draw_sprite(SpriteBatch* sprite_batch, NodeId id, Texture* texture, vec2 size,
+                                     const Rect* source, u32 color) const
+{
+    Affine2d transform = world(id);
+
+    // SpriteBatch сдвигает спрайт на -origin, поэтому начало координат узла становится центром
+    sprite_batch->draw_sprite(texture, Rect(transform.translation(), size), source, color,
+                              transform.rotation(), size * 0.5f, transform.scale());
+}
+
+} // namespace dviglo
@@ -0,0 +1,171 @@
+// Copyright (c) the Dviglo project
+// License: MIT
+
+#pragma once
+
+#include "sprite_batch.hpp"
+#include "sprite_set.hpp"
+
+#include <glm/glm.hpp>
+
+#include <span>
+#include <vector>
+
+
+namespace dviglo
+{
+
+// Аффинное преобразование 2x3. Точка (x, y) переходит в (a * x + c * y + tx, b * x + d * y + ty).
+// Порядок элементов совпадает с матрицей в SpriteBatch::transform_sprite_internal()
+struct Affine2d
+{
+    f32 a = 1.f, b = 0.f;
+    f32 c = 0.f, d = 1.f;
+    f32 tx = 0.f, ty = 0.f;
+
+    // Масштабирование, затем поворот (в радианах, по часовой стрелке), затем перенос
+    static Affine2d from_trs(glm::vec2 translation, f32 rotation = 0.f, glm::vec2 scale = {1.f, 1.f});
+
+    glm::vec2 transform_point(glm::vec2 point) const
+    {
+        return {a * point.x + c * point.y + tx, b * point.x + d * point.y + ty};
+    }
+
+    glm::vec2 translation() const { return {tx, ty}; }
+
+    // Обратные операции к from_trs(). При неравномерном масштабе родителя и повороте потомка
+    // в матрице появляется сдвиг, который не раскладывается на поворот и масштаб
+    f32 rotation() const;
+    glm::vec2 scale() const;
+};
+
+// Результат parent * child: сначала child, затем parent
+Affine2d operator*(const Affine2d& parent, const Affine2d& child);
+
+// Иерархия преобразований (сцен-граф) для спрайтов, UI и скелетов.
+// Локальные и мировые матрицы хранятся в отдельных массивах по компонентам (SoA), а узлы
+// упорядочены по глубине: сначала корни, затем их дети и т.д. Дети одного родителя лежат подряд,
+// поэтому при изменении родителя мировые матрицы детей пересчитываются одним непрерывным циклом,
+// который компилятор векторизует. Для каждого уровня хранится диапазон изменённых узлов,
+// поэтому update() обходит только изменённые поддеревья.
+// Создание и удаление узлов и смена родителя перестраивают порядок узлов при следующем update(),
+// после чего пересчитываются только новые и перемещённые поддеревья
+class TransformHierarchy
+{
+public:
+    // Стабильный номер узла (не меняется при перестроении порядка)
+    using NodeId = u32;
+
+    inline static constexpr NodeId null_node = ~0u;
+
+private:
+    // Состояние узла в отсортированном порядке
+    enum class NodeState : u8
+    {
+        clean = 0,
+        local_changed, // Нужно пересчитать мировую матрицу узла
+        world_changed, // Мировая матрица уже пересчитана, нужно пересчитать детей
+    };
+
+    // ===================== Данные по NodeId =====================
+
+    std::vector<NodeId> parents_;
+    std::vector<NodeId> first_children_;
+    std::vector<NodeId> next_siblings_;
+    std::vector<bool> used_;
+    std::vector<NodeId> free_ids_;
+
+    // Индекс узла в отсортированных массивах
+    std::vector<i32> indices_;
+
+    // ============= Данные в порядке глубины (SoA) =============
+
+    std::vector<NodeId> ids_;
+    std::vector<i32> parent_indices_; // -1 у корней
+    std::vector<i32> child_begins_;
+    std::vector<i32> child_counts_;
+    std::vector<NodeState> states_;
+
+    // Локальные матрицы
+    std::vector<f32> local_a_, local_b_, local_c_, local_d_, local_tx_, local_ty_;
+
+    // Мировые матрицы
+    std::vector<f32> world_a_, world_b_, world_c_, world_d_, world_tx_, world_ty_;
+
+    std::vector<i32> depths_; // Номер уровня
+
+    // Начало каждого уровня в отсортированных массивах и в конце - число узлов
+    std::vector<i32> level_begins_;
+
+    // Изменённые узлы уровня лежат в диапазоне [dirty_begins_[i], dirty_ends_[i])
+    std::vector<i32> dirty_begins_;
+    std::vector<i32> dirty_ends_;
+
+    // Узлы создавались, удалялись или меняли родителя
+    bool layout_dirty_ = false;
+
+    // Узлы, которые нужно пересчитать после перестроения: созданные, перемещённые и узлы,
+    // у которых менялась локальная матрица, пока порядок был недействителен
+    std::vector<NodeId> relayout_dirty_ids_;
+
+    i32 num_nodes_ = 0;
+    i32 last_update_count_ = 0;
+
+    void rebuild_layout();
+    void mark_dirty(i32 index, NodeState state);
+    void unlink(NodeId id);
+    void link(NodeId id, NodeId parent);
+
+    void set_world(i32 index, const Affine2d& transform);
+    Affine2d get_local(i32 index) const;
+    Affine2d get_world(i32 index) const;
+
+    // Пересчитывает мировые матрицы детей одного родителя
+    void update_children(i32 parent_index);
+
+public:
+    // parent == null_node - корень
+    NodeId create(NodeId parent = null_node, const Affine2d& local = {});
+
+    // Удаляет узел вместе с потомками
+    void destroy(NodeId id);
+
+    bool alive(NodeId id) const { return id < used_.size() && used_[id]; }
+
+    i32 num_nodes() const { return num_nodes_; }
+
+    NodeId parent(NodeId id) const;
+    void set_parent(NodeId id, NodeId parent);
+
+    Affine2d local(NodeId id) const;
+    void set_local(NodeId id, const Affine2d& local);
+
+    void set_local(NodeId id, glm::vec2 translation, f32 rotation = 0.f, glm::vec2 scale = {1.f, 1.f})
+    {
+        set_local(id, Affine2d::from_trs(translation, rotation, scale));
+    }
+
+    // Пересчитывает мировые матрицы изменённых поддеревьев
+    void update();
+
+    // Сколько мировых матриц пересчитано при последнем update()
+    i32 last_update_count() const { return last_update_count_; }
+
+    // Действительна после update()
+    Affine2d world(NodeId id) const;
+    glm::vec2 world_position(NodeId id) const;
+
+    // Заполняет положение, размер и поворот спрайта по мировой матрице узла.
+    // size - размер спрайта до преобразования
+    void apply(NodeId id, glm::vec2 size, SpriteInstance& instance) const;
+
+    // То же для многих спрайтов: instances[i] заполняется по узлу ids[i] и размеру sizes[i].
+    // Проверки выполняются один раз, а матрицы читаются прямо из массивов
+    void apply(std::span<const NodeId> ids, std::span<const glm::vec2> sizes, std::span<SpriteInstance> instances) const;
+
+    // Выводит спрайт с центром в начале координат узла
+    void draw_sprite(SpriteBatch* sprite_batch, NodeId id, Texture* texture, glm::vec2 size,
+                     const Rect* source = nullptr, u32 color = 0xFFFFFFFF) const;
+};
+
+} // namespace dviglo
@@ -6,6 +6,11 @@
 #include "engine_params.hpp"
 #include "timer.hpp"
 
+#include "../gl_utils/draw_counters.hpp"
+#include "../gl_utils/gl_debug.hpp"
+#include "../gl_utils/gpu_memory.hpp"
+#include "../rhi/gl_render_device.hpp"
+
 #include <glad/gl.h>
 
 using namespace std;
@@ -29,17 +34,90 @@ Application::Application(const vector<StrUtf8>& args)
             // Сразу же запоминаем следующий аргумент, если есть
             StrUtf8 value = i + 1 < args.size() ? args[i + 1] : StrUtf8();
 
+            if (argument == "capture" && !value.empty())
+            {
+                arg_capture_path_ = value;
+                ++i;
+                continue;
+            }
+            else if (argument == "capture_frames" && !value.empty())
+            {
+                arg_capture_frames_ = (i32)to_u64(value);
+                ++i;
+                continue;
+            }
+
 #ifdef DV_CTEST
             if (argument == "duration" && !value.empty())
             {
                 duration_ = to_u64(value);
                 ++i;
             }
+            else if (argument == "max_p50_ms" && !value.empty())
+            {
+                max_p50_ms_ = to_f64(value);
+                ++i;
+            }
+            else if (argument == "max_p95_ms" && !value.empty())
+            {
+                max_p95_ms_ = to_f64(value);
+                ++i;
+            }
+            else if (argument == "max_p99_ms" && !value.empty())
+            {
+                max_p99_ms_ = to_f64(value);
+                ++i;
+            }
+            else if (argument == "max_frame_ms" && !value.empty())
+            {
+                max_frame_ms_ = to_f64(value);
+                ++i;
+            }
+            else if (argument == "max_hitches" && !value.empty())
+            {
+                max_hitches_ = (i64)to_u64(value);
+                ++i;
+            }
 #endif
         }
     }
 }
 
+// Примерный объём буфера окна: два цветовых буфера RGBA8 и буфер глубины D24S8 с учётом MSAA
+static void track_window_memory()
+{
+    i64 num_bytes = gpu_memory::calc_texture_bytes(DV_OS_WINDOW->get_size_in_pixels(), 4 * 2 + 4, false,
+                                                   engine_params::msaa_samples);
+
+    gpu_memory::track(GpuObjectKind::window, 0, GpuMemoryCategory::render_target, num_bytes);
+    gpu_memory::set_source(GpuObjectKind::window, 0, "window framebuffer");
+}
+
+// События, задержку которых измеряет режим низкой задержки
+static bool is_input_event(u32 type)
+{
+    switch (type)
+    {
+    case SDL_EVENT_KEY_DOWN:
+    case SDL_EVENT_KEY_UP:
+    case SDL_EVENT_TEXT_INPUT:
+    case SDL_EVENT_MOUSE_MOTION:
+    case SDL_EVENT_MOUSE_BUTTON_DOWN:
+    case SDL_EVENT_MOUSE_BUTTON_UP:
+    case SDL_EVENT_MOUSE_WHEEL:
+    case SDL_EVENT_GAMEPAD_BUTTON_DOWN:
+    case SDL_EVENT_GAMEPAD_BUTTON_UP:
+    case SDL_EVENT_GAMEPAD_AXIS_MOTION:
+    case SDL_EVENT_FINGER_DOWN:
+    case SDL_EVENT_FINGER_UP:
+    case SDL_EVENT_FINGER_MOTION:
+        return true;
+
+    default:
+        return false;
+    }
+}
+
 void Application::handle_sdl_event(const SDL_Event& event)
 {
     switch (event.type)
@@ -48,31 +126,172 @@ void Application::handle_sdl_event(const SDL_Event& event)
         should_exit_ = true;
         return;
 
+    case SDL_EVENT_KEY_DOWN:
+        if (event.key.key == engine_params::perf_hud_key && engine_params::perf_hud_key != SDLK_UNKNOWN
+            && !event.key.repeat)
+        {
+            perf_hud_visible_ = !perf_hud_visible_;
+
+            if (perf_hud_visible_ && !perf_hud_)
+                perf_hud_ = make_unique<PerfHud>();
+        }
+        return;
+
     case SDL_EVENT_WINDOW_RESIZED:
         {
             i32 width = event.window.data1;
             i32 height = event.window.data2;
             glViewport(0, 0, width, height);
+            track_window_memory();
             return;
         }
     }
 }
 
+#ifdef DV_CTEST
+bool Application::check_budgets() const
+{
+    bool budgets_set = max_p50_ms_ > 0.0 || max_p95_ms_ > 0.0 || max_p99_ms_ > 0.0 || max_frame_ms_ > 0.0
+                       || max_hitches_ >= 0;
+
+    // Кадры прогрева не попадают в статистику. Без проверки слишком медленный запуск
+    // (меньше FrameStats::warmup_frames кадров) проходил бы любой бюджет
+    if (budgets_set && frame_stats_.count() == 0)
+    {
+        DV_LOG->writef_error("Performance budget check failed | no frames after warm-up ({} frames total)",
+                             frame_stats_.total_frames());
+        return false;
+    }
+
+    FrameTimeSummary summary = frame_stats_.summary(&FrameSample::frame_ns);
+    bool ret = true;
+
+    auto check = [&ret](const char* name, f64 value, f64 budget)
+    {
+        if (budget > 0.0 && value > budget)
+        {
+            DV_LOG->writef_error("Performance budget exceeded | {} = {:.2f} ms > {:.2f} ms", name, value, budget);
+            ret = false;
+        }
+    };
+
+    check("p50", summary.p50_ms, max_p50_ms_);
+    check("p95", summary.p95_ms, max_p95_ms_);
+    check("p99", summary.p99_ms, max_p99_ms_);
+    check("max", (f64)frame_stats_.max_frame_ns() / ns_per_ms, max_frame_ms_); // Не только кадры в буфере
+
+    if (max_hitches_ >= 0 && frame_stats_.total_hitches() > max_hitches_)
+    {
+        DV_LOG->writef_error("Performance budget exceeded | hitches = {} > {}", frame_stats_.total_hitches(), max_hitches_);
+        ret = false;
+    }
+
+    return ret;
+}
+#endif
+
+void Application::retire_frame_fence()
+{
+    const FrameFence& fence = frame_fences_.front();
+
+    if (fence.input_ns)
+    {
+        input_latency_ns_ = (i64)(SDL_GetTicksNS() - fence.input_ns);
+        input_latency_sum_ns_ += input_latency_ns_;
+        input_latency_max_ns_ = std::max(input_latency_max_ns_, input_latency_ns_);
+        ++num_input_latency_samples_;
+    }
+
+    glDeleteSync(fence.sync);
+    frame_fences_.pop_front();
+}
+
+void Application::limit_frames_in_flight()
+{
+    if (engine_params::max_frames_in_flight > 0)
+        frame_fences_.push_back({glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0), frame_input_ns_});
+
+    // Завершённые кадры освобождаем без ожидания, чтобы задержка измерялась точнее
+    while (!frame_fences_.empty())
+    {
+        GLenum status = glClientWaitSync(frame_fences_.front().sync, 0, 0);
+
+        if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED)
+            break;
+
+        retire_frame_fence();
+    }
+
+    // Ждём, пока очередь не сократится до нужной длины
+    while ((i32)frame_fences_.size() > std::max(engine_params::max_frames_in_flight, 0))
+    {
+        GLenum status;
+
+        // GL_SYNC_FLUSH_COMMANDS_BIT гарантирует, что забор отправлен GPU и ожидание закончится
+        do
+            status = glClientWaitSync(frame_fences_.front().sync, GL_SYNC_FLUSH_COMMANDS_BIT, ns_per_s);
+        while (status == GL_TIMEOUT_EXPIRED);
+
+        if (status == GL_WAIT_FAILED)
+            DV_LOG->writef_error("{} | status == GL_WAIT_FAILED", DV_FUNCSIG);
+
+        retire_frame_fence();
+    }
+}
+
+SDL_AppResult Application::exit_result()
+{
+    if (!frame_stats_logged_)
+    {
+        frame_stats_.log_summary();
+        gpu_memory::log_summary();
+
+        if (num_input_latency_samples_ > 0)
+        {
+            DV_LOG->writef_info("Input latency | avg {:.2f} ms | max {:.2f} ms | {} samples",
+                                (f64)input_latency_sum_ns_ / num_input_latency_samples_ / ns_per_ms,
+                                (f64)input_latency_max_ns_ / ns_per_ms, num_input_latency_samples_);
+        }
+
+        frame_stats_logged_ = true;
+    }
+
+#ifdef DV_CTEST
+    if (!check_budgets())
+        return SDL_APP_FAILURE;
+#endif
+
+    return SDL_APP_SUCCESS;
+}
+
 SDL_AppResult Application::main_init()
 {
     setup();
 
+    // Командная строка важнее значений из setup()
+    if (!arg_capture_path_.empty())
+        engine_params::capture_path = arg_capture_path_;
+
+    if (arg_capture_frames_ > 0)
+        engine_params::capture_frames = arg_capture_frames_;
+
     log_ = make_unique<Log>(engine_params::log_path);
 
     if (!SDL_Init(0))
         return SDL_APP_FAILURE;
 
     os_window_ = make_unique<OsWindow>();
+    track_window_memory();
     shader_cache_ = make_unique<ShaderCache>();
+    render_device_ = make_unique<GlRenderDevice>();
     texture_cache_ = make_unique<TextureCache>();
+    render_layer_atlas_ = make_unique<RenderLayerAtlas>();
     audio_ = make_unique<Audio>();
     freetype_ = make_unique<FreeType>();
 
+    if (engine_params::dynamic_resolution)
+        dynamic_resolution_ = make_unique<DynamicResolution>();
+
     start();
     new_frame();
 
@@ -100,13 +319,73 @@ SDL_AppResult Application::main_iterate()
         return SDL_APP_CONTINUE;
     }
 
+    FrameSample sample;
+    sample.frame_ns = ns;
+
+    // События ввода, накопленные с прошлого кадра, обрабатываются в этом кадре
+    frame_input_ns_ = pending_input_ns_;
+    pending_input_ns_ = 0;
+
     update(ns);
-    draw();
+    i64 update_end_ticks = get_ticks_ns();
+    sample.update_ns = update_end_ticks - new_ticks;
+
+    if (!capture_started_ && !engine_params::capture_path.empty())
+    {
+        capture_started_ = true;
+
+        if (capture_sprite_batch_)
+            capture_sprite_batch_->begin_capture(engine_params::capture_path, engine_params::capture_frames);
+        else
+            DV_LOG->writef_error("{} | !capture_sprite_batch_", DV_FUNCSIG);
+    }
+
+    if (dynamic_resolution_)
+        dynamic_resolution_->begin_frame();
+
+    {
+        GlDebugGroup debug_group("Application::draw");
+        draw();
+    }
+
+    if (dynamic_resolution_)
+        dynamic_resolution_->upscale();
+
+    {
+        GlDebugGroup debug_group("Application::draw_ui");
+        draw_ui();
+    }
+
+    if (capture_sprite_batch_)
+        capture_sprite_batch_->end_capture_frame();
+
+    if (perf_hud_visible_)
+    {
+        GlDebugGroup debug_group("PerfHud::draw");
+        perf_hud_->draw(frame_stats_, engine_params::max_frames_in_flight > 0 ? input_latency_ns_ : -1);
+    }
+
+    if (dynamic_resolution_)
+        dynamic_resolution_->end_frame();
+
+    // Время отправки команд, без ожидания развёртки и GPU
+    i64 draw_end_ticks = get_ticks_ns();
+    sample.draw_ns = draw_end_ticks - update_end_ticks;
+
     SDL_GL_SwapWindow(DV_OS_WINDOW->window());
 
+    if (engine_params::max_frames_in_flight > 0 || !frame_fences_.empty())
+        limit_frames_in_flight();
+
+    sample.present_ns = get_ticks_ns() - draw_end_ticks;
+    draw_counters::end_frame();
+    gpu_memory::end_frame();
+
+    frame_stats_.add(sample);
+
     if (should_exit_)
     {
-        return SDL_APP_SUCCESS;
+        return exit_result();
     }
     else
     {
@@ -117,10 +396,13 @@ SDL_AppResult Application::main_iterate()
 
 SDL_AppResult Application::main_event(SDL_Event* event)
 {
+    if (is_input_event(event->type) && (pending_input_ns_ == 0 || event->common.timestamp < pending_input_ns_))
+        pending_input_ns_ = event->common.timestamp;
+
     handle_sdl_event(*event);
 
     if (should_exit_)
-        return SDL_APP_SUCCESS;
+        return exit_result();
     else
         return SDL_APP_CONTINUE;
 }
@@ -3,17 +3,23 @@
 
 #pragma once
 
+#include "frame_stats.hpp"
 #include "os_window.hpp"
+#include "perf_hud.hpp"
 
 #include "../audio/audio.hpp"
 #include "../fs/log.hpp"
+#include "../graphics/dynamic_resolution.hpp"
+#include "../graphics/render_layer_atlas.hpp"
 #include "../gl_utils/shader_cache.hpp"
 #include "../gl_utils/texture_cache.hpp"
 #include "../res/freetype.hpp"
+#include "../rhi/rhi.hpp"
 #include "../std_utils/scope_guard.hpp"
 
 #include <SDL3/SDL.h>
 
+#include <deque>
 #include <memory>
 
 
@@ -30,21 +36,98 @@ private:
     std::unique_ptr<Log> log_;
     std::unique_ptr<OsWindow> os_window_;
     std::unique_ptr<ShaderCache> shader_cache_;
+    std::unique_ptr<RenderDevice> render_device_;
     std::unique_ptr<TextureCache> texture_cache_;
+    std::unique_ptr<RenderLayerAtlas> render_layer_atlas_;
     std::unique_ptr<Audio> audio_;
     std::unique_ptr<FreeType> freetype_;
 
+    // Создаётся при engine_params::dynamic_resolution
+    std::unique_ptr<DynamicResolution> dynamic_resolution_;
+
+    // Создаётся при первом показе
+    std::unique_ptr<PerfHud> perf_hud_;
+    bool perf_hud_visible_ = false;
+
+    // Значения параметров командной строки -capture и -capture_frames.
+    // Заменяют engine_params::capture_path и engine_params::capture_frames после setup()
+    StrUtf8 arg_capture_path_;
+    i32 arg_capture_frames_ = 0;
+
+    // Запись по engine_params::capture_path уже началась
+    bool capture_started_ = false;
+
 #ifdef DV_CTEST
     // Через сколько секунд после запуска приложение автоматически закроется.
     // При значении 0 закрываться не будет.
     // Задаётся с помощью параметра -duration x
     i64 duration_ = 0;
+
+    // Бюджеты производительности в миллисекундах. Если при выходе бюджет превышен,
+    // то приложение завершается с ошибкой и тест не проходит. При значении 0 не проверяется.
+    // Задаются с помощью параметров -max_p50_ms x, -max_p95_ms x, -max_p99_ms x, -max_frame_ms x
+    f64 max_p50_ms_ = 0.0;
+    f64 max_p95_ms_ = 0.0;
+    f64 max_p99_ms_ = 0.0;
+    f64 max_frame_ms_ = 0.0;
+
+    // Допустимое число рывков. При значении -1 не проверяется.
+    // Задаётся с помощью параметра -max_hitches x
+    i64 max_hitches_ = -1;
+
+    // Проверяет бюджеты производительности
+    bool check_budgets() const;
 #endif
 
+    // Времена последних кадров
+    FrameStats frame_stats_;
+
+    // Статистика уже выведена в лог
+    bool frame_stats_logged_ = false;
+
+    // Кадр в очереди драйвера (см. engine_params::max_frames_in_flight)
+    struct FrameFence
+    {
+        GLsync sync;
+
+        // Время самого раннего события ввода, обработанного в этом кадре (SDL_GetTicksNS()).
+        // 0 - событий не было
+        u64 input_ns;
+    };
+
+    std::deque<FrameFence> frame_fences_;
+
+    // Время самого раннего события ввода, которое ещё не обработано в update()
+    u64 pending_input_ns_ = 0;
+
+    // Время самого раннего события ввода, обработанного в текущем кадре
+    u64 frame_input_ns_ = 0;
+
+    // Задержка ввода: последнее измерение, сумма и максимум для лога
+    i64 input_latency_ns_ = 0;
+    i64 input_latency_sum_ns_ = 0;
+    i64 input_latency_max_ns_ = 0;
+    i64 num_input_latency_samples_ = 0;
+
+    // Вставляет забор после SDL_GL_SwapWindow() и ждёт, пока в очереди
+    // останется не больше engine_params::max_frames_in_flight кадров
+    void limit_frames_in_flight();
+
+    // Освобождает забор и измеряет задержку ввода для завершённого кадра
+    void retire_frame_fence();
+
+    // Выводит статистику кадров в лог и определяет код завершения
+    SDL_AppResult exit_result();
+
 protected:
     // Пользователь желает прервать главный цикл
     bool should_exit_ = false;
 
+    // Батч, который записывается при непустом engine_params::capture_path.
+    // Задаётся в start(). Запись начинается перед draw() первого кадра,
+    // а кадр завершается после draw_ui()
+    SpriteBatch* capture_sprite_batch_ = nullptr;
+
     Application(const std::vector<StrUtf8>& args);
     virtual ~Application() = default;
 
@@ -52,14 +135,33 @@ protected:
     virtual void start() {}
     virtual void new_frame() {}
 
-    // Обработчики событий вызываются перед update()
+    // Обработчики событий вызываются перед update().
+    // Переопределённый обработчик должен вызывать базовый, чтобы работала клавиша оверлея производительности
     virtual void handle_sdl_event(const SDL_Event& event);
 
     virtual void update(i64 ns) { (void)ns; }
+
+    // Рисует сцену. При динамическом разрешении вьюпорт меньше окна,
+    // но SpriteBatch по-прежнему принимает координаты в пикселях окна
     virtual void draw() {}
 
+    // Рисует интерфейс поверх сцены всегда в разрешении окна
+    virtual void draw_ui() {}
+
 public:
     const std::vector<StrUtf8>& args() const { return args_; }
+    const FrameStats& frame_stats() const { return frame_stats_; }
+
+    // Доля размера окна, в которой рендерится сцена (1, если динамическое разрешение выключено)
+    f32 resolution_scale() const { return dynamic_resolution_ ? dynamic_resolution_->scale() : 1.f; }
+
+    // Время (SDL_GetTicksNS()) самого раннего события ввода, которое обрабатывается в текущем кадре.
+    // 0, если в этом кадре событий ввода не было
+    u64 frame_input_ns() const { return frame_input_ns_; }
+
+    // Последняя измеренная задержка от события ввода до завершения кадра на GPU.
+    // Измеряется только при engine_params::max_frames_in_flight > 0
+    i64 input_latency_ns() const { return input_latency_ns_; }
 
     // Методы ниже должны быть публичными, чтобы SDL мог их вызвать.
     // Пользователь не должен их вызывать
@@ -5,6 +5,7 @@
 
 #include "../std_utils/string.hpp"
 
+#include <SDL3/SDL_keycode.h>
 #include <glm/glm.hpp>
 
 
@@ -29,15 +30,62 @@ namespace engine_params
     inline glm::ivec2 window_size{800, 600};
     inline WindowMode window_mode = WindowMode::windowed;
 
+    // Окно создаётся скрытым (например для бенчмарков, которые рендерят в FBO)
+    inline bool window_hidden = false;
+
     // 0 - выключено, 1 - включено,
     // -1 - адаптивная вертикальная синхронизация (если не поддерживается, то включается обычная).
     // Значения 2, -2, 3, -3 и т.д. делят частоту кадров
     inline i32 vsync = 0;
 
+    // Режим низкой задержки: сколько кадров может одновременно находиться в очереди драйвера.
+    // После каждого SDL_GL_SwapWindow() вставляется glFenceSync(), и перед следующим кадром
+    // движок ждёт завершения кадра, отправленного max_frames_in_flight кадров назад.
+    // Заодно измеряется задержка от события ввода до завершения кадра на GPU (Application::input_latency_ns()).
+    // 0 - очередь не ограничивается (драйвер может буферизовать несколько кадров при вертикальной синхронизации)
+    inline i32 max_frames_in_flight = 0;
+
+    // Динамическое разрешение (см. graphics/dynamic_resolution.hpp): сцена (Application::draw())
+    // рендерится в FBO, размер которого подстраивается по таймерам GPU, чтобы время кадра на GPU
+    // не превышало target_gpu_frame_ms. Затем сцена растягивается на окно с повышением резкости,
+    // а интерфейс (Application::draw_ui()) рисуется в разрешении окна
+    inline bool dynamic_resolution = false;
+    inline f32 target_gpu_frame_ms = 14.f;
+
+    // Наименьшая доля размера окна по каждой оси
+    inline f32 min_resolution_scale = 0.5f;
+
+    // Сила повышения резкости при растягивании: от 0 до 1
+    inline f32 upscale_sharpness = 0.5f;
+
     // 0 или 1 - MSAA выключено,
     // другое значение - число сэмплов (рекомендуется 4 или 8).
     // Подробнее: https://habr.com/ru/articles/351706/
     inline i32 msaa_samples = 0;
+
+    // Использовать возможности OpenGL 4.3 (например multi-draw indirect в SpriteBatch), если драйвер
+    // их поддерживает. Выключается, чтобы проверить запасной путь OpenGL 3.3
+    inline bool gl_4_3_features = true;
+
+    // Отладочный контекст OpenGL и расширение GL_KHR_debug (см. gl_utils/gl_debug.hpp).
+    // Сообщения драйвера выводятся в лог, объекты OpenGL получают имена,
+    // а вызовы отрисовки группируются в GPU-профайлерах
+#ifdef _DEBUG
+    inline bool gl_debug = true;
+#else
+    inline bool gl_debug = false;
+#endif
+
+    // Запись вызовов SpriteBatch для dviglo_replay (см. SpriteBatch::begin_capture()).
+    // Если путь не пустой, Application записывает capture_frames кадров батча,
+    // который приложение указало в Application::capture_sprite_batch_.
+    // Задаётся также параметрами командной строки -capture path и -capture_frames x
+    inline StrUtf8 capture_path;
+    inline i32 capture_frames = 60;
+
+    // Клавиша, которая показывает и скрывает оверлей производительности (см. main/perf_hud.hpp).
+    // SDLK_UNKNOWN отключает оверлей
+    inline SDL_Keycode perf_hud_key = SDLK_F3;
 }
 
 } // namespace dviglo
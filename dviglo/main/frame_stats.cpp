@@ -0,0 +1,136 @@
+// Copyright (c) the Dviglo project
+// License: MIT
+
+#include "frame_stats.hpp"
+
+#include "timer.hpp"
+
+#include "../fs/log.hpp"
+
+#include <algorithm> // nth_element, max_element
+
+using namespace std;
+
+
+namespace dviglo
+{
+
+// Значение, меньше которого percent процентов values. Меняет порядок элементов
+static i64 percentile(vector<i64>& values, f64 percent)
+{
+    size_t index = (size_t)(percent / 100.0 * (values.size() - 1) + 0.5);
+    nth_element(values.begin(), values.begin() + index, values.end());
+    return values[index];
+}
+
+FrameStats::FrameStats(size_t capacity)
+    : samples_(capacity)
+{
+    assert(capacity > 0);
+}
+
+void FrameStats::add(const FrameSample& sample)
+{
+    ++total_frames_;
+
+    if ((i32)warmup_frame_ns_.size() < warmup_frames)
+    {
+        warmup_frame_ns_.push_back(sample.frame_ns);
+
+        // Медиана не зависит от единичных выбросов в начале
+        if ((i32)warmup_frame_ns_.size() == warmup_frames)
+            smoothed_frame_ns_ = (f64)percentile(warmup_frame_ns_, 50.0);
+
+        return;
+    }
+
+    if (sample.frame_ns > smoothed_frame_ns_ * hitch_factor)
+        ++total_hitches_;
+
+    max_frame_ns_ = std::max(max_frame_ns_, sample.frame_ns);
+
+    // Рывки тоже учитываются, но с малым весом
+    smoothed_frame_ns_ += (sample.frame_ns - smoothed_frame_ns_) * 0.05;
+
+    samples_[next_] = sample;
+    next_ = (next_ + 1) % samples_.size();
+    count_ = std::min(count_ + 1, samples_.size());
+}
+
+void FrameStats::clear()
+{
+    next_ = 0;
+    count_ = 0;
+    total_frames_ = 0;
+    total_hitches_ = 0;
+    max_frame_ns_ = 0;
+    smoothed_frame_ns_ = 0.0;
+    warmup_frame_ns_.clear();
+}
+
+const FrameSample& FrameStats::last() const
+{
+    assert(count_ > 0);
+    return samples_[(next_ + samples_.size() - 1) % samples_.size()];
+}
+
+const FrameSample& FrameStats::recent(size_t index) const
+{
+    assert(index < count_);
+    return samples_[(next_ + samples_.size() - 1 - index) % samples_.size()];
+}
+
+static f64 to_ms(f64 ns)
+{
+    return ns / ns_per_ms;
+}
+
+FrameTimeSummary FrameStats::summary(i64 FrameSample::* metric) const
+{
+    FrameTimeSummary ret;
+
+    if (count_ == 0)
+        return ret;
+
+    vector<i64> values(count_);
+    f64 sum = 0.0;
+
+    // Порядок кадров не важен
+    for (size_t i = 0; i < count_; ++i)
+    {
+        values[i] = samples_[i].*metric;
+        sum += (f64)values[i];
+    }
+
+    ret.num_frames = (i32)count_;
+    ret.avg_ms = to_ms(sum / count_);
+    ret.max_ms = to_ms((f64)*max_element(values.begin(), values.end()));
+    ret.p99_ms = to_ms((f64)percentile(values, 99.0));
+    ret.p95_ms = to_ms((f64)percentile(values, 95.0));
+    ret.p50_ms = to_ms((f64)percentile(values, 50.0));
+
+    return ret;
+}
+
+static void log_metric(const char* name, const FrameTimeSummary& summary)
+{
+    DV_LOG->writef_info("{:>7} ms | avg {:.2f} | p50 {:.2f} | p95 {:.2f} | p99 {:.2f} | max {:.2f}",
+                        name, summary.avg_ms, summary.p50_ms, summary.p95_ms, summary.p99_ms, summary.max_ms);
+}
+
+void FrameStats::log_summary() const
+{
+    if (count_ == 0)
+        return;
+
+    DV_LOG->writef_info("Frame stats | {} frames total, last {} analyzed | {} hitches (> {}x smoothed frame time)"
+                        " | max frame {:.2f} ms",
+                        total_frames_, count_, total_hitches_, hitch_factor, to_ms((f64)max_frame_ns_));
+
+    log_metric("frame", summary(&FrameSample::frame_ns));
+    log_metric("update", summary(&FrameSample::update_ns));
+    log_metric("draw", summary(&FrameSample::draw_ns));
+    log_metric("present", summary(&FrameSample::present_ns));
+}
+
+} // namespace dviglo
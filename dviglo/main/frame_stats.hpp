@@ -0,0 +1,95 @@
+// Copyright (c) the Dviglo project
+// License: MIT
+
+#pragma once
+
+#include "../common/primitive_types.hpp"
+
+#include <vector>
+
+
+namespace dviglo
+{
+
+// Время одного кадра
+struct FrameSample
+{
+    i64 frame_ns = 0;   // Между началами соседних кадров
+    i64 update_ns = 0;  // Application::update()
+    i64 draw_ns = 0;    // Application::draw(), draw_ui() и PerfHud до SDL_GL_SwapWindow()
+    i64 present_ns = 0; // SDL_GL_SwapWindow() и ожидание кадров в полёте (с vsync - ожидание развёртки)
+};
+
+// Распределение одной из величин FrameSample (в миллисекундах)
+struct FrameTimeSummary
+{
+    i32 num_frames = 0;
+    f64 avg_ms = 0.0;
+    f64 p50_ms = 0.0;
+    f64 p95_ms = 0.0;
+    f64 p99_ms = 0.0;
+    f64 max_ms = 0.0;
+};
+
+// Кольцевой буфер с временами последних кадров
+class FrameStats
+{
+private:
+    std::vector<FrameSample> samples_;
+
+    // Куда будет записан следующий кадр
+    size_t next_ = 0;
+
+    // Число заполненных элементов samples_
+    size_t count_ = 0;
+
+    // Число кадров за всё время
+    i64 total_frames_ = 0;
+
+    // Число рывков за всё время
+    i64 total_hitches_ = 0;
+
+    // Самый долгий кадр за всё время после прогрева (в буфере он может быть уже перезаписан)
+    i64 max_frame_ns_ = 0;
+
+    // Среднее время кадра (экспоненциальное сглаживание) для обнаружения рывков
+    f64 smoothed_frame_ns_ = 0.0;
+
+    // Времена кадров прогрева. По их медиане задаётся начальное smoothed_frame_ns_
+    std::vector<i64> warmup_frame_ns_;
+
+public:
+    // Кадр считается рывком, если он длиннее сглаженного времени кадра в hitch_factor раз
+    inline static constexpr f64 hitch_factor = 2.0;
+
+    // Первые кадры (загрузка, компиляция шейдеров, первый кадр длиной в микросекунды)
+    // не попадают в буфер и не считаются рывками
+    inline static constexpr i32 warmup_frames = 30;
+
+    // capacity - сколько последних кадров хранится
+    FrameStats(size_t capacity = 4096);
+
+    void add(const FrameSample& sample);
+
+    // Сбрасывает статистику (например после загрузки уровня)
+    void clear();
+
+    size_t count() const { return count_; }
+    i64 total_frames() const { return total_frames_; }
+    i64 total_hitches() const { return total_hitches_; }
+    i64 max_frame_ns() const { return max_frame_ns_; }
+
+    // Последний добавленный кадр
+    const FrameSample& last() const;
+
+    // Кадр, добавленный index кадров назад (0 - последний). index < count()
+    const FrameSample& recent(size_t index) const;
+
+    // Распределение величины по кадрам в буфере, например summary(&FrameSample::frame_ns)
+    FrameTimeSummary summary(i64 FrameSample::* metric) const;
+
+    // Выводит распределения всех величин в лог
+    void log_summary() const;
+};
+
+} // namespace dviglo
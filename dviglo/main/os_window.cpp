@@ -6,6 +6,7 @@
 #include "engine_params.hpp"
 
 #include "../fs/log.hpp"
+#include "../gl_utils/gl_debug.hpp"
 
 #include <glad/gl.h>
 
@@ -34,6 +35,10 @@ OsWindow::OsWindow()
     SDL_GL_SetAttribute(SDL_GL_GREEN_SIZE, 8);
     SDL_GL_SetAttribute(SDL_GL_BLUE_SIZE, 8);
     SDL_GL_SetAttribute(SDL_GL_ALPHA_SIZE, 8);
+    SDL_GL_SetAttribute(SDL_GL_DEPTH_SIZE, 24); // Для SpriteBatch::begin_depth_scene()
+
+    if (engine_params::gl_debug)
+        SDL_GL_SetAttribute(SDL_GL_CONTEXT_FLAGS, SDL_GL_CONTEXT_DEBUG_FLAG);
 
     if (engine_params::msaa_samples > 1)
     {
@@ -53,6 +58,7 @@ OsWindow::OsWindow()
     SDL_SetBooleanProperty(props, SDL_PROP_WINDOW_CREATE_FULLSCREEN_BOOLEAN,
                            engine_params::window_mode == WindowMode::fullscreen_window
                            || engine_params::window_mode == WindowMode::exclusive_fullscreen);
+    SDL_SetBooleanProperty(props, SDL_PROP_WINDOW_CREATE_HIDDEN_BOOLEAN, engine_params::window_hidden);
     window_ = SDL_CreateWindowWithProperties(props);
     SDL_DestroyProperties(props);
 
@@ -107,6 +113,8 @@ OsWindow::OsWindow()
     DV_LOG->writef_info("GL_RENDERER: {}", reinterpret_cast<const char*>(glGetString(GL_RENDERER)));
     DV_LOG->writef_info("GL_VERSION: {}", reinterpret_cast<const char*>(glGetString(GL_VERSION)));
 
+    init_gl_debug();
+
     instance_ = this;
     DV_LOG->write_debug("OsWindow constructed");
 }
@@ -131,4 +139,9 @@ ivec2 OsWindow::get_size_in_pixels() const
     return ret;
 }
 
+f32 OsWindow::get_pixel_density() const
+{
+    return SDL_GetWindowPixelDensity(window_);
+}
+
 } // namespace dviglo
@@ -3,6 +3,8 @@
 
 #pragma once
 
+#include "../common/primitive_types.hpp"
+
 #include <glm/glm.hpp>
 #include <SDL3/SDL.h>
 
@@ -29,6 +31,9 @@ public:
     SDL_GLContext gl_context() const { return gl_context_; }
 
     glm::ivec2 get_size_in_pixels() const;
+
+    // Отношение пикселей к логическим единицам окна (больше 1 на экранах с высокой плотностью пикселей)
+    f32 get_pixel_density() const;
 };
 
 #define DV_OS_WINDOW (dviglo::OsWindow::instance())
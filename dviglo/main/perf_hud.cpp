@@ -0,0 +1,156 @@
+// Copyright (c) the Dviglo project
+// License: MIT
+
+#include "perf_hud.hpp"
+
+#include "timer.hpp"
+
+#include "../fs/log.hpp"
+#include "../gl_utils/draw_counters.hpp"
+#include "../gl_utils/gpu_memory.hpp"
+#include "../gl_utils/texture_cache.hpp"
+
+#include <format>
+
+using namespace glm;
+using namespace std;
+
+
+namespace dviglo
+{
+
+// Отступ от края окна и от края панели
+static constexpr f32 margin = 8.f;
+static constexpr f32 padding = 6.f;
+
+static constexpr f32 graph_height = 60.f;
+
+PerfHud::PerfHud()
+{
+    font_ = SpriteFont::create_builtin();
+    sprite_batch_ = make_unique<SpriteBatch>();
+    glyphs_.reserve(512);
+}
+
+void PerfHud::layout_line(const StrUtf8& text, vec2 position)
+{
+    // Текст в оверлее только ASCII
+    for (char c : text)
+    {
+        auto it = font_->glyphs().find((c32)c);
+
+        if (it == font_->glyphs().end())
+            it = font_->glyphs().find('?');
+
+        const Glyph& glyph = it->second;
+
+        if (c != ' ')
+            glyphs_.push_back({Rect(position + vec2(glyph.offset), vec2(glyph.rect.size)), Rect(glyph.rect)});
+
+        position.x += glyph.advance_x;
+    }
+}
+
+void PerfHud::refresh_text(const FrameStats& frame_stats, i64 input_latency_ns, i64 now_ns)
+{
+    f64 elapsed_s = last_refresh_ns_ ? (f64)(now_ns - last_refresh_ns_) / ns_per_s : 0.0;
+    last_refresh_ns_ = now_ns;
+
+    i64 num_messages = DV_LOG->num_messages();
+    f64 log_rate = elapsed_s > 0.0 ? (num_messages - last_num_messages_) / elapsed_s : 0.0;
+    last_num_messages_ = num_messages;
+
+    FrameTimeSummary frame = frame_stats.summary(&FrameSample::frame_ns);
+    const FrameSample& last = frame_stats.last();
+
+    i32 num_textures;
+    i64 texture_bytes;
+    DV_TEXTURE_CACHE->get_usage(&num_textures, &texture_bytes);
+
+    const DrawCounters& counters = draw_counters::last_frame;
+
+    StrUtf8 lines[] =
+    {
+        format("FPS {:.1f}  frame {:.2f} ms", frame.avg_ms > 0.0 ? 1000.0 / frame.avg_ms : 0.0, frame.avg_ms),
+        format("p95 {:.2f}  p99 {:.2f}  max {:.2f} ms", frame.p95_ms, frame.p99_ms, frame.max_ms),
+        format("update {:.2f}  draw {:.2f}  present {:.2f} ms", (f64)last.update_ns / ns_per_ms,
+               (f64)last.draw_ns / ns_per_ms, (f64)last.present_ns / ns_per_ms),
+        format("draw calls {}  vertices {}", counters.draw_calls, counters.vertices),
+        format("textures {}  ~{:.1f} MB", num_textures, texture_bytes / (1024.0 * 1024.0)),
+        format("GPU memory {:.1f} MB  peak {:.1f} MB", gpu_memory::total_used_bytes() / (1024.0 * 1024.0),
+               gpu_memory::total_peak_bytes() / (1024.0 * 1024.0)),
+        format("log {:.1f} msg/s  hitches {}", log_rate, frame_stats.total_hitches()),
+        input_latency_ns >= 0 ? format("input latency {:.1f} ms", (f64)input_latency_ns / ns_per_ms)
+                              : StrUtf8("input latency: max_frames_in_flight = 0")
+    };
+
+    glyphs_.clear();
+    vec2 position(margin + padding, margin + padding);
+
+    for (const StrUtf8& line : lines)
+    {
+        layout_line(line, position);
+        position.y += font_->line_height();
+    }
+
+    text_height_ = position.y - margin - padding;
+}
+
+void PerfHud::draw(const FrameStats& frame_stats, i64 input_latency_ns)
+{
+    if (frame_stats.count() == 0)
+        return;
+
+    i64 now_ns = get_ticks_ns();
+
+    if (now_ns - last_refresh_ns_ >= text_refresh_ns)
+        refresh_text(frame_stats, input_latency_ns, now_ns);
+
+    SpriteBatch* sb = sprite_batch_.get();
+    sb->prepare_ogl();
+
+    // Панель
+    vec2 panel_pos(margin, margin);
+    vec2 panel_size(graph_length + padding * 2.f, text_height_ + graph_height + padding * 3.f);
+    sb->set_shape_color(0xB0000000);
+    sb->draw_rect(Rect(panel_pos, panel_size));
+
+    // График: каждый кадр - столбик шириной в пиксель, новые кадры справа
+    vec2 graph_pos(margin + padding, margin + padding * 2.f + text_height_);
+    f32 graph_bottom = graph_pos.y + graph_height;
+    f32 px_per_ms = graph_height / (f32)graph_max_ms;
+
+    i32 num_bars = std::min((i32)frame_stats.count(), graph_length);
+
+    for (i32 i = 0; i < num_bars; ++i)
+    {
+        f32 ms = (f32)frame_stats.recent(i).frame_ns / ns_per_ms;
+        f32 height = std::min(ms * px_per_ms, graph_height);
+
+        // Зелёный - 60 FPS, жёлтый - 30 FPS, красный - медленнее
+        if (ms <= 1000.f / 60.f)
+            sb->set_shape_color(0xFF40C040);
+        else if (ms <= 1000.f / 30.f)
+            sb->set_shape_color(0xFF40C0E0);
+        else
+            sb->set_shape_color(0xFF4040E0);
+
+        f32 x = graph_pos.x + graph_length - 1 - i;
+        sb->draw_rect(Rect(x, graph_bottom - height, 1.f, height));
+    }
+
+    // Уровни 60 и 30 FPS
+    sb->set_shape_color(0x80FFFFFF);
+    sb->draw_rect(Rect(graph_pos.x, graph_bottom - 1000.f / 60.f * px_per_ms, (f32)graph_length, 1.f));
+    sb->draw_rect(Rect(graph_pos.x, graph_bottom - 1000.f / 30.f * px_per_ms, (f32)graph_length, 1.f));
+
+    // Текст
+    Texture* texture = font_->textures()[0].get();
+
+    for (const HudGlyph& glyph : glyphs_)
+        sb->draw_sprite(texture, glyph.destination, &glyph.source);
+
+    sb->flush();
+}
+
+} // namespace dviglo
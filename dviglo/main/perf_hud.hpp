@@ -0,0 +1,67 @@
+// Copyright (c) the Dviglo project
+// License: MIT
+
+#pragma once
+
+#include "frame_stats.hpp"
+#include "timer.hpp"
+
+#include "../graphics/sprite_batch.hpp"
+#include "../res/sprite_font.hpp"
+
+#include <memory>
+#include <vector>
+
+
+namespace dviglo
+{
+
+// Оверлей производительности: график времени кадров, вызовы отрисовки, текстуры,
+// частота сообщений лога и время подсистем.
+// Включается клавишей engine_params::perf_hud_key (см. Application::handle_sdl_event()).
+// Текст переформатируется и раскладывается только несколько раз в секунду,
+// а в остальных кадрах выводятся готовые четырёхугольники глифов
+class PerfHud
+{
+private:
+    std::unique_ptr<SpriteFont> font_;
+    std::unique_ptr<SpriteBatch> sprite_batch_;
+
+    // Глиф с готовыми координатами (в пикселях)
+    struct HudGlyph
+    {
+        Rect destination;
+        Rect source;
+    };
+
+    std::vector<HudGlyph> glyphs_;
+
+    // Как часто обновляется текст
+    inline static constexpr i64 text_refresh_ns = 250 * ns_per_ms;
+
+    // Сколько последних кадров показывает график
+    inline static constexpr i32 graph_length = 240;
+
+    // Время, соответствующее верхней границе графика
+    inline static constexpr f64 graph_max_ms = 50.0;
+
+    i64 last_refresh_ns_ = 0;
+    i64 last_num_messages_ = 0;
+
+    // Высота текста после последней раскладки
+    f32 text_height_ = 0.f;
+
+    void refresh_text(const FrameStats& frame_stats, i64 input_latency_ns, i64 now_ns);
+
+    // Добавляет глифы строки в glyphs_
+    void layout_line(const StrUtf8& text, glm::vec2 position);
+
+public:
+    PerfHud();
+
+    // Вызывается после Application::draw() перед SDL_GL_SwapWindow().
+    // input_latency_ns - задержка ввода (см. Application::input_latency_ns()), -1 - не измеряется
+    void draw(const FrameStats& frame_stats, i64 input_latency_ns);
+};
+
+} // namespace dviglo
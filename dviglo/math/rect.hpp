@@ -92,6 +92,34 @@ struct Aabb
     {
     }
 
+    explicit Aabb(const Rect& rect)
+        : min(rect.pos)
+        , max(rect.pos + rect.size)
+    {
+    }
+
+    bool operator==(const Aabb& other) const { return min == other.min && max == other.max; }
+    bool operator!=(const Aabb& other) const { return !(*this == other); }
+
+    // Имеют ли AABB общую область ненулевой площади
+    bool intersects(const Aabb& aabb) const
+    {
+        return min.x < aabb.max.x && aabb.min.x < max.x
+            && min.y < aabb.max.y && aabb.min.y < max.y;
+    }
+
+    bool contains(const Aabb& aabb) const
+    {
+        return aabb.min.x >= min.x && aabb.max.x <= max.x
+            && aabb.min.y >= min.y && aabb.max.y <= max.y;
+    }
+
+    // Если AABB не пересекаются, то результат пустой (min > max)
+    Aabb intersection(const Aabb& aabb) const
+    {
+        return Aabb(glm::max(min, aabb.min), glm::min(max, aabb.max));
+    }
+
     void merge(glm::vec2 point)
     {
         if (point.x < min.x)
@@ -0,0 +1,285 @@
+// Copyright (c) the Dviglo project
+// License: MIT
+
+#include "animation_library.hpp"
+
+#include "../fs/file.hpp"
+#include "../fs/file_base.hpp"
+#include "../fs/log.hpp"
+#include "../fs/path.hpp"
+#include "../gl_utils/texture_cache.hpp"
+
+#include <pugixml.hpp>
+
+#include <cstring> // memcmp, memcpy
+
+using namespace glm;
+using namespace pugi;
+using namespace std;
+
+
+namespace dviglo
+{
+
+// Последовательное чтение бинарного файла с проверкой границ
+struct AnimationReader
+{
+    const byte* data;
+    size_t size;
+    size_t offset = 0;
+    bool error = false;
+
+    void read(void* out, size_t num_bytes)
+    {
+        if (error || offset + num_bytes > size)
+        {
+            error = true;
+            return;
+        }
+
+        memcpy(out, data + offset, num_bytes);
+        offset += num_bytes;
+    }
+
+    template <typename T>
+    T read()
+    {
+        T ret{};
+        read(&ret, sizeof(T));
+        return ret;
+    }
+
+    StrUtf8 read_string()
+    {
+        u32 length = read<u32>();
+
+        if (error || offset + length > size)
+        {
+            error = true;
+            return StrUtf8();
+        }
+
+        StrUtf8 ret((const char*)data + offset, length);
+        offset += length;
+        return ret;
+    }
+};
+
+static void write_string(FILE* file, const StrUtf8& str)
+{
+    u32 length = (u32)str.size();
+    file_write(&length, sizeof(length), 1, file);
+    file_write(str.data(), 1, (i32)length, file);
+}
+
+AnimationLibrary::AnimationLibrary(const StrUtf8& file_path)
+{
+    StrUtf8 ext;
+    split_path(file_path, nullptr, nullptr, &ext);
+
+    bool ok = ext == "anim" ? load_binary(file_path) : load_xml(file_path);
+
+    if (!ok)
+    {
+        clips_.clear();
+        clip_indices_.clear();
+        frame_sources_.clear();
+        return;
+    }
+
+    if (!texture_file_name_.empty())
+        texture_ = DV_TEXTURE_CACHE->get(get_parent(file_path) + texture_file_name_);
+
+    update_uvs();
+}
+
+bool AnimationLibrary::load_xml(const StrUtf8& file_path)
+{
+    xml_document doc;
+    xml_parse_result result = doc.load_file(file_path.c_str());
+
+    if (!result)
+    {
+        DV_LOG->writef_error(R"({} | !result | "{}")", DV_FUNCSIG, file_path);
+        return false;
+    }
+
+    xml_node root_node = doc.first_child();
+
+    if (root_node.name() != string("animations"))
+    {
+        DV_LOG->writef_error(R"({} | root_node.name() != string("animations") | "{}")", DV_FUNCSIG, file_path);
+        return false;
+    }
+
+    texture_file_name_ = root_node.attribute("texture").as_string();
+
+    for (xml_node clip_node : root_node.children("clip"))
+    {
+        vector<Rect> frames;
+
+        for (xml_node frame_node : clip_node.children("frame"))
+        {
+            frames.emplace_back(vec2(frame_node.attribute("x").as_float(), frame_node.attribute("y").as_float()),
+                                vec2(frame_node.attribute("width").as_float(), frame_node.attribute("height").as_float()));
+        }
+
+        StrUtf8 name = clip_node.attribute("name").as_string();
+
+        if (add_clip(name, frames, clip_node.attribute("fps").as_float(10.f), clip_node.attribute("loop").as_bool(true)) < 0)
+        {
+            DV_LOG->writef_error(R"({} | add_clip() < 0 | "{}" | "{}")", DV_FUNCSIG, file_path, name);
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool AnimationLibrary::load_binary(const StrUtf8& file_path)
+{
+    vector<byte> data = read_all_data(file_path);
+
+    if (data.empty())
+        return false;
+
+    AnimationReader reader{data.data(), data.size()};
+    AnimationFileHeader header = reader.read<AnimationFileHeader>();
+    AnimationFileHeader expected;
+
+    if (reader.error || memcmp(header.magic, expected.magic, sizeof(expected.magic)) != 0
+        || header.version != expected.version)
+    {
+        DV_LOG->writef_error(R"({} | wrong header | "{}")", DV_FUNCSIG, file_path);
+        return false;
+    }
+
+    texture_file_name_ = reader.read_string();
+
+    u32 num_frames = reader.read<u32>();
+
+    if (reader.error || num_frames > data.size() / sizeof(Rect))
+    {
+        DV_LOG->writef_error(R"({} | wrong num_frames | "{}")", DV_FUNCSIG, file_path);
+        return false;
+    }
+
+    frame_sources_.resize(num_frames);
+    reader.read(frame_sources_.data(), num_frames * sizeof(Rect));
+
+    u32 num_clips = reader.read<u32>();
+
+    for (u32 i = 0; i < num_clips && !reader.error; ++i)
+    {
+        AnimationClip clip;
+        clip.name = reader.read_string();
+        clip.first_frame = reader.read<i32>();
+        clip.num_frames = reader.read<i32>();
+        clip.frame_duration_ns = reader.read<i64>();
+        clip.loop = reader.read<u8>();
+
+        if (clip.first_frame < 0 || clip.num_frames <= 0 || clip.first_frame + clip.num_frames > (i32)num_frames
+            || clip.frame_duration_ns <= 0 || clip_indices_.contains(clip.name))
+        {
+            DV_LOG->writef_error(R"({} | wrong clip | "{}" | "{}")", DV_FUNCSIG, file_path, clip.name);
+            return false;
+        }
+
+        clip_indices_[clip.name] = (i32)clips_.size();
+        clips_.push_back(std::move(clip));
+    }
+
+    if (reader.error)
+    {
+        DV_LOG->writef_error(R"({} | reader.error | "{}")", DV_FUNCSIG, file_path);
+        return false;
+    }
+
+    return true;
+}
+
+void AnimationLibrary::update_uvs(i32 first_frame)
+{
+    frame_uv_mins_.resize(frame_sources_.size());
+    frame_uv_maxs_.resize(frame_sources_.size());
+
+    vec2 inv_texture_size = texture_ ? 1.f / vec2(texture_->size()) : vec2(0.f);
+
+    for (size_t i = first_frame; i < frame_sources_.size(); ++i)
+    {
+        const Rect& source = frame_sources_[i];
+        frame_uv_mins_[i] = source.pos * inv_texture_size;
+        frame_uv_maxs_[i] = (source.pos + source.size) * inv_texture_size;
+    }
+}
+
+void AnimationLibrary::set_texture(shared_ptr<Texture> texture, const StrUtf8& file_name)
+{
+    texture_ = std::move(texture);
+    texture_file_name_ = file_name;
+    update_uvs();
+}
+
+i32 AnimationLibrary::add_clip(const StrUtf8& name, const vector<Rect>& frames, f32 fps, bool loop)
+{
+    if (frames.empty() || fps <= 0.f || clip_indices_.contains(name))
+        return -1;
+
+    AnimationClip clip;
+    clip.name = name;
+    clip.first_frame = (i32)frame_sources_.size();
+    clip.num_frames = (i32)frames.size();
+    clip.frame_duration_ns = std::max((i64)(1'000'000'000.0 / fps), (i64)1);
+    clip.loop = loop;
+
+    // UV уже добавленных кадров не меняются
+    frame_sources_.insert(frame_sources_.end(), frames.begin(), frames.end());
+    update_uvs(clip.first_frame);
+
+    i32 index = (i32)clips_.size();
+    clip_indices_[name] = index;
+    clips_.push_back(std::move(clip));
+    return index;
+}
+
+i32 AnimationLibrary::find_clip(const StrUtf8& name) const
+{
+    auto it = clip_indices_.find(name);
+    return it == clip_indices_.end() ? -1 : it->second;
+}
+
+void AnimationLibrary::save(const StrUtf8& file_path) const
+{
+    FILE* file = file_open(file_path, "wb");
+
+    if (!file)
+    {
+        DV_LOG->writef_error(R"({} | !file | "{}")", DV_FUNCSIG, file_path);
+        return;
+    }
+
+    AnimationFileHeader header;
+    file_write(&header, sizeof(header), 1, file);
+    write_string(file, texture_file_name_);
+
+    u32 num_frames = (u32)frame_sources_.size();
+    file_write(&num_frames, sizeof(num_frames), 1, file);
+    file_write(frame_sources_.data(), sizeof(Rect), (i32)num_frames, file);
+
+    u32 num_clips = (u32)clips_.size();
+    file_write(&num_clips, sizeof(num_clips), 1, file);
+
+    for (const AnimationClip& clip : clips_)
+    {
+        write_string(file, clip.name);
+        file_write(&clip.first_frame, sizeof(clip.first_frame), 1, file);
+        file_write(&clip.num_frames, sizeof(clip.num_frames), 1, file);
+        file_write(&clip.frame_duration_ns, sizeof(clip.frame_duration_ns), 1, file);
+        u8 loop = clip.loop;
+        file_write(&loop, sizeof(loop), 1, file);
+    }
+
+    file_close(file);
+}
+
+} // namespace dviglo
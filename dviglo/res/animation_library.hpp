@@ -0,0 +1,96 @@
+// Copyright (c) the Dviglo project
+// License: MIT
+
+#pragma once
+
+#include "../gl_utils/texture.hpp"
+#include "../math/rect.hpp"
+#include "../std_utils/string.hpp"
+
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+
+namespace dviglo
+{
+
+// Покадровая анимация: непрерывный диапазон кадров в AnimationLibrary
+struct AnimationClip
+{
+    StrUtf8 name;
+    i32 first_frame = 0;
+    i32 num_frames = 0;
+    i64 frame_duration_ns = 0;
+    bool loop = true;
+};
+
+// Заголовок бинарного файла с анимациями
+struct AnimationFileHeader
+{
+    char magic[4] = {'D', 'V', 'A', 'N'};
+    u32 version = 1;
+};
+
+// Набор анимаций, кадры которых являются областями одного текстурного атласа.
+// Загружается из XML:
+//   <animations texture="hero.png">
+//     <clip name="run" fps="12" loop="true">
+//       <frame x="0" y="0" width="32" height="32" />
+//     </clip>
+//   </animations>
+// или из бинарного файла .anim, который сохраняет save(). Путь к текстуре указывается
+// относительно файла с анимациями. Кадры всех анимаций хранятся в общих массивах,
+// а UV кадров вычисляются при загрузке
+class AnimationLibrary
+{
+private:
+    StrUtf8 texture_file_name_;
+    std::shared_ptr<Texture> texture_;
+
+    // Кадры всех анимаций
+    std::vector<Rect> frame_sources_;
+    std::vector<glm::vec2> frame_uv_mins_;
+    std::vector<glm::vec2> frame_uv_maxs_;
+
+    std::vector<AnimationClip> clips_;
+
+    // Используется только при поиске анимации по имени
+    std::unordered_map<StrUtf8, i32> clip_indices_;
+
+    bool load_xml(const StrUtf8& file_path);
+    bool load_binary(const StrUtf8& file_path);
+    // Вычисляет UV кадров, начиная с first_frame
+    void update_uvs(i32 first_frame = 0);
+
+public:
+    AnimationLibrary() = default;
+
+    // Формат определяется по расширению: .anim - бинарный, иначе XML
+    AnimationLibrary(const StrUtf8& file_path);
+
+    AnimationLibrary(const AnimationLibrary&) = delete;
+    AnimationLibrary& operator=(const AnimationLibrary&) = delete;
+
+    Texture* texture() const { return texture_.get(); }
+    void set_texture(std::shared_ptr<Texture> texture, const StrUtf8& file_name = StrUtf8());
+
+    // Возвращает индекс анимации или -1, если имя уже занято
+    i32 add_clip(const StrUtf8& name, const std::vector<Rect>& frames, f32 fps, bool loop = true);
+
+    // -1, если анимации нет. Индекс лучше получить один раз при загрузке уровня
+    i32 find_clip(const StrUtf8& name) const;
+
+    i32 num_clips() const { return (i32)clips_.size(); }
+    const AnimationClip& clip(i32 index) const { return clips_[index]; }
+    const std::vector<AnimationClip>& clips() const { return clips_; }
+
+    const Rect& frame_source(i32 frame) const { return frame_sources_[frame]; }
+    const std::vector<glm::vec2>& frame_uv_mins() const { return frame_uv_mins_; }
+    const std::vector<glm::vec2>& frame_uv_maxs() const { return frame_uv_maxs_; }
+
+    // Сохраняет в бинарный формат (.anim)
+    void save(const StrUtf8& file_path) const;
+};
+
+} // namespace dviglo
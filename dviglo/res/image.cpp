@@ -3,17 +3,18 @@
 
 #include "image.hpp"
 
+#include "../fs/embedded_files.hpp"
 #include "../fs/file_base.hpp"
 #include "../fs/log.hpp"
 #include "../main/timer.hpp"
 #include "../math/rect.hpp"
 
-// Miniz сжимает PNG сильнее и быстрее, чем stb_image_write
+// Miniz сжимает PNG сильнее и быстрее, чем stb_image_write.
+// Кроме того, кодировщик на основе miniz сжимает полосы изображения параллельно
 #define DV_USE_MINIZ 1
 
 #if DV_USE_MINIZ
-    #define MINIZ_NO_ZLIB_COMPATIBLE_NAMES
-    #include <miniz.h>
+    #include "png_encoder.hpp"
 #else
     #define STB_IMAGE_WRITE_IMPLEMENTATION
     #define STBIW_WINDOWS_UTF8
@@ -31,18 +32,36 @@ using namespace std;
 namespace dviglo
 {
 
+// Выделяет неинициализированный буфер, который освобождается через stbi_image_free()
+static shared_ptr<u8[]> alloc_pixels(ivec2 size, i32 num_components)
+{
+    return shared_ptr<u8[]>((u8*)STBI_MALLOC(size.x * size.y * num_components), stbi_image_free);
+}
+
+ImageView ImageView::sub_view(IntRect rect) const
+{
+    // Обрезаем прямоугольник по границам области
+    ivec2 begin = glm::clamp(rect.pos, ivec2(0), size);
+    ivec2 end = glm::clamp(rect.pos + rect.size, ivec2(0), size);
+
+    if (end.x <= begin.x || end.y <= begin.y)
+        return ImageView();
+
+    return ImageView(line_ptr(begin.y) + begin.x * num_components, end - begin, num_components, stride);
+}
+
 Image::Image()
     : size_(0, 0)
     , num_components_(0)
-    , data_(nullptr)
 {
 }
 
 Image::Image(ivec2 size, i32 num_components, u32 color)
     : size_(size)
     , num_components_(num_components)
+    , data_(alloc_pixels(size, num_components))
 {
-    data_ = (u8*)STBI_MALLOC(size_.x * size_.y * num_components_);
+    u8* data = data_.get();
 
 #ifdef _MSC_VER
     #pragma warning(push)
@@ -51,12 +70,12 @@ Image::Image(ivec2 size, i32 num_components, u32 color)
 
     if (!color)
     {
-        memset(data_, 0, size_.x * size_.y * num_components_);
+        memset(data, 0, size_.x * size_.y * num_components_);
     }
     else
     {
         for (i32 i = 0; i < size_.x * size_.y; ++i)
-            memcpy(data_ + i * num_components_, &color, num_components_);
+            memcpy(data + i * num_components_, &color, num_components_);
     }
 
 #ifdef _MSC_VER
@@ -69,41 +88,26 @@ Image::Image(i32 width, i32 height, i32 num_components, u32 color)
 {
 }
 
-Image::Image(const Image& other)
+Image::Image(const ImageView& view)
+    : Image()
 {
-    size_ = other.size_;
-    num_components_ = other.num_components_;
-    data_ = (u8*)STBI_MALLOC(size_.x * size_.y * num_components_);
-
-#ifdef _MSC_VER
-    #pragma warning(suppress: 6387)
-#endif
-    memcpy(data_, other.data_, size_.x * size_.y * num_components_);
-}
+    if (view.empty())
+        return;
 
-Image& Image::operator=(const Image& other)
-{
-    if (this != &other)
-    {
-        stbi_image_free(data_);
+    size_ = view.size;
+    num_components_ = view.num_components;
+    data_ = alloc_pixels(size_, num_components_);
 
-        size_ = other.size_;
-        num_components_ = other.num_components_;
-        data_ = (u8*)STBI_MALLOC(size_.x * size_.y * num_components_);
+    i32 line_size = size_.x * num_components_;
 
-#ifdef _MSC_VER
-    #pragma warning(suppress: 6387)
-#endif
-        memcpy(data_, other.data_, size_.x * size_.y * num_components_);
-    }
-
-    return *this;
+    for (i32 y = 0; y < size_.y; ++y)
+        memcpy(data_.get() + y * line_size, view.line_ptr(y), line_size);
 }
 
 Image::Image(Image&& other) noexcept
     : size_(std::exchange(other.size_, {}))
     , num_components_(std::exchange(other.num_components_, 0))
-    , data_(std::exchange(other.data_, nullptr))
+    , data_(std::move(other.data_))
 {
 }
 
@@ -113,70 +117,140 @@ Image& Image::operator=(Image&& other) noexcept
     {
         size_ = std::exchange(other.size_, {});
         num_components_ = std::exchange(other.num_components_, 0);
-        data_ = std::exchange(other.data_, nullptr);
+        data_ = std::move(other.data_);
     }
 
     return *this;
 }
 
-Image::~Image()
-{
-    stbi_image_free(data_);
-}
-
 Image::Image(const StrUtf8& file_path, bool use_error_image)
+    : Image()
 {
-    data_ = (u8*)stbi_load(file_path.c_str(), &size_.x, &size_.y, &num_components_, 0);
+    u8* data;
+
+    if (const EmbeddedFile* file = find_embedded_file(file_path))
+        data = (u8*)stbi_load_from_memory(file->data, (i32)file->size, &size_.x, &size_.y, &num_components_, 0);
+    else
+        data = (u8*)stbi_load(to_disk_path(file_path).c_str(), &size_.x, &size_.y, &num_components_, 0);
 
-    if (!data_)
+    if (data)
+    {
+        data_ = shared_ptr<u8[]>(data, stbi_image_free);
+    }
+    else
     {
         DV_LOG->writef_error("Image::Image(\"{}\"): {}", file_path, stbi_failure_reason());
 
         if (use_error_image)
-            *this = error_image;
+            *this = error_image; // Пиксели не копируются
+        else
+            size_ = {};
     }
 }
 
-void Image::save_png(const StrUtf8& path)
+void Image::detach()
+{
+    // Буфер принадлежит только этому изображению
+    if (data_.use_count() <= 1)
+        return;
+
+    shared_ptr<u8[]> new_data = alloc_pixels(size_, num_components_);
+    memcpy(new_data.get(), data_.get(), size_.x * size_.y * num_components_);
+    data_ = std::move(new_data);
+}
+
+ImageView Image::view() const
+{
+    return ImageView(data_.get(), size_, num_components_, size_.x * num_components_);
+}
+
+ImageView Image::view(const IntRect& rect) const
+{
+    return view().sub_view(rect);
+}
+
+void Image::save_png(const StrUtf8& path, PngCompression compression) const
 {
     i64 begin_time_ms = get_ticks_ms();
 
 #if DV_USE_MINIZ
-    i32 compr_level = MZ_DEFAULT_LEVEL;
-    size_t png_data_size = 0;
-    void* png_data = tdefl_write_image_to_png_file_in_memory_ex(data_, size_.x, size_.y, num_components_, &png_data_size, compr_level, 0);
+    vector<byte> png_data = encode_png(view(), compression);
 
-    if (!png_data)
+    if (png_data.empty())
     {
-        DV_LOG->write_error("Image::save_png(const StrUtf8&) | !png_data");
+        DV_LOG->write_error("Image::save_png(const StrUtf8&) | png_data.empty()");
+        return;
     }
-    else
+
+    FILE* stream = file_open(path.c_str(), "wb");
+
+    if (!stream)
     {
-        FILE* stream = file_open(path.c_str(), "wb");
-        file_write(png_data, (i32)png_data_size, 1, stream);
-        file_close(stream);
-        mz_free(png_data);
+        DV_LOG->writef_error("Image::save_png(const StrUtf8&) | !stream | {}", path);
+        return;
     }
+
+    file_write(png_data.data(), (i32)png_data.size(), 1, stream);
+    file_close(stream);
 #else
-    stbi_write_png_compression_level = 8;
-    stbi_write_png(path.c_str(), size_.x, size_.y, num_components_, data_, 0);
+    stbi_write_png_compression_level = (compression == PngCompression::fast) ? 1 : 8;
+    stbi_write_png(path.c_str(), size_.x, size_.y, num_components_, data_.get(), 0);
 #endif
 
     i64 duration_ms = get_ticks_ms() - begin_time_ms;
     DV_LOG->writef_info("Image::save_png(const StrUtf8&) | {} | Saved in {} ms", path, duration_ms);
 }
 
-void Image::paste(const Image& img, ivec2 pos)
+bool Image::is_opaque() const
 {
-    if (img.num_components() != num_components())
+    if (num_components_ != 4)
+        return true;
+
+    const u8* this_data = data_.get();
+    const i32 num_pixels = size_.x * size_.y;
+
+    for (i32 i = 0; i < num_pixels; ++i)
+    {
+        if (this_data[i * 4 + 3] != 0xFF)
+            return false;
+    }
+
+    return true;
+}
+
+void Image::fill(IntRect rect, u32 color)
+{
+    ivec2 begin = glm::clamp(rect.pos, ivec2(0), size_);
+    ivec2 end = glm::clamp(rect.pos + rect.size, ivec2(0), size_);
+
+    if (end.x <= begin.x || end.y <= begin.y)
+        return;
+
+    u8* this_data = data();
+
+    for (i32 y = begin.y; y < end.y; ++y)
+    {
+        u8* line = this_data + (y * size_.x + begin.x) * num_components_;
+
+        for (i32 x = 0; x < end.x - begin.x; ++x)
+            memcpy(line + x * num_components_, &color, num_components_);
+    }
+}
+
+void Image::paste(const ImageView& src, ivec2 pos)
+{
+    if (src.empty())
+        return;
+
+    if (src.num_components != num_components())
     {
         // TODO: Конвертировать вставляемое изображение
-        DV_LOG->write_error("Image::paste(): img.num_components() != num_components()");
+        DV_LOG->write_error("Image::paste(): src.num_components != num_components()");
         return;
     }
 
     // Границы вставляемого изображения
-    IntRect img_rect({0, 0}, img.size());
+    IntRect img_rect({0, 0}, src.size);
 
     if (pos.x < 0)
     {
@@ -212,35 +286,42 @@ void Image::paste(const Image& img, ivec2 pos)
     if (pos.y + img_rect.size.y > size().y) // Вставляемое изображение не умещается
         img_rect.size.y = size().y - pos.y;
 
-    // Копируем линии вставляемого изображения
+    // Отделяем буфер один раз, а не на каждой линии
+    u8* this_data = data();
+
+    // Копируем линии вставляемого изображения.
+    // memmove(), так как src может ссылаться на это же изображение
     for (i32 img_y = img_rect.pos.y, this_y = pos.y;
          img_y < img_rect.pos.y + img_rect.size.y;
          ++img_y, ++this_y)
     {
-        i32 img_data_offset = (img_y * img.size().x + img_rect.pos.x) * img.num_components();
+        const u8* src_line = src.line_ptr(img_y) + img_rect.pos.x * src.num_components;
         i32 this_data_offset = (this_y * size().x + pos.x) * num_components();
-        memcpy(data() + this_data_offset, img.data() + img_data_offset, img_rect.size.x * num_components());
+        memmove(this_data + this_data_offset, src_line, img_rect.size.x * num_components());
     }
 }
 
-Image Image::to_rgba(u32 color)
+Image Image::to_rgba(u32 color) const
 {
     // TODO: Пока только grayscale изображение
     if (num_components() != 1)
     {
         DV_LOG->write_error("Image::to_rgba(u32) | num_components() != 1");
-        return *this;
+        return *this; // Пиксели не копируются
     }
 
     Image ret(size_, 4);
+    const u8* src = data_.get();
+    u8* dest = ret.data();
+
+    u32 color_a = (color & 0xFF000000) >> 24;
+    u32 bgr = color & 0x00FFFFFF;
 
     for (i32 i = 0; i < size_.x * size_.y; ++i)
     {
-        u32 color_a = (color & 0xFF000000) >> 24;
-        u32 a = data_[i] * color_a / 255;
-        u32 bgr = color & 0x00FFFFFF;
+        u32 a = src[i] * color_a / 255;
         u32 abgr = (a << 24) | bgr;
-        memcpy(ret.data() + i * 4, &abgr, 4);
+        memcpy(dest + i * 4, &abgr, 4);
     }
 
     return ret;
@@ -274,6 +355,12 @@ void Image::blur_triangle(i32 radius)
 
     Image tmp(size_, num_components_);
 
+    // Изображение будет изменено, поэтому сразу отделяем буфер от других копий
+    detach();
+
+    // Чтение через константную ссылку не проверяет счётчик ссылок на каждом пикселе
+    const Image& src = *this;
+
     // Размываем по вертикали и сохраняем результат в tmp
     for (i32 x = 0; x < size_.x; ++x)
     {
@@ -281,7 +368,7 @@ void Image::blur_triangle(i32 radius)
         {
             // Сразу записываем вклад центрального пикселя.
             // Его вес равен radius + 1
-            u32 sum = (u32)pixel_ptr(x, y)[0] * (radius + 1);
+            u32 sum = (u32)src.pixel_ptr(x, y)[0] * (radius + 1);
             i32 dist = 1;
 
             while (dist <= radius)
@@ -291,10 +378,10 @@ void Image::blur_triangle(i32 radius)
                 // Пиксель вне изображения черный, ноль можно не плюсовать.
                 // Так что тут все корректно
                 if (is_inside(x, y + dist))
-                    sum += (u32)pixel_ptr(x, y + dist)[0] * weight;
+                    sum += (u32)src.pixel_ptr(x, y + dist)[0] * weight;
 
                 if (is_inside(x, y - dist))
-                    sum += (u32)pixel_ptr(x, y - dist)[0] * weight;
+                    sum += (u32)src.pixel_ptr(x, y - dist)[0] * weight;
 
                 ++dist;
             }
@@ -3,30 +3,73 @@
 
 #pragma once
 
+#include "../math/rect.hpp"
 #include "../std_utils/string.hpp"
 
 #include <glm/glm.hpp>
 
+#include <memory>  // std::shared_ptr
 #include <utility> // std::exchange()
 
 
 namespace dviglo
 {
 
+// Степень сжатия PNG
+enum class PngCompression : u32
+{
+    fast = 0, // Для скриншотов и кэшей: быстрое сжатие и фиксированный фильтр строк
+    normal,   // Выбор фильтра для каждой строки
+    best      // Как normal, но сильнее сжимает и медленнее работает
+};
+
+// Невладеющая ссылка на прямоугольную область пикселей (всего изображения или его части).
+// Остаётся корректной, пока жив буфер, на который ссылается
+struct ImageView
+{
+    const u8* data = nullptr; // Левый верхний пиксель области
+    glm::ivec2 size{0, 0};
+    i32 num_components = 0;
+    i32 stride = 0; // Число байт, занимаемых одной линией исходного изображения
+
+    ImageView() = default;
+
+    ImageView(const u8* data, glm::ivec2 size, i32 num_components, i32 stride)
+        : data(data)
+        , size(size)
+        , num_components(num_components)
+        , stride(stride)
+    {
+    }
+
+    const u8* line_ptr(i32 y) const { return data + y * stride; }
+    bool empty() const { return data == nullptr || size.x <= 0 || size.y <= 0; }
+
+    // Часть области. Прямоугольник обрезается по границам области
+    ImageView sub_view(IntRect rect) const;
+};
+
+// Пиксели хранятся в буфере со счётчиком ссылок. При копировании изображения буфер
+// не копируется, а разделяется между копиями. Копия буфера создаётся только при первом
+// изменении разделяемых данных (copy-on-write).
+// Счётчик ссылок атомарный, но одно и то же изображение нельзя менять из разных потоков
 class Image
 {
 private:
     glm::ivec2 size_;
     i32 num_components_;
-    u8* data_;
+    std::shared_ptr<u8[]> data_;
+
+    // Делает буфер уникальным перед изменением данных
+    void detach();
 
 public:
     Image();
-    ~Image();
+    ~Image() = default;
 
-    // Копирование
-    Image(const Image& other);
-    Image& operator=(const Image& other);
+    // Копирование (буфер разделяется)
+    Image(const Image& other) = default;
+    Image& operator=(const Image& other) = default;
 
     // Перемещение
     Image(Image&& other) noexcept;
@@ -36,21 +79,52 @@ public:
     Image(glm::ivec2 size, i32 num_components, u32 color = 0);
     Image(i32 width, i32 height, i32 num_components, u32 color = 0);
 
-    // Загрузка из файла.
-    // При неудаче и use_error_image копирует данные из error_image
+    // Копирует пиксели из области другого изображения
+    explicit Image(const ImageView& view);
+
+    // Загрузка из файла (в том числе встроенного, см. embedded_files.hpp).
+    // При неудаче и use_error_image использует данные error_image
     Image(const StrUtf8& file_path, bool use_error_image = false);
 
     glm::ivec2 size() const { return size_; }
     i32 width() const { return size_.x; }
     i32 height() const { return size_.y; }
     i32 num_components() const { return num_components_; }
-    u8* data() const { return data_; }
-    u8* pixel_ptr(i32 x, i32 y) { return data_ + (y * size_.x + x) * num_components_; }
+
+    // Неконстантные методы доступа к пикселям отделяют буфер от других копий
+    const u8* data() const { return data_.get(); }
+    u8* data() { detach(); return data_.get(); }
+
+    // Доступ на чтение без отделения буфера даже для неконстантного изображения
+    const u8* const_data() const { return data_.get(); }
+
+    const u8* pixel_ptr(i32 x, i32 y) const { return data_.get() + (y * size_.x + x) * num_components_; }
+    u8* pixel_ptr(i32 x, i32 y) { return data() + (y * size_.x + x) * num_components_; }
+
     bool is_inside(i32 x, i32 y) const { return x >= 0 && y >= 0 && x < size_.x && y < size_.y; }
     bool empty() const { return data_ == nullptr; }
-    void paste(const Image& img, glm::ivec2 pos);
-    Image to_rgba(u32 color);
-    void save_png(const StrUtf8& path);
+
+    // Разделяет ли изображение буфер с другими копиями
+    bool is_shared() const { return data_.use_count() > 1; }
+
+    // Все ли пиксели полностью непрозрачны. Изображения без альфа-канала всегда непрозрачны
+    bool is_opaque() const;
+
+    // Всё изображение или его часть без копирования пикселей
+    ImageView view() const;
+    ImageView view(const IntRect& rect) const;
+
+    // Заполняет прямоугольник цветом (в формате 0xAABBGGRR, используются первые num_components байт).
+    // Прямоугольник обрезается по границам изображения
+    void fill(IntRect rect, u32 color);
+
+    void paste(const ImageView& src, glm::ivec2 pos);
+    void paste(const Image& img, glm::ivec2 pos) { paste(img.view(), pos); }
+
+    Image to_rgba(u32 color) const;
+
+    // Для скриншотов и кэшей лучше использовать PngCompression::fast
+    void save_png(const StrUtf8& path, PngCompression compression = PngCompression::normal) const;
     void blur_triangle(i32 radius);
 };
 
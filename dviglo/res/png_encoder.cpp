@@ -0,0 +1,403 @@
+// Copyright (c) the Dviglo project
+// License: MIT
+
+#include "png_encoder.hpp"
+
+#include "../fs/log.hpp"
+
+#define MINIZ_NO_ZLIB_COMPATIBLE_NAMES
+#include <miniz.h>
+
+#include <algorithm>
+#include <cstring> // memcpy
+#include <future>
+#include <thread>
+
+using namespace std;
+
+
+namespace dviglo
+{
+
+// Полоса меньше этого размера не стоит отдельного потока
+static constexpr i32 min_band_size = 256 * 1024;
+
+// Типы фильтров строк PNG
+enum class PngFilter : u8
+{
+    none = 0,
+    sub,
+    up,
+    average,
+    paeth,
+    count
+};
+
+static u8 paeth_predictor(i32 a, i32 b, i32 c)
+{
+    // Вычисления без ветвлений, чтобы компилятор мог векторизовать цикл
+    i32 pa = abs(b - c);
+    i32 pb = abs(a - c);
+    i32 pc = abs(a + b - c - c);
+    i32 ret = (pb < pa) ? b : a;
+    ret = (pc < min(pa, pb)) ? c : ret;
+    return (u8)ret;
+}
+
+// Фильтрует строку. prev == nullptr для первой строки изображения.
+// Циклы простые, без зависимостей между итерациями, поэтому компилятор векторизует их (SSE2/AVX2/NEON)
+static void filter_line(PngFilter filter, const u8* cur, const u8* prev, i32 line_size, i32 bpp, u8* out)
+{
+    switch (filter)
+    {
+    case PngFilter::none:
+        memcpy(out, cur, line_size);
+        return;
+
+    case PngFilter::sub:
+        memcpy(out, cur, bpp);
+        for (i32 i = bpp; i < line_size; ++i)
+            out[i] = u8(cur[i] - cur[i - bpp]);
+        return;
+
+    case PngFilter::up:
+        if (!prev)
+        {
+            memcpy(out, cur, line_size);
+            return;
+        }
+
+        for (i32 i = 0; i < line_size; ++i)
+            out[i] = u8(cur[i] - prev[i]);
+        return;
+
+    case PngFilter::average:
+        if (!prev)
+        {
+            memcpy(out, cur, bpp);
+            for (i32 i = bpp; i < line_size; ++i)
+                out[i] = u8(cur[i] - (cur[i - bpp] >> 1));
+            return;
+        }
+
+        for (i32 i = 0; i < bpp; ++i)
+            out[i] = u8(cur[i] - (prev[i] >> 1));
+        for (i32 i = bpp; i < line_size; ++i)
+            out[i] = u8(cur[i] - ((cur[i - bpp] + prev[i]) >> 1));
+        return;
+
+    case PngFilter::paeth:
+        if (!prev) // Без верхней строки Paeth вырождается в Sub
+        {
+            filter_line(PngFilter::sub, cur, prev, line_size, bpp, out);
+            return;
+        }
+
+        for (i32 i = 0; i < bpp; ++i)
+            out[i] = u8(cur[i] - prev[i]);
+        for (i32 i = bpp; i < line_size; ++i)
+            out[i] = u8(cur[i] - paeth_predictor(cur[i - bpp], prev[i], prev[i - bpp]));
+        return;
+
+    default:
+        assert(false);
+        return;
+    }
+}
+
+// Эвристика из спецификации PNG: минимальная сумма модулей байт, рассматриваемых как знаковые
+static u32 filtered_line_cost(const u8* line, i32 line_size)
+{
+    u32 ret = 0;
+
+    for (i32 i = 0; i < line_size; ++i)
+        ret += (u32)abs((i32)(i8)line[i]);
+
+    return ret;
+}
+
+// Объединяет контрольные суммы Adler-32 двух соседних фрагментов (алгоритм из zlib)
+static u32 adler32_combine(u32 adler1, u32 adler2, u64 len2)
+{
+    constexpr u64 base = 65521;
+
+    u64 rem = len2 % base;
+    u64 sum1 = adler1 & 0xFFFF;
+    u64 sum2 = (rem * sum1) % base;
+    sum1 += (adler2 & 0xFFFF) + base - 1;
+    sum2 += ((adler1 >> 16) & 0xFFFF) + ((adler2 >> 16) & 0xFFFF) + base - rem;
+
+    if (sum1 >= base)
+        sum1 -= base;
+    if (sum1 >= base)
+        sum1 -= base;
+    if (sum2 >= base << 1)
+        sum2 -= base << 1;
+    if (sum2 >= base)
+        sum2 -= base;
+
+    return (u32)(sum1 | (sum2 << 16));
+}
+
+// Результат сжатия одной полосы
+struct PngBand
+{
+    vector<byte> deflated; // Фрагмент сырого deflate-потока (без заголовка zlib)
+    u32 adler = 1; // Adler-32 отфильтрованных данных полосы
+    u64 filtered_size = 0;
+    bool ok = false;
+};
+
+static PngBand encode_band(const ImageView& view, i32 begin_y, i32 end_y, PngCompression compression, bool last)
+{
+    PngBand ret;
+
+    const i32 bpp = view.num_components;
+    const i32 line_size = view.size.x * bpp;
+
+    // Каждая строка начинается с байта типа фильтра
+    vector<u8> filtered((size_t)(line_size + 1) * (end_y - begin_y));
+
+    // Временные строки для подбора фильтра
+    vector<u8> candidates;
+    if (compression != PngCompression::fast)
+        candidates.resize((size_t)line_size * (size_t)PngFilter::count);
+
+    for (i32 y = begin_y; y < end_y; ++y)
+    {
+        const u8* cur = view.line_ptr(y);
+        const u8* prev = y > 0 ? view.line_ptr(y - 1) : nullptr;
+        u8* out = filtered.data() + (size_t)(line_size + 1) * (y - begin_y);
+
+        if (compression == PngCompression::fast)
+        {
+            // Sub не требует верхней строки и почти так же хорош, как адаптивный выбор
+            out[0] = (u8)PngFilter::sub;
+            filter_line(PngFilter::sub, cur, prev, line_size, bpp, out + 1);
+            continue;
+        }
+
+        u32 best_cost = UINT32_MAX;
+        u8 best_filter = 0;
+
+        for (u8 f = 0; f < (u8)PngFilter::count; ++f)
+        {
+            u8* candidate = candidates.data() + (size_t)line_size * f;
+            filter_line((PngFilter)f, cur, prev, line_size, bpp, candidate);
+            u32 cost = filtered_line_cost(candidate, line_size);
+
+            if (cost < best_cost)
+            {
+                best_cost = cost;
+                best_filter = f;
+            }
+        }
+
+        out[0] = best_filter;
+        memcpy(out + 1, candidates.data() + (size_t)line_size * best_filter, line_size);
+    }
+
+    ret.filtered_size = filtered.size();
+    ret.adler = (u32)mz_adler32(1, filtered.data(), filtered.size());
+
+    i32 level;
+    if (compression == PngCompression::fast)
+        level = MZ_BEST_SPEED;
+    else if (compression == PngCompression::best)
+        level = MZ_BEST_COMPRESSION;
+    else
+        level = MZ_DEFAULT_LEVEL;
+
+    mz_stream stream{};
+
+    // Отрицательный размер окна - сырой deflate без заголовка zlib
+    if (mz_deflateInit2(&stream, level, MZ_DEFLATED, -MZ_DEFAULT_WINDOW_BITS, 9, MZ_DEFAULT_STRATEGY) != MZ_OK)
+    {
+        DV_LOG->write_error("encode_band() | mz_deflateInit2() != MZ_OK");
+        return ret;
+    }
+
+    // Запас под служебные блоки sync flush
+    ret.deflated.resize(mz_deflateBound(&stream, (mz_ulong)filtered.size()) + 64);
+
+    stream.next_in = filtered.data();
+    stream.avail_in = (u32)filtered.size();
+
+    // Промежуточные полосы заканчиваются пустым stored-блоком и выравниваются по байту.
+    // Финальный блок (BFINAL) только у последней полосы
+    i32 flush = last ? MZ_FINISH : MZ_SYNC_FLUSH;
+
+    while (true)
+    {
+        size_t written = stream.total_out;
+        stream.next_out = reinterpret_cast<u8*>(ret.deflated.data()) + written;
+        stream.avail_out = (u32)(ret.deflated.size() - written);
+
+        i32 status = mz_deflate(&stream, flush);
+
+        if (status == MZ_STREAM_END || (status == MZ_OK && !last && stream.avail_in == 0 && stream.avail_out != 0))
+            break;
+
+        if (status != MZ_OK && status != MZ_BUF_ERROR)
+        {
+            DV_LOG->writef_error("encode_band() | mz_deflate() == {}", status);
+            mz_deflateEnd(&stream);
+            return ret;
+        }
+
+        // Не хватило места
+        ret.deflated.resize(ret.deflated.size() * 2);
+    }
+
+    ret.deflated.resize(stream.total_out);
+    mz_deflateEnd(&stream);
+    ret.ok = true;
+
+    return ret;
+}
+
+static void append_u32_be(vector<byte>& out, u32 value)
+{
+    out.push_back(byte(value >> 24));
+    out.push_back(byte(value >> 16));
+    out.push_back(byte(value >> 8));
+    out.push_back(byte(value));
+}
+
+// Завершает чанк: записывает длину и CRC. Данные чанка уже находятся в конце out
+static void finish_chunk(vector<byte>& out, size_t type_offset)
+{
+    // Длина чанка записана перед типом
+    u32 data_size = (u32)(out.size() - type_offset - 4);
+    out[type_offset - 4] = byte(data_size >> 24);
+    out[type_offset - 3] = byte(data_size >> 16);
+    out[type_offset - 2] = byte(data_size >> 8);
+    out[type_offset - 1] = byte(data_size);
+
+    // CRC считается по типу и данным
+    u32 crc = (u32)mz_crc32(0, reinterpret_cast<const u8*>(out.data()) + type_offset, data_size + 4);
+    append_u32_be(out, crc);
+}
+
+// Начинает чанк и возвращает смещение типа чанка
+static size_t begin_chunk(vector<byte>& out, const char* type)
+{
+    append_u32_be(out, 0); // Длина будет записана в finish_chunk()
+    size_t type_offset = out.size();
+
+    for (i32 i = 0; i < 4; ++i)
+        out.push_back(byte(type[i]));
+
+    return type_offset;
+}
+
+vector<byte> encode_png(const ImageView& view, PngCompression compression, i32 max_threads)
+{
+    vector<byte> ret;
+
+    if (view.empty())
+    {
+        DV_LOG->write_error("encode_png() | view.empty()");
+        return ret;
+    }
+
+    u8 color_type;
+
+    switch (view.num_components)
+    {
+    case 1: color_type = 0; break; // Grayscale
+    case 2: color_type = 4; break; // Grayscale + alpha
+    case 3: color_type = 2; break; // RGB
+    case 4: color_type = 6; break; // RGBA
+
+    default:
+        DV_LOG->writef_error("encode_png() | view.num_components == {}", view.num_components);
+        return ret;
+    }
+
+    // Делим изображение на полосы
+    i64 data_size = (i64)view.size.x * view.num_components * view.size.y;
+
+    if (max_threads <= 0)
+        max_threads = max((i32)thread::hardware_concurrency(), 1);
+
+    i32 num_bands = (i32)clamp<i64>(data_size / min_band_size, 1, max_threads);
+    num_bands = min(num_bands, view.size.y);
+    i32 band_height = (view.size.y + num_bands - 1) / num_bands;
+    num_bands = (view.size.y + band_height - 1) / band_height;
+
+    vector<PngBand> bands(num_bands);
+
+    if (num_bands == 1)
+    {
+        bands[0] = encode_band(view, 0, view.size.y, compression, true);
+    }
+    else
+    {
+        // Первая полоса кодируется в текущем потоке
+        vector<future<PngBand>> futures;
+        futures.reserve(num_bands - 1);
+
+        for (i32 i = 1; i < num_bands; ++i)
+        {
+            i32 begin_y = i * band_height;
+            i32 end_y = min(begin_y + band_height, view.size.y);
+            bool last = (i == num_bands - 1);
+            futures.push_back(async(launch::async, encode_band, cref(view), begin_y, end_y, compression, last));
+        }
+
+        bands[0] = encode_band(view, 0, band_height, compression, false);
+
+        for (i32 i = 1; i < num_bands; ++i)
+            bands[i] = futures[i - 1].get();
+    }
+
+    size_t idat_size = 2 + 4; // Заголовок zlib и Adler-32
+    u32 adler = 1;
+
+    for (const PngBand& band : bands)
+    {
+        if (!band.ok)
+            return ret; // Сообщение уже в логе
+
+        idat_size += band.deflated.size();
+        adler = adler32_combine(adler, band.adler, band.filtered_size);
+    }
+
+    ret.reserve(idat_size + 64);
+
+    // Сигнатура
+    const u8 signature[]{0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+    for (u8 c : signature)
+        ret.push_back(byte(c));
+
+    size_t chunk = begin_chunk(ret, "IHDR");
+    append_u32_be(ret, (u32)view.size.x);
+    append_u32_be(ret, (u32)view.size.y);
+    ret.push_back(byte(8)); // Бит на компонент
+    ret.push_back(byte(color_type));
+    ret.push_back(byte(0)); // Метод сжатия
+    ret.push_back(byte(0)); // Метод фильтрации
+    ret.push_back(byte(0)); // Без интерлейсинга
+    finish_chunk(ret, chunk);
+
+    // Все полосы в одном IDAT
+    chunk = begin_chunk(ret, "IDAT");
+
+    // Заголовок zlib: deflate с окном 32 КБ. Второй байт дополняет заголовок до кратного 31
+    ret.push_back(byte(0x78));
+    ret.push_back(byte(compression == PngCompression::fast ? 0x01 : 0x9C));
+
+    for (const PngBand& band : bands)
+        ret.insert(ret.end(), band.deflated.begin(), band.deflated.end());
+
+    append_u32_be(ret, adler);
+    finish_chunk(ret, chunk);
+
+    chunk = begin_chunk(ret, "IEND");
+    finish_chunk(ret, chunk);
+
+    return ret;
+}
+
+} // namespace dviglo
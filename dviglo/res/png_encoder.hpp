@@ -0,0 +1,22 @@
+// Copyright (c) the Dviglo project
+// License: MIT
+
+// Многопоточный кодировщик PNG
+
+#pragma once
+
+#include "image.hpp"
+
+
+namespace dviglo
+{
+
+// Кодирует изображение в PNG в памяти.
+// Изображение делится на горизонтальные полосы, которые фильтруются и сжимаются параллельно.
+// Каждая полоса - независимый фрагмент deflate, который заканчивается sync flush
+// (последняя полоса - финальным блоком), поэтому фрагменты склеиваются в один поток IDAT.
+// max_threads == 0 - использовать все ядра процессора
+std::vector<byte> encode_png(const ImageView& view, PngCompression compression = PngCompression::normal,
+                             i32 max_threads = 0);
+
+} // namespace dviglo
@@ -9,6 +9,8 @@
 
 #include <pugixml.hpp>
 
+#include <future>
+
 using namespace glm;
 using namespace pugi;
 using namespace std;
@@ -82,6 +84,7 @@ SpriteFont::SpriteFont(const StrUtf8& file_path)
         glyph.offset = ivec2(char_node.attribute("xoffset").as_int(), char_node.attribute("yoffset").as_int()); // TODO: Переименовать в offset_x
         glyph.advance_x = char_node.attribute("advance_x").as_int();
         glyph.page = char_node.attribute("page").as_int();
+        glyph.channel = char_node.attribute("channel").as_int(-1);
         glyphs_[id] = glyph;
     }
 
@@ -109,9 +112,16 @@ void SpriteFont::save(const StrUtf8& file_path) const
         return;
     }
 
-    // Сохраняем текстуры
+    // Сохраняем текстуры параллельно (каждая страница к тому же сжимается в несколько потоков)
+    vector<future<void>> saving;
+    saving.reserve(textures_.size());
+
     for (size_t i = 0; i < textures_.size(); ++i)
-        textures_[i]->image()->save_png(dir_path + file_name + "_" + to_string(i) + ".png");
+    {
+        shared_ptr<Image> image = textures_[i]->image();
+        StrUtf8 page_path = dir_path + file_name + "_" + to_string(i) + ".png";
+        saving.push_back(async(launch::async, [image, page_path] { image->save_png(page_path); }));
+    }
 
     xml_document doc;
     xml_node root_node = doc.append_child("font");
@@ -146,6 +156,9 @@ void SpriteFont::save(const StrUtf8& file_path) const
         char_node.append_attribute("yoffset") = glyph.offset.y;
         char_node.append_attribute("advance_x") = glyph.advance_x;
         char_node.append_attribute("page") = glyph.page;
+
+        if (glyph.channel >= 0)
+            char_node.append_attribute("channel") = glyph.channel;
     }
 
     xml_node common_node = root_node.append_child("common");
@@ -161,6 +174,9 @@ void SpriteFont::save(const StrUtf8& file_path) const
     }
 
     doc.save_file(file_path.c_str(), "    ");
+
+    for (future<void>& f : saving)
+        f.get();
 }
 
 } // namespace dviglo
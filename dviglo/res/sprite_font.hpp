@@ -8,7 +8,9 @@
 #include "../std_utils/string.hpp"
 
 #include <limits>
+#include <memory>
 #include <unordered_map>
+#include <variant>
 
 
 namespace dviglo
@@ -30,6 +32,10 @@ struct Glyph
 
     // Номер текстуры
     i32 page = std::numeric_limits<i32>::max();
+
+    // Канал текстуры с глифом (0 - R, 1 - G, 2 - B, 3 - A).
+    // -1 - глиф занимает все каналы (цвет стиля запечён в текстуру)
+    i32 channel = -1;
 };
 
 
@@ -115,6 +121,11 @@ struct SFSettingsOutlined : SFSettings
     }
 };
 
+// Любой из стилей генерируемого шрифта
+using SFVariant = std::variant<SFSettingsSimple, SFSettingsContour, SFSettingsOutlined>;
+
+class FreeTypeFace;
+
 class SpriteFont
 {
 private:
@@ -124,6 +135,15 @@ private:
     std::vector<std::shared_ptr<Texture>> textures_; // Текстурные атласы с символами
     std::unordered_map<c32, Glyph> glyphs_; // Кодовая позиция : изображение
 
+    SpriteFont() = default;
+
+    // Генерирует fonts[i] из variants[i]. Реализация в sprite_font_generator.cpp
+    static void generate_into(const std::vector<SFVariant>& variants, const std::vector<SpriteFont*>& fonts,
+                              i64* generation_time_ms);
+
+    // Заполняет метрики шрифта. Реализация в sprite_font_generator.cpp
+    void fill(const FreeTypeFace& face, const SFVariant& variant, const std::vector<std::shared_ptr<Texture>>& textures);
+
 public:
     SpriteFont(const SpriteFont&) = delete;
     SpriteFont& operator=(const SpriteFont&) = delete;
@@ -135,6 +155,25 @@ public:
     SpriteFont(const SFSettingsContour& settings, i64* generation_time_ms = nullptr);
     SpriteFont(const SFSettingsOutlined& settings, i64* generation_time_ms = nullptr);
 
+    // Генерирует несколько стилей одного шрифта за один проход.
+    // src_path, height и anti_aliasing у всех стилей должны совпадать.
+    // Каждый глиф загружается и растеризуется один раз, а все стили упаковываются в общие текстуры,
+    // поэтому текст разных стилей (например тень и сам текст) рендерится без смены текстуры.
+    // Возвращает шрифты в порядке variants или пустой вектор при ошибке
+    static std::vector<std::unique_ptr<SpriteFont>> generate(const std::vector<SFVariant>& variants,
+                                                             i64* generation_time_ms = nullptr);
+
+    // Упаковывает до четырёх наборов глифов (разные шрифты или размеры) в каналы R, G, B и A общих текстур.
+    // Глифы хранятся без цвета, цвет задаётся при выводе текста. Стиль outlined не поддерживается.
+    // Атлас занимает примерно в 4 раза меньше памяти, а текст всех шрифтов рендерится одним вызовом отрисовки.
+    // Возвращает шрифты в порядке variants (шрифт i в канале i) или пустой вектор при ошибке
+    static std::vector<std::unique_ptr<SpriteFont>> generate_channel_packed(const std::vector<SFVariant>& variants,
+                                                                            i64* generation_time_ms = nullptr);
+
+    // Встроенный моноширинный растровый шрифт (ASCII, высота строки 13 пикселей).
+    // Не требует файлов. Реализация в sprite_font_builtin.cpp
+    static std::unique_ptr<SpriteFont> create_builtin();
+
     const std::vector<std::shared_ptr<Texture>>& textures() const { return textures_; }
     const std::unordered_map<c32, Glyph>& glyphs() const { return glyphs_; }
     i32 line_height() const { return line_height_; }
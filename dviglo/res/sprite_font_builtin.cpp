@@ -0,0 +1,172 @@
+// Copyright (c) the Dviglo project
+// License: MIT
+
+// Встроенный растровый шрифт, который не требует файлов (например для оверлея производительности)
+
+#include "sprite_font.hpp"
+
+#include "../gl_utils/texture_cache.hpp"
+
+using namespace glm;
+using namespace std;
+
+
+namespace dviglo
+{
+
+// Размер ячейки глифа в пикселях
+static constexpr i32 cell_width = 8;
+static constexpr i32 cell_height = 13;
+
+// Расстояние между глифами (шрифт моноширинный)
+static constexpr i32 advance_x = 7;
+
+// Глифы ASCII 32..126: по байту на строку, старший бит - левый пиксель.
+// Растеризовано из DejaVu Sans Mono (12 px) без сглаживания
+static constexpr u8 glyph_rows[][cell_height] =
+{
+    0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00, // пробел
+    0x00,0x10,0x10,0x10,0x10,0x10,0x10,0x00,0x10,0x10,0x00,0x00,0x00, // !
+    0x00,0x28,0x28,0x28,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00, // "
+    0x00,0x00,0x14,0x24,0x7E,0x28,0x28,0xFC,0x48,0x50,0x00,0x00,0x00, // #
+    0x00,0x10,0x38,0x54,0x50,0x70,0x1C,0x14,0x54,0x38,0x10,0x10,0x00, // $
+    0x00,0x60,0x90,0x90,0x64,0x18,0x6C,0x12,0x12,0x0C,0x00,0x00,0x00, // %
+    0x00,0x1C,0x20,0x20,0x30,0x30,0x4A,0x4E,0x64,0x3A,0x00,0x00,0x00, // &
+    0x00,0x10,0x10,0x10,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00, // '
+    0x0C,0x08,0x08,0x10,0x10,0x10,0x10,0x10,0x08,0x08,0x0C,0x00,0x00, // (
+    0x30,0x10,0x10,0x08,0x08,0x08,0x08,0x08,0x10,0x10,0x30,0x00,0x00, // )
+    0x00,0x10,0x54,0x38,0x38,0x54,0x10,0x00,0x00,0x00,0x00,0x00,0x00, // *
+    0x00,0x00,0x00,0x10,0x10,0x10,0xFE,0x10,0x10,0x10,0x00,0x00,0x00, // +
+    0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x10,0x10,0x20,0x00,0x00, // ,
+    0x00,0x00,0x00,0x00,0x00,0x00,0x38,0x00,0x00,0x00,0x00,0x00,0x00, // -
+    0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x10,0x10,0x00,0x00,0x00, // .
+    0x00,0x02,0x04,0x04,0x08,0x08,0x10,0x10,0x20,0x20,0x40,0x00,0x00, // /
+    0x00,0x3C,0x24,0x42,0x42,0x4A,0x42,0x42,0x24,0x3C,0x00,0x00,0x00, // 0
+    0x00,0x70,0x10,0x10,0x10,0x10,0x10,0x10,0x10,0x7C,0x00,0x00,0x00, // 1
+    0x00,0x3C,0x42,0x02,0x02,0x04,0x08,0x10,0x20,0x7E,0x00,0x00,0x00, // 2
+    0x00,0x3C,0x42,0x02,0x02,0x1C,0x02,0x02,0x42,0x3C,0x00,0x00,0x00, // 3
+    0x00,0x0C,0x0C,0x14,0x34,0x24,0x44,0x7E,0x04,0x04,0x00,0x00,0x00, // 4
+    0x00,0x7C,0x40,0x40,0x7C,0x06,0x02,0x02,0x46,0x3C,0x00,0x00,0x00, // 5
+    0x00,0x1C,0x22,0x40,0x5C,0x66,0x42,0x42,0x26,0x3C,0x00,0x00,0x00, // 6
+    0x00,0x7E,0x06,0x04,0x04,0x08,0x08,0x10,0x10,0x20,0x00,0x00,0x00, // 7
+    0x00,0x3C,0x42,0x42,0x42,0x3C,0x42,0x42,0x42,0x3C,0x00,0x00,0x00, // 8
+    0x00,0x3C,0x64,0x42,0x42,0x46,0x3A,0x02,0x44,0x38,0x00,0x00,0x00, // 9
+    0x00,0x00,0x00,0x00,0x10,0x10,0x00,0x00,0x10,0x10,0x00,0x00,0x00, // :
+    0x00,0x00,0x00,0x00,0x10,0x10,0x00,0x00,0x10,0x10,0x20,0x00,0x00, // ;
+    0x00,0x00,0x00,0x02,0x1C,0x60,0x60,0x1C,0x02,0x00,0x00,0x00,0x00, // <
+    0x00,0x00,0x00,0x00,0x00,0x7E,0x00,0x7E,0x00,0x00,0x00,0x00,0x00, // =
+    0x00,0x00,0x00,0x40,0x38,0x06,0x06,0x38,0x40,0x00,0x00,0x00,0x00, // >
+    0x00,0x1C,0x22,0x02,0x0C,0x18,0x10,0x00,0x10,0x10,0x00,0x00,0x00, // ?
+    0x00,0x00,0x1C,0x26,0x42,0x4E,0x52,0x52,0x4E,0x60,0x20,0x1C,0x00, // @
+    0x00,0x18,0x18,0x18,0x24,0x24,0x24,0x3C,0x42,0x42,0x00,0x00,0x00, // A
+    0x00,0x7C,0x42,0x42,0x42,0x7C,0x42,0x42,0x42,0x7C,0x00,0x00,0x00, // B
+    0x00,0x1C,0x22,0x40,0x40,0x40,0x40,0x40,0x22,0x1C,0x00,0x00,0x00, // C
+    0x00,0x78,0x44,0x42,0x42,0x42,0x42,0x42,0x44,0x78,0x00,0x00,0x00, // D
+    0x00,0x7E,0x40,0x40,0x40,0x7E,0x40,0x40,0x40,0x7E,0x00,0x00,0x00, // E
+    0x00,0x7E,0x40,0x40,0x40,0x7E,0x40,0x40,0x40,0x40,0x00,0x00,0x00, // F
+    0x00,0x1C,0x22,0x40,0x40,0x46,0x42,0x42,0x22,0x1C,0x00,0x00,0x00, // G
+    0x00,0x42,0x42,0x42,0x42,0x7E,0x42,0x42,0x42,0x42,0x00,0x00,0x00, // H
+    0x00,0x7C,0x10,0x10,0x10,0x10,0x10,0x10,0x10,0x7C,0x00,0x00,0x00, // I
+    0x00,0x1C,0x04,0x04,0x04,0x04,0x04,0x04,0x44,0x38,0x00,0x00,0x00, // J
+    0x00,0x42,0x44,0x48,0x50,0x70,0x48,0x4C,0x44,0x42,0x00,0x00,0x00, // K
+    0x00,0x40,0x40,0x40,0x40,0x40,0x40,0x40,0x40,0x7E,0x00,0x00,0x00, // L
+    0x00,0x42,0x66,0x66,0x5A,0x5A,0x5A,0x42,0x42,0x42,0x00,0x00,0x00, // M
+    0x00,0x62,0x62,0x52,0x52,0x5A,0x4A,0x4A,0x46,0x46,0x00,0x00,0x00, // N
+    0x00,0x3C,0x24,0x42,0x42,0x42,0x42,0x42,0x24,0x3C,0x00,0x00,0x00, // O
+    0x00,0x7C,0x42,0x42,0x42,0x7C,0x40,0x40,0x40,0x40,0x00,0x00,0x00, // P
+    0x00,0x3C,0x24,0x42,0x42,0x42,0x42,0x42,0x26,0x3C,0x04,0x04,0x00, // Q
+    0x00,0x7C,0x42,0x42,0x42,0x7C,0x44,0x42,0x42,0x41,0x00,0x00,0x00, // R
+    0x00,0x3C,0x42,0x40,0x60,0x3C,0x02,0x02,0x42,0x3C,0x00,0x00,0x00, // S
+    0x00,0xFE,0x10,0x10,0x10,0x10,0x10,0x10,0x10,0x10,0x00,0x00,0x00, // T
+    0x00,0x42,0x42,0x42,0x42,0x42,0x42,0x42,0x42,0x3C,0x00,0x00,0x00, // U
+    0x00,0x42,0x42,0x24,0x24,0x24,0x24,0x18,0x18,0x18,0x00,0x00,0x00, // V
+    0x00,0x82,0x92,0x92,0xAA,0xAA,0xAA,0x6C,0x44,0x44,0x00,0x00,0x00, // W
+    0x00,0x42,0x24,0x24,0x18,0x18,0x18,0x24,0x24,0x42,0x00,0x00,0x00, // X
+    0x00,0x82,0x44,0x28,0x28,0x10,0x10,0x10,0x10,0x10,0x00,0x00,0x00, // Y
+    0x00,0x7E,0x06,0x04,0x08,0x18,0x10,0x20,0x60,0x7E,0x00,0x00,0x00, // Z
+    0x18,0x10,0x10,0x10,0x10,0x10,0x10,0x10,0x10,0x10,0x18,0x00,0x00, // [
+    0x00,0x40,0x20,0x20,0x10,0x10,0x08,0x08,0x04,0x04,0x02,0x00,0x00, // backslash
+    0x30,0x10,0x10,0x10,0x10,0x10,0x10,0x10,0x10,0x10,0x30,0x00,0x00, // ]
+    0x00,0x30,0x48,0x84,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00, // ^
+    0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0xFE, // _
+    0x10,0x08,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00, // `
+    0x00,0x00,0x00,0x38,0x44,0x04,0x3C,0x44,0x44,0x3C,0x00,0x00,0x00, // a
+    0x40,0x40,0x40,0x78,0x44,0x44,0x44,0x44,0x44,0x78,0x00,0x00,0x00, // b
+    0x00,0x00,0x00,0x38,0x64,0x40,0x40,0x40,0x60,0x3C,0x00,0x00,0x00, // c
+    0x04,0x04,0x04,0x3C,0x44,0x44,0x44,0x44,0x44,0x3C,0x00,0x00,0x00, // d
+    0x00,0x00,0x00,0x38,0x64,0x44,0x7C,0x40,0x44,0x38,0x00,0x00,0x00, // e
+    0x0C,0x10,0x10,0x7C,0x10,0x10,0x10,0x10,0x10,0x10,0x00,0x00,0x00, // f
+    0x00,0x00,0x00,0x3C,0x44,0x44,0x44,0x44,0x44,0x3C,0x04,0x24,0x18, // g
+    0x40,0x40,0x40,0x58,0x64,0x44,0x44,0x44,0x44,0x44,0x00,0x00,0x00, // h
+    0x10,0x00,0x00,0x70,0x10,0x10,0x10,0x10,0x10,0x7C,0x00,0x00,0x00, // i
+    0x08,0x00,0x00,0x38,0x08,0x08,0x08,0x08,0x08,0x08,0x08,0x08,0x30, // j
+    0x40,0x40,0x40,0x44,0x48,0x50,0x60,0x50,0x48,0x44,0x00,0x00,0x00, // k
+    0x70,0x10,0x10,0x10,0x10,0x10,0x10,0x10,0x10,0x0C,0x00,0x00,0x00, // l
+    0x00,0x00,0x00,0x7C,0x54,0x54,0x54,0x54,0x54,0x54,0x00,0x00,0x00, // m
+    0x00,0x00,0x00,0x58,0x64,0x44,0x44,0x44,0x44,0x44,0x00,0x00,0x00, // n
+    0x00,0x00,0x00,0x38,0x44,0x44,0x44,0x44,0x44,0x38,0x00,0x00,0x00, // o
+    0x00,0x00,0x00,0x78,0x44,0x44,0x44,0x44,0x44,0x78,0x40,0x40,0x40, // p
+    0x00,0x00,0x00,0x3C,0x44,0x44,0x44,0x44,0x44,0x3C,0x04,0x04,0x04, // q
+    0x00,0x00,0x00,0x3C,0x32,0x20,0x20,0x20,0x20,0x20,0x00,0x00,0x00, // r
+    0x00,0x00,0x00,0x38,0x44,0x40,0x38,0x04,0x44,0x38,0x00,0x00,0x00, // s
+    0x00,0x10,0x10,0x7C,0x10,0x10,0x10,0x10,0x10,0x1C,0x00,0x00,0x00, // t
+    0x00,0x00,0x00,0x44,0x44,0x44,0x44,0x44,0x44,0x3C,0x00,0x00,0x00, // u
+    0x00,0x00,0x00,0x44,0x44,0x28,0x28,0x28,0x10,0x10,0x00,0x00,0x00, // v
+    0x00,0x00,0x00,0x82,0x82,0x54,0x54,0x6C,0x28,0x28,0x00,0x00,0x00, // w
+    0x00,0x00,0x00,0x44,0x28,0x28,0x10,0x28,0x28,0x44,0x00,0x00,0x00, // x
+    0x00,0x00,0x00,0x44,0x44,0x28,0x28,0x28,0x30,0x10,0x10,0x20,0x60, // y
+    0x00,0x00,0x00,0x7C,0x04,0x08,0x10,0x20,0x40,0x7C,0x00,0x00,0x00, // z
+    0x1C,0x10,0x10,0x10,0x10,0x60,0x10,0x10,0x10,0x10,0x1C,0x00,0x00, // {
+    0x10,0x10,0x10,0x10,0x10,0x10,0x10,0x10,0x10,0x10,0x10,0x10,0x00, // |
+    0x70,0x10,0x10,0x10,0x10,0x0C,0x10,0x10,0x10,0x10,0x70,0x00,0x00, // }
+    0x00,0x00,0x00,0x00,0x00,0x70,0x0E,0x00,0x00,0x00,0x00,0x00,0x00, // ~
+};
+
+static constexpr c32 first_code_point = 32;
+static constexpr i32 num_glyphs = (i32)size(glyph_rows);
+
+// Число ячеек в строке атласа
+static constexpr i32 atlas_columns = 16;
+
+unique_ptr<SpriteFont> SpriteFont::create_builtin()
+{
+    constexpr i32 atlas_rows = (num_glyphs + atlas_columns - 1) / atlas_columns;
+
+    shared_ptr<Image> image = make_shared<Image>(atlas_columns * cell_width, atlas_rows * cell_height, 4, 0x00FFFFFF);
+
+    unique_ptr<SpriteFont> font(new SpriteFont());
+    font->face_ = "builtin";
+    font->size_ = 12;
+    font->line_height_ = cell_height;
+
+    for (i32 i = 0; i < num_glyphs; ++i)
+    {
+        ivec2 cell_pos((i % atlas_columns) * cell_width, (i / atlas_columns) * cell_height);
+
+        for (i32 y = 0; y < cell_height; ++y)
+        {
+            for (i32 x = 0; x < cell_width; ++x)
+            {
+                if (glyph_rows[i][y] & (0x80 >> x))
+                    image->pixel_ptr(cell_pos.x + x, cell_pos.y + y)[3] = 0xFF;
+            }
+        }
+
+        Glyph glyph;
+        glyph.rect = IntRect(cell_pos, ivec2(cell_width, cell_height));
+        glyph.advance_x = advance_x;
+        glyph.page = 0;
+        font->glyphs_[first_code_point + i] = glyph;
+    }
+
+    // Пиксельный шрифт не масштабируется, поэтому мипмапы и фильтрация не нужны
+    shared_ptr<Texture> texture = make_shared<Texture>(image);
+    texture->set_params(TextureParams{GL_NEAREST, GL_NEAREST});
+    texture->set_label("SpriteFont builtin");
+    DV_TEXTURE_CACHE->add(texture);
+    font->textures_.push_back(texture);
+
+    return font;
+}
+
+} // namespace dviglo
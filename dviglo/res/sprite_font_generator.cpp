@@ -16,6 +16,7 @@
 
 #include <ft2build.h>
 #include FT_FREETYPE_H
+#include FT_GLYPH_H
 #include FT_STROKER_H
 
 #define STB_RECT_PACK_IMPLEMENTATION
@@ -115,13 +116,14 @@ public:
 static Image to_image(const FT_Bitmap& bitmap)
 {
     Image ret(bitmap.width, bitmap.rows, 1);
+    u8* ret_data = ret.data();
 
     for (i32 y = 0; y < ret.size().y; ++y)
     {
         // pitch - это число байт, занимаемых одной линией изображения
         u8* src = bitmap.buffer + bitmap.pitch * y;
 
-        u8* dest = ret.data() + ret.size().x * y;
+        u8* dest = ret_data + ret.size().x * y;
 
         for (i32 x = 0; x < ret.size().x; ++x)
         {
@@ -149,15 +151,169 @@ static Image to_image(const FT_Bitmap& bitmap)
 }
 
 
+// Растровое изображение глифа и его положение относительно origin (FT_BitmapGlyph::left и top)
+struct GlyphBitmap
+{
+    Image image;
+    i32 left = 0;
+    i32 top = 0;
+};
+
+
+// Глиф, загруженный в слот FT_Face один раз для всех стилей.
+// Растровые изображения вычисляются по требованию и запоминаются, так что
+// стили с одинаковой толщиной обводки не растеризуют глиф повторно
+class GlyphSource
+{
+private:
+    FT_Face face_; // Это указатель
+    FT_Render_Mode render_mode_;
+
+    // Копия контура из слота
+    FT_Glyph outline_ = nullptr;
+
+    // Обычный глиф
+    bool plain_rendered_ = false;
+    GlyphBitmap plain_;
+
+    // Обведённые глифы
+    struct Stroked
+    {
+        FT_Fixed radius;
+        bool border_only;
+        GlyphBitmap bitmap;
+    };
+
+    std::vector<Stroked> stroked_;
+
+    GlyphBitmap render(FT_Fixed radius, bool border_only) const
+    {
+        GlyphBitmap ret;
+
+        // FT_Glyph_To_Bitmap() и FT_Glyph_Stroke() заменяют глиф, поэтому работаем с копией
+        FT_Glyph glyph;
+        FT_Error error = FT_Glyph_Copy(outline_, &glyph);
+
+        if (error)
+        {
+            DV_LOG->writef_error("{} | FT_Glyph_Copy(...) error | {}", DV_FUNCSIG, error);
+            return ret;
+        }
+
+        if (radius)
+        {
+            FT_Stroker stroker;
+            FT_Stroker_New(glyph->library, &stroker);
+            FT_Stroker_Set(stroker, radius, FT_STROKER_LINECAP_ROUND, FT_STROKER_LINEJOIN_ROUND, 0);
+
+            if (border_only)
+                FT_Glyph_StrokeBorder(&glyph, stroker, false, true); // Раздутый глиф
+            else
+                FT_Glyph_Stroke(&glyph, stroker, true); // Заменяем глиф контуром глифа
+
+            FT_Stroker_Done(stroker);
+        }
+
+        error = FT_Glyph_To_Bitmap(&glyph, render_mode_, nullptr, true);
+
+        if (error)
+        {
+            DV_LOG->writef_error("{} | FT_Glyph_To_Bitmap(...) error | {}", DV_FUNCSIG, error);
+            FT_Done_Glyph(glyph);
+            return ret;
+        }
+
+        FT_BitmapGlyph bitmap_glyph = reinterpret_cast<FT_BitmapGlyph>(glyph);
+        ret.image = to_image(bitmap_glyph->bitmap);
+        ret.left = bitmap_glyph->left;
+        ret.top = bitmap_glyph->top;
+        FT_Done_Glyph(glyph);
+
+        return ret;
+    }
+
+public:
+    // Глиф уже должен быть загружен в слот
+    GlyphSource(FT_Face face, FT_Render_Mode render_mode)
+        : face_(face)
+        , render_mode_(render_mode)
+    {
+        FT_Error error = FT_Get_Glyph(face_->glyph, &outline_);
+
+        if (error)
+        {
+            DV_LOG->writef_error("{} | FT_Get_Glyph(...) error | {}", DV_FUNCSIG, error);
+            outline_ = nullptr;
+        }
+    }
+
+    ~GlyphSource()
+    {
+        if (outline_)
+            FT_Done_Glyph(outline_);
+    }
+
+    // Запрещаем копирование
+    GlyphSource(const GlyphSource&) = delete;
+    GlyphSource& operator =(const GlyphSource&) = delete;
+
+    bool valid() const { return outline_ != nullptr; }
+
+    // Смещение при выводе на экран
+    ivec2 offset() const
+    {
+        return ivec2(round_to_pixels(face_->glyph->metrics.horiBearingX),
+                     round_to_pixels(face_->size->metrics.ascender - face_->glyph->metrics.horiBearingY));
+    }
+
+    i32 advance_x() const
+    {
+        return round_to_pixels(face_->glyph->metrics.horiAdvance);
+    }
+
+    const GlyphBitmap& plain()
+    {
+        if (!plain_rendered_)
+        {
+            plain_ = render(0, false);
+            plain_rendered_ = true;
+        }
+
+        return plain_;
+    }
+
+    // Контур глифа (border_only == false) или раздутый глиф (border_only == true).
+    // radius в формате 26.6
+    const GlyphBitmap& stroked(FT_Fixed radius, bool border_only)
+    {
+        for (const Stroked& item : stroked_)
+        {
+            if (item.radius == radius && item.border_only == border_only)
+                return item.bitmap;
+        }
+
+        stroked_.push_back(Stroked{radius, border_only, render(radius, border_only)});
+        return stroked_.back().bitmap;
+    }
+};
+
+
 struct RenderedGlyph
 {
-    // Для стилей Simple и Contour изображение grayscale,
-    // а для Outlined - rgba
-    unique_ptr<Image> image;
+    // RGBA-изображение глифа (цвет стиля уже применён).
+    // Для атласов с упаковкой по каналам - grayscale-изображение
+    Image image;
+
+    // Цвет отступов вокруг глифа в текстуре. Совпадает с цветом глифа, но прозрачный,
+    // чтобы при билинейной фильтрации на краях глифа не появлялась тёмная кайма
+    u32 padding_color = 0;
 
     // Символ в кодировке UTF-32
     u32 code_point = 0;
 
+    // Индекс стиля при пакетной генерации
+    i32 variant_index = 0;
+
     // Смещение при выводе на экран
     glm::ivec2 offset{0, 0};
 
@@ -169,21 +325,8 @@ struct RenderedGlyph
     // Область в текстуре
     IntRect rect = IntRect::zero;
 
-    // TODO: Удалить
     RenderedGlyph() = default;
 
-    // Забирает уже отрендеренный глиф из слота (FT_Face->glyph)
-    RenderedGlyph(const u32 code_point, const FreeTypeFace& face)
-    {
-        const FT_GlyphSlot slot = face.get()->glyph; // Это указатель
-
-        this->code_point = code_point;
-        image = make_unique<Image>(to_image(slot->bitmap));
-        offset.x = round_to_pixels(slot->metrics.horiBearingX);
-        offset.y = round_to_pixels(face.get()->size->metrics.ascender - slot->metrics.horiBearingY);
-        advance_x = round_to_pixels(slot->metrics.horiAdvance);
-    }
-
     // Запрещаем копирование
     RenderedGlyph(const RenderedGlyph&) = delete;
     RenderedGlyph& operator=(const RenderedGlyph&) = delete;
@@ -196,20 +339,27 @@ struct RenderedGlyph
     void blur(const i32 blur_radius)
     {
         assert(blur_radius >= 0);
-        assert(image->num_components() == 1);
+        assert(image.num_components() == 1);
 
         if (!blur_radius)
             return;
 
         // Расширенное изображение
-        Image new_image(image->size() + blur_radius * 2, image->num_components());
+        Image new_image(image.size() + blur_radius * 2, image.num_components());
         // Вставляем исходное изображение в центр расширенного
-        new_image.paste(*image, ivec2(blur_radius));
+        new_image.paste(image, ivec2(blur_radius));
         new_image.blur_triangle(blur_radius);
-        *image = std::move(new_image);
+        image = std::move(new_image);
         // Размытый текст предназначен для создания тени от неразмытого текста
         offset -= blur_radius;
     }
+
+    // Окрашивает grayscale Image
+    void colorize(u32 color)
+    {
+        image = image.to_rgba(color);
+        padding_color = color & 0x00FFFFFF;
+    }
 };
 
 
@@ -226,7 +376,7 @@ class GlyphPacker
 #endif
 
 public:
-    GlyphPacker(FT_Long num_glyphs)
+    GlyphPacker(size_t num_glyphs)
     {
         rendered_glyphs_.reserve(num_glyphs);
         rects_.reserve(num_glyphs);
@@ -245,18 +395,19 @@ public:
     void add(RenderedGlyph&& rendered_glyph)
     {
         stbrp_rect r{};
-        r.id = rendered_glyphs_.size(); // Индекс в векторе rendered_glyphs
-        r.w = rendered_glyph.image->width() + padding * 2;
-        r.h = rendered_glyph.image->height() + padding * 2;
+        r.id = (i32)rendered_glyphs_.size(); // Индекс в векторе rendered_glyphs
+        r.w = rendered_glyph.image.width() + padding * 2;
+        r.h = rendered_glyph.image.height() + padding * 2;
         rects_.push_back(r);
 
         rendered_glyphs_.push_back(std::move(rendered_glyph));
     }
 
-    vector<shared_ptr<Image>> pack(const ivec2 texture_size)
+    // Возвращает страницы. num_components должно совпадать с числом компонентов изображений глифов
+    vector<shared_ptr<Image>> pack(const ivec2 texture_size, const i32 num_components = 4)
     {
         // Проверяем, что метод не вызывается повторно
-        assert(!packed);
+        assert(!packed_);
 
 #ifndef NDEBUG
         packed_ = true;
@@ -272,25 +423,33 @@ public:
 
         while (rects_.size())
         {
-            shared_ptr<Image> current_page = make_shared<Image>(texture_size, 1);
+            shared_ptr<Image> current_page = make_shared<Image>(texture_size, num_components);
             stbrp_init_target(&pack_context, texture_size.x, texture_size.y, nodes.data(), num_nodes);
             stbrp_pack_rects(&pack_context, rects_.data(), (i32)rects_.size());
 
+            bool any_packed = false;
+
             for (size_t i = 0; i < rects_.size();)
             {
                 stbrp_rect& rect = rects_[i];
 
                 if (rect.was_packed)
                 {
-                    current_page->paste(*rendered_glyphs_[rect.id].image, ivec2(rect.x + padding, rect.y + padding));
-                    rendered_glyphs_[rect.id].page = (i32)ret.size();
-                    rendered_glyphs_[rect.id].rect.pos = ivec2(rect.x, rect.y) + padding;
-                    rendered_glyphs_[rect.id].rect.size = ivec2(rect.w, rect.h) - padding * 2;
-                    assert(rendered_glyphs_[rect.id].rect.size.x == rendered_glyphs_[rect.id].image->size().x);
+                    RenderedGlyph& rendered_glyph = rendered_glyphs_[rect.id];
+
+                    if (rendered_glyph.padding_color)
+                        current_page->fill(IntRect(rect.x, rect.y, rect.w, rect.h), rendered_glyph.padding_color);
+
+                    current_page->paste(rendered_glyph.image, ivec2(rect.x + padding, rect.y + padding));
+                    rendered_glyph.page = (i32)ret.size();
+                    rendered_glyph.rect.pos = ivec2(rect.x, rect.y) + padding;
+                    rendered_glyph.rect.size = ivec2(rect.w, rect.h) - padding * 2;
+                    assert(rendered_glyph.rect.size.x == rendered_glyph.image.size().x);
 
                     // Удаляем упакованный прямоугольник из списка, путём перемещения в конец
                     rect = std::move(rects_.back());
                     rects_.pop_back();
+                    any_packed = true;
                 }
                 else
                 {
@@ -298,6 +457,13 @@ public:
                 }
             }
 
+            // Глиф больше текстуры
+            if (!any_packed)
+            {
+                DV_LOG->writef_error("{} | glyph doesn't fit into texture {}x{}", DV_FUNCSIG, texture_size.x, texture_size.y);
+                break;
+            }
+
             ret.push_back(current_page);
         }
 
@@ -306,169 +472,285 @@ public:
 };
 
 
-SpriteFont::SpriteFont(const SFSettingsSimple& settings, i64* generation_time_ms)
+static RenderedGlyph render_glyph_simple(GlyphSource& source, const SFSettingsSimple& settings)
 {
-    i64 begin_time_ms = get_ticks_ms();
+    assert(settings.blur_radius >= 0);
 
-    FreeTypeFace face(settings);
+    RenderedGlyph ret;
+    ret.image = source.plain().image; // Пиксели не копируются
+    ret.offset = source.offset();
+    ret.advance_x = source.advance_x();
+    ret.blur(settings.blur_radius);
 
-    FT_UInt glyph_index;
-    FT_ULong char_code = FT_Get_First_Char(face.get(), &glyph_index);
-    vector<shared_ptr<Image>> pages;
+    return ret;
+}
 
-    GlyphPacker glyph_packer(face.get()->num_glyphs);
+static RenderedGlyph render_glyph_contour(GlyphSource& source, const SFSettingsContour& settings)
+{
+    assert(settings.blur_radius >= 0);
 
-    while (glyph_index != 0)
-    {
-        // При загрузке глифа сразу же его рендерим
-        FT_Int32 load_flags = FT_LOAD_RENDER;
+    RenderedGlyph ret;
+    ret.image = source.stroked(static_cast<FT_Fixed>(settings.thickness * (64 / 2)), false).image;
+    ret.offset = source.offset();
+    ret.advance_x = source.advance_x();
 
-        // По умолчанию рендерится в режиме FT_RENDER_MODE_NORMAL.
-        // Перезаписываем, если сглаживание отключено
-        if (!settings.anti_aliasing)
-        {
-            load_flags |= FT_LOAD_MONOCHROME;  // 1 бит на пиксель
-            load_flags |= FT_LOAD_TARGET_MONO; // Алгоритм хинтига
-        }
+    // Отличаетися от simple
+    // Глиф стал больше примерно на половину толщины контура в каждую сторону.
+    // Необходимо вручную модифицировать метрики.
+    // См. примечание https://www.freetype.org/freetype2/docs/reference/ft2-glyph_stroker.html#FT_Glyph_Stroke
+    ret.advance_x += (i32)settings.thickness;
+    // Конец
 
-        // Результат будет помещён в слот
-        FT_Error error = FT_Load_Glyph(face.get(), glyph_index, load_flags);
+    ret.blur(settings.blur_radius);
 
-        if (error)
-        {
-            DV_LOG->writef_error("{} | FT_Load_Glyph(...) | {}", DV_FUNCSIG, error);
-            continue;
-        }
+    return ret;
+}
 
-        RenderedGlyph rendered_glyph(char_code, face);
-        rendered_glyph.blur(settings.blur_radius);
-        glyph_packer.add(std::move(rendered_glyph));
+static RenderedGlyph render_glyph_outlined(GlyphSource& source, const SFSettingsOutlined& settings)
+{
+    RenderedGlyph ret;
 
-        char_code = FT_Get_Next_Char(face.get(), char_code, &glyph_index);
-    }
+    // Можно вычислить и до ренгедринга
+    ret.offset = source.offset();
+    ret.advance_x = source.advance_x();
+    ret.advance_x += i32(settings.outline_thickness * 2);
 
-    pages = glyph_packer.pack(settings.texture_size);
+    // Внутренний глиф рендерится обычным способом
+    const GlyphBitmap& normal_glyph = source.plain();
 
-    // face.get()->size->metrics.height - это расстояние между базовыми линиями.
-    // Смотри коммент к FT_FaceRec_ в freetype.h
-    line_height_ = round_to_pixels(face.get()->size->metrics.height);
+    // Раздутый глиф
+    const GlyphBitmap& inflated_glyph = source.stroked(FT_Fixed(settings.outline_thickness * 64), true);
+    Image inflated_image = inflated_glyph.image; // Пиксели не копируются
 
-    for (const RenderedGlyph& rendered_glyph : glyph_packer.rendered_glyphs())
+    // Смещение нормального изображения относительно раздутого.
+    // Оно не всегда равно толщине обводки. Поэтому вычисляем так.
+    i32 delta_x = normal_glyph.left - inflated_glyph.left;
+    i32 delta_y = inflated_glyph.top - normal_glyph.top;
+
+    if (settings.outline_blur_radius > 0)
     {
-        Glyph glyph;
-        glyph.page = rendered_glyph.page;
-        glyph.rect = rendered_glyph.rect;
-        glyph.advance_x = rendered_glyph.advance_x;
-        glyph.offset = rendered_glyph.offset;
+        Image new_image(inflated_image.size() + settings.outline_blur_radius * 2,
+            inflated_image.num_components());
 
-        glyphs_[rendered_glyph.code_point] = glyph;
+        // Вставляем в центр расширенного изображения
+        new_image.paste(inflated_image, ivec2(settings.outline_blur_radius, settings.outline_blur_radius));
+
+        // TODO: Изображение может быть нулевого размера
+        new_image.blur_triangle(settings.outline_blur_radius);
+
+        inflated_image = std::move(new_image);
+
+        ret.offset.x -= settings.outline_blur_radius;
+        ret.offset.y -= settings.outline_blur_radius;
+
+        // Переделать
+        delta_x += settings.outline_blur_radius;
+        delta_y += settings.outline_blur_radius;
     }
 
-    for (shared_ptr<Image> page : pages)
+    // Специальный случай - цвета внутри и снаружи совпадают. При этом не выводим внутренний глиф.
+    // При размытии обводки внутренний глиф будет видно, даже если их цвет одинаковый.
+    // Это на случай, если будет нужна размытая тень для глифа с обводкой.
+
+    ret.image = inflated_image.to_rgba(settings.outline_color);
+    ret.padding_color = settings.outline_color & 0x00FFFFFF;
+
+    if (settings.main_color != settings.outline_color)
     {
-        shared_ptr<Image> colored_page = make_shared<Image>(page->to_rgba(settings.color));
-        shared_ptr<Texture> page_tex = make_shared<Texture>(colored_page, true);
-        DV_TEXTURE_CACHE->add(page_tex);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-        textures_.push_back(page_tex);
+        // Накладываем нормальный глиф на раздутый.
+        // Это не альфа-блендинг. Тут пиксели нормального (внтуренннего) глифа перезаписывают
+        // пиксели раздутого глифа. Но учитывается альфа крайних полупрозрачных пикселей.
+        for (i32 y = 0; y < normal_glyph.image.size().y; ++y)
+        {
+            for (i32 x = 0; x < normal_glyph.image.size().x; ++x)
+            {
+                if (!ret.image.is_inside(x + delta_x, y + delta_y))
+                    continue;
+
+                u32 back_color;
+                memcpy(&back_color, ret.image.pixel_ptr(x + delta_x, y + delta_y), 4);
+
+                u32 front_color = settings.main_color;
+
+                u32 mask = normal_glyph.image.pixel_ptr(x, y)[0];
+                u32 result_r = get_r(front_color) * mask + get_r(back_color) * (0xFFu - mask);
+                u32 result_g = get_g(front_color) * mask + get_g(back_color) * (0xFFu - mask);
+                u32 result_b = get_b(front_color) * mask + get_b(back_color) * (0xFFu - mask);
+                u32 result_a = get_a(front_color) * mask + get_a(back_color) * (0xFFu - mask);
+                u32 result_color = to_rgba(result_r / 0xFF, result_g / 0xFF, result_b / 0xFF, result_a / 0xFF);
+                memcpy(ret.image.pixel_ptr(x + delta_x, y + delta_y), &result_color, 4);
+            }
+        }
     }
 
-    i64 duration_ms = get_ticks_ms() - begin_time_ms;
+    return ret;
+}
 
-    if (generation_time_ms)
-        *generation_time_ms = duration_ms;
+static const SFSettings& get_base_settings(const SFVariant& variant)
+{
+    return std::visit([](const SFSettings& settings) -> const SFSettings& { return settings; }, variant);
+}
 
-    DV_LOG->writef_debug("{} | {} | Generated in {} ms", DV_FUNCSIG, settings.src_path, duration_ms);
+// Насколько стиль увеличивает высоту строки.
+// Глиф стал больше примерно на половину толщины контура в каждую сторону.
+// См. примечание https://www.freetype.org/freetype2/docs/reference/ft2-glyph_stroker.html#FT_Glyph_Stroke
+static i32 extra_line_height(const SFVariant& variant)
+{
+    if (const SFSettingsContour* contour = get_if<SFSettingsContour>(&variant))
+        return (i32)contour->thickness;
+    else if (const SFSettingsOutlined* outlined = get_if<SFSettingsOutlined>(&variant))
+        return i32(outlined->outline_thickness * 2);
+    else
+        return 0;
 }
 
-RenderedGlyph render_glyph_contour(FT_Face face, const SFSettingsContour& font_settings)
+// Если grayscale == true, то цвет стиля не применяется (для атласов с упаковкой по каналам).
+// Стиль outlined двухцветный, поэтому всегда рендерится в RGBA
+static RenderedGlyph render_glyph(GlyphSource& source, const SFVariant& variant, bool grayscale)
 {
     RenderedGlyph ret;
 
-    assert(font_settings.blur_radius >= 0);
+    if (const SFSettingsSimple* simple = get_if<SFSettingsSimple>(&variant))
+    {
+        ret = render_glyph_simple(source, *simple);
 
-    FT_Glyph glyph;
-    FT_Error error = FT_Get_Glyph(face->glyph, &glyph);
+        if (!grayscale)
+            ret.colorize(simple->color);
+    }
+    else if (const SFSettingsContour* contour = get_if<SFSettingsContour>(&variant))
+    {
+        ret = render_glyph_contour(source, *contour);
 
-    if (error)
+        if (!grayscale)
+            ret.colorize(contour->color);
+    }
+    else
     {
-        DV_LOG->writef_error("{} | FT_Get_Glyph(...) error | {}", DV_FUNCSIG, error);
-        return ret;
+        assert(!grayscale);
+        ret = render_glyph_outlined(source, get<SFSettingsOutlined>(variant));
     }
 
-    FT_Stroker stroker;
-    FT_Stroker_New(glyph->library, &stroker);
-    FT_Stroker_Set(stroker, static_cast<FT_Fixed>(font_settings.thickness * (64 / 2)), FT_STROKER_LINECAP_ROUND, FT_STROKER_LINEJOIN_ROUND, 0);
-    FT_Glyph_Stroke(&glyph, stroker, 1); // Заменяем глиф контуром глифа
-    FT_Stroker_Done(stroker);
+    return ret;
+}
+
+// Загружает все глифы шрифта и растеризует их во всех стилях.
+// Номер стиля у глифа равен first_variant_index + индекс в variants
+static void rasterize_glyphs(const FreeTypeFace& face, const vector<SFVariant>& variants, i32 first_variant_index,
+                             bool grayscale, GlyphPacker& glyph_packer)
+{
+    const SFSettings& settings = get_base_settings(variants[0]);
 
-    FT_Render_Mode render_mode = font_settings.anti_aliasing ? FT_RENDER_MODE_NORMAL : FT_RENDER_MODE_MONO;
-    error = FT_Glyph_To_Bitmap(&glyph, render_mode, nullptr, 1);
+    // Алгоритм хинтига
+    FT_Int32 load_flags = settings.anti_aliasing ? FT_LOAD_TARGET_NORMAL : FT_LOAD_TARGET_MONO;
+    FT_Render_Mode render_mode = settings.anti_aliasing ? FT_RENDER_MODE_NORMAL : FT_RENDER_MODE_MONO;
 
-    if (error)
+    FT_UInt glyph_index;
+    FT_ULong char_code = FT_Get_First_Char(face.get(), &glyph_index);
+
+    while (glyph_index != 0)
     {
-        DV_LOG->writef_error("{} | FT_Glyph_To_Bitmap(...) error | {}", DV_FUNCSIG, error);
-        FT_Done_Glyph(glyph);
-        return ret;
-    }
+        // Глиф загружается один раз для всех стилей
+        FT_Error error = FT_Load_Glyph(face.get(), glyph_index, load_flags);
 
-    FT_BitmapGlyph bitmap_glyph = reinterpret_cast<FT_BitmapGlyph>(glyph);
-    ret.image = make_unique<Image>(to_image(bitmap_glyph->bitmap));
-    FT_Done_Glyph(glyph);
+        if (error)
+        {
+            DV_LOG->writef_error("{} | FT_Load_Glyph(...) | {}", DV_FUNCSIG, error);
+            char_code = FT_Get_Next_Char(face.get(), char_code, &glyph_index);
+            continue;
+        }
 
-    ret.offset.x = round_to_pixels(face->glyph->metrics.horiBearingX);
-    ret.offset.y = round_to_pixels(face->size->metrics.ascender - face->glyph->metrics.horiBearingY);
-    ret.advance_x = round_to_pixels(face->glyph->metrics.horiAdvance);
+        GlyphSource source(face.get(), render_mode);
 
-    // Отличаетися от simple
-    // Глиф стал больше примерно на половину толщины контура в каждую сторону.
-    // Необходимо вручную модифицировать метрики.
-    // См. примечание https://www.freetype.org/freetype2/docs/reference/ft2-glyph_stroker.html#FT_Glyph_Stroke
-    ret.advance_x += (f32)font_settings.thickness;
-    // Конец
+        if (source.valid())
+        {
+            for (size_t i = 0; i < variants.size(); ++i)
+            {
+                RenderedGlyph rendered_glyph = render_glyph(source, variants[i], grayscale);
+                rendered_glyph.code_point = (u32)char_code;
+                rendered_glyph.variant_index = first_variant_index + (i32)i;
+                glyph_packer.add(std::move(rendered_glyph));
+            }
+        }
 
-    ret.blur(font_settings.blur_radius);
+        char_code = FT_Get_Next_Char(face.get(), char_code, &glyph_index);
+    }
+}
+
+static vector<shared_ptr<Texture>> create_textures(const vector<shared_ptr<Image>>& pages)
+{
+    vector<shared_ptr<Texture>> ret;
+    ret.reserve(pages.size());
+
+    TextureParams texture_params;
+    texture_params.min_filter = GL_LINEAR_MIPMAP_LINEAR;
+    texture_params.mag_filter = GL_LINEAR;
+
+    for (shared_ptr<Image> page : pages)
+    {
+        shared_ptr<Texture> page_tex = make_shared<Texture>(page, true);
+        DV_TEXTURE_CACHE->add(page_tex);
+        page_tex->set_params(texture_params);
+        ret.push_back(page_tex);
+    }
 
     return ret;
 }
 
-SpriteFont::SpriteFont(const SFSettingsContour& settings, i64* generation_time_ms)
+void SpriteFont::fill(const FreeTypeFace& face, const SFVariant& variant, const vector<shared_ptr<Texture>>& textures)
 {
-    i64 begin_time_ms = get_ticks_ms();
+    const SFSettings& settings = get_base_settings(variant);
 
-    FreeTypeFace face(settings);
+    face_ = face.get()->family_name ? face.get()->family_name : "";
+    size_ = settings.height;
 
-    FT_UInt glyph_index;
-    FT_ULong char_code = FT_Get_First_Char(face.get(), &glyph_index);
-    vector<shared_ptr<Image>> pages;
+    // face.get()->size->metrics.height - это расстояние между базовыми линиями.
+    // Смотри коммент к FT_FaceRec_ в freetype.h
+    line_height_ = round_to_pixels(face.get()->size->metrics.height) + extra_line_height(variant);
 
-    GlyphPacker glyph_packer(face.get()->num_glyphs);
+    textures_ = textures;
+}
 
-    while (glyph_index != 0)
+void SpriteFont::generate_into(const vector<SFVariant>& variants, const vector<SpriteFont*>& fonts,
+                               i64* generation_time_ms)
+{
+    assert(variants.size() == fonts.size());
+
+    i64 begin_time_ms = get_ticks_ms();
+
+    if (variants.empty())
     {
-        // Алгоритм хинтига
-        FT_Int32 load_flags = settings.anti_aliasing ? FT_LOAD_TARGET_NORMAL : FT_LOAD_TARGET_MONO;
+        DV_LOG->writef_error("{} | variants.empty()", DV_FUNCSIG);
+        return;
+    }
 
-        FT_Load_Glyph(face.get(), glyph_index, load_flags);
-        RenderedGlyph rendered_glyph = render_glyph_contour(face.get(), settings);
-        rendered_glyph.code_point = char_code;
+    const SFSettings& settings = get_base_settings(variants[0]);
 
-        glyph_packer.add(std::move(rendered_glyph));
+    // Глифы загружаются один раз, поэтому у всех стилей должны быть одинаковые шрифт, размер и сглаживание
+    for (const SFVariant& variant : variants)
+    {
+        const SFSettings& other = get_base_settings(variant);
 
-        char_code = FT_Get_Next_Char(face.get(), char_code, &glyph_index);
+        if (other.src_path != settings.src_path || other.height != settings.height
+            || other.anti_aliasing != settings.anti_aliasing)
+        {
+            DV_LOG->writef_error("{} | variants differ in src_path, height or anti_aliasing", DV_FUNCSIG);
+            return;
+        }
     }
 
-    pages = glyph_packer.pack(settings.texture_size);
+    FreeTypeFace face(settings);
 
-    line_height_ = round_to_pixels(face.get()->size->metrics.height);
+    if (!face.get())
+        return; // Сообщение об ошибке уже выведено в лог
 
-    // Отличаетися от simple
-    // Глиф стал больше примерно на половину толщины контура в каждую сторону.
-    // Необходимо вручную модифицировать метрики.
-    // См. примечание https://www.freetype.org/freetype2/docs/reference/ft2-glyph_stroker.html#FT_Glyph_Stroke
-    line_height_ += (f32)settings.thickness;
-    // Конец
+    GlyphPacker glyph_packer(face.get()->num_glyphs * variants.size());
+    rasterize_glyphs(face, variants, 0, false, glyph_packer);
+
+    // Все стили упаковываются в общие страницы
+    vector<shared_ptr<Texture>> textures = create_textures(glyph_packer.pack(settings.texture_size));
+
+    for (size_t i = 0; i < fonts.size(); ++i)
+        fonts[i]->fill(face, variants[i], textures);
 
     for (const RenderedGlyph& rendered_glyph : glyph_packer.rendered_glyphs())
     {
@@ -478,17 +760,7 @@ SpriteFont::SpriteFont(const SFSettingsContour& settings, i64* generation_time_m
         glyph.advance_x = rendered_glyph.advance_x;
         glyph.offset = rendered_glyph.offset;
 
-        glyphs_[rendered_glyph.code_point] = glyph;
-    }
-
-    for (shared_ptr<Image> page : pages)
-    {
-        shared_ptr<Image> colored_page = make_shared<Image>(page->to_rgba(settings.color));
-        shared_ptr<Texture> page_tex = make_shared<Texture>(colored_page, true);
-        DV_TEXTURE_CACHE->add(page_tex);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-        textures_.push_back(page_tex);
+        fonts[rendered_glyph.variant_index]->glyphs_[rendered_glyph.code_point] = glyph;
     }
 
     i64 duration_ms = get_ticks_ms() - begin_time_ms;
@@ -496,233 +768,149 @@ SpriteFont::SpriteFont(const SFSettingsContour& settings, i64* generation_time_m
     if (generation_time_ms)
         *generation_time_ms = duration_ms;
 
-    DV_LOG->writef_debug("{} | {} | Generated in {} ms", DV_FUNCSIG, settings.src_path, duration_ms);
+    DV_LOG->writef_debug("{} | {} | {} variant(s) generated in {} ms", DV_FUNCSIG, settings.src_path, variants.size(), duration_ms);
 }
 
-
-RenderedGlyph render_glyph_outlined(FT_Face face, const SFSettingsOutlined& settings)
+vector<unique_ptr<SpriteFont>> SpriteFont::generate(const vector<SFVariant>& variants, i64* generation_time_ms)
 {
-    RenderedGlyph ret;
-
-    //assert(font_settings.blur_radius >= 0);
-
-    // Реднерим глиф
-    FT_Glyph glyph;
-    FT_BitmapGlyph bitmapGlyph;
-
-    FT_Render_Mode render_mode = settings.anti_aliasing ? FT_RENDER_MODE_NORMAL : FT_RENDER_MODE_MONO;
-
-    // Реднерим внутренний глиф обычным способом
-    FT_Get_Glyph(face->glyph, &glyph);
-    FT_Glyph_To_Bitmap(&glyph, render_mode, nullptr, true);
-    bitmapGlyph = reinterpret_cast<FT_BitmapGlyph>(glyph);
-
-    // Можно вычислить и до ренгедринга
-    ret.offset.x = round_to_pixels(face->glyph->metrics.horiBearingX);
-    ret.offset.y = round_to_pixels(face->size->metrics.ascender - face->glyph->metrics.horiBearingY);
-    ret.advance_x = round_to_pixels(face->glyph->metrics.horiAdvance);
-    ret.advance_x += i32(settings.outline_thickness * 2);
-
-    // Используем манипулятор просто как место временного хранения.
-    Image normalGlyph = to_image(bitmapGlyph->bitmap);
-
-    int normalGlyphLeft = bitmapGlyph->left;
-    int normalGlyphTop = bitmapGlyph->top;
-    FT_Done_Glyph(glyph);
-
-    // Рендерим раздутый глиф.
-    FT_Get_Glyph(face->glyph, &glyph);
-    FT_Stroker stroker;
-    FT_Stroker_New(glyph->library, &stroker);
-    FT_Stroker_Set(stroker, FT_Fixed(settings.outline_thickness * 64), FT_STROKER_LINECAP_ROUND, FT_STROKER_LINEJOIN_ROUND, 0);
-    FT_Glyph_StrokeBorder(&glyph, stroker, false, true);
-    FT_Stroker_Done(stroker);
-    FT_Glyph_To_Bitmap(&glyph, render_mode, nullptr, true);
-    bitmapGlyph = reinterpret_cast<FT_BitmapGlyph>(glyph);
-    Image inflatedGlyph(to_image(bitmapGlyph->bitmap));
-    int inflatedGlyphLeft = bitmapGlyph->left;
-    int inflatedGlyphTop = bitmapGlyph->top;
-    FT_Done_Glyph(glyph);
-
-    // Смещение нормального изображения относительно раздутого.
-    // Оно не всегда равно толщине обводки. Поэтому вычисляем так.
-    int deltaX = normalGlyphLeft - inflatedGlyphLeft;
-    int deltaY = inflatedGlyphTop - normalGlyphTop;
+    vector<unique_ptr<SpriteFont>> ret;
+    vector<SpriteFont*> fonts;
 
-    if (settings.outline_blur_radius > 0)
+    for (size_t i = 0; i < variants.size(); ++i)
     {
-        Image new_image(inflatedGlyph.size() + settings.outline_blur_radius * 2,
-            inflatedGlyph.num_components());
+        ret.emplace_back(new SpriteFont()); // Конструктор приватный, поэтому не make_unique
+        fonts.push_back(ret.back().get());
+    }
 
-        // Вставляем в центр расширенного изображения
-        new_image.paste(inflatedGlyph, ivec2(settings.outline_blur_radius, settings.outline_blur_radius));
+    generate_into(variants, fonts, generation_time_ms);
 
-        // TODO: Изображение может быть нулевого размера
-        new_image.blur_triangle(settings.outline_blur_radius);
+    // Генерация не удалась
+    if (!ret.empty() && ret[0]->textures_.empty())
+        ret.clear();
 
-        inflatedGlyph = std::move(new_image);
+    return ret;
+}
 
-        ret.offset.x -= settings.outline_blur_radius;
-        ret.offset.y -= settings.outline_blur_radius;
-    }
+vector<unique_ptr<SpriteFont>> SpriteFont::generate_channel_packed(const vector<SFVariant>& variants,
+                                                                  i64* generation_time_ms)
+{
+    i64 begin_time_ms = get_ticks_ms();
 
-    if (settings.outline_blur_radius > 0)
+    if (variants.empty() || variants.size() > 4)
     {
-        // Переделать
-        deltaX += settings.outline_blur_radius;
-        deltaY += settings.outline_blur_radius;
+        DV_LOG->writef_error("{} | variants.empty() || variants.size() > 4", DV_FUNCSIG);
+        return {};
     }
 
-    // Специальный случай - цвета внутри и снаружи совпадают. При этом не выводим внутренний глиф.
-// При размытии обводки внутренний глиф будет видно, даже если их цвет одинаковый.
-// Это на случай, если будет нужна размытая тень для глифа с обводкой.
-
-    ret.image = make_unique<Image>(inflatedGlyph.to_rgba(settings.outline_color));
+    const ivec2 texture_size = get_base_settings(variants[0]).texture_size;
 
-    if (settings.main_color != settings.outline_color)
+    for (const SFVariant& variant : variants)
     {
-        // Накладываем нормальный глиф на раздутый.
-        // Это не альфа-блендинг. Тут пиксели нормального (внтуренннего) глифа перезаписывают
-        // пиксели раздутого глифа. Но учитывается альфа крайних полупрозрачных пикселей.
-        for (int y = 0; y < normalGlyph.size().y; ++y)
+        // Двухцветный стиль нельзя хранить в одном канале
+        if (holds_alternative<SFSettingsOutlined>(variant))
         {
-            for (int x = 0; x < normalGlyph.size().x; ++x)
-            {
-                u32 backColor;
-                memcpy(&backColor, ret.image->pixel_ptr(x + deltaX, y + deltaY), 4);
-
-                u32 frontColor = settings.main_color;
+            DV_LOG->writef_error("{} | holds_alternative<SFSettingsOutlined>(variant)", DV_FUNCSIG);
+            return {};
+        }
 
-                u32 mask = normalGlyph.pixel_ptr(x, y)[0];
-                u32 result_r = get_r(frontColor) * mask + get_r(backColor) * (0xFFu - mask);
-                u32 result_g = get_g(frontColor) * mask + get_g(backColor) * (0xFFu - mask);
-                u32 result_b = get_b(frontColor) * mask + get_b(backColor) * (0xFFu - mask);
-                u32 result_a = get_a(frontColor) * mask + get_a(backColor) * (0xFFu - mask);
-                u32 result_color = to_rgba(result_r / 0xFF, result_g / 0xFF, result_b / 0xFF, result_a / 0xFF);
-                memcpy(ret.image->pixel_ptr(x + deltaX, y + deltaY), &result_color, 4);
-
-                /*
-                float mask = normalGlyph.GetPixel(x, y);
-                float r = mask * mainColor_.r_ + backColor.r_ * (1.0f - mask);
-                float g = mask * mainColor_.g_ + backColor.g_ * (1.0f - mask);
-                float b = mask * mainColor_.b_ + backColor.b_ * (1.0f - mask);
-                float a = mask * mainColor_.a_ + backColor.a_ * (1.0f - mask);
-                resultImage->SetPixel(x + deltaX, y + deltaY, Color(r, g, b, a));
-                */
-            }
+        if (get_base_settings(variant).texture_size != texture_size)
+        {
+            DV_LOG->writef_error("{} | variants differ in texture_size", DV_FUNCSIG);
+            return {};
         }
     }
 
-    return ret;
-}
+    vector<unique_ptr<SpriteFont>> ret;
 
-SpriteFont::SpriteFont(const SFSettingsOutlined& settings, i64* generation_time_ms)
-{
-    i64 begin_time_ms = get_ticks_ms();
+    // Каждый набор глифов упаковывается отдельно в свои grayscale-страницы
+    vector<vector<shared_ptr<Image>>> channel_pages(variants.size());
+    size_t num_pages = 0;
 
-    FreeTypeFace face(settings);
-
-    FT_UInt glyph_index;
-    FT_ULong char_code = FT_Get_First_Char(face.get(), &glyph_index);
-    vector<RenderedGlyph> rendered_glyphs;
-    rendered_glyphs.reserve(face.get()->num_glyphs);
-    vector<stbrp_rect> rects;
-    rects.reserve(face.get()->num_glyphs);
-    vector<shared_ptr<Image>> pages;
-
-    const i32 padding = 2;
-
-    while (glyph_index != 0)
+    // Набор глифов может быть из другого шрифта, поэтому FreeTypeFace для каждого свой
+    for (size_t channel = 0; channel < variants.size(); ++channel)
     {
-        // Алгоритм хинтига
-        FT_Int32 load_flags = settings.anti_aliasing ? FT_LOAD_TARGET_NORMAL : FT_LOAD_TARGET_MONO;
+        const SFSettings& settings = get_base_settings(variants[channel]);
+        FreeTypeFace face(settings);
 
-        FT_Load_Glyph(face.get(), glyph_index, load_flags);
-        RenderedGlyph rendered_glyph = render_glyph_outlined(face.get(), settings);
-        rendered_glyph.code_point = char_code;
+        if (!face.get())
+            return {}; // Сообщение об ошибке уже выведено в лог
 
-        stbrp_rect r{};
-        r.id = rendered_glyphs.size(); // Индекс в векторе rendered_glyphs
-        r.w = rendered_glyph.image->width() + padding * 2;
-        r.h = rendered_glyph.image->height() + padding * 2;
-        rects.push_back(r);
+        GlyphPacker glyph_packer(face.get()->num_glyphs);
+        rasterize_glyphs(face, {variants[channel]}, (i32)channel, true, glyph_packer);
+        channel_pages[channel] = glyph_packer.pack(texture_size, 1);
+        num_pages = std::max(num_pages, channel_pages[channel].size());
 
-        rendered_glyphs.push_back(std::move(rendered_glyph));
+        unique_ptr<SpriteFont> font(new SpriteFont()); // Конструктор приватный, поэтому не make_unique
+        font->fill(face, variants[channel], {}); // Текстуры будут добавлены ниже
 
-        char_code = FT_Get_Next_Char(face.get(), char_code, &glyph_index);
+        for (const RenderedGlyph& rendered_glyph : glyph_packer.rendered_glyphs())
+        {
+            Glyph glyph;
+            glyph.page = rendered_glyph.page;
+            glyph.rect = rendered_glyph.rect;
+            glyph.advance_x = rendered_glyph.advance_x;
+            glyph.offset = rendered_glyph.offset;
+            glyph.channel = (i32)channel;
+
+            font->glyphs_[rendered_glyph.code_point] = glyph;
+        }
+
+        ret.push_back(std::move(font));
     }
 
-    stbrp_context pack_context;
-    i32 num_nodes = settings.texture_size.x;
-    vector<stbrp_node> nodes(num_nodes);
+    // Страница i итогового атласа хранит в канале c страницу i набора c.
+    // Неиспользуемые каналы остаются нулевыми
+    vector<shared_ptr<Image>> pages;
+    pages.reserve(num_pages);
 
-    while (rects.size())
+    for (size_t page_index = 0; page_index < num_pages; ++page_index)
     {
-        shared_ptr<Image> current_page = make_shared<Image>(settings.texture_size, 4);
-        stbrp_init_target(&pack_context, settings.texture_size.x, settings.texture_size.y, nodes.data(), num_nodes);
-        stbrp_pack_rects(&pack_context, rects.data(), (i32)rects.size());
+        shared_ptr<Image> page = make_shared<Image>(texture_size, 4);
+        u8* dest = page->data();
 
-        for (size_t i = 0; i < rects.size();)
+        for (size_t channel = 0; channel < channel_pages.size(); ++channel)
         {
-            stbrp_rect& rect = rects[i];
+            if (page_index >= channel_pages[channel].size())
+                continue;
 
-            if (rect.was_packed)
-            {
-                current_page->paste(*rendered_glyphs[rect.id].image, ivec2(rect.x + padding, rect.y + padding));
-                rendered_glyphs[rect.id].page = (i32)pages.size();
-                rendered_glyphs[rect.id].rect.pos = ivec2(rect.x, rect.y) + padding;
-                rendered_glyphs[rect.id].rect.size = ivec2(rect.w, rect.h) - padding * 2;
-                assert(rendered_glyphs[rect.id].rect.size.x == rendered_glyphs[rect.id].image->size().x);
-
-                // Удаляем упакованный прямоугольник из списка, путём перемещения в конец
-                rect = std::move(rects.back());
-                rects.pop_back();
-            }
-            else
-            {
-                ++i;
-            }
+            const u8* src = channel_pages[channel][page_index]->const_data();
+            const i32 num_pixels = texture_size.x * texture_size.y;
+
+            for (i32 i = 0; i < num_pixels; ++i)
+                dest[i * 4 + channel] = src[i];
         }
 
-        pages.push_back(current_page);
+        pages.push_back(page);
     }
 
-    line_height_ = round_to_pixels(face.get()->size->metrics.height);
-
-    // Отличаетися от simple
-    // Глиф стал больше примерно на половину толщины контура в каждую сторону.
-    // Необходимо вручную модифицировать метрики.
-    // См. примечание https://www.freetype.org/freetype2/docs/reference/ft2-glyph_stroker.html#FT_Glyph_Stroke
-    line_height_ += i32(settings.outline_thickness * 2);
-    // Конец
-
-    for (const RenderedGlyph& rendered_glyph : rendered_glyphs)
-    {
-        Glyph glyph;
-        glyph.page = rendered_glyph.page;
-        glyph.rect = rendered_glyph.rect;
-        glyph.advance_x = rendered_glyph.advance_x;
-        glyph.offset = rendered_glyph.offset;
-
-        glyphs_[rendered_glyph.code_point] = glyph;
-    }
+    vector<shared_ptr<Texture>> textures = create_textures(pages);
 
-    for (shared_ptr<Image> page : pages)
-    {
-        shared_ptr<Image> colored_page = page; // Изображение уже преобразовано в rgba
-        shared_ptr<Texture> page_tex = make_shared<Texture>(colored_page, true);
-        DV_TEXTURE_CACHE->add(page_tex);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-        textures_.push_back(page_tex);
-    }
+    for (unique_ptr<SpriteFont>& font : ret)
+        font->textures_ = textures;
 
     i64 duration_ms = get_ticks_ms() - begin_time_ms;
 
     if (generation_time_ms)
         *generation_time_ms = duration_ms;
 
-    DV_LOG->writef_debug("{} | {} | Generated in {} ms", DV_FUNCSIG, settings.src_path, duration_ms);
+    DV_LOG->writef_debug("{} | {} glyph set(s) packed into {} page(s) in {} ms", DV_FUNCSIG, variants.size(), num_pages, duration_ms);
+
+    return ret;
+}
+
+SpriteFont::SpriteFont(const SFSettingsSimple& settings, i64* generation_time_ms)
+{
+    generate_into({settings}, {this}, generation_time_ms);
+}
+
+SpriteFont::SpriteFont(const SFSettingsContour& settings, i64* generation_time_ms)
+{
+    generate_into({settings}, {this}, generation_time_ms);
+}
+
+SpriteFont::SpriteFont(const SFSettingsOutlined& settings, i64* generation_time_ms)
+{
+    generate_into({settings}, {this}, generation_time_ms);
 }
 
 } // namespace dviglo
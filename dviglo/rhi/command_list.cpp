@@ -0,0 +1,102 @@
+// Copyright (c) the Dviglo project
+// License: MIT
+
+#include "rhi.hpp"
+
+#include <cstring> // memcpy()
+
+using namespace glm;
+using namespace std;
+
+
+namespace dviglo
+{
+
+void CommandList::reset()
+{
+    commands_.clear();
+    data_.clear();
+}
+
+void CommandList::set_viewport(const IntRect& rect)
+{
+    RhiCommand& command = commands_.emplace_back(RhiCommand{RhiCommandType::set_viewport});
+    command.rect = rect;
+}
+
+void CommandList::set_scissor(const IntRect& rect)
+{
+    RhiCommand& command = commands_.emplace_back(RhiCommand{RhiCommandType::set_scissor});
+    command.rect = rect;
+}
+
+void CommandList::clear(const vec4& color)
+{
+    RhiCommand& command = commands_.emplace_back(RhiCommand{RhiCommandType::clear});
+    command.color = color;
+}
+
+void CommandList::set_pipeline(RhiPipeline pipeline)
+{
+    RhiCommand& command = commands_.emplace_back(RhiCommand{RhiCommandType::set_pipeline});
+    command.pipeline = pipeline;
+}
+
+void CommandList::set_vertex_buffer(RhiBuffer buffer)
+{
+    RhiCommand& command = commands_.emplace_back(RhiCommand{RhiCommandType::set_vertex_buffer});
+    command.buffer = buffer;
+}
+
+void CommandList::set_index_buffer(RhiBuffer buffer, RhiIndexType type)
+{
+    RhiCommand& command = commands_.emplace_back(RhiCommand{RhiCommandType::set_index_buffer});
+    command.buffer = buffer;
+    command.index_type = type;
+}
+
+void CommandList::set_uniform_buffer(u32 slot, RhiBuffer buffer)
+{
+    RhiCommand& command = commands_.emplace_back(RhiCommand{RhiCommandType::set_uniform_buffer});
+    command.slot = slot;
+    command.buffer = buffer;
+}
+
+void CommandList::set_texture(u32 slot, RhiTexture texture)
+{
+    RhiCommand& command = commands_.emplace_back(RhiCommand{RhiCommandType::set_texture});
+    command.slot = slot;
+    command.texture = texture;
+}
+
+void CommandList::update_buffer(RhiBuffer buffer, u32 offset, const void* data, u32 size)
+{
+    RhiCommand& command = commands_.emplace_back(RhiCommand{RhiCommandType::update_buffer});
+    command.buffer = buffer;
+    command.first = offset;
+    command.count = size;
+    command.data_offset = (u32)data_.size();
+
+    data_.resize(data_.size() + size);
+    memcpy(data_.data() + command.data_offset, data, size);
+}
+
+void CommandList::draw(u32 first_vertex, u32 num_vertices, u32 num_instances)
+{
+    RhiCommand& command = commands_.emplace_back(RhiCommand{RhiCommandType::draw});
+    command.first = first_vertex;
+    command.count = num_vertices;
+    command.num_instances = num_instances;
+}
+
+void CommandList::draw_indexed(u32 first_index, u32 num_indices, u32 num_vertices, i32 base_vertex, u32 num_instances)
+{
+    RhiCommand& command = commands_.emplace_back(RhiCommand{RhiCommandType::draw_indexed});
+    command.first = first_index;
+    command.count = num_indices;
+    command.num_vertices = num_vertices;
+    command.base_vertex = base_vertex;
+    command.num_instances = num_instances;
+}
+
+} // namespace dviglo
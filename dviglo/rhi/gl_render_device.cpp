@@ -0,0 +1,459 @@
+// Copyright (c) the Dviglo project
+// License: MIT
+
+#include "gl_render_device.hpp"
+
+#include "../fs/log.hpp"
+#include "../gl_utils/draw_counters.hpp"
+#include "../gl_utils/gl_debug.hpp"
+#include "../gl_utils/shader_cache.hpp"
+
+#include <cstring> // memcpy
+
+using namespace glm;
+using namespace std;
+
+
+namespace dviglo
+{
+
+static GLenum to_gl_usage(RhiBufferUsage usage)
+{
+    switch (usage)
+    {
+        case RhiBufferUsage::static_draw:  return GL_STATIC_DRAW;
+        case RhiBufferUsage::dynamic_draw: return GL_DYNAMIC_DRAW;
+        case RhiBufferUsage::stream_draw:  return GL_STREAM_DRAW;
+    }
+
+    return GL_STATIC_DRAW;
+}
+
+static GLenum to_gl_primitive(RhiPrimitive primitive)
+{
+    switch (primitive)
+    {
+        case RhiPrimitive::triangles:      return GL_TRIANGLES;
+        case RhiPrimitive::triangle_strip: return GL_TRIANGLE_STRIP;
+        case RhiPrimitive::lines:          return GL_LINES;
+    }
+
+    return GL_TRIANGLES;
+}
+
+// Настраивает атрибут в текущем VAO. Вершинный буфер должен быть привязан
+static void set_attribute_pointer(const RhiVertexAttribute& attribute, u32 stride)
+{
+    const void* offset = (const void*)(uintptr_t)attribute.offset;
+
+    switch (attribute.format)
+    {
+        case RhiVertexFormat::f32x1:
+        case RhiVertexFormat::f32x2:
+        case RhiVertexFormat::f32x3:
+        case RhiVertexFormat::f32x4:
+        {
+            GLint size = (GLint)attribute.format - (GLint)RhiVertexFormat::f32x1 + 1;
+            glVertexAttribPointer(attribute.location, size, GL_FLOAT, GL_FALSE, stride, offset);
+            break;
+        }
+
+        case RhiVertexFormat::u8x4_norm:
+            glVertexAttribPointer(attribute.location, 4, GL_UNSIGNED_BYTE, GL_TRUE, stride, offset);
+            break;
+
+        case RhiVertexFormat::u32x1:
+            glVertexAttribIPointer(attribute.location, 1, GL_UNSIGNED_INT, stride, offset);
+            break;
+    }
+
+    glEnableVertexAttribArray(attribute.location);
+}
+
+// Индекс свободного элемента. Если свободных нет, добавляет элемент в конец
+template <typename T>
+static u32 alloc_index(vector<T>& elements, vector<u32>& free_indices)
+{
+    if (free_indices.empty())
+    {
+        elements.emplace_back();
+        return (u32)elements.size() - 1;
+    }
+
+    u32 index = free_indices.back();
+    free_indices.pop_back();
+    return index;
+}
+
+GlRenderDevice::~GlRenderDevice()
+{
+    for (GlBuffer& buffer : buffers_)
+        glDeleteBuffers(1, &buffer.gpu_object_name); // Проверка на 0 не нужна
+
+    for (GlPipeline& pipeline : pipelines_)
+        glDeleteVertexArrays(1, &pipeline.vao);
+}
+
+RhiBuffer GlRenderDevice::create_buffer(const RhiBufferDesc& desc)
+{
+    // Тип буфера нужен только при создании в Vulkan. В OpenGL буфер можно привязать к любой точке
+    GlBuffer buffer;
+    buffer.size = desc.size;
+    buffer.usage = to_gl_usage(desc.usage);
+    glGenBuffers(1, &buffer.gpu_object_name);
+
+    // Индексный буфер привязывается к VAO, поэтому загружаем данные через GL_COPY_WRITE_BUFFER
+    glBindBuffer(GL_COPY_WRITE_BUFFER, buffer.gpu_object_name);
+    glBufferData(GL_COPY_WRITE_BUFFER, desc.size, desc.data, buffer.usage);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+    if (!desc.label.empty())
+        set_gl_label(GL_BUFFER, buffer.gpu_object_name, desc.label);
+
+    u32 index = alloc_index(buffers_, free_buffer_indices_);
+    buffers_[index] = buffer;
+
+    return RhiBuffer{index + 1};
+}
+
+void GlRenderDevice::destroy_buffer(RhiBuffer buffer)
+{
+    if (!buffer)
+        return;
+
+    GlBuffer& gl_buffer = buffers_[buffer.id - 1];
+
+    // Имя буфера может достаться новому буферу, поэтому VAO нужно будет настроить заново
+    for (GlPipeline& pipeline : pipelines_)
+    {
+        if (pipeline.vao_vertex_buffer == gl_buffer.gpu_object_name)
+            pipeline.vao_vertex_buffer = 0;
+
+        if (pipeline.vao_index_buffer == gl_buffer.gpu_object_name)
+            pipeline.vao_index_buffer = 0;
+    }
+
+    glDeleteBuffers(1, &gl_buffer.gpu_object_name);
+    gl_buffer = GlBuffer();
+    free_buffer_indices_.push_back(buffer.id - 1);
+}
+
+void GlRenderDevice::write_buffer(RhiBuffer buffer, u32 offset, const void* data, u32 size, bool discard)
+{
+    const GlBuffer& gl_buffer = buffers_[buffer.id - 1];
+
+    if (offset + size > gl_buffer.size)
+    {
+        DV_LOG->writef_error("{} | offset + size > gl_buffer.size", DV_FUNCSIG);
+        return;
+    }
+
+    glBindBuffer(GL_COPY_WRITE_BUFFER, gl_buffer.gpu_object_name);
+
+    // Orphaning: драйвер выделяет новую память, а старую освобождает, когда GPU её прочитает
+    if (discard)
+        glBufferData(GL_COPY_WRITE_BUFFER, gl_buffer.size, nullptr, gl_buffer.usage);
+
+    void* mapped = glMapBufferRange(GL_COPY_WRITE_BUFFER, offset, size,
+                                    GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+
+    if (mapped)
+    {
+        memcpy(mapped, data, size);
+        glUnmapBuffer(GL_COPY_WRITE_BUFFER);
+    }
+    else
+    {
+        glBufferSubData(GL_COPY_WRITE_BUFFER, offset, size, data);
+    }
+
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+}
+
+RhiTexture GlRenderDevice::create_texture(const Image& image)
+{
+    u32 index = alloc_index(textures_, free_texture_indices_);
+    GlTexture& texture = textures_[index];
+    texture.owned = make_unique<Texture>(image);
+    texture.texture = texture.owned.get();
+
+    return RhiTexture{index + 1};
+}
+
+RhiTexture GlRenderDevice::import_texture(Texture* texture)
+{
+    u32 index = alloc_index(textures_, free_texture_indices_);
+    textures_[index].texture = texture;
+
+    return RhiTexture{index + 1};
+}
+
+void GlRenderDevice::destroy_texture(RhiTexture texture)
+{
+    if (!texture)
+        return;
+
+    textures_[texture.id - 1] = GlTexture();
+    free_texture_indices_.push_back(texture.id - 1);
+}
+
+RhiShader GlRenderDevice::create_shader(const RhiShaderDesc& desc)
+{
+    // Программа остаётся в ShaderCache, поэтому одинаковые шейдеры собираются один раз
+    ShaderProgram* shader_program = DV_SHADER_CACHE->get(desc.vertex_shader_path, desc.fragment_shader_path);
+
+    if (!shader_program->gpu_object_name())
+    {
+        DV_LOG->writef_error("{} | !shader_program->gpu_object_name()", DV_FUNCSIG);
+        return RhiShader();
+    }
+
+    u32 index = alloc_index(shaders_, free_shader_indices_);
+    shaders_[index].shader_program = shader_program;
+
+    return RhiShader{index + 1};
+}
+
+void GlRenderDevice::destroy_shader(RhiShader shader)
+{
+    if (!shader)
+        return;
+
+    shaders_[shader.id - 1] = GlShader();
+    free_shader_indices_.push_back(shader.id - 1);
+}
+
+RhiPipeline GlRenderDevice::create_pipeline(const RhiPipelineDesc& desc)
+{
+    if (!desc.shader)
+    {
+        DV_LOG->writef_error("{} | !desc.shader", DV_FUNCSIG);
+        return RhiPipeline();
+    }
+
+    ShaderProgram* shader_program = shaders_[desc.shader.id - 1].shader_program;
+    GLuint program = shader_program->gpu_object_name();
+
+    // Привязки не меняются, поэтому задаём их один раз
+
+    for (size_t i = 0; i < desc.uniform_blocks.size(); ++i)
+    {
+        GLuint block_index = glGetUniformBlockIndex(program, desc.uniform_blocks[i].c_str());
+
+        if (block_index != GL_INVALID_INDEX)
+            glUniformBlockBinding(program, block_index, (GLuint)i);
+    }
+
+    shader_program->use();
+
+    for (size_t i = 0; i < desc.samplers.size(); ++i)
+        shader_program->set(desc.samplers[i], (GLint)i);
+
+    GlPipeline pipeline;
+    pipeline.shader_program = shader_program;
+    pipeline.attributes = desc.attributes;
+    pipeline.vertex_stride = desc.vertex_stride;
+    pipeline.primitive = to_gl_primitive(desc.primitive);
+    pipeline.blend_mode = desc.blend_mode;
+    pipeline.depth_test = desc.depth_test;
+
+    glGenVertexArrays(1, &pipeline.vao);
+
+    u32 index = alloc_index(pipelines_, free_pipeline_indices_);
+    pipelines_[index] = std::move(pipeline);
+
+    return RhiPipeline{index + 1};
+}
+
+void GlRenderDevice::destroy_pipeline(RhiPipeline pipeline)
+{
+    if (!pipeline)
+        return;
+
+    GlPipeline& gl_pipeline = pipelines_[pipeline.id - 1];
+    glDeleteVertexArrays(1, &gl_pipeline.vao);
+    gl_pipeline = GlPipeline();
+    free_pipeline_indices_.push_back(pipeline.id - 1);
+}
+
+void GlRenderDevice::apply_blend_mode(RhiBlendMode blend_mode)
+{
+    if (state_.blend_known && state_.blend_mode == blend_mode)
+        return;
+
+    switch (blend_mode)
+    {
+        case RhiBlendMode::opaque:
+            glDisable(GL_BLEND);
+            break;
+
+        case RhiBlendMode::alpha:
+            glEnable(GL_BLEND);
+            glBlendFuncSeparate(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA, GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
+            glBlendEquation(GL_FUNC_ADD);
+            break;
+
+        case RhiBlendMode::additive:
+            glEnable(GL_BLEND);
+            glBlendFunc(GL_ONE, GL_ONE);
+            glBlendEquation(GL_FUNC_ADD);
+            break;
+
+        case RhiBlendMode::premultiplied:
+            glEnable(GL_BLEND);
+            glBlendFunc(GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
+            glBlendEquation(GL_FUNC_ADD);
+            break;
+    }
+
+    state_.blend_known = true;
+    state_.blend_mode = blend_mode;
+}
+
+void GlRenderDevice::apply_depth_test(RhiDepthTest depth_test)
+{
+    if (state_.depth_test_known && state_.depth_test == depth_test)
+        return;
+
+    if (depth_test == RhiDepthTest::enabled)
+        glEnable(GL_DEPTH_TEST);
+    else
+        glDisable(GL_DEPTH_TEST);
+
+    state_.depth_test_known = true;
+    state_.depth_test = depth_test;
+}
+
+void GlRenderDevice::prepare_draw()
+{
+    GlPipeline* pipeline = state_.pipeline;
+
+    // VAO текущего конвейера уже привязан
+    if (pipeline->vao_vertex_buffer != state_.vertex_buffer)
+    {
+        glBindBuffer(GL_ARRAY_BUFFER, state_.vertex_buffer);
+
+        for (const RhiVertexAttribute& attribute : pipeline->attributes)
+            set_attribute_pointer(attribute, pipeline->vertex_stride);
+
+        pipeline->vao_vertex_buffer = state_.vertex_buffer;
+    }
+
+    if (pipeline->vao_index_buffer != state_.index_buffer)
+    {
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, state_.index_buffer);
+        pipeline->vao_index_buffer = state_.index_buffer;
+    }
+}
+
+void GlRenderDevice::execute(const CommandList& command_list)
+{
+    for (const RhiCommand& command : command_list.commands())
+    {
+        switch (command.type)
+        {
+            case RhiCommandType::set_viewport:
+                glViewport(command.rect.pos.x, command.rect.pos.y, command.rect.size.x, command.rect.size.y);
+                break;
+
+            case RhiCommandType::set_scissor:
+                if (command.rect.size.x <= 0 || command.rect.size.y <= 0)
+                {
+                    glDisable(GL_SCISSOR_TEST);
+                }
+                else
+                {
+                    glEnable(GL_SCISSOR_TEST);
+                    glScissor(command.rect.pos.x, command.rect.pos.y, command.rect.size.x, command.rect.size.y);
+                }
+                break;
+
+            case RhiCommandType::clear:
+                glClearColor(command.color.x, command.color.y, command.color.z, command.color.w);
+                glClear(GL_COLOR_BUFFER_BIT);
+                break;
+
+            case RhiCommandType::set_pipeline:
+            {
+                state_.pipeline = &pipelines_[command.pipeline.id - 1];
+
+                GLuint program = state_.pipeline->shader_program->gpu_object_name();
+
+                if (state_.program != program)
+                {
+                    glUseProgram(program);
+                    state_.program = program;
+                }
+
+                if (state_.vao != state_.pipeline->vao)
+                {
+                    glBindVertexArray(state_.pipeline->vao);
+                    state_.vao = state_.pipeline->vao;
+                }
+
+                apply_blend_mode(state_.pipeline->blend_mode);
+                apply_depth_test(state_.pipeline->depth_test);
+                break;
+            }
+
+            case RhiCommandType::set_vertex_buffer:
+                state_.vertex_buffer = buffers_[command.buffer.id - 1].gpu_object_name;
+                break;
+
+            case RhiCommandType::set_index_buffer:
+                state_.index_buffer = buffers_[command.buffer.id - 1].gpu_object_name;
+                state_.index_type = command.index_type == RhiIndexType::u16 ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+                break;
+
+            case RhiCommandType::set_uniform_buffer:
+                glBindBufferBase(GL_UNIFORM_BUFFER, command.slot, buffers_[command.buffer.id - 1].gpu_object_name);
+                break;
+
+            case RhiCommandType::set_texture:
+                glActiveTexture(GL_TEXTURE0 + command.slot);
+                textures_[command.texture.id - 1].texture->bind();
+                break;
+
+            case RhiCommandType::update_buffer:
+                glBindBuffer(GL_COPY_WRITE_BUFFER, buffers_[command.buffer.id - 1].gpu_object_name);
+                glBufferSubData(GL_COPY_WRITE_BUFFER, command.first, command.count, command_list.data() + command.data_offset);
+                break;
+
+            case RhiCommandType::draw:
+                prepare_draw();
+                glDrawArraysInstanced(state_.pipeline->primitive, command.first, command.count, command.num_instances);
+                draw_counters::add((i64)command.count * command.num_instances);
+                break;
+
+            case RhiCommandType::draw_indexed:
+            {
+                prepare_draw();
+                uintptr_t index_size = state_.index_type == GL_UNSIGNED_SHORT ? sizeof(u16) : sizeof(u32);
+                glDrawElementsInstancedBaseVertex(state_.pipeline->primitive, command.count, state_.index_type,
+                                                  (const void*)(command.first * index_size), command.num_instances,
+                                                  command.base_vertex);
+                draw_counters::add((i64)command.num_vertices * command.num_instances);
+                break;
+            }
+        }
+    }
+}
+
+void GlRenderDevice::submit(const CommandList* const* command_lists, i32 num_command_lists)
+{
+    GlDebugGroup debug_group("GlRenderDevice::submit");
+
+    // Код вне RHI мог изменить состояние OpenGL
+    state_ = {};
+
+    for (i32 i = 0; i < num_command_lists; ++i)
+        execute(*command_lists[i]);
+
+    // Код вне RHI может привязать индексный буфер, что изменило бы VAO конвейера.
+    // Остальные привязки сбрасываются, а не восстанавливаются
+    glBindVertexArray(0);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    glActiveTexture(GL_TEXTURE0);
+}
+
+} // namespace dviglo
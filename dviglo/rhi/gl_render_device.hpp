@@ -0,0 +1,120 @@
+// Copyright (c) the Dviglo project
+// License: MIT
+
+#pragma once
+
+#include "rhi.hpp"
+
+#include "../gl_utils/shader_program.hpp"
+#include "../gl_utils/texture.hpp"
+
+#include <memory>
+
+
+namespace dviglo
+{
+
+// Реализация RHI поверх OpenGL 3.3 и классов из gl_utils
+class GlRenderDevice : public RenderDevice
+{
+private:
+    struct GlBuffer
+    {
+        GLuint gpu_object_name = 0;
+        u32 size = 0; // В байтах
+        GLenum usage = GL_STATIC_DRAW;
+    };
+
+    struct GlTexture
+    {
+        Texture* texture = nullptr;
+        std::unique_ptr<Texture> owned; // nullptr для импортированных текстур
+    };
+
+    struct GlShader
+    {
+        ShaderProgram* shader_program = nullptr; // Из ShaderCache
+    };
+
+    struct GlPipeline
+    {
+        ShaderProgram* shader_program = nullptr;
+        GLuint vao = 0;
+
+        // Буферы, к которым сейчас привязаны атрибуты VAO. VAO хранит привязку между submit(),
+        // поэтому атрибуты настраиваются заново только при смене буфера
+        GLuint vao_vertex_buffer = 0;
+        GLuint vao_index_buffer = 0;
+
+        std::vector<RhiVertexAttribute> attributes;
+        u32 vertex_stride = 0;
+        GLenum primitive = GL_TRIANGLES;
+        RhiBlendMode blend_mode = RhiBlendMode::alpha;
+        RhiDepthTest depth_test = RhiDepthTest::disabled;
+    };
+
+    // Индекс - id дескриптора минус 1. Освобождённые элементы остаются пустыми,
+    // а их индексы переиспользуются
+    std::vector<GlBuffer> buffers_;
+    std::vector<GlTexture> textures_;
+    std::vector<GlShader> shaders_;
+    std::vector<GlPipeline> pipelines_;
+
+    std::vector<u32> free_buffer_indices_;
+    std::vector<u32> free_texture_indices_;
+    std::vector<u32> free_shader_indices_;
+    std::vector<u32> free_pipeline_indices_;
+
+    // Состояние OpenGL, заданное во время выполнения списков команд. Хранится на CPU, чтобы не повторять
+    // одинаковые вызовы и не запрашивать OpenGL. Код вне RHI меняет OpenGL между вызовами submit(),
+    // поэтому в начале submit() состояние считается неизвестным
+    struct
+    {
+        GlPipeline* pipeline = nullptr;
+        GLuint program = 0;
+        GLuint vao = 0;
+        GLuint vertex_buffer = 0;
+        GLuint index_buffer = 0;
+        GLenum index_type = GL_UNSIGNED_SHORT;
+
+        bool blend_known = false;
+        RhiBlendMode blend_mode = RhiBlendMode::opaque;
+
+        bool depth_test_known = false;
+        RhiDepthTest depth_test = RhiDepthTest::disabled;
+    } state_;
+
+    void apply_blend_mode(RhiBlendMode blend_mode);
+    void apply_depth_test(RhiDepthTest depth_test);
+
+    // Привязывает атрибуты и индексный буфер к VAO текущего конвейера, если они изменились
+    void prepare_draw();
+
+    void execute(const CommandList& command_list);
+
+public:
+    GlRenderDevice() = default;
+    ~GlRenderDevice() override;
+
+    GlRenderDevice(const GlRenderDevice&) = delete;
+    GlRenderDevice& operator=(const GlRenderDevice&) = delete;
+
+    RhiBuffer create_buffer(const RhiBufferDesc& desc) override;
+    void destroy_buffer(RhiBuffer buffer) override;
+    void write_buffer(RhiBuffer buffer, u32 offset, const void* data, u32 size, bool discard = false) override;
+
+    RhiTexture create_texture(const Image& image) override;
+    RhiTexture import_texture(Texture* texture) override;
+    void destroy_texture(RhiTexture texture) override;
+
+    RhiShader create_shader(const RhiShaderDesc& desc) override;
+    void destroy_shader(RhiShader shader) override;
+
+    RhiPipeline create_pipeline(const RhiPipelineDesc& desc) override;
+    void destroy_pipeline(RhiPipeline pipeline) override;
+
+    void submit(const CommandList* const* command_lists, i32 num_command_lists) override;
+    using RenderDevice::submit;
+};
+
+} // namespace dviglo
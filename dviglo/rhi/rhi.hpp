@@ -0,0 +1,281 @@
+// Copyright (c) the Dviglo project
+// License: MIT
+
+// Тонкий интерфейс рендеринга (RHI): буферы, текстуры, шейдеры, конвейеры и списки команд.
+// Ресурсы создаются через RenderDevice, а команды записываются в CommandList,
+// который не обращается к графическому API. Поэтому списки команд можно заполнять
+// в нескольких потоках одновременно, а выполнять в потоке рендеринга (RenderDevice::submit()).
+// Смешение и тест глубины - часть конвейера, поэтому для каждого режима создаётся свой конвейер.
+// Реализация для OpenGL - GlRenderDevice
+
+#pragma once
+
+#include "../math/rect.hpp"
+#include "../res/image.hpp"
+#include "../std_utils/string.hpp"
+
+#include <cassert>
+#include <vector>
+
+
+namespace dviglo
+{
+
+class Texture;
+
+// Дескриптор ресурса. 0 - пустой дескриптор
+template <typename Tag>
+struct RhiHandle
+{
+    u32 id = 0;
+
+    explicit operator bool() const { return id != 0; }
+    bool operator==(const RhiHandle& other) const { return id == other.id; }
+    bool operator!=(const RhiHandle& other) const { return id != other.id; }
+};
+
+using RhiBuffer = RhiHandle<struct RhiBufferTag>;
+using RhiTexture = RhiHandle<struct RhiTextureTag>;
+using RhiShader = RhiHandle<struct RhiShaderTag>;
+using RhiPipeline = RhiHandle<struct RhiPipelineTag>;
+
+enum class RhiBufferType : u8
+{
+    vertex,
+    index,
+    uniform
+};
+
+enum class RhiBufferUsage : u8
+{
+    static_draw,  // Заполняется один раз
+    dynamic_draw, // Часто обновляется
+    stream_draw   // Обновляется каждый кадр
+};
+
+struct RhiBufferDesc
+{
+    RhiBufferType type = RhiBufferType::vertex;
+    RhiBufferUsage usage = RhiBufferUsage::static_draw;
+    u32 size = 0; // В байтах
+    const void* data = nullptr; // Может быть nullptr
+    StrUtf8 label; // Имя в GPU-профайлерах
+};
+
+enum class RhiIndexType : u8
+{
+    u16,
+    u32
+};
+
+// Формат атрибута вершины
+enum class RhiVertexFormat : u8
+{
+    f32x1,
+    f32x2,
+    f32x3,
+    f32x4,
+    u8x4_norm, // Цвет 0xAABBGGRR
+    u32x1
+};
+
+struct RhiVertexAttribute
+{
+    u32 location;
+    RhiVertexFormat format;
+    u32 offset; // Смещение от начала вершины в байтах
+};
+
+enum class RhiPrimitive : u8
+{
+    triangles,
+    triangle_strip,
+    lines
+};
+
+enum class RhiBlendMode : u8
+{
+    opaque,
+    alpha,         // Альфа-смешение, как в SpriteBatch::prepare_ogl()
+    additive,
+    premultiplied  // Цвет уже умножен на альфу (например, содержимое RenderLayer)
+};
+
+// Число значений RhiBlendMode
+inline constexpr u32 num_rhi_blend_modes = 4;
+
+enum class RhiDepthTest : u8
+{
+    disabled,
+    enabled
+};
+
+// Вершинный и фрагментный шейдеры
+struct RhiShaderDesc
+{
+    StrUtf8 vertex_shader_path;
+    StrUtf8 fragment_shader_path;
+};
+
+struct RhiPipelineDesc
+{
+    RhiShader shader;
+
+    std::vector<RhiVertexAttribute> attributes;
+    u32 vertex_stride = 0;
+
+    RhiPrimitive primitive = RhiPrimitive::triangles;
+    RhiBlendMode blend_mode = RhiBlendMode::alpha;
+    RhiDepthTest depth_test = RhiDepthTest::disabled;
+
+    // Имена uniform-блоков и семплеров. Индекс - точка привязки
+    // в CommandList::set_uniform_buffer() и CommandList::set_texture()
+    std::vector<StrAscii> uniform_blocks;
+    std::vector<StrAscii> samplers;
+};
+
+// Команды в CommandList
+enum class RhiCommandType : u8
+{
+    set_viewport,       // IntRect
+    set_scissor,        // IntRect, размер 0 отключает scissor-тест
+    clear,              // Цвет
+    set_pipeline,
+    set_vertex_buffer,
+    set_index_buffer,   // Тип индексов
+    set_uniform_buffer, // Точка привязки
+    set_texture,        // Точка привязки
+    update_buffer,      // Смещение, размер, данные в data_ (см. также RenderDevice::write_buffer())
+    draw,
+    draw_indexed
+};
+
+// Команда. Поля, которые не нужны команде, не используются
+struct RhiCommand
+{
+    RhiCommandType type;
+    u32 slot = 0;
+    RhiIndexType index_type = RhiIndexType::u16;
+
+    RhiBuffer buffer{};
+    RhiTexture texture{};
+    RhiPipeline pipeline{};
+
+    IntRect rect{0, 0, 0, 0};
+    glm::vec4 color{0.f};
+
+    // draw: первая вершина и число вершин.
+    // draw_indexed: первый индекс, число индексов, число вершин и смещение вершин.
+    // update_buffer: смещение в буфере и размер
+    u32 first = 0;
+    u32 count = 0;
+    u32 num_vertices = 0;
+    i32 base_vertex = 0;
+    u32 num_instances = 1;
+
+    // update_buffer: смещение данных в CommandList::data()
+    u32 data_offset = 0;
+};
+
+// Список команд. Не обращается к графическому API, поэтому может заполняться в любом потоке.
+// Один список нельзя заполнять в нескольких потоках одновременно
+class CommandList
+{
+private:
+    std::vector<RhiCommand> commands_;
+
+    // Данные для update_buffer
+    std::vector<byte> data_;
+
+public:
+    const std::vector<RhiCommand>& commands() const { return commands_; }
+    const byte* data() const { return data_.data(); }
+    bool empty() const { return commands_.empty(); }
+
+    // Не освобождает память, чтобы список можно было переиспользовать каждый кадр
+    void reset();
+
+    void set_viewport(const IntRect& rect);
+
+    // Пустой прямоугольник отключает scissor-тест. Координаты как у вьюпорта
+    void set_scissor(const IntRect& rect);
+
+    void clear(const glm::vec4& color);
+
+    void set_pipeline(RhiPipeline pipeline);
+    void set_vertex_buffer(RhiBuffer buffer);
+    void set_index_buffer(RhiBuffer buffer, RhiIndexType type);
+    void set_uniform_buffer(u32 slot, RhiBuffer buffer);
+    void set_texture(u32 slot, RhiTexture texture);
+
+    // Данные копируются в список и загружаются в буфер при выполнении.
+    // В потоке рендеринга дешевле RenderDevice::write_buffer(), который пишет прямо в буфер
+    void update_buffer(RhiBuffer buffer, u32 offset, const void* data, u32 size);
+
+    void draw(u32 first_vertex, u32 num_vertices, u32 num_instances = 1);
+    // num_vertices - сколько вершин используют индексы. Нужно для счётчиков отрисовки,
+    // которые считают вершины, а не индексы
+    void draw_indexed(u32 first_index, u32 num_indices, u32 num_vertices, i32 base_vertex = 0, u32 num_instances = 1);
+};
+
+// Создаёт ресурсы и выполняет списки команд. Методы вызываются только в потоке рендеринга.
+// Создаётся в Application::main_init()
+class RenderDevice
+{
+private:
+    // Инициализируется в конструкторе
+    inline static RenderDevice* instance_ = nullptr;
+
+protected:
+    RenderDevice()
+    {
+        assert(!instance_);
+        instance_ = this;
+    }
+
+public:
+    static RenderDevice* instance() { return instance_; }
+
+    virtual ~RenderDevice()
+    {
+        instance_ = nullptr;
+    }
+
+    virtual RhiBuffer create_buffer(const RhiBufferDesc& desc) = 0;
+    virtual void destroy_buffer(RhiBuffer buffer) = 0;
+
+    // Сразу записывает данные в буфер, без копии в CommandList. GPU может ещё читать буфер,
+    // поэтому запись не синхронизируется: вызывающая сторона пишет по кольцу в неиспользованную часть буфера,
+    // а при переходе в начало передаёт discard == true (старое содержимое буфера отбрасывается)
+    virtual void write_buffer(RhiBuffer buffer, u32 offset, const void* data, u32 size, bool discard = false) = 0;
+
+    // Создаёт текстуру из изображения
+    virtual RhiTexture create_texture(const Image& image) = 0;
+
+    // Даёт доступ к существующей текстуре (например, из TextureCache). Владельцем остаётся вызывающая сторона
+    virtual RhiTexture import_texture(Texture* texture) = 0;
+
+    virtual void destroy_texture(RhiTexture texture) = 0;
+
+    // Возвращает пустой дескриптор, если не удалось собрать шейдеры
+    virtual RhiShader create_shader(const RhiShaderDesc& desc) = 0;
+    virtual void destroy_shader(RhiShader shader) = 0;
+
+    // Возвращает пустой дескриптор, если шейдер пустой
+    virtual RhiPipeline create_pipeline(const RhiPipelineDesc& desc) = 0;
+    virtual void destroy_pipeline(RhiPipeline pipeline) = 0;
+
+    // Выполняет списки в указанном порядке. Состояние, которое задают команды (вьюпорт, scissor-тест,
+    // цвет очистки, смешение и тест глубины конвейера), после выполнения не восстанавливается
+    virtual void submit(const CommandList* const* command_lists, i32 num_command_lists) = 0;
+
+    void submit(const CommandList& command_list)
+    {
+        const CommandList* ptr = &command_list;
+        submit(&ptr, 1);
+    }
+};
+
+#define DV_RENDER_DEVICE (dviglo::RenderDevice::instance())
+
+} // namespace dviglo
@@ -80,6 +80,19 @@ inline u64 to_u64(const StrUtf8& str)
     }
 }
 
+// Версия std::stod(), которая не вызывает исключений
+inline f64 to_f64(const StrUtf8& str)
+{
+    try
+    {
+        return std::stod(str);
+    }
+    catch (...)
+    {
+        return 0.0;
+    }
+}
+
 constexpr StrAscii replace_all(StrViewAscii str,
                                char old_ascii_c, char new_ascii_c,
                                bool case_sensitive = true)
@@ -0,0 +1,16 @@
+#version 330 core
+
+in vec4 v_color;
+in vec2 v_uv;
+in vec4 v_channel_mask;
+
+uniform sampler2D u_texture;
+
+out vec4 out_color;
+
+void main()
+{
+    // Покрытие глифа хранится в одном канале, цвет берётся из вершины
+    float coverage = dot(texture(u_texture, v_uv), v_channel_mask);
+    out_color = vec4(v_color.rgb, v_color.a * coverage);
+}
@@ -0,0 +1,22 @@
+#version 330 core
+
+// Отладочные режимы SpriteBatch. Подходит для вершин любого вида, так как позиция всегда первый атрибут
+
+layout (location = 0) in vec2 a_position; // В пикселях, ось Y направлена вниз
+layout (location = 3) in float a_depth; // Используется, только если u_use_depth == true
+
+uniform vec2 u_pixel_size; // 2 / размер_вьюпорта
+uniform bool u_flip_vertically;
+uniform bool u_use_depth;
+
+void main()
+{
+    // Переводим пиксели в NDC
+    vec2 pos = a_position * u_pixel_size - 1.0;
+
+    if (!u_flip_vertically)
+        pos.y = -pos.y;
+
+    float depth = u_use_depth ? a_depth * 2.0 - 1.0 : 0.0;
+    gl_Position = vec4(pos, depth, 1.0);
+}
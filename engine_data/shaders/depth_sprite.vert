@@ -0,0 +1,27 @@
+#version 330 core
+
+// Спрайты в сцене с буфером глубины (SpriteBatch::begin_depth_scene())
+
+layout (location = 0) in vec2 a_position; // В пикселях, ось Y направлена вниз
+layout (location = 1) in vec4 a_color;
+layout (location = 2) in vec2 a_uv;
+layout (location = 3) in float a_depth; // [0, 1], 0 - ближе всего к камере
+
+uniform vec2 u_pixel_size; // 2 / размер_вьюпорта
+uniform bool u_flip_vertically;
+
+out vec4 v_color;
+out vec2 v_uv;
+
+void main()
+{
+    // Переводим пиксели в NDC
+    vec2 pos = a_position * u_pixel_size - 1.0;
+
+    if (!u_flip_vertically)
+        pos.y = -pos.y;
+
+    gl_Position = vec4(pos, a_depth * 2.0 - 1.0, 1.0);
+    v_color = a_color;
+    v_uv = a_uv;
+}
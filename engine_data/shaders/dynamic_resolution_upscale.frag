@@ -0,0 +1,38 @@
+#version 330 core
+
+// Растягивает сцену с повышением резкости. Усиление уменьшается на контрастных краях,
+// чтобы не появлялись ореолы (как в AMD FidelityFX CAS)
+
+in vec2 v_uv;
+
+uniform sampler2D u_texture;
+uniform vec2 u_texel_size; // 1 / размер_текстуры
+uniform vec2 u_uv_min; // Центры крайних текселей сцены, за которые нельзя выходить
+uniform vec2 u_uv_max;
+uniform float u_sharpness; // От 0 (только растягивание) до 1
+
+out vec4 out_color;
+
+vec3 fetch(vec2 uv)
+{
+    return texture(u_texture, clamp(uv, u_uv_min, u_uv_max)).rgb;
+}
+
+void main()
+{
+    vec3 c = fetch(v_uv);
+    vec3 n = fetch(v_uv + vec2(0.0, u_texel_size.y));
+    vec3 s = fetch(v_uv - vec2(0.0, u_texel_size.y));
+    vec3 e = fetch(v_uv + vec2(u_texel_size.x, 0.0));
+    vec3 w = fetch(v_uv - vec2(u_texel_size.x, 0.0));
+
+    vec3 min_rgb = min(c, min(min(n, s), min(e, w)));
+    vec3 max_rgb = max(c, max(max(n, s), max(e, w)));
+
+    // Чем ближе соседи к границам диапазона, тем слабее усиление
+    vec3 amp = sqrt(clamp(min(min_rgb, 1.0 - max_rgb) / max(max_rgb, 1e-4), 0.0, 1.0));
+    vec3 weight = -amp * (u_sharpness * 0.2);
+
+    vec3 color = (c + (n + s + e + w) * weight) / (1.0 + 4.0 * weight);
+    out_color = vec4(clamp(color, 0.0, 1.0), 1.0);
+}
@@ -0,0 +1,16 @@
+#version 330 core
+
+// Полноэкранный треугольник без вершинного буфера (DynamicResolution, LightMap)
+
+uniform vec2 u_uv_scale; // Доля текстуры, в которую нарисована сцена
+
+out vec2 v_uv;
+
+void main()
+{
+    // Вершины (0, 0), (2, 0), (0, 2) покрывают весь экран
+    vec2 corner = vec2((gl_VertexID << 1) & 2, gl_VertexID & 2);
+
+    gl_Position = vec4(corner * 2.0 - 1.0, 0.0, 1.0);
+    v_uv = corner * u_uv_scale;
+}
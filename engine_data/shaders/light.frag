@@ -0,0 +1,13 @@
+#version 330 core
+
+in vec2 v_local;
+flat in float v_falloff;
+flat in vec3 v_color;
+
+out vec4 out_color;
+
+void main()
+{
+    float attenuation = pow(max(1.0 - length(v_local), 0.0), v_falloff);
+    out_color = vec4(v_color * attenuation, 0.0);
+}
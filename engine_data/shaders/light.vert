@@ -0,0 +1,28 @@
+#version 330 core
+
+// Источник света LightMap. Каждый экземпляр - один источник, 4 вершины рисуются как GL_TRIANGLE_STRIP
+
+layout (location = 0) in vec2 a_position; // Центр в пикселях, ось Y направлена вниз
+layout (location = 1) in float a_radius;
+layout (location = 2) in float a_falloff;
+layout (location = 3) in vec4 a_color; // Уже умножен на яркость
+
+uniform vec2 u_pixel_size; // 2 / логический_размер_вьюпорта
+
+out vec2 v_local; // От -1 до 1 внутри описанного квадрата
+flat out float v_falloff;
+flat out vec3 v_color;
+
+void main()
+{
+    // Угол четырёхугольника: (0, 0), (1, 0), (0, 1), (1, 1)
+    vec2 corner = vec2(gl_VertexID & 1, gl_VertexID >> 1);
+    v_local = corner * 2.0 - 1.0;
+
+    // Переводим пиксели в NDC
+    vec2 pos = (a_position + v_local * a_radius) * u_pixel_size - 1.0;
+    gl_Position = vec4(pos.x, -pos.y, 0.0, 1.0);
+
+    v_falloff = a_falloff;
+    v_color = a_color.rgb;
+}
@@ -0,0 +1,14 @@
+#version 330 core
+
+// Наложение карты освещения на сцену. Умножение выполняется смешением GL_DST_COLOR, GL_ZERO
+
+in vec2 v_uv;
+
+uniform sampler2D u_texture;
+
+out vec4 out_color;
+
+void main()
+{
+    out_color = vec4(texture(u_texture, v_uv).rgb, 1.0);
+}
@@ -0,0 +1,7 @@
+#version 330 core
+
+// Тени пишутся только в буфер трафарета
+
+void main()
+{
+}
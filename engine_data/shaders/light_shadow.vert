@@ -0,0 +1,21 @@
+#version 330 core
+
+// Тень ребра препятствия. Дальние вершины ребра вытягиваются от источника света
+// за пределы его радиуса, образуя четырёхугольник тени
+
+layout (location = 0) in vec2 a_position; // В пикселях, ось Y направлена вниз
+layout (location = 1) in float a_extrude; // 0 - вершина ребра, 1 - вытянутая вершина
+
+uniform vec2 u_pixel_size; // 2 / логический_размер_вьюпорта
+uniform vec2 u_light_pos;
+uniform float u_extrude_distance;
+
+void main()
+{
+    vec2 dir = a_position - u_light_pos;
+    vec2 world = a_position + normalize(dir + 1e-6) * u_extrude_distance * a_extrude;
+
+    // Переводим пиксели в NDC
+    vec2 pos = world * u_pixel_size - 1.0;
+    gl_Position = vec4(pos.x, -pos.y, 0.0, 1.0);
+}
@@ -0,0 +1,44 @@
+#version 430 core
+
+in vec4 v_color;
+in vec2 v_uv;
+flat in uint v_texture_slot;
+
+// Размер совпадает с SpriteBatch::max_textures_in_portion_
+uniform sampler2D u_textures[16];
+
+out vec4 out_color;
+
+// Индексировать массив семплеров можно только динамически однородным выражением, а фрагменты
+// из разных команд glMultiDrawElementsIndirect() могут попасть в одну волну. Поэтому каждая ветка
+// обращается к семплеру по константному индексу. Все фрагменты четвёрки пикселей принадлежат
+// одному треугольнику и идут по одной ветке, так что производные для выбора мипа корректны
+vec4 sample_slot(uint slot, vec2 uv)
+{
+    switch (slot)
+    {
+        case 0u: return texture(u_textures[0], uv);
+        case 1u: return texture(u_textures[1], uv);
+        case 2u: return texture(u_textures[2], uv);
+        case 3u: return texture(u_textures[3], uv);
+        case 4u: return texture(u_textures[4], uv);
+        case 5u: return texture(u_textures[5], uv);
+        case 6u: return texture(u_textures[6], uv);
+        case 7u: return texture(u_textures[7], uv);
+        case 8u: return texture(u_textures[8], uv);
+        case 9u: return texture(u_textures[9], uv);
+        case 10u: return texture(u_textures[10], uv);
+        case 11u: return texture(u_textures[11], uv);
+        case 12u: return texture(u_textures[12], uv);
+        case 13u: return texture(u_textures[13], uv);
+        case 14u: return texture(u_textures[14], uv);
+        case 15u: return texture(u_textures[15], uv);
+    }
+
+    return vec4(0.0);
+}
+
+void main()
+{
+    out_color = sample_slot(v_texture_slot, v_uv) * v_color;
+}
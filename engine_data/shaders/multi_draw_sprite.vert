@@ -0,0 +1,30 @@
+#version 430 core
+
+// Спрайты, которые выводятся одним вызовом glMultiDrawElementsIndirect() с разными текстурами.
+// Номер текстуры берётся из атрибута экземпляра, который выбирается полем baseInstance команды отрисовки
+
+layout (location = 0) in vec2 a_position; // В пикселях, ось Y направлена вниз
+layout (location = 1) in vec4 a_color;
+layout (location = 2) in vec2 a_uv;
+layout (location = 4) in uint a_texture_slot;
+
+uniform vec2 u_pixel_size; // 2 / размер_вьюпорта
+uniform bool u_flip_vertically;
+
+out vec4 v_color;
+out vec2 v_uv;
+flat out uint v_texture_slot;
+
+void main()
+{
+    // Переводим пиксели в NDC
+    vec2 pos = a_position * u_pixel_size - 1.0;
+
+    if (!u_flip_vertically)
+        pos.y = -pos.y;
+
+    gl_Position = vec4(pos, 0.0, 1.0);
+    v_color = a_color;
+    v_uv = a_uv;
+    v_texture_slot = a_texture_slot;
+}
@@ -0,0 +1,29 @@
+#version 330 core
+
+in vec2 v_uv;
+
+uniform sampler2D u_texture;
+
+out vec4 out_color;
+
+// Число перерисовок пикселя -> цвет
+const vec3 colors[7] = vec3[7](
+    vec3(0.0, 0.0, 0.0),  // 0
+    vec3(0.0, 0.0, 0.6),  // 1
+    vec3(0.0, 0.7, 0.0),  // 2
+    vec3(0.9, 0.9, 0.0),  // 3
+    vec3(1.0, 0.5, 0.0),  // 4
+    vec3(1.0, 0.0, 0.0),  // 5-7
+    vec3(1.0, 1.0, 1.0)   // 8 и больше
+);
+
+void main()
+{
+    // Каждый слой добавлял 1/255
+    float count = texture(u_texture, v_uv).r * 255.0;
+
+    if (count < 5.0)
+        out_color = vec4(mix(colors[int(count)], colors[int(count) + 1], fract(count)), 1.0);
+    else
+        out_color = vec4(mix(colors[5], colors[6], clamp((count - 5.0) / 3.0, 0.0, 1.0)), 1.0);
+}
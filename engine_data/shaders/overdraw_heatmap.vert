@@ -0,0 +1,22 @@
+#version 330 core
+
+layout (location = 0) in vec2 a_position; // В пикселях, ось Y направлена вниз
+layout (location = 1) in vec4 a_color;
+layout (location = 2) in vec2 a_uv;
+
+uniform vec2 u_pixel_size; // 2 / размер_вьюпорта
+uniform bool u_flip_vertically;
+
+out vec2 v_uv;
+
+void main()
+{
+    // Переводим пиксели в NDC
+    vec2 pos = a_position * u_pixel_size - 1.0;
+
+    if (!u_flip_vertically)
+        pos.y = -pos.y;
+
+    gl_Position = vec4(pos, 0.0, 1.0);
+    v_uv = a_uv;
+}
@@ -0,0 +1,59 @@
+#version 330 core
+
+// Значения должны совпадать с SpriteBatch::shape_kind_box и SpriteBatch::shape_kind_arc
+const float shape_kind_box = 0.0;
+
+// Должно совпадать с SpriteBatch::shape_margin_
+const float shape_margin = 1.0;
+
+const float pi = 3.14159265;
+
+in vec4 v_color;
+in vec2 v_local_pos;
+flat in vec2 v_half_size;
+flat in vec4 v_params;
+
+out vec4 out_color;
+
+// Прямоугольник со скруглёнными углами. https://iquilezles.org/articles/distfunctions2d/
+float sd_rounded_box(vec2 p, vec2 half_size, float radius)
+{
+    vec2 q = abs(p) - half_size + radius;
+    return length(max(q, 0.0)) + min(max(q.x, q.y), 0.0) - radius;
+}
+
+// Дуга, симметричная относительно оси Y. https://iquilezles.org/articles/distfunctions2d/
+float sd_arc(vec2 p, float half_angle, float radius, float thickness)
+{
+    vec2 sc = vec2(sin(half_angle), cos(half_angle));
+    p.x = abs(p.x);
+    float d = (sc.y * p.x > sc.x * p.y) ? length(p - sc * radius) : abs(length(p) - radius);
+    return d - thickness * 0.5;
+}
+
+void main()
+{
+    float d;
+
+    if (v_params.x == shape_kind_box)
+    {
+        d = sd_rounded_box(v_local_pos, v_half_size - shape_margin, v_params.y);
+
+        // Только обводка внутрь фигуры
+        if (v_params.z > 0.0)
+            d = abs(d + v_params.z * 0.5) - v_params.z * 0.5;
+    }
+    else // shape_kind_arc
+    {
+        d = sd_arc(v_local_pos, min(v_params.w, pi), v_params.y, v_params.z);
+    }
+
+    // Аналитическое сглаживание: ширина перехода - примерно один пиксель экрана
+    float aa = max(fwidth(d), 0.0001);
+    float coverage = clamp(0.5 - d / aa, 0.0, 1.0);
+
+    if (coverage <= 0.0)
+        discard;
+
+    out_color = vec4(v_color.rgb, v_color.a * coverage);
+}
@@ -0,0 +1,31 @@
+#version 330 core
+
+// Фигуры SpriteBatch (круг, кольцо, прямоугольник со скруглёнными углами, линия, дуга)
+
+layout (location = 0) in vec2 a_position; // В пикселях, ось Y направлена вниз
+layout (location = 1) in vec4 a_color;
+layout (location = 2) in vec2 a_local_pos; // От центра фигуры, в пикселях
+layout (location = 3) in vec4 a_params;
+
+uniform vec2 u_pixel_size; // 2 / размер_вьюпорта
+uniform bool u_flip_vertically;
+
+out vec4 v_color;
+out vec2 v_local_pos;
+flat out vec2 v_half_size; // Половина размера четырёхугольника
+flat out vec4 v_params;
+
+void main()
+{
+    // Переводим пиксели в NDC
+    vec2 pos = a_position * u_pixel_size - 1.0;
+
+    if (!u_flip_vertically)
+        pos.y = -pos.y;
+
+    gl_Position = vec4(pos, 0.0, 1.0);
+    v_color = a_color;
+    v_local_pos = a_local_pos;
+    v_half_size = abs(a_local_pos); // Одинаково у всех вершин
+    v_params = a_params;
+}
@@ -0,0 +1,38 @@
+#version 330 core
+
+// Спрайты SpriteSet. Каждый экземпляр - один спрайт, 4 вершины рисуются как GL_TRIANGLE_STRIP
+
+layout (location = 0) in vec2 a_position; // Центр спрайта в пикселях, ось Y направлена вниз
+layout (location = 1) in vec2 a_size;
+layout (location = 2) in vec2 a_uv_min;
+layout (location = 3) in vec2 a_uv_max;
+layout (location = 4) in vec4 a_color;
+layout (location = 5) in float a_rotation; // В радианах, по часовой стрелке
+
+uniform vec2 u_view_pos; // Левый верхний угол видимой области
+uniform vec2 u_pixel_size; // 2 / размер_вьюпорта
+uniform bool u_flip_vertically;
+
+out vec4 v_color;
+out vec2 v_uv;
+
+void main()
+{
+    // Угол четырёхугольника: (0, 0), (1, 0), (0, 1), (1, 1)
+    vec2 corner = vec2(gl_VertexID & 1, gl_VertexID >> 1);
+
+    vec2 local = (corner - 0.5) * a_size;
+    float s = sin(a_rotation);
+    float c = cos(a_rotation);
+    vec2 world = a_position + vec2(local.x * c - local.y * s, local.x * s + local.y * c);
+
+    // Переводим пиксели в NDC
+    vec2 pos = (world - u_view_pos) * u_pixel_size - 1.0;
+
+    if (!u_flip_vertically)
+        pos.y = -pos.y;
+
+    gl_Position = vec4(pos, 0.0, 1.0);
+    v_color = a_color;
+    v_uv = mix(a_uv_min, a_uv_max, corner);
+}
@@ -0,0 +1,108 @@
+// Copyright (c) the Dviglo project
+// License: MIT
+
+// World: перенос сущностей между архетипами и удаление строк из чанков
+
+#include "test_utils.hpp"
+
+#include <dviglo/ecs/components_2d.hpp>
+#include <dviglo/ecs/sprite_systems.hpp>
+
+using namespace dviglo;
+using namespace glm;
+using namespace std;
+
+
+// Номер сущности хранится в компоненте, чтобы проверять, что данные переносятся вместе с сущностью
+struct Tag
+{
+    i32 value;
+};
+
+int main()
+{
+    Log log("test_ecs_world.log");
+
+    World world;
+
+    // Несколько чанков в каждом архетипе
+    constexpr i32 num_entities = 5000;
+    vector<Entity> entities;
+
+    for (i32 i = 0; i < num_entities; ++i)
+    {
+        if (i % 2)
+            entities.push_back(world.create(Tag{i}, Position2d{vec2((f32)i, 0.f)}, Velocity2d{vec2(1.f, 2.f)}));
+        else
+            entities.push_back(world.create(Tag{i}, Position2d{vec2((f32)i, 0.f)}));
+    }
+
+    DV_TEST_CHECK(world.num_entities() == num_entities);
+
+    // move_entity(): добавление и удаление компонента переносит строку в другой архетип
+    for (i32 i = 0; i < num_entities; i += 4)
+        world.add(entities[i], Velocity2d{vec2(1.f, 2.f)});
+
+    for (i32 i = 1; i < num_entities; i += 4)
+        world.remove<Velocity2d>(entities[i]);
+
+    // remove_row(): на место удалённой строки переносится последняя строка чанка
+    Entity last_destroyed;
+
+    for (i32 i = 0; i < num_entities; i += 3)
+    {
+        world.destroy(entities[i]);
+        last_destroyed = entities[i];
+        DV_TEST_CHECK(!world.alive(entities[i]));
+    }
+
+    i32 num_alive = 0;
+
+    for (i32 i = 0; i < num_entities; ++i)
+    {
+        if (i % 3 == 0)
+        {
+            DV_TEST_CHECK(world.get<Tag>(entities[i]) == nullptr);
+            continue;
+        }
+
+        ++num_alive;
+        DV_TEST_CHECK(world.alive(entities[i]));
+        DV_TEST_CHECK(world.get<Tag>(entities[i])->value == i);
+        DV_TEST_CHECK(world.get<Position2d>(entities[i])->value == vec2((f32)i, 0.f));
+
+        bool has_velocity = i % 4 == 0 || i % 4 == 3;
+        DV_TEST_CHECK(world.has<Velocity2d>(entities[i]) == has_velocity);
+    }
+
+    DV_TEST_CHECK(world.num_entities() == num_alive);
+
+    // Каждая сущность перебирается ровно один раз, в том числе параллельно
+    i32 num_visited = 0;
+    world.for_each<const Tag>([&](Entity, const Tag&) { ++num_visited; });
+    DV_TEST_CHECK(num_visited == num_alive);
+
+    WorkerPool workers(4);
+    move_entities(world, 0.5f, workers);
+
+    for (i32 i = 0; i < num_entities; ++i)
+    {
+        if (i % 3 == 0)
+            continue;
+
+        vec2 expected((f32)i, 0.f);
+
+        if (world.has<Velocity2d>(entities[i]))
+            expected += vec2(0.5f, 1.f);
+
+        DV_TEST_CHECK(world.get<Position2d>(entities[i])->value == expected);
+    }
+
+    // Индекс удалённой сущности используется повторно с новым поколением
+    Entity reused = world.create(Tag{-1});
+    DV_TEST_CHECK(reused.index == last_destroyed.index);
+    DV_TEST_CHECK(!world.alive(last_destroyed));
+    DV_TEST_CHECK(world.get<Tag>(reused)->value == -1);
+
+    return 0;
+}
@@ -0,0 +1,56 @@
+// Copyright (c) the Dviglo project
+// License: MIT
+
+// Поиск встроенных файлов по виртуальным путям
+
+#include "test_utils.hpp"
+
+#include <dviglo/fs/embedded_files.hpp>
+
+using namespace dviglo;
+using namespace std;
+
+
+int main()
+{
+    Log log("test_embedded_files.log");
+
+    DV_TEST_CHECK(is_embedded_path(":/engine_data/shaders/sprite_cull.comp"));
+    DV_TEST_CHECK(!is_embedded_path("engine_data/shaders/sprite_cull.comp"));
+
+    // Обычные пути не ищутся и не меняются
+    DV_TEST_CHECK(find_embedded_file("engine_data/shaders/sprite_cull.comp") == nullptr);
+    DV_TEST_CHECK(to_disk_path("some/file.txt") == "some/file.txt");
+    DV_TEST_CHECK(to_disk_path(":/engine_data/shaders/sprite_cull.comp").ends_with("engine_data/shaders/sprite_cull.comp"));
+
+    span<const EmbeddedFile> files = get_embedded_files();
+
+#ifdef DV_EMBED_ENGINE_DATA
+    DV_TEST_CHECK(!files.empty());
+
+    // find_embedded_file() использует двоичный поиск
+    for (size_t i = 1; i < files.size(); ++i)
+        DV_TEST_CHECK(StrViewUtf8(files[i - 1].path) < StrViewUtf8(files[i].path));
+
+    // Каждый файл находится по своему виртуальному пути
+    for (const EmbeddedFile& file : files)
+    {
+        StrUtf8 path = StrUtf8(embedded_prefix) + file.path;
+        DV_TEST_CHECK(find_embedded_file(path) == &file);
+    }
+
+    const EmbeddedFile* shader = find_embedded_file(":/engine_data/shaders/sprite_cull.comp");
+    DV_TEST_CHECK(shader);
+    DV_TEST_CHECK(shader->size > 0);
+    DV_TEST_CHECK(StrViewUtf8((const char*)shader->data, shader->size).starts_with("#version"));
+#else
+    DV_TEST_CHECK(files.empty());
+#endif
+
+    // Файла нет, и префикс пути тоже не должен совпадать с существующим файлом
+    DV_TEST_CHECK(find_embedded_file(":/engine_data/shaders/no_such_file.comp") == nullptr);
+    DV_TEST_CHECK(find_embedded_file(":/engine_data/shaders/sprite_cull.com") == nullptr);
+    DV_TEST_CHECK(find_embedded_file(":/") == nullptr);
+
+    return 0;
+}
@@ -0,0 +1,78 @@
+// Copyright (c) the Dviglo project
+// License: MIT
+
+// encode_png(): PNG декодируется обратно через stb_image и сравнивается с исходными пикселями
+
+#include "test_utils.hpp"
+
+#include <dviglo/res/png_encoder.hpp>
+
+#include <stb_image.h>
+
+#include <cstring> // memcmp
+
+using namespace dviglo;
+using namespace glm;
+using namespace std;
+
+
+// Пиксели, которые плохо предсказываются фильтрами строк, с плавными участками
+static Image make_image(ivec2 size, i32 num_components)
+{
+    Image image(size, num_components);
+    u8* data = image.data();
+    u32 state = 12345;
+
+    for (i32 i = 0; i < size.x * size.y * num_components; ++i)
+    {
+        state = state * 1664525u + 1013904223u;
+        data[i] = (i % 7 == 0) ? (u8)(state >> 24) : (u8)(i / num_components);
+    }
+
+    return image;
+}
+
+static void check_round_trip(const ImageView& view, PngCompression compression, i32 max_threads)
+{
+    vector<byte> png = encode_png(view, compression, max_threads);
+    DV_TEST_CHECK(!png.empty());
+
+    ivec2 size;
+    i32 num_components;
+    u8* decoded = stbi_load_from_memory((const u8*)png.data(), (i32)png.size(), &size.x, &size.y, &num_components, 0);
+    DV_TEST_CHECK(decoded);
+    DV_TEST_CHECK(size == view.size);
+    DV_TEST_CHECK(num_components == view.num_components);
+
+    i32 line_size = view.size.x * view.num_components;
+
+    for (i32 y = 0; y < view.size.y; ++y)
+        DV_TEST_CHECK(memcmp(decoded + y * line_size, view.line_ptr(y), line_size) == 0);
+
+    stbi_image_free(decoded);
+}
+
+int main()
+{
+    Log log("test_png_encoder.log");
+
+    for (PngCompression compression : {PngCompression::fast, PngCompression::normal, PngCompression::best})
+    {
+        for (i32 num_components = 1; num_components <= 4; ++num_components)
+        {
+            // Маленькое изображение с нечётным размером - одна полоса
+            Image small = make_image(ivec2(37, 19), num_components);
+            check_round_trip(small.view(), compression, 0);
+
+            // Большое изображение делится на полосы, которые сжимаются в разных потоках
+            Image large = make_image(ivec2(700, 600), num_components);
+            check_round_trip(large.view(), compression, 4);
+            check_round_trip(large.view(), compression, 1);
+
+            // Часть изображения: stride больше ширины строки
+            check_round_trip(large.view(IntRect(13, 7, 300, 500)), compression, 4);
+        }
+    }
+
+    return 0;
+}
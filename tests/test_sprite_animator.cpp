@@ -0,0 +1,88 @@
+// Copyright (c) the Dviglo project
+// License: MIT
+
+// SpriteAnimator: смена кадров по времени, повтор, скорость и проверка AnimId
+
+#include "test_utils.hpp"
+
+#include <dviglo/graphics/sprite_animator.hpp>
+
+using namespace dviglo;
+using namespace glm;
+using namespace std;
+
+using AnimId = SpriteAnimator::AnimId;
+
+static constexpr i64 ms = 1'000'000;
+
+
+int main()
+{
+    Log log("test_sprite_animator.log");
+
+    AnimationLibrary library;
+
+    // 10 кадров в секунду - 100 мс на кадр
+    vector<Rect> frames(4, Rect(vec2(0.f), vec2(16.f)));
+    i32 run = library.add_clip("run", frames, 10.f, true);
+    i32 die = library.add_clip("die", vector<Rect>(3, Rect(vec2(0.f), vec2(8.f))), 10.f, false);
+    DV_TEST_CHECK(run == 0);
+    DV_TEST_CHECK(die == 1);
+    DV_TEST_CHECK(library.clip(die).first_frame == 4);
+    DV_TEST_CHECK(library.add_clip("run", frames, 10.f) == -1);
+    DV_TEST_CHECK((i32)library.frame_uv_mins().size() == 7);
+
+    SpriteAnimator animator(&library);
+    AnimId a = animator.add(run);
+    AnimId b = animator.add(die);
+    AnimId fast = animator.add(run, 2.f);
+
+    animator.update(250 * ms);
+    DV_TEST_CHECK(animator.frame(a) == 2);
+    DV_TEST_CHECK(animator.frame(b) == 4 + 2);
+    DV_TEST_CHECK(animator.frame(fast) == 1); // 500 мс, цикл 400 мс
+
+    // Повторяющаяся анимация начинается заново, неповторяющаяся останавливается на последнем кадре
+    animator.update(200 * ms);
+    DV_TEST_CHECK(animator.frame(a) == 0);
+    DV_TEST_CHECK(!animator.finished(a));
+    DV_TEST_CHECK(animator.frame(b) == 4 + 2);
+    DV_TEST_CHECK(animator.finished(b));
+
+    // Та же анимация без restart продолжается, с restart - начинается сначала
+    animator.play(a, run);
+    DV_TEST_CHECK(animator.frame(a) == 0);
+    animator.update(100 * ms);
+    DV_TEST_CHECK(animator.frame(a) == 1);
+    animator.play(a, run, true);
+    DV_TEST_CHECK(animator.frame(a) == 0);
+
+    animator.play(a, die);
+    DV_TEST_CHECK(animator.clip(a) == die);
+    DV_TEST_CHECK(animator.frame(a) == 4);
+
+    // Удалённый слот используется повторно, а обращения к удалённой анимации отклоняются
+    animator.remove(b);
+    DV_TEST_CHECK(!animator.alive(b));
+    DV_TEST_CHECK(animator.clip(b) == -1);
+    DV_TEST_CHECK(animator.frame(b) == -1);
+
+    i64 num_messages = log.num_messages();
+    animator.play(b, run);
+    animator.set_speed(b, 1.f);
+    animator.play(-1, run);
+    animator.play(animator.size(), run);
+    DV_TEST_CHECK(log.num_messages() == num_messages + 4);
+    DV_TEST_CHECK(!animator.alive(b));
+
+    AnimId c = animator.add(run);
+    DV_TEST_CHECK(c == b);
+    DV_TEST_CHECK(animator.frame(c) == 0);
+
+    // Нулевая скорость останавливает анимацию
+    animator.set_speed(c, 0.f);
+    animator.update(1000 * ms);
+    DV_TEST_CHECK(animator.frame(c) == 0);
+
+    return 0;
+}
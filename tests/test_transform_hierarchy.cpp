@@ -0,0 +1,106 @@
+// Copyright (c) the Dviglo project
+// License: MIT
+
+// TransformHierarchy: распространение изменений и пересчёт только изменённых поддеревьев
+
+#include "test_utils.hpp"
+
+#include <dviglo/graphics/transform_hierarchy.hpp>
+
+#include <cmath> // abs
+
+using namespace dviglo;
+using namespace glm;
+using namespace std;
+
+using NodeId = TransformHierarchy::NodeId;
+
+
+static bool nearly_equal(vec2 a, vec2 b)
+{
+    return abs(a.x - b.x) < 0.001f && abs(a.y - b.y) < 0.001f;
+}
+
+int main()
+{
+    Log log("test_transform_hierarchy.log");
+
+    TransformHierarchy hierarchy;
+
+    NodeId root = hierarchy.create(TransformHierarchy::null_node, Affine2d::from_trs(vec2(100.f, 0.f)));
+    NodeId child = hierarchy.create(root, Affine2d::from_trs(vec2(10.f, 0.f), 0.f, vec2(2.f)));
+    NodeId grandchild = hierarchy.create(child, Affine2d::from_trs(vec2(1.f, 1.f)));
+
+    hierarchy.update();
+    DV_TEST_CHECK(hierarchy.last_update_count() == 3);
+    DV_TEST_CHECK(nearly_equal(hierarchy.world_position(root), vec2(100.f, 0.f)));
+    DV_TEST_CHECK(nearly_equal(hierarchy.world_position(child), vec2(110.f, 0.f)));
+    DV_TEST_CHECK(nearly_equal(hierarchy.world_position(grandchild), vec2(112.f, 2.f)));
+
+    // Без изменений ничего не пересчитывается
+    hierarchy.update();
+    DV_TEST_CHECK(hierarchy.last_update_count() == 0);
+
+    // Изменение корня доходит до всех потомков
+    hierarchy.set_local(root, vec2(200.f, 0.f));
+    hierarchy.update();
+    DV_TEST_CHECK(hierarchy.last_update_count() == 3);
+    DV_TEST_CHECK(nearly_equal(hierarchy.world_position(grandchild), vec2(212.f, 2.f)));
+
+    // Изменение листа не трогает родителей
+    hierarchy.set_local(grandchild, vec2(2.f, 0.f));
+    hierarchy.update();
+    DV_TEST_CHECK(hierarchy.last_update_count() == 1);
+    DV_TEST_CHECK(nearly_equal(hierarchy.world_position(grandchild), vec2(214.f, 0.f)));
+
+    // После перестроения порядка пересчитывается только новое поддерево
+    NodeId other_root = hierarchy.create(TransformHierarchy::null_node, Affine2d::from_trs(vec2(0.f, 50.f)));
+    NodeId other_child = hierarchy.create(other_root, Affine2d::from_trs(vec2(0.f, 5.f)));
+    hierarchy.update();
+    DV_TEST_CHECK(hierarchy.last_update_count() == 2);
+    DV_TEST_CHECK(nearly_equal(hierarchy.world_position(other_child), vec2(0.f, 55.f)));
+    DV_TEST_CHECK(nearly_equal(hierarchy.world_position(grandchild), vec2(214.f, 0.f)));
+
+    // Перемещённое поддерево пересчитывается вместе с потомками
+    hierarchy.set_parent(child, other_root);
+    hierarchy.update();
+    DV_TEST_CHECK(hierarchy.last_update_count() == 2);
+    DV_TEST_CHECK(hierarchy.parent(child) == other_root);
+    DV_TEST_CHECK(nearly_equal(hierarchy.world_position(child), vec2(10.f, 50.f)));
+    DV_TEST_CHECK(nearly_equal(hierarchy.world_position(grandchild), vec2(14.f, 50.f)));
+    DV_TEST_CHECK(nearly_equal(hierarchy.world_position(root), vec2(200.f, 0.f)));
+
+    // Изменение локальной матрицы до перестроения не теряется
+    hierarchy.set_local(root, vec2(300.f, 0.f));
+    NodeId leaf = hierarchy.create(root, Affine2d::from_trs(vec2(1.f, 0.f)));
+    hierarchy.update();
+    DV_TEST_CHECK(nearly_equal(hierarchy.world_position(root), vec2(300.f, 0.f)));
+    DV_TEST_CHECK(nearly_equal(hierarchy.world_position(leaf), vec2(301.f, 0.f)));
+
+    // Удаление узла удаляет потомков и не трогает остальные узлы
+    hierarchy.destroy(child);
+    hierarchy.update();
+    DV_TEST_CHECK(!hierarchy.alive(child));
+    DV_TEST_CHECK(!hierarchy.alive(grandchild));
+    DV_TEST_CHECK(hierarchy.num_nodes() == 4);
+    DV_TEST_CHECK(hierarchy.last_update_count() == 0);
+    DV_TEST_CHECK(nearly_equal(hierarchy.world_position(other_child), vec2(0.f, 55.f)));
+    DV_TEST_CHECK(nearly_equal(hierarchy.world_position(leaf), vec2(301.f, 0.f)));
+
+    // Пакетный apply() совпадает с поштучным
+    NodeId ids[] = {root, other_child, leaf};
+    vec2 sizes[] = {vec2(8.f), vec2(16.f), vec2(4.f, 2.f)};
+    SpriteInstance instances[3];
+    hierarchy.apply(ids, sizes, instances);
+
+    for (i32 i = 0; i < 3; ++i)
+    {
+        SpriteInstance expected;
+        hierarchy.apply(ids[i], sizes[i], expected);
+        DV_TEST_CHECK(nearly_equal(instances[i].position, expected.position));
+        DV_TEST_CHECK(nearly_equal(instances[i].size, expected.size));
+        DV_TEST_CHECK(instances[i].rotation == expected.rotation);
+    }
+
+    return 0;
+}
@@ -0,0 +1,23 @@
+// Copyright (c) the Dviglo project
+// License: MIT
+
+// Общее для тестов
+
+#pragma once
+
+#include <dviglo/fs/log.hpp>
+
+#include <cstdlib> // EXIT_FAILURE
+#include <iostream>
+
+
+// Проверяет условие. При ошибке выводит условие и строку и завершает тест с ненулевым кодом
+#define DV_TEST_CHECK(condition) \
+    do \
+    { \
+        if (!(condition)) \
+        { \
+            std::cerr << __FILE__ << ":" << __LINE__ << ": DV_TEST_CHECK(" #condition ") failed\n"; \
+            std::exit(EXIT_FAILURE); \
+        } \
+    } while (false)
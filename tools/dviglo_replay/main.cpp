@@ -0,0 +1,212 @@
+// Copyright (c) the Dviglo project
+// License: MIT
+
+// Воспроизводит запись SpriteBatch (SpriteBatch::begin_capture()) максимально быстро
+// и выводит в лог время CPU и GPU для каждого кадра записи.
+// Использование: dviglo_replay <файл записи> [-loops N] [-visible]
+//   -loops N  - сколько раз воспроизвести запись (время усредняется), по умолчанию 10
+//   -visible  - показывать окно (по умолчанию окно скрыто и рендеринг идёт только в FBO)
+// Утилита собирается вместе с движком, если включена опция DV_BUILD_REPLAY:
+//   cmake -S . -B build -D DV_BUILD_REPLAY=ON && cmake --build build --target dviglo_replay
+
+#define SDL_MAIN_USE_CALLBACKS
+#include <SDL3/SDL_main.h>
+
+#include <dviglo/gl_utils/fbo.hpp>
+#include <dviglo/graphics/sprite_batch.hpp>
+#include <dviglo/main/application.hpp>
+#include <dviglo/main/engine_params.hpp>
+#include <dviglo/main/main.hpp>
+#include <dviglo/main/timer.hpp>
+
+#include <algorithm>
+
+using namespace dviglo;
+using namespace glm;
+using namespace std;
+
+
+class App : public Application
+{
+private:
+    StrUtf8 capture_path_;
+    i32 num_loops_ = 10;
+    bool visible_ = false;
+
+    unique_ptr<SpriteBatch> sprite_batch_;
+    unique_ptr<SpriteBatchReplay> replay_;
+    unique_ptr<Fbo> fbo_;
+
+    // Запросы времени GPU. Результат запроса читается через num_queries кадров, чтобы не ждать GPU
+    static constexpr i32 num_queries = 4;
+    GLuint queries_[num_queries]{};
+    i32 query_frames_[num_queries]; // Кадр записи, время которого измеряет запрос (-1 - запрос свободен)
+
+    // Число воспроизведённых кадров
+    i64 num_played_ = 0;
+
+    // Суммарное время каждого кадра записи по всем повторам
+    vector<i64> cpu_ns_;
+    vector<i64> gpu_ns_;
+
+    // Сколько раз число выведенных четырёхугольников не совпало с записью
+    i64 num_mismatches_ = 0;
+
+    // Забирает результат запроса, если он использовался
+    void collect_query(i32 index)
+    {
+        if (query_frames_[index] < 0)
+            return;
+
+        GLint64 ns = 0;
+        glGetQueryObjecti64v(queries_[index], GL_QUERY_RESULT, &ns);
+        gpu_ns_[query_frames_[index]] += ns;
+        query_frames_[index] = -1;
+    }
+
+    void report()
+    {
+        for (i32 i = 0; i < num_queries; ++i)
+            collect_query(i);
+
+        f64 total_cpu_ms = 0.0;
+        f64 total_gpu_ms = 0.0;
+        f64 max_cpu_ms = 0.0;
+        f64 max_gpu_ms = 0.0;
+
+        for (size_t i = 0; i < cpu_ns_.size(); ++i)
+        {
+            f64 cpu_ms = (f64)cpu_ns_[i] / num_loops_ / ns_per_ms;
+            f64 gpu_ms = (f64)gpu_ns_[i] / num_loops_ / ns_per_ms;
+            DV_LOG->writef_info("Frame {} | cpu {:.3f} ms | gpu {:.3f} ms", i, cpu_ms, gpu_ms);
+
+            total_cpu_ms += cpu_ms;
+            total_gpu_ms += gpu_ms;
+            max_cpu_ms = std::max(max_cpu_ms, cpu_ms);
+            max_gpu_ms = std::max(max_gpu_ms, gpu_ms);
+        }
+
+        f64 num_frames = (f64)cpu_ns_.size();
+        DV_LOG->writef_info("Replay | {} frames x {} loops | cpu avg {:.3f} ms, max {:.3f} ms | gpu avg {:.3f} ms, max {:.3f} ms",
+                            cpu_ns_.size(), num_loops_, total_cpu_ms / num_frames, max_cpu_ms,
+                            total_gpu_ms / num_frames, max_gpu_ms);
+
+        if (num_mismatches_ > 0)
+            DV_LOG->writef_error("Replay | quad count differs from the capture in {} frames", num_mismatches_);
+    }
+
+public:
+    App(const vector<StrUtf8>& args)
+        : Application(args)
+    {
+        for (size_t i = 1; i < args.size(); ++i)
+        {
+            if (args[i] == "-loops" && i + 1 < args.size())
+                num_loops_ = std::max((i32)to_u64(args[++i]), 1);
+            else if (args[i] == "-visible")
+                visible_ = true;
+            else if (args[i].length() > 0 && args[i][0] != '-')
+                capture_path_ = args[i];
+        }
+
+        fill(begin(query_frames_), end(query_frames_), -1);
+    }
+
+    void setup() override
+    {
+        engine_params::log_path = "dviglo_replay.log";
+        engine_params::window_title = "dviglo_replay";
+        engine_params::window_hidden = !visible_;
+        engine_params::vsync = 0; // Воспроизводим максимально быстро
+    }
+
+    void start() override
+    {
+        if (capture_path_.empty())
+        {
+            DV_LOG->write_error("Usage: dviglo_replay <capture file> [-loops N] [-visible]");
+            should_exit_ = true;
+            return;
+        }
+
+        sprite_batch_ = make_unique<SpriteBatch>();
+        replay_ = make_unique<SpriteBatchReplay>(capture_path_);
+
+        if (!replay_->is_loaded())
+        {
+            DV_LOG->writef_error("Can not load \"{}\"", capture_path_);
+            should_exit_ = true;
+            return;
+        }
+
+        fbo_ = make_unique<Fbo>(replay_->target_size(), true);
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+        glGenQueries(num_queries, queries_);
+
+        cpu_ns_.resize(replay_->num_frames(), 0);
+        gpu_ns_.resize(replay_->num_frames(), 0);
+
+        DV_LOG->writef_info("Replaying \"{}\" | {} frames x {} loops", capture_path_, replay_->num_frames(), num_loops_);
+    }
+
+    ~App() override
+    {
+        if (queries_[0])
+            glDeleteQueries(num_queries, queries_);
+    }
+
+    void draw() override
+    {
+        if (!replay_ || !replay_->is_loaded())
+            return;
+
+        i32 frame_index = (i32)(num_played_ % replay_->num_frames());
+        i32 query_index = (i32)(num_played_ % num_queries);
+        collect_query(query_index);
+
+        ivec2 target_size = replay_->target_size();
+        fbo_->bind();
+        glViewport(0, 0, target_size.x, target_size.y);
+        glClearColor(0.f, 0.f, 0.f, 1.f);
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+        i64 start_ns = get_ticks_ns();
+        glBeginQuery(GL_TIME_ELAPSED, queries_[query_index]);
+
+        if (!replay_->play_frame(frame_index, sprite_batch_.get()))
+        {
+            if (num_mismatches_ == 0)
+                DV_LOG->writef_error("Frame {} | quad count differs from the capture", frame_index);
+
+            ++num_mismatches_;
+        }
+
+        glEndQuery(GL_TIME_ELAPSED);
+        cpu_ns_[frame_index] += get_ticks_ns() - start_ns;
+        query_frames_[query_index] = frame_index;
+
+        // Показываем результат, если окно видимо
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, fbo_->gpu_object_name());
+        glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+
+        if (visible_)
+        {
+            ivec2 window_size;
+            SDL_GetWindowSizeInPixels(DV_OS_WINDOW->window(), &window_size.x, &window_size.y);
+            glBlitFramebuffer(0, 0, target_size.x, target_size.y, 0, 0, window_size.x, window_size.y,
+                              GL_COLOR_BUFFER_BIT, GL_LINEAR);
+        }
+
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+        if (++num_played_ == (i64)replay_->num_frames() * num_loops_)
+        {
+            report();
+            should_exit_ = true;
+        }
+    }
+};
+
+
+DV_DEFINE_APP(App)